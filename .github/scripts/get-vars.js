@@ -77,6 +77,9 @@ if (!isGitTag) {
     .pop()
     .replace(/[^a-zA-Z0-9-]/g, '-');
 
+  // Cut to the firmware's prerelease capacity (SemVer::MaxPrereleaseLength in include/SemVer.h), longer versions fail to compile
+  sanitizedGitHeadRefName = sanitizedGitHeadRefName.slice(0, 63);
+
   // Remove leading and trailing dashes
   sanitizedGitHeadRefName = sanitizedGitHeadRefName.replace(/^\-+|\-+$/g, '');
 
@@ -201,9 +204,9 @@ if (versionChangeLog !== '') {
 // Parse platformio.ini and extract the different boards
 const platformioIni = ini.parse(platformioIniStr);
 
-// Get every key that starts with "env:", and that isnt "env:fs" (which is the filesystem) or "env:ci-build" (which is for CI CodeQL and cppcheck)
+// Get every key that starts with "env:", and that isnt "env:fs" (which is the filesystem), "env:ci-build" (which is for CI CodeQL and cppcheck) or "env:native*" (which are for host unit tests)
 const boards = Object.keys(platformioIni)
-  .filter((key) => key.startsWith('env:') && key !== 'env:fs' && key !== 'env:ci-build')
+  .filter((key) => key.startsWith('env:') && key !== 'env:fs' && key !== 'env:ci-build' && !key.startsWith('env:native'))
   .reduce((arr, key) => {
     arr.push(key.substring(4));
     return arr;
@@ -0,0 +1,211 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <type_traits>
+
+// Deferred binary logging, enabled by building with OPENSHOCK_LOG_BINARY=1.
+//
+// OS_LOG* call sites don't format anything, they copy the address of their format string, a timestamp and their raw arguments
+// into a lock-free ring buffer for the core they run on. A low-priority task drains the buffers to a sink (serial by default),
+// and scripts/decode_binary_log.py formats the records on the host by looking the format strings up in the firmware ELF.
+//
+// Every record is sent as a COBS frame preceded and terminated by 0x00, decoded it is laid out as:
+//   [format address: u32][timestamp us: i64][core: u8][arguments][crc32: u32, over everything before it]
+// Each argument is a type byte followed by its value:
+//   U32/U64: the raw integer, F64: a double, Ptr: a u32 address,
+//   RomStr: the u32 address of a string in flash, RamStr: a u8 length followed by the string bytes (truncated to MaxStringLength).
+// A record with format address 0 reports records dropped on a full buffer, its only argument is the drop count.
+// All values are little-endian. Text written to serial by anything else ends up between frames, it fails the CRC.
+namespace OpenShock::BinaryLog {
+  enum class ArgType : uint8_t {
+    U32    = 1,
+    U64    = 2,
+    F64    = 3,
+    Ptr    = 4,
+    RomStr = 5,
+    RamStr = 6,
+  };
+
+  const std::size_t MaxRecordSize   = 256;  // Larger records are dropped
+  const std::size_t MaxStringLength = 64;
+
+  /// @brief Marks a string that lives in flash for the lifetime of the firmware (literals, TAG, __FUNCTION__), only its address is logged
+  struct RomString {
+    const char* str;
+  };
+
+  using Sink = std::function<void(const uint8_t* data, std::size_t len)>;
+
+  /// @brief Starts the drain task, records written before this are kept in the buffers until then
+  bool Init();
+
+  /// @brief Replaces where drained frames are written, defaults to serial. Must be called before Init()
+  void SetSink(Sink sink);
+
+  /// @brief Returns a bitmask of the arguments of a printf format that are strings bounded by a "%.*s" precision
+  template<std::size_t N>
+  constexpr uint32_t PrecisionStringMask(const char (&format)[N])
+  {
+    uint32_t mask   = 0;
+    std::size_t arg = 0;
+
+    for (std::size_t i = 0; i + 1 < N; i++) {
+      if (format[i] != '%') {
+        continue;
+      }
+
+      if (format[++i] == '%') {
+        continue;
+      }
+
+      bool boundedByPrecision = false;
+      for (; i + 1 < N; i++) {
+        char c = format[i];
+        if (c == '*') {
+          boundedByPrecision = format[i - 1] == '.';
+          arg++;
+          continue;
+        }
+
+        if (c == 'd' || c == 'i' || c == 'o' || c == 'u' || c == 'x' || c == 'X' || c == 'e' || c == 'E' || c == 'f' || c == 'F' || c == 'g' || c == 'G' || c == 'a' || c == 'A' || c == 'c' || c == 's' || c == 'p' || c == 'n') {
+          if (c == 's' && boundedByPrecision && arg < 32) {
+            mask |= 1U << arg;
+          }
+          arg++;
+          break;
+        }
+      }
+    }
+
+    return mask;
+  }
+
+  namespace Internal {
+    struct Reservation {
+      uint8_t* record;  // Start of the record in the ring buffer, its first word commits it
+      uint32_t size;
+    };
+
+    /// @brief Reserves space for a record in the current core's buffer and fills in its header, returns false if the buffer is full
+    bool BeginRecord(const char* format, std::size_t argsSize, Reservation& reservation);
+    /// @brief Returns where the arguments of a reserved record go
+    uint8_t* RecordArgs(const Reservation& reservation);
+    /// @brief Publishes a reserved record to the drain task
+    void CommitRecord(const Reservation& reservation);
+
+    template<bool Measure>
+    class ArgWriter {
+    public:
+      ArgWriter(uint32_t precisionStrings, uint8_t* stringLengths, uint8_t* out)
+        : m_precisionStrings(precisionStrings)
+        , m_stringLengths(stringLengths)
+        , m_out(out)
+        , m_size(0)
+        , m_index(0)
+        , m_lastInt(0)
+      {
+      }
+
+      std::size_t size() const { return m_size; }
+
+      template<typename T>
+      void add(T value)
+      {
+        if constexpr (std::is_same_v<T, RomString>) {
+          put(ArgType::RomStr, static_cast<uint32_t>(reinterpret_cast<uintptr_t>(value.str)));
+        } else if constexpr (std::is_pointer_v<T> && (std::is_same_v<std::remove_cv_t<std::remove_pointer_t<T>>, char> || std::is_same_v<std::remove_cv_t<std::remove_pointer_t<T>>, unsigned char> || std::is_same_v<std::remove_cv_t<std::remove_pointer_t<T>>, signed char>)) {
+          putString(reinterpret_cast<const char*>(value));
+        } else if constexpr (std::is_null_pointer_v<T>) {
+          put(ArgType::Ptr, static_cast<uint32_t>(0));
+        } else if constexpr (std::is_pointer_v<T>) {
+          put(ArgType::Ptr, static_cast<uint32_t>(reinterpret_cast<uintptr_t>(value)));
+        } else if constexpr (std::is_floating_point_v<T>) {
+          put(ArgType::F64, static_cast<double>(value));
+        } else if constexpr (std::is_enum_v<T>) {
+          addInteger(static_cast<std::underlying_type_t<T>>(value));
+        } else {
+          static_assert(std::is_integral_v<T>, "Unsupported log argument type");
+          addInteger(value);
+        }
+
+        m_index++;
+      }
+
+    private:
+      template<typename T>
+      void addInteger(T value)
+      {
+        if constexpr (sizeof(T) > sizeof(uint32_t)) {
+          put(ArgType::U64, static_cast<uint64_t>(value));
+        } else {
+          // Promoted like a vararg, so "%hhi" of a negative int8_t decodes the same as it prints
+          uint32_t promoted = static_cast<uint32_t>(static_cast<std::conditional_t<std::is_signed_v<T>, int32_t, uint32_t>>(value));
+          m_lastInt         = static_cast<int32_t>(promoted);
+          put(ArgType::U32, promoted);
+        }
+      }
+
+      template<typename V>
+      void put(ArgType type, V value)
+      {
+        if constexpr (!Measure) {
+          m_out[m_size] = static_cast<uint8_t>(type);
+          memcpy(m_out + m_size + 1, &value, sizeof(V));
+        }
+        m_size += 1 + sizeof(V);
+      }
+
+      void putString(const char* str)
+      {
+        // Lengths are measured once, a string changing before the record is written can't overflow its reservation
+        std::size_t len;
+        if constexpr (Measure) {
+          len = 0;
+          if (str != nullptr) {
+            std::size_t limit = MaxStringLength;
+            if (m_index < 32 && (m_precisionStrings & (1U << m_index)) != 0 && m_lastInt >= 0 && static_cast<std::size_t>(m_lastInt) < limit) {
+              limit = static_cast<std::size_t>(m_lastInt);
+            }
+            len = strnlen(str, limit);
+          }
+          m_stringLengths[m_index] = static_cast<uint8_t>(len);
+        } else {
+          len = m_stringLengths[m_index];
+          m_out[m_size]     = static_cast<uint8_t>(ArgType::RamStr);
+          m_out[m_size + 1] = static_cast<uint8_t>(len);
+          memcpy(m_out + m_size + 2, str, len);
+        }
+        m_size += 2 + len;
+      }
+
+      uint32_t m_precisionStrings;
+      uint8_t* m_stringLengths;  // Indexed by argument
+      uint8_t* m_out;
+      std::size_t m_size;
+      std::size_t m_index;
+      int32_t m_lastInt;  // Precision of a following "%.*s"
+    };
+  }  // namespace Internal
+
+  template<uint32_t PrecisionStrings, typename... Args>
+  void Write(const char* format, Args... args)
+  {
+    uint8_t stringLengths[sizeof...(Args) + 1];
+
+    Internal::ArgWriter<true> measure(PrecisionStrings, stringLengths, nullptr);
+    (measure.add(args), ...);
+
+    Internal::Reservation reservation;
+    if (!Internal::BeginRecord(format, measure.size(), reservation)) {
+      return;
+    }
+
+    Internal::ArgWriter<false> writer(PrecisionStrings, stringLengths, Internal::RecordArgs(reservation));
+    (writer.add(args), ...);
+
+    Internal::CommitRecord(reservation);
+  }
+}  // namespace OpenShock::BinaryLog
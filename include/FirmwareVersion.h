@@ -0,0 +1,21 @@
+#pragma once
+
+#include "Common.h"
+#include "SemVer.h"
+
+namespace OpenShock {
+  static_assert(
+    [] {
+      SemVer version;
+      return TryParseSemVer(OPENSHOCK_FW_VERSION, version);
+    }(),
+    "OPENSHOCK_FW_VERSION must be a valid semantic version, with prerelease and build of at most SemVer::MaxPrereleaseLength and SemVer::MaxBuildLength characters"
+  );
+
+  /// @brief Version of the running firmware, parsed from OPENSHOCK_FW_VERSION at compile time
+  inline constexpr SemVer FirmwareVersion = [] {
+    SemVer version;
+    TryParseSemVer(OPENSHOCK_FW_VERSION, version);
+    return version;
+  }();
+}  // namespace OpenShock
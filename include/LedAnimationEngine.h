@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
+// Drives every LED pattern from a single one-shot esp_timer that is re-armed for whichever channel needs the next frame.
+// Frames are rendered in the timer callback itself, a frame is one RMT write of 24 bits per LED (30 us for the single status LED) or a GPIO level,
+// which costs the esp_timer task less than the 4 KB stack a dedicated render task would need.
+// Patterns don't own a task, changing one only swaps its steps and makes its next frame due immediately.
+namespace OpenShock::LedAnimationEngine {
+  class Channel {
+  public:
+    virtual ~Channel() = default;
+
+    /// @brief Outputs the frame due at the given time, only called by the engine while it holds its lock
+    /// @param now Microseconds since boot
+    /// @return Time of the next frame in microseconds since boot, or -1 if there is nothing left to show
+    virtual int64_t renderFrame(int64_t now) = 0;
+  };
+
+  bool Attach(Channel* channel);
+  void Detach(Channel* channel);
+
+  /// @brief Runs fn while holding the engine lock, then has the timer render the channel as soon as possible
+  void Update(Channel* channel, const std::function<void()>& fn);
+}  // namespace OpenShock::LedAnimationEngine
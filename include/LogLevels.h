@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Runtime log levels per TAG, on top of the compile-time ceiling set by OPENSHOCK_LOG_LEVEL.
+//
+// Every translation unit that logs gets its own TagBinding (see Logging.h). The first log call of the unit interns its TAG,
+// after which the binding's level byte is kept in sync with the level set for that TAG, so an OS_LOG* call only costs a single
+// load and compare before anything is formatted. Levels above OPENSHOCK_LOG_LEVEL are still compiled out.
+namespace OpenShock::LogLevels {
+  const uint8_t MaxTags = 128;
+
+  /// @brief Level of a TAG that has no level of its own and follows the default level
+  const uint8_t Inherit = 0xFF;
+
+  struct TagBinding {
+    uint8_t level;  // Effective level, the only field read on the logging path
+    uint8_t tagId;  // 0 until the TAG has been interned
+    TagBinding* next;
+  };
+
+  struct TagLevel {
+    std::string tag;
+    uint8_t level;  // Inherit if the TAG follows the default level
+  };
+
+  /// @brief Interns the TAG of a translation unit and links its binding, called by the first log call of the unit
+  /// @return The effective level of the TAG
+  uint8_t Bind(TagBinding& binding, const char* tag);
+
+  /// @brief Loads the levels persisted in config, TAGs that haven't logged yet pick them up when they do
+  bool Init();
+
+  uint8_t GetDefaultLevel();
+  bool SetDefaultLevel(uint8_t level);
+
+  /// @brief Sets the level of a TAG, which doesn't have to have logged yet. Inherit makes it follow the default level again
+  bool SetLevel(std::string_view tag, uint8_t level);
+
+  /// @brief Returns every known TAG with its own level (Inherit if it has none)
+  std::vector<TagLevel> GetLevels();
+
+  /// @brief Removes every TAG level and restores the default level
+  void Reset();
+
+  /// @brief Writes the default level and every TAG level to config, restored by Init() on the next boot
+  bool Persist();
+
+  const char* LevelToString(uint8_t level);
+  bool LevelFromString(std::string_view str, uint8_t& out);
+}  // namespace OpenShock::LogLevels
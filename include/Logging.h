@@ -1,5 +1,6 @@
 #pragma once
 
+#include "LogLevels.h"
 #include "Time.h"
 
 #include <esp32-hal-uart.h>
@@ -31,43 +32,75 @@ constexpr const char* openshockPathToFileName(const char (&path)[N]) {
 
 #define OPENSHOCK_LOG_FORMAT(letter, format) "[%lli][" #letter "][%s:%u] %s(): " format "\r\n", OpenShock::millis(), openshockPathToFileName(__FILE__), __LINE__, __FUNCTION__
 
+#if OPENSHOCK_LOG_BINARY
+#include "BinaryLog.h"
+
+// Same layout as OPENSHOCK_LOG_FORMAT, the timestamp is part of the record header
+#define OPENSHOCK_LOG_BINARY_FORMAT(letter, format) "[" #letter "][%s:%u] %s(): [%s] " format "\r\n"
+#define OPENSHOCK_LOG_BINARY_WRITE(letter, TAG, format, ...)                                                           \
+  OpenShock::BinaryLog::Write<OpenShock::BinaryLog::PrecisionStringMask(OPENSHOCK_LOG_BINARY_FORMAT(letter, format))>( \
+    OPENSHOCK_LOG_BINARY_FORMAT(letter, format),                                                                       \
+    OpenShock::BinaryLog::RomString {openshockPathToFileName(__FILE__)},                                               \
+    __LINE__,                                                                                                          \
+    OpenShock::BinaryLog::RomString {__FUNCTION__},                                                                    \
+    OpenShock::BinaryLog::RomString {TAG},                                                                             \
+    ##__VA_ARGS__)
+#define OPENSHOCK_LOG_WRITE(letter, TAG, format, ...) OPENSHOCK_LOG_BINARY_WRITE(letter, TAG, format, ##__VA_ARGS__)
+#else
+#define OPENSHOCK_LOG_WRITE(letter, TAG, format, ...) log_printf(OPENSHOCK_LOG_FORMAT(letter, "[%s] " format), TAG, ##__VA_ARGS__)
+#endif
+
+// Every OS_LOG* call of a translation unit uses the TAG of that unit, so each unit binds its TAG once (see LogLevels.h)
+[[maybe_unused]] static OpenShock::LogLevels::TagBinding openshockLogTagBinding__ = {OPENSHOCK_LOG_LEVEL, 0, nullptr};
+
+// Single load and compare once bound, the TAG is interned by the first call that passes the compile-time ceiling
+#define OPENSHOCK_LOG_ENABLED(TAG, minLevel) (openshockLogTagBinding__.level >= (minLevel) && (openshockLogTagBinding__.tagId != 0 || OpenShock::LogLevels::Bind(openshockLogTagBinding__, TAG) >= (minLevel)))
+#define OPENSHOCK_LOG_FILTERED(minLevel, letter, TAG, format, ...) \
+  do {                                                             \
+    if (OPENSHOCK_LOG_ENABLED(TAG, minLevel)) {                    \
+      OPENSHOCK_LOG_WRITE(letter, TAG, format, ##__VA_ARGS__);     \
+    }                                                              \
+  } while (0)
+
 #if OPENSHOCK_LOG_LEVEL >= OPENSHOCK_LOG_LEVEL_VERBOSE
-#define OS_LOGV(TAG, format, ...) log_printf(OPENSHOCK_LOG_FORMAT(V, "[%s] " format), TAG, ##__VA_ARGS__)
+#define OS_LOGV(TAG, format, ...) OPENSHOCK_LOG_FILTERED(OPENSHOCK_LOG_LEVEL_VERBOSE, V, TAG, format, ##__VA_ARGS__)
 #else
 #define OS_LOGV(TAG, format, ...)  do {} while(0)
 #endif
 
 #if OPENSHOCK_LOG_LEVEL >= OPENSHOCK_LOG_LEVEL_DEBUG
-#define OS_LOGD(TAG, format, ...) log_printf(OPENSHOCK_LOG_FORMAT(D, "[%s] " format), TAG, ##__VA_ARGS__)
+#define OS_LOGD(TAG, format, ...) OPENSHOCK_LOG_FILTERED(OPENSHOCK_LOG_LEVEL_DEBUG, D, TAG, format, ##__VA_ARGS__)
 #else
 #define OS_LOGD(TAG, format, ...)  do {} while(0)
 #endif
 
 #if OPENSHOCK_LOG_LEVEL >= OPENSHOCK_LOG_LEVEL_INFO
-#define OS_LOGI(TAG, format, ...) log_printf(OPENSHOCK_LOG_FORMAT(I, "[%s] " format), TAG, ##__VA_ARGS__)
+#define OS_LOGI(TAG, format, ...) OPENSHOCK_LOG_FILTERED(OPENSHOCK_LOG_LEVEL_INFO, I, TAG, format, ##__VA_ARGS__)
 #else
 #define OS_LOGI(TAG, format, ...) do {} while(0)
 #endif
 
 #if OPENSHOCK_LOG_LEVEL >= OPENSHOCK_LOG_LEVEL_WARN
-#define OS_LOGW(TAG, format, ...) log_printf(OPENSHOCK_LOG_FORMAT(W, "[%s] " format), TAG, ##__VA_ARGS__)
+#define OS_LOGW(TAG, format, ...) OPENSHOCK_LOG_FILTERED(OPENSHOCK_LOG_LEVEL_WARN, W, TAG, format, ##__VA_ARGS__)
 #else
 #define OS_LOGW(TAG, format, ...) do {} while(0)
 #endif
 
 #if OPENSHOCK_LOG_LEVEL >= OPENSHOCK_LOG_LEVEL_ERROR
-#define OS_LOGE(TAG, format, ...) log_printf(OPENSHOCK_LOG_FORMAT(E, "[%s] " format), TAG, ##__VA_ARGS__)
+#define OS_LOGE(TAG, format, ...) OPENSHOCK_LOG_FILTERED(OPENSHOCK_LOG_LEVEL_ERROR, E, TAG, format, ##__VA_ARGS__)
 #else
 #define OS_LOGE(TAG, format, ...) do {} while(0)
 #endif
 
+// Not filtered at runtime, a TAG set to none still prints these
 #if OPENSHOCK_LOG_LEVEL >= OPENSHOCK_LOG_LEVEL_NONE
-#define OS_LOGN(TAG, format, ...) log_printf(OPENSHOCK_LOG_FORMAT(E, "[%s] " format), TAG, ##__VA_ARGS__)
+#define OS_LOGN(TAG, format, ...) OPENSHOCK_LOG_WRITE(E, TAG, format, ##__VA_ARGS__)
 #else
 #define OS_LOGN(TAG, format, ...) do {} while(0)
 #endif
 
-#define OS_PANIC_PRINT(TAG, format, ...) OS_LOGE(TAG, "PANIC: " format, ##__VA_ARGS__)
+// Always printed synchronously, the device restarts before a deferred record would be drained
+#define OS_PANIC_PRINT(TAG, format, ...) log_printf(OPENSHOCK_LOG_FORMAT(E, "[%s] PANIC: " format), TAG, ##__VA_ARGS__)
 
 #define OS_PANIC(TAG, format, ...)                                           \
   OS_PANIC_PRINT(TAG, format ", restarting in 5 seconds...", ##__VA_ARGS__); \
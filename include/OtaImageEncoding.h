@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+
+namespace OpenShock {
+  /// @brief Transfer encoding of a firmware release artifact, as advertised by the release's hashes.sha256.txt
+  enum class OtaImageEncoding : uint8_t {
+    Raw,   // e.g. app.bin
+    Gzip,  // e.g. app.bin.gz, decompressed on the fly before being written to flash
+  };
+
+  inline const char* OtaImageEncodingToString(OtaImageEncoding encoding) {
+    switch (encoding) {
+      case OtaImageEncoding::Raw:
+        return "raw";
+      case OtaImageEncoding::Gzip:
+        return "gzip";
+      default:
+        return "unknown";
+    }
+  }
+}  // namespace OpenShock
@@ -1,11 +1,13 @@
 #pragma once
 
 #include "FirmwareBootType.h"
+#include "OtaImageEncoding.h"
 #include "OtaUpdateChannel.h"
 #include "SemVer.h"
 
 #include <array>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
@@ -14,13 +16,15 @@ namespace OpenShock::OtaUpdateManager {
 
   struct FirmwareRelease {
     std::string appBinaryUrl;
-    uint8_t appBinaryHash[32];
+    uint8_t appBinaryHash[32];  // Hash of the decompressed image
+    OtaImageEncoding appBinaryEncoding;
+    std::string appPatchUrl;  // Delta patch from the running firmware version, empty if the release has none
     std::string filesystemBinaryUrl;
-    uint8_t filesystemBinaryHash[32];
+    uint8_t filesystemBinaryHash[32];  // Hash of the decompressed image
+    OtaImageEncoding filesystemBinaryEncoding;
   };
 
   bool TryGetFirmwareVersion(OtaUpdateChannel channel, OpenShock::SemVer& version);
-  bool TryGetFirmwareBoards(const OpenShock::SemVer& version, std::vector<std::string>& boards);
   bool TryGetFirmwareRelease(const OpenShock::SemVer& version, FirmwareRelease& release);
 
   bool TryStartFirmwareInstallation(const OpenShock::SemVer& version);
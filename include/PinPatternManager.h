@@ -1,17 +1,15 @@
 #pragma once
 
 #include "Common.h"
-#include "SimpleMutex.h"
+#include "LedAnimationEngine.h"
 
 #include <hal/gpio_types.h>
 
-#include <freertos/task.h>
-
 #include <cstdint>
 #include <vector>
 
 namespace OpenShock {
-  class PinPatternManager {
+  class PinPatternManager : private LedAnimationEngine::Channel {
     DISABLE_COPY(PinPatternManager);
 
   public:
@@ -35,12 +33,11 @@ namespace OpenShock {
     void ClearPattern();
 
   private:
-    void ClearPatternInternal();
-    void RunPattern();
+    int64_t renderFrame(int64_t now) override;
 
     gpio_num_t m_gpioPin;
     std::vector<State> m_pattern;
-    TaskHandle_t m_taskHandle;
-    SimpleMutex m_taskMutex;
+    std::size_t m_stepIndex;
+    int64_t m_stepStart;  // -1 until the first frame of the pattern is shown
   };
 }  // namespace OpenShock
@@ -1,24 +1,23 @@
 #pragma once
 
 #include "Common.h"
-#include "SimpleMutex.h"
+#include "LedAnimationEngine.h"
 
 #include <hal/gpio_types.h>
 
-#include <freertos/task.h>
-
 #include <esp32-hal-rmt.h>
 
 #include <cstdint>
 #include <vector>
 
 namespace OpenShock {
-  class RGBPatternManager {
+  /// @brief Shows colour patterns on a chain of WS2812B LEDs, all LEDs in the chain show the same colour
+  class RGBPatternManager : private LedAnimationEngine::Channel {
     DISABLE_COPY(RGBPatternManager);
 
   public:
     RGBPatternManager() = delete;
-    RGBPatternManager(gpio_num_t gpioPin);
+    RGBPatternManager(gpio_num_t gpioPin, uint16_t ledCount);
     ~RGBPatternManager();
 
     bool IsValid() const { return m_gpioPin != GPIO_NUM_NC; }
@@ -28,6 +27,7 @@ namespace OpenShock {
       uint8_t green;
       uint8_t blue;
       uint32_t duration;
+      uint32_t fade;  // Part of the duration spent fading in from the previous state's colour, 0 switches instantly
     };
 
     void SetPattern(const RGBState* pattern, std::size_t patternLength);
@@ -40,14 +40,19 @@ namespace OpenShock {
     void ClearPattern();
 
   private:
-    void ClearPatternInternal();
-    static void RunPattern(void* arg);
+    int64_t renderFrame(int64_t now) override;
+    void encodePattern();
+    void transmit(const rmt_data_t* ledData);
 
     gpio_num_t m_gpioPin;
+    uint16_t m_ledCount;
     uint8_t m_brightness;  // 0-255
     std::vector<RGBState> m_pattern;
+    std::vector<rmt_data_t> m_encodedPattern;  // 24 RMT items per state, encoded once when the pattern or brightness changes
+    std::vector<rmt_data_t> m_txBuffer;        // One frame for the whole chain
     rmt_obj_t* m_rmtHandle;
-    TaskHandle_t m_taskHandle;
-    SimpleMutex m_taskMutex;
+    std::size_t m_stepIndex;
+    int64_t m_stepStart;  // -1 until the first frame of the pattern is shown
+    bool m_stepShown;     // Whether the steady colour of the current step has been sent
   };
 }  // namespace OpenShock
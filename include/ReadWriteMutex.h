@@ -4,12 +4,48 @@
 
 #include "Common.h"
 
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// Define as 1 to collect wait and hold times of every named ReadWriteMutex, listed by the sysinfo serial command
+#ifndef OPENSHOCK_RWMUTEX_METRICS
+#define OPENSHOCK_RWMUTEX_METRICS 0
+#endif
+
+// Define as 1 to panic when a task takes a lock it already holds instead of deadlocking, debug builds enable it (see scripts/embed_env_vars.py)
+#ifndef OPENSHOCK_RWMUTEX_CHECK_REENTRY
+#define OPENSHOCK_RWMUTEX_CHECK_REENTRY 0
+#endif
+
+#if OPENSHOCK_RWMUTEX_CHECK_REENTRY
+#include <freertos/task.h>
+#endif
+
 namespace OpenShock {
+  /// @brief Reader-writer lock whose uncontended paths are a single atomic operation, tasks only block on its semaphores under contention.
+  /// A waiting writer holds off new readers, a released writer lets the readers that queued behind it in before the next writer.
+  /// Not recursive, taking a read lock while holding one can deadlock against a waiting writer. With OPENSHOCK_RWMUTEX_CHECK_REENTRY such a nested lock panics right away.
   class ReadWriteMutex {
     DISABLE_COPY(ReadWriteMutex);
     DISABLE_MOVE(ReadWriteMutex);
   public:
+    struct Metrics {
+      uint32_t readLocks;
+      uint32_t readContended;  // Read locks that had to wait
+      uint64_t readWaitUs;
+      uint64_t readHeldUs;  // Time at least one reader held the lock
+      uint32_t writeLocks;
+      uint32_t writeContended;
+      uint64_t writeWaitUs;
+      uint32_t writeWaitMaxUs;
+      uint64_t writeHeldUs;
+      uint32_t writeHeldMaxUs;
+    };
+
     ReadWriteMutex();
+    /// @param name Lists the mutex in GetAllMetrics() when metrics are enabled
+    ReadWriteMutex(const char* name);
     ~ReadWriteMutex();
 
     bool lockRead(TickType_t xTicksToWait);
@@ -17,10 +53,63 @@ namespace OpenShock {
 
     bool lockWrite(TickType_t xTicksToWait);
     void unlockWrite();
+
+    const char* name() const { return m_name; }
+
+#if OPENSHOCK_RWMUTEX_METRICS
+    Metrics getMetrics() const;
+    void resetMetrics();
+
+    struct NamedMetrics {
+      const char* name;
+      Metrics metrics;
+    };
+
+    static std::vector<NamedMetrics> GetAllMetrics();
+#endif
   private:
-    SemaphoreHandle_t m_mutex;
-    SemaphoreHandle_t m_readSem;
-    int m_readers;
+    bool lockReadSlow(TickType_t xTicksToWait);
+    void unlockReadSlow();
+    bool lockWriteSlow(TickType_t xTicksToWait);
+    void unlockWriteSlow();
+    void grant(uint32_t readers, bool writer);
+
+    const char* m_name;
+    std::atomic<uint32_t> m_state;   // Active readers, writer bit, and counts of waiting writers and readers
+    SemaphoreHandle_t m_readerGate;  // One token per waiting reader let in
+    SemaphoreHandle_t m_writerGate;  // One token per waiting writer let in
+
+#if OPENSHOCK_RWMUTEX_CHECK_REENTRY
+    void checkNotHeld(const char* lockType) const;
+    void addReaderTask();
+    void removeReaderTask();
+
+    std::atomic<TaskHandle_t> m_writerTask;
+    std::atomic<TaskHandle_t> m_readerTasks[8];  // Readers past the first 8 at once go unchecked
+#endif
+
+#if OPENSHOCK_RWMUTEX_METRICS
+    void addReadWait(int64_t since);
+    void addWriteWait(int64_t since);
+    void onReadersEntered(int64_t now);
+    void onReadersLeft();
+    void onWriterEntered();
+    void onWriterLeft();
+
+    std::atomic<uint32_t> m_readLocks;
+    std::atomic<uint32_t> m_readContended;
+    std::atomic<uint64_t> m_readWaitUs;
+    std::atomic<uint64_t> m_readHeldUs;
+    std::atomic<int64_t> m_readersSince;
+    std::atomic<uint32_t> m_writeLocks;
+    std::atomic<uint32_t> m_writeContended;
+    std::atomic<uint64_t> m_writeWaitUs;
+    std::atomic<uint32_t> m_writeWaitMaxUs;
+    std::atomic<uint64_t> m_writeHeldUs;
+    std::atomic<uint32_t> m_writeHeldMaxUs;
+    int64_t m_writerSince;  // Only touched by the writer holding the lock
+    ReadWriteMutex* m_nextNamed;
+#endif
   };
 
   class ScopedReadLock {
@@ -1,18 +1,246 @@
 #pragma once
 
+#include <array>
 #include <cstdint>
-#include <string>
 #include <string_view>
 
 namespace OpenShock {
+  namespace Internal {
+    // std::string_view::find and compare are not usable in constant expressions on member arrays with every GCC, so these stay hand written
+    constexpr std::size_t _semverFind(std::string_view str, char c, std::size_t pos = 0)
+    {
+      for (std::size_t i = pos; i < str.length(); i++) {
+        if (str[i] == c) {
+          return i;
+        }
+      }
+
+      return std::string_view::npos;
+    }
+    constexpr int _semverCompareChars(std::string_view a, std::string_view b)
+    {
+      std::size_t length = a.length() < b.length() ? a.length() : b.length();
+      for (std::size_t i = 0; i < length; i++) {
+        if (a[i] != b[i]) {
+          return static_cast<unsigned char>(a[i]) < static_cast<unsigned char>(b[i]) ? -1 : 1;
+        }
+      }
+
+      return a.length() == b.length() ? 0 : (a.length() < b.length() ? -1 : 1);
+    }
+    // https://semver.org/#backusnaur-form-grammar-for-valid-semver-versions
+    constexpr bool _semverIsLetter(char c)
+    {
+      return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+    }
+    constexpr bool _semverIsPositiveDigit(char c)
+    {
+      return c >= '1' && c <= '9';
+    }
+    constexpr bool _semverIsDigit(char c)
+    {
+      return c == '0' || _semverIsPositiveDigit(c);
+    }
+    constexpr bool _semverIsDigits(std::string_view str)
+    {
+      if (str.empty()) {
+        return false;
+      }
+
+      for (auto c : str) {
+        if (!_semverIsDigit(c)) {
+          return false;
+        }
+      }
+
+      return true;
+    }
+    constexpr bool _semverIsNonDigit(char c)
+    {
+      return _semverIsLetter(c) || c == '-';
+    }
+    constexpr bool _semverIsIdentifierChararacter(char c)
+    {
+      return _semverIsDigit(c) || _semverIsNonDigit(c);
+    }
+    constexpr bool _semverIsIdentifierChararacters(std::string_view str)
+    {
+      if (str.empty()) {
+        return false;
+      }
+
+      for (auto c : str) {
+        if (!_semverIsIdentifierChararacter(c)) {
+          return false;
+        }
+      }
+
+      return true;
+    }
+    constexpr bool _semverIsNumericIdentifier(std::string_view str)
+    {
+      if (str.empty()) {
+        return false;
+      }
+
+      if (str.length() == 1) {
+        return _semverIsDigit(str[0]);
+      }
+
+      return _semverIsPositiveDigit(str[0]) && _semverIsDigits(str.substr(1));
+    }
+    constexpr bool _semverIsAlphanumericIdentifier(std::string_view str)
+    {
+      // Identifier characters with at least one non-digit
+      if (!_semverIsIdentifierChararacters(str)) {
+        return false;
+      }
+
+      for (auto c : str) {
+        if (_semverIsNonDigit(c)) {
+          return true;
+        }
+      }
+
+      return false;
+    }
+    constexpr bool _semverIsBuildIdentifier(std::string_view str)
+    {
+      return _semverIsAlphanumericIdentifier(str) || _semverIsDigits(str);
+    }
+    constexpr bool _semverIsPrereleaseIdentifier(std::string_view str)
+    {
+      return _semverIsAlphanumericIdentifier(str) || _semverIsNumericIdentifier(str);
+    }
+    constexpr bool _semverIsDotSeperatedIdentifiers(std::string_view str, bool (*isIdentifier)(std::string_view))
+    {
+      if (str.empty()) {
+        return false;
+      }
+
+      auto dotIdx = _semverFind(str, '.');
+      while (dotIdx != std::string_view::npos) {
+        if (!isIdentifier(str.substr(0, dotIdx))) {
+          return false;
+        }
+
+        str    = str.substr(dotIdx + 1);
+        dotIdx = _semverFind(str, '.');
+      }
+
+      return isIdentifier(str);
+    }
+    constexpr bool _semverIsPrerelease(std::string_view str)
+    {
+      return _semverIsDotSeperatedIdentifiers(str, _semverIsPrereleaseIdentifier);
+    }
+    constexpr bool _semverIsBuild(std::string_view str)
+    {
+      return _semverIsDotSeperatedIdentifiers(str, _semverIsBuildIdentifier);
+    }
+    constexpr bool _semverTryParseNumber(std::string_view str, uint16_t& out)
+    {
+      if (!_semverIsNumericIdentifier(str) || str.length() > 5) {
+        return false;
+      }
+
+      uint32_t value = 0;
+      for (auto c : str) {
+        value = (value * 10) + static_cast<uint32_t>(c - '0');
+      }
+
+      if (value > UINT16_MAX) {
+        return false;
+      }
+
+      out = static_cast<uint16_t>(value);
+
+      return true;
+    }
+    // Precedence of two prerelease identifiers, numeric ones compare numerically and sort before alphanumeric ones
+    constexpr int _semverCompareIdentifier(std::string_view a, std::string_view b)
+    {
+      bool aNumeric = _semverIsDigits(a);
+      bool bNumeric = _semverIsDigits(b);
+
+      if (aNumeric != bNumeric) {
+        return aNumeric ? -1 : 1;
+      }
+
+      // Numeric identifiers have no leading zeros, so the shorter one is the smaller one
+      if (aNumeric && a.length() != b.length()) {
+        return a.length() < b.length() ? -1 : 1;
+      }
+
+      return _semverCompareChars(a, b);
+    }
+    constexpr int _semverComparePrerelease(std::string_view a, std::string_view b)
+    {
+      // A version without a prerelease has higher precedence than one with
+      if (a.empty() || b.empty()) {
+        return a.empty() == b.empty() ? 0 : (a.empty() ? 1 : -1);
+      }
+
+      while (true) {
+        auto aDot = _semverFind(a, '.');
+        auto bDot = _semverFind(b, '.');
+
+        int result = _semverCompareIdentifier(a.substr(0, aDot), b.substr(0, bDot));
+        if (result != 0) {
+          return result;
+        }
+
+        // A larger set of identifiers has higher precedence when all preceding ones are equal
+        if (aDot == std::string_view::npos || bDot == std::string_view::npos) {
+          return aDot == bDot ? 0 : (aDot == std::string_view::npos ? -1 : 1);
+        }
+
+        a = a.substr(aDot + 1);
+        b = b.substr(bDot + 1);
+      }
+    }
+    constexpr bool _semverIsSpace(char c)
+    {
+      return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+    }
+    constexpr std::string_view _semverTrim(std::string_view str)
+    {
+      while (!str.empty() && _semverIsSpace(str.front())) {
+        str.remove_prefix(1);
+      }
+      while (!str.empty() && _semverIsSpace(str.back())) {
+        str.remove_suffix(1);
+      }
+
+      return str;
+    }
+    template<std::size_t N>
+    constexpr void _semverCopy(std::string_view str, char (&out)[N])
+    {
+      std::size_t length = str.length() < N - 1 ? str.length() : N - 1;
+      for (std::size_t i = 0; i < length; i++) {
+        out[i] = str[i];
+      }
+      for (std::size_t i = length; i < N; i++) {
+        out[i] = '\0';
+      }
+    }
+  }  // namespace Internal
+
+  /// @brief Semantic version with fixed capacity identifiers, trivially copyable and usable in constant expressions
   struct SemVer {
+    // CI versions carry the branch name as prerelease, .github/scripts/get-vars.js and scripts/embed_env_vars.py cut it to fit
+    static constexpr std::size_t MaxPrereleaseLength = 63;
+    static constexpr std::size_t MaxBuildLength      = 63;
+    static constexpr std::size_t MaxStringLength     = (3 * 5) + 2 + (1 + MaxPrereleaseLength) + (1 + MaxBuildLength);
+
     uint16_t major;
     uint16_t minor;
     uint16_t patch;
-    std::string prerelease;
-    std::string build;
+    char prerelease[MaxPrereleaseLength + 1];  // Null terminated, empty if there is none
+    char build[MaxBuildLength + 1];            // Null terminated, empty if there is none
 
-    inline SemVer()
+    constexpr SemVer()
       : major(0)
       , minor(0)
       , patch(0)
@@ -20,7 +248,7 @@ namespace OpenShock {
       , build()
     {
     }
-    inline SemVer(uint16_t major, uint16_t minor, uint16_t patch)
+    constexpr SemVer(uint16_t major, uint16_t minor, uint16_t patch)
       : major(major)
       , minor(minor)
       , patch(patch)
@@ -28,33 +256,208 @@ namespace OpenShock {
       , build()
     {
     }
-    inline SemVer(uint16_t major, uint16_t minor, uint16_t patch, std::string_view prerelease, std::string_view build)
+    /// @remark Identifiers longer than MaxPrereleaseLength or MaxBuildLength are truncated
+    constexpr SemVer(uint16_t major, uint16_t minor, uint16_t patch, std::string_view prerelease, std::string_view build)
       : major(major)
       , minor(minor)
       , patch(patch)
-      , prerelease(std::string(prerelease))
-      , build(std::string(build))
+      , prerelease()
+      , build()
+    {
+      Internal::_semverCopy(prerelease, this->prerelease);
+      Internal::_semverCopy(build, this->build);
+    }
+
+    constexpr std::string_view getPrerelease() const { return std::string_view(prerelease); }
+    constexpr std::string_view getBuild() const { return std::string_view(build); }
+
+    /// @brief Orders by precedence as defined by semver.org, the build metadata only breaks ties so that the ordering agrees with operator==
+    /// @return Negative if this version is lower, zero if equal, positive if higher
+    constexpr int compare(const SemVer& other) const
     {
+      if (major != other.major) {
+        return major < other.major ? -1 : 1;
+      }
+      if (minor != other.minor) {
+        return minor < other.minor ? -1 : 1;
+      }
+      if (patch != other.patch) {
+        return patch < other.patch ? -1 : 1;
+      }
+
+      int result = Internal::_semverComparePrerelease(getPrerelease(), other.getPrerelease());
+      if (result != 0) {
+        return result;
+      }
+
+      return Internal::_semverCompareChars(getBuild(), other.getBuild());
     }
 
-    bool operator==(const SemVer& other) const;
-    inline bool operator!=(const SemVer& other) const { return !(*this == other); }
-    bool operator<(const SemVer& other) const;
-    inline bool operator<=(const SemVer& other) const { return *this < other || *this == other; }
-    inline bool operator>(const SemVer& other) const { return !(*this <= other); }
-    inline bool operator>=(const SemVer& other) const { return !(*this < other); }
+    constexpr bool operator==(const SemVer& other) const { return compare(other) == 0; }
+    constexpr bool operator!=(const SemVer& other) const { return compare(other) != 0; }
+    constexpr bool operator<(const SemVer& other) const { return compare(other) < 0; }
+    constexpr bool operator<=(const SemVer& other) const { return compare(other) <= 0; }
+    constexpr bool operator>(const SemVer& other) const { return compare(other) > 0; }
+    constexpr bool operator>=(const SemVer& other) const { return compare(other) >= 0; }
 
-    bool operator==(const std::string_view& other) const;
-    inline bool operator!=(const std::string_view& other) const { return !(*this == other); }
-    bool operator<(const std::string_view& other) const;
-    inline bool operator<=(const std::string_view& other) const { return *this < other || *this == other; }
-    inline bool operator>(const std::string_view& other) const { return !(*this <= other); }
-    inline bool operator>=(const std::string_view& other) const { return !(*this < other); }
+    // Comparisons against strings that do not parse are always false
+    constexpr bool operator==(std::string_view other) const;
+    constexpr bool operator!=(std::string_view other) const;
+    constexpr bool operator<(std::string_view other) const;
+    constexpr bool operator<=(std::string_view other) const;
+    constexpr bool operator>(std::string_view other) const;
+    constexpr bool operator>=(std::string_view other) const;
+
+    constexpr bool isValid() const
+    {
+      if (prerelease[0] != '\0' && !Internal::_semverIsPrerelease(getPrerelease())) {
+        return false;
+      }
 
-    bool isValid() const;
+      if (build[0] != '\0' && !Internal::_semverIsBuild(getBuild())) {
+        return false;
+      }
 
-    std::string toString() const;
+      return true;
+    }
+
+    /// @brief Formats the version into a null terminated buffer, use .data() to get a C string
+    constexpr std::array<char, MaxStringLength + 1> toString() const
+    {
+      std::array<char, MaxStringLength + 1> str {};
+      std::size_t pos = 0;
+
+      for (uint16_t part : {major, minor, patch}) {
+        if (pos != 0) {
+          str[pos++] = '.';
+        }
+
+        char digits[5] = {};
+        std::size_t count = 0;
+        do {
+          digits[count++] = static_cast<char>('0' + (part % 10));
+          part /= 10;
+        } while (part != 0);
+
+        while (count != 0) {
+          str[pos++] = digits[--count];
+        }
+      }
+
+      if (prerelease[0] != '\0') {
+        str[pos++] = '-';
+        for (std::size_t i = 0; prerelease[i] != '\0'; i++) {
+          str[pos++] = prerelease[i];
+        }
+      }
+
+      if (build[0] != '\0') {
+        str[pos++] = '+';
+        for (std::size_t i = 0; build[i] != '\0'; i++) {
+          str[pos++] = build[i];
+        }
+      }
+
+      return str;
+    }
   };
 
-  bool TryParseSemVer(std::string_view str, SemVer& out);
+  /// @brief Parses a semantic version, rejecting anything outside the semver.org grammar or over the identifier capacity
+  constexpr bool TryParseSemVer(std::string_view str, SemVer& out)
+  {
+    std::string_view core = str, prerelease, build;
+
+    auto plusIdx = Internal::_semverFind(core, '+');
+    if (plusIdx != std::string_view::npos) {
+      build = core.substr(plusIdx + 1);
+      core  = core.substr(0, plusIdx);
+
+      if (!Internal::_semverIsBuild(build) || build.length() > SemVer::MaxBuildLength) {
+        return false;
+      }
+    }
+
+    // The core has no dashes, so the first one starts the prerelease
+    auto dashIdx = Internal::_semverFind(core, '-');
+    if (dashIdx != std::string_view::npos) {
+      prerelease = core.substr(dashIdx + 1);
+      core       = core.substr(0, dashIdx);
+
+      if (!Internal::_semverIsPrerelease(prerelease) || prerelease.length() > SemVer::MaxPrereleaseLength) {
+        return false;
+      }
+    }
+
+    auto firstDot  = Internal::_semverFind(core, '.');
+    auto secondDot = firstDot != std::string_view::npos ? Internal::_semverFind(core, '.', firstDot + 1) : std::string_view::npos;
+    if (secondDot == std::string_view::npos) {
+      return false;
+    }
+
+    uint16_t major = 0, minor = 0, patch = 0;
+    if (!Internal::_semverTryParseNumber(core.substr(0, firstDot), major) || !Internal::_semverTryParseNumber(core.substr(firstDot + 1, secondDot - firstDot - 1), minor) || !Internal::_semverTryParseNumber(core.substr(secondDot + 1), patch)) {
+      return false;
+    }
+
+    out = SemVer(major, minor, patch, prerelease, build);
+
+    return true;
+  }
+
+  /// @brief Finds the highest version in a newline separated list, such as a CDN version file, without copying any of it
+  /// @remark Surrounding whitespace is ignored, blank lines and lines that are not a version are skipped
+  /// @return False if no line holds a version
+  constexpr bool TryParseHighestSemVer(std::string_view list, SemVer& out)
+  {
+    bool found = false;
+
+    while (!list.empty()) {
+      auto lineEnd = Internal::_semverFind(list, '\n');
+
+      SemVer version;
+      if (TryParseSemVer(Internal::_semverTrim(list.substr(0, lineEnd)), version) && (!found || version > out)) {
+        out   = version;
+        found = true;
+      }
+
+      if (lineEnd == std::string_view::npos) {
+        break;
+      }
+
+      list = list.substr(lineEnd + 1);
+    }
+
+    return found;
+  }
+
+  constexpr bool SemVer::operator==(std::string_view other) const
+  {
+    SemVer otherSemVer;
+    return TryParseSemVer(other, otherSemVer) && *this == otherSemVer;
+  }
+  constexpr bool SemVer::operator!=(std::string_view other) const
+  {
+    SemVer otherSemVer;
+    return TryParseSemVer(other, otherSemVer) && *this != otherSemVer;
+  }
+  constexpr bool SemVer::operator<(std::string_view other) const
+  {
+    SemVer otherSemVer;
+    return TryParseSemVer(other, otherSemVer) && *this < otherSemVer;
+  }
+  constexpr bool SemVer::operator<=(std::string_view other) const
+  {
+    SemVer otherSemVer;
+    return TryParseSemVer(other, otherSemVer) && *this <= otherSemVer;
+  }
+  constexpr bool SemVer::operator>(std::string_view other) const
+  {
+    SemVer otherSemVer;
+    return TryParseSemVer(other, otherSemVer) && *this > otherSemVer;
+  }
+  constexpr bool SemVer::operator>=(std::string_view other) const
+  {
+    SemVer otherSemVer;
+    return TryParseSemVer(other, otherSemVer) && *this >= otherSemVer;
+  }
 }  // namespace OpenShock
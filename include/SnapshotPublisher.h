@@ -0,0 +1,144 @@
+#pragma once
+
+#include "Common.h"
+#include "SimpleMutex.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace OpenShock {
+  /// @brief Hands out the current version of an immutable object to any number of readers without locking.
+  /// Readers pin what they loaded through one shared reader count, a replaced object is retired and only deleted once that count has been seen at zero after it was replaced.
+  /// Loading is an atomic add and an atomic pointer load, unlike std::atomic_load on a std::shared_ptr which goes through a global spinlock in libstdc++.
+  /// Publishing never waits for readers, but every Ref alive at the time delays deleting what it replaced, so don't keep Refs around longer than needed.
+  template<typename T>
+  class SnapshotPublisher {
+    DISABLE_COPY(SnapshotPublisher);
+    DISABLE_MOVE(SnapshotPublisher);
+  public:
+    /// @brief Keeps the object it was loaded with alive for as long as it exists
+    class Ref {
+    public:
+      Ref() : m_publisher(nullptr), m_object(nullptr) { }
+      Ref(std::nullptr_t) : Ref() { }
+      Ref(const Ref& other) : m_publisher(other.m_publisher), m_object(other.m_object) {
+        if (m_publisher != nullptr) {
+          // Already pinned by other, so the count can't be seen at zero in between
+          m_publisher->m_readers.fetch_add(1, std::memory_order_relaxed);
+        }
+      }
+      Ref(Ref&& other) noexcept : m_publisher(other.m_publisher), m_object(other.m_object) {
+        other.m_publisher = nullptr;
+        other.m_object    = nullptr;
+      }
+      ~Ref() { release(); }
+
+      Ref& operator=(const Ref& other) {
+        if (this != &other) {
+          Ref copy(other);
+          *this = std::move(copy);
+        }
+
+        return *this;
+      }
+      Ref& operator=(Ref&& other) noexcept {
+        if (this != &other) {
+          release();
+
+          m_publisher       = other.m_publisher;
+          m_object          = other.m_object;
+          other.m_publisher = nullptr;
+          other.m_object    = nullptr;
+        }
+
+        return *this;
+      }
+
+      const T* get() const { return m_object; }
+      const T* operator->() const { return m_object; }
+      const T& operator*() const { return *m_object; }
+
+      bool operator==(std::nullptr_t) const { return m_object == nullptr; }
+      bool operator!=(std::nullptr_t) const { return m_object != nullptr; }
+      bool operator==(const Ref& other) const { return m_object == other.m_object; }
+      bool operator!=(const Ref& other) const { return m_object != other.m_object; }
+
+      void release() {
+        if (m_publisher != nullptr) {
+          m_publisher->m_readers.fetch_sub(1, std::memory_order_release);
+        }
+
+        m_publisher = nullptr;
+        m_object    = nullptr;
+      }
+    private:
+      friend class SnapshotPublisher;
+
+      Ref(SnapshotPublisher* publisher, const T* object) : m_publisher(publisher), m_object(object) { }
+
+      SnapshotPublisher* m_publisher;
+      const T* m_object;
+    };
+
+    SnapshotPublisher() : m_current(nullptr), m_readers(0), m_retiredMutex(), m_retired() { }
+    /// @remark No Ref may outlive the publisher
+    ~SnapshotPublisher() {
+      delete m_current.load(std::memory_order_relaxed);
+
+      for (const T* object : m_retired) {
+        delete object;
+      }
+    }
+
+    /// @brief Gets the current object, a null Ref if nothing has been published yet
+    Ref load() {
+      // Counted before the pointer is read, reclaim() can then never miss a reader that got hold of a retired object
+      m_readers.fetch_add(1, std::memory_order_seq_cst);
+
+      const T* object = m_current.load(std::memory_order_seq_cst);
+      if (object == nullptr) {
+        m_readers.fetch_sub(1, std::memory_order_release);
+        return Ref();
+      }
+
+      return Ref(this, object);
+    }
+
+    /// @brief Replaces the current object, readers that already loaded the previous one keep using it until they release it
+    void publish(std::unique_ptr<const T> object) {
+      const T* previous = m_current.exchange(object.release(), std::memory_order_seq_cst);
+      if (previous != nullptr) {
+        ScopedLock lock(&m_retiredMutex);
+        m_retired.push_back(previous);
+      }
+
+      reclaim();
+    }
+
+    /// @brief Deletes retired objects if no reader is active right now, publish() already tries this
+    /// @return Number of retired objects still waiting to be deleted
+    std::size_t reclaim() {
+      ScopedLock lock(&m_retiredMutex);
+
+      // Everything in the list was replaced before this check, a reader counted after it can only have loaded a newer object
+      if (m_retired.empty() || m_readers.load(std::memory_order_seq_cst) != 0) {
+        return m_retired.size();
+      }
+
+      for (const T* object : m_retired) {
+        delete object;
+      }
+      m_retired.clear();
+
+      return 0;
+    }
+  private:
+    std::atomic<const T*> m_current;
+    std::atomic<uint32_t> m_readers;  // Live Refs
+    SimpleMutex m_retiredMutex;
+    std::vector<const T*> m_retired;  // Replaced objects that may still be referenced
+  };
+}  // namespace OpenShock
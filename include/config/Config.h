@@ -2,24 +2,40 @@
 
 #include "config/BackendConfig.h"
 #include "config/CaptivePortalConfig.h"
+#include "config/ConfigSnapshot.h"
 #include "config/EStopConfig.h"
 #include "config/OtaUpdateConfig.h"
 #include "config/RFConfig.h"
 #include "config/SerialInputConfig.h"
 #include "config/WiFiConfig.h"
 #include "config/WiFiCredentials.h"
+#include "serialization/JsonStream.h"
+#include "SnapshotPublisher.h"
 
 #include <hal/gpio_types.h>
 
 #include <functional>
+#include <memory>
 #include <string_view>
 #include <vector>
 
 namespace OpenShock::Config {
+  /// @brief Immutable copy of the whole config, stays valid for as long as it is held even if the config changes meanwhile
+  using Snapshot = SnapshotPublisher<ConfigSnapshot>::Ref;
+
   void Init();
 
-  /* GetAsJSON and SaveFromJSON are used for Reading/Writing the config file in its human-readable form. */
+  /* GetSnapshot is the cheap way to read config: no locking and no copies, but don't hold on to it longer than needed as it keeps replaced configs in memory.
+     Strings read through it are views into the snapshot, the Get* functions below copy what they return. */
+  Snapshot GetSnapshot();
+
+  /* Setters only schedule writing the config to flash, Flush writes pending changes immediately (e.g. before cutting power). */
+  bool Flush();
+
+  /* GetAsJSON and SaveFromJSON are used for Reading/Writing the config file in its human-readable form, neither builds a JSON tree. */
   std::string GetAsJSON(bool withSensitiveData);
+  /* WriteAsJSON streams the same output in small pieces, for sending it somewhere without holding all of it in memory. */
+  bool WriteAsJSON(Serialization::JsonStream::Writer::Sink sink, bool withSensitiveData);
   bool SaveFromJSON(std::string_view json);
 
   /* GetAsFlatBuffer and SaveFromFlatBuffer are used for Reading/Writing the config file in its binary form. */
@@ -69,17 +85,13 @@ namespace OpenShock::Config {
   uint8_t GetWiFiCredentialsIDbySSID(const char* ssid);
   bool RemoveWiFiCredentials(uint8_t id);
   bool ClearWiFiCredentials();
-  bool GetWiFiHostname(std::string& out);
   bool SetWiFiHostname(std::string_view hostname);
 
-  bool GetBackendDomain(std::string& out);
   bool SetBackendDomain(std::string_view domain);
   bool HasBackendAuthToken();
-  bool GetBackendAuthToken(std::string& out);
   bool SetBackendAuthToken(std::string_view token);
   bool ClearBackendAuthToken();
   bool HasBackendLCGOverride();
-  bool GetBackendLCGOverride(std::string& out);
   bool SetBackendLCGOverride(std::string_view lcgOverride);
   bool ClearBackendLCGOverride();
 
@@ -91,6 +103,19 @@ namespace OpenShock::Config {
   bool GetOtaUpdateStep(OtaUpdateStep& out);
   bool SetOtaUpdateStep(OtaUpdateStep updateStep);
 
+  /* Digests of flashed partition images, cached next to the config file so they don't have to be recomputed by hashing the whole partition. */
+  bool GetPartitionHash(std::string_view label, uint8_t (&hash)[32], std::string& tag);
+  bool SetPartitionHash(std::string_view label, const uint8_t (&hash)[32], std::string_view tag);
+  bool ClearPartitionHash(std::string_view label);
+
+  /* Access point of the last successful connection, cached next to the config file so a reboot can reconnect without scanning. */
+  bool GetWiFiLastConnection(uint8_t& credentialsID, uint8_t (&bssid)[6], uint8_t& channel);
+  bool SetWiFiLastConnection(uint8_t credentialsID, const uint8_t (&bssid)[6], uint8_t channel);
+
+  /* Runtime log levels as "TAG=level" lines, kept next to the config file so they survive a config reset from the frontend. */
+  bool GetLogLevels(std::string& out);
+  bool SetLogLevels(std::string_view levels);
+
   bool GetEStopEnabled(bool& out);
   bool SetEStopEnabled(bool enabled);
   bool GetEStopGpioPin(gpio_num_t& out);
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "serialization/_fbs/HubConfig_generated.h"
+#include "serialization/JsonStream.h"
 
 #include <cJSON.h>
 
@@ -14,6 +15,7 @@ namespace OpenShock::Config {
 
     virtual bool FromJSON(const cJSON* json)                          = 0;
     [[nodiscard]] virtual cJSON* ToJSON(bool withSensitiveData) const = 0;
+    virtual void ToJSON(Serialization::JsonStream::Writer& writer, bool withSensitiveData) const = 0;
   };
 
 }  // namespace OpenShock::Config
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "Common.h"
+
+#include "config/CaptivePortalConfig.h"
+#include "config/EStopConfig.h"
+#include "config/OtaUpdateConfig.h"
+#include "config/RFConfig.h"
+#include "config/SerialInputConfig.h"
+#include "serialization/_fbs/HubConfig_generated.h"
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace OpenShock::Config {
+  /// @brief Immutable, verified HubConfig flatbuffer that is read in place instead of being deserialized
+  ///
+  /// Fields missing from the buffer (e.g. one written by an older firmware) read as their defaults, same as when loading them into a RootConfig.
+  /// The small fixed-size sections are decoded once when the snapshot is created, so reading them costs no more than a field access.
+  class ConfigSnapshot {
+    DISABLE_COPY(ConfigSnapshot);
+    DISABLE_MOVE(ConfigSnapshot);
+
+  public:
+    /// @brief Takes ownership of a serialized HubConfig, ok() tells whether it passed verification
+    /// @param generation Tells snapshots apart that may end up at the same address, see generation()
+    ConfigSnapshot(std::vector<uint8_t> buffer, uint32_t generation = 0);
+
+    inline bool ok() const { return m_root != nullptr; }
+    inline uint32_t generation() const { return m_generation; }
+
+    inline const Serialization::Configuration::HubConfig* root() const { return m_root; }
+    inline const std::vector<uint8_t>& buffer() const { return m_buffer; }
+
+    /// @remark Strings point into the snapshot and are null-terminated, they are valid for as long as the snapshot is held
+    std::string_view wifiHostname() const;
+    std::string_view backendDomain() const;
+    std::string_view backendAuthToken() const;
+    std::string_view backendLCGOverride() const;
+
+    inline const RFConfig& rf() const { return m_rf; }
+    inline const CaptivePortalConfig& captivePortal() const { return m_captivePortal; }
+    inline const SerialInputConfig& serialInput() const { return m_serialInput; }
+    inline const OtaUpdateConfig& otaUpdate() const { return m_otaUpdate; }
+    inline const EStopConfig& estop() const { return m_estop; }
+
+  private:
+    std::vector<uint8_t> m_buffer;
+    const Serialization::Configuration::HubConfig* m_root;
+    uint32_t m_generation;
+    RFConfig m_rf;
+    CaptivePortalConfig m_captivePortal;
+    SerialInputConfig m_serialInput;
+    OtaUpdateConfig m_otaUpdate;
+    EStopConfig m_estop;
+  };
+}  // namespace OpenShock::Config
@@ -41,5 +41,6 @@ namespace OpenShock::Config {
 
     bool FromJSON(const cJSON* json) override;
     [[nodiscard]] cJSON* ToJSON(bool withSensitiveData) const override;
+    void ToJSON(Serialization::JsonStream::Writer& writer, bool withSensitiveData) const override;
   };
 }  // namespace OpenShock::Config
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Common.h"
+#include "config/RootConfig.h"
+#include "serialization/JsonStream.h"
+
+#include <cstdint>
+
+namespace OpenShock::Config::Internal {
+  /// @brief Streaming counterpart of RootConfig::FromJSON, fills a RootConfig from parser tokens without building a cJSON tree
+  ///
+  /// Accepts the same documents with the same defaults: missing sections and members are defaulted, members of the wrong type keep their default.
+  class JsonConfigReader : public Serialization::JsonStream::Handler {
+    DISABLE_COPY(JsonConfigReader);
+    DISABLE_MOVE(JsonConfigReader);
+
+  public:
+    JsonConfigReader(RootConfig& config);
+
+    bool onToken(const Serialization::JsonStream::Token& token) override;
+    bool onEnd() override;
+
+  private:
+    enum class Section : uint8_t {
+      None,
+      RF,
+      WiFi,
+      CaptivePortal,
+      Backend,
+      SerialInput,
+      OtaUpdate,
+      EStop,
+      Unknown,
+    };
+
+    bool _beginSection(const Serialization::JsonStream::Token& token);
+    bool _endSection();
+    bool _readWiFiToken(const Serialization::JsonStream::Token& token);
+    bool _readSectionMember(const Serialization::JsonStream::Token& token);
+
+    RootConfig& m_config;
+    Section m_section;
+    bool m_hasRoot;
+    bool m_hasCredentials;
+    bool m_inCredentials;
+    bool m_hasEStopEnabled;
+    WiFiCredentials m_credentials;
+  };
+}  // namespace OpenShock::Config::Internal
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace OpenShock::HTTP {
+  /// @brief Resumable decoder for HTTP/1.1 chunked transfer encoding (RFC 9112 section 7.1)
+  ///
+  /// Input can be fed in arbitrarily sized pieces, payload bytes are handed to the callback straight out of the input buffer as soon as they arrive.
+  /// Chunk sizes are therefore not limited by any buffer, and no data is ever copied or moved by the decoder.
+  class ChunkedDecoder {
+  public:
+    enum class Result : uint8_t {
+      NeedMoreData,  // All input consumed, transfer not finished yet
+      Done,          // Final chunk and trailer section have been consumed
+      Invalid,       // Malformed chunk framing
+      Cancelled,     // Payload callback returned false
+    };
+
+    ChunkedDecoder() { reset(); }
+
+    void reset();
+
+    bool isDone() const { return m_state == State::Done; }
+
+    /// @brief Feeds a piece of the response body into the decoder
+    /// @param data Raw response body bytes
+    /// @param len Number of bytes in data
+    /// @param consumed Set to the number of bytes consumed, any bytes after the terminating chunk are left unconsumed
+    /// @param onPayload Callable with signature bool(const uint8_t* data, std::size_t len), returning false cancels decoding
+    template<typename Fn>
+    Result feed(const uint8_t* data, std::size_t len, std::size_t& consumed, Fn&& onPayload)
+    {
+      std::size_t pos = 0;
+
+      while (pos < len) {
+        if (m_state == State::Payload) {
+          std::size_t n = len - pos;
+          if (n > m_remaining) {
+            n = m_remaining;
+          }
+
+          if (!onPayload(data + pos, n)) {
+            consumed = pos;
+            return Result::Cancelled;
+          }
+
+          pos += n;
+          m_remaining -= n;
+
+          if (m_remaining == 0) {
+            m_state = State::PayloadCR;
+          }
+
+          continue;
+        }
+
+        _consumeControlByte(data[pos++]);
+
+        if (m_state == State::Invalid) {
+          consumed = pos;
+          return Result::Invalid;
+        }
+
+        if (m_state == State::Done) {
+          consumed = pos;
+          return Result::Done;
+        }
+      }
+
+      consumed = pos;
+
+      if (m_state == State::Invalid) {
+        return Result::Invalid;
+      }
+
+      return m_state == State::Done ? Result::Done : Result::NeedMoreData;
+    }
+
+  private:
+    enum class State : uint8_t {
+      Size,          // Reading hex chunk size
+      Extension,     // Skipping chunk extensions until CR
+      SizeLF,        // Expecting LF after chunk size line
+      Payload,       // Passing payload bytes through
+      PayloadCR,     // Expecting CR after payload
+      PayloadLF,     // Expecting LF after payload
+      TrailerStart,  // Start of a trailer field line, or the final CRLF
+      TrailerLine,   // Skipping a trailer field line until LF
+      TrailerLF,     // Expecting LF of the final CRLF
+      Done,
+      Invalid,
+    };
+
+    void _consumeControlByte(uint8_t c);
+
+    State m_state;
+    uint8_t m_sizeDigits;
+    std::size_t m_remaining;
+  };
+}  // namespace OpenShock::HTTP
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace OpenShock::HTTP {
+  /// @brief Parses the first byte position out of a "Content-Range: bytes <first>-<last>/<length>" header
+  bool TryParseContentRangeStart(std::string_view contentRange, std::size_t& start);
+
+  /// @brief Drops the bytes of a received body piece that lie before resumeOffset, which the caller already has
+  /// @param resumeOffset Offset within the resource the download was resumed at
+  /// @param offset Offset of the piece within the resource, advanced past the dropped bytes
+  /// @return False if the whole piece lies before resumeOffset
+  bool TrimToResumeOffset(std::size_t resumeOffset, std::size_t& offset, const uint8_t*& data, std::size_t& len);
+}  // namespace OpenShock::HTTP
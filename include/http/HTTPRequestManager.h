@@ -1,8 +1,8 @@
 #pragma once
 
-#include <Arduino.h>
+#include "serialization/JsonStream.h"
 
-#include <cJSON.h>
+#include <Arduino.h>
 
 #include <functional>
 #include <map>
@@ -29,33 +29,54 @@ namespace OpenShock::HTTP {
     T data;
   };
 
-  template<typename T>
-  using JsonParser               = std::function<bool(int code, const cJSON* json, T& data)>;
   using GotContentLengthCallback = std::function<bool(int contentLength)>;
   using DownloadCallback         = std::function<bool(std::size_t offset, const uint8_t* data, std::size_t len)>;
 
   Response<std::size_t> Download(std::string_view url, const std::map<String, String>& headers, GotContentLengthCallback contentLengthCallback, DownloadCallback downloadCallback, const std::vector<int>& acceptedCodes = {200}, uint32_t timeoutMs = 10'000);
+  /// @brief Continues a download at resumeOffset using a Range request, 206 responses are accepted in addition to acceptedCodes
+  /// @note Callback offsets and the reported content length are relative to the start of the resource, if the server ignores the Range header the bytes before resumeOffset are skipped
+  Response<std::size_t> ResumeDownload(std::string_view url, const std::map<String, String>& headers, std::size_t resumeOffset, GotContentLengthCallback contentLengthCallback, DownloadCallback downloadCallback, const std::vector<int>& acceptedCodes = {200}, uint32_t timeoutMs = 10'000);
   Response<std::string> GetString(std::string_view url, const std::map<String, String>& headers, const std::vector<int>& acceptedCodes = {200}, uint32_t timeoutMs = 10'000);
 
-  template<typename T>
-  Response<T> GetJSON(std::string_view url, const std::map<String, String>& headers, JsonParser<T> jsonParser, const std::vector<int>& acceptedCodes = {200}, uint32_t timeoutMs = 10'000) {
-    auto response = GetString(url, headers, acceptedCodes, timeoutMs);
-    if (response.result != RequestResult::Success) {
-      return {response.result, response.code, {}};
-    }
+  /// @brief Downloads and parses a JSON response in a streaming fashion, the body is never buffered in full
+  /// @tparam T The response struct to populate
+  /// @tparam Parser A Serialization::JsonStream::Handler constructible from T&
+  template<typename T, typename Parser>
+  Response<T> GetJSON(std::string_view url, const std::map<String, String>& headers, const std::vector<int>& acceptedCodes = {200}, uint32_t timeoutMs = 10'000) {
+    T data {};
+    Parser handler(data);
+    Serialization::JsonStream::Parser parser(handler);
+
+    bool parseFailed = false;
 
-    cJSON* json = cJSON_ParseWithLength(response.data.c_str(), response.data.length());
-    if (json == nullptr) {
+    auto contentLengthCallback = [](int contentLength) {
+      (void)contentLength;
+      return true;
+    };
+    auto writer = [&parser, &parseFailed](std::size_t offset, const uint8_t* chunk, std::size_t len) {
+      (void)offset;
+
+      auto result = parser.feed(chunk, len);
+      if (result == Serialization::JsonStream::Parser::Result::Invalid || result == Serialization::JsonStream::Parser::Result::Cancelled) {
+        parseFailed = true;
+        return false;
+      }
+
+      return true;
+    };
+
+    auto response = Download(url, headers, contentLengthCallback, writer, acceptedCodes, timeoutMs);
+    if (parseFailed) {
       return {RequestResult::ParseFailed, response.code, {}};
     }
+    if (response.result != RequestResult::Success) {
+      return {response.result, response.code, {}};
+    }
 
-    T data;
-    if (!jsonParser(response.code, json, data)) {
+    if (parser.finish() != Serialization::JsonStream::Parser::Result::Done) {
       return {RequestResult::ParseFailed, response.code, {}};
     }
 
-    cJSON_Delete(json);
-
-    return {response.result, response.code, data};
+    return {response.result, response.code, std::move(data)};
   }
 }  // namespace OpenShock::HTTP
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Common.h"
+
+#include <esp32-hal-rmt.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace OpenShock {
+  /// @brief Decides what the RF transmitter puts on air and in which order, without touching the RMT peripheral or FreeRTOS
+  ///
+  /// Every pending command is sent once per round, a command past its end keeps sending its zero sequence for a while so the shocker reliably stops.
+  /// Kept apart from RFTransmitter so its behaviour under load can be simulated on the host.
+  class RFCommandScheduler {
+    DISABLE_COPY(RFCommandScheduler);
+    DISABLE_MOVE(RFCommandScheduler);
+
+  public:
+    struct Command {
+      int64_t until;  // Milliseconds
+      std::vector<rmt_data_t> sequence;
+      std::vector<rmt_data_t> zeroSequence;
+      uint16_t shockerId;
+      bool overwrite;
+    };
+
+    /// @brief How long an ended command keeps sending its zero sequence, in milliseconds
+    static constexpr int64_t TransmitEndDuration = 300;
+
+    RFCommandScheduler();
+
+    inline std::size_t size() const { return m_commands.size(); }
+    inline bool empty() const { return m_commands.empty(); }
+
+    /// @brief Adds a command, or replaces the pending command for the same shocker if that one may be overwritten
+    /// @return False if the command was discarded in favour of the pending one
+    bool add(std::unique_ptr<Command> command);
+
+    /// @brief Ends every pending command at the given time, they then only send their zero sequence
+    void endAll(int64_t until);
+
+    void clear();
+
+    /// @brief Sends every pending command once and drops the ones that are done
+    /// @param millis Current time, read again after every transmission since those block for as long as they are on air
+    /// @param transmit Puts a sequence on air, stopping tells whether it is the command's zero sequence
+    void transmitRound(const std::function<int64_t()>& millis, const std::function<void(const Command& command, bool stopping)>& transmit);
+
+  private:
+    std::vector<std::unique_ptr<Command>> m_commands;
+  };
+}  // namespace OpenShock
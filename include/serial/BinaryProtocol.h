@@ -0,0 +1,70 @@
+#pragma once
+
+#include "Common.h"
+
+#include <cstddef>
+#include <cstdint>
+
+// Binary serial mode, entered from the text console with the "binary" command.
+//
+// Frames are COBS-encoded and terminated by a 0x00 byte, decoded they are laid out as:
+//   [type: u8][status: u8][sequence: u16 LE][payload][crc32: u32 LE, over everything before it]
+// The status byte is only used by acks (0 otherwise), it also keeps the payload 4-byte aligned for flatbuffers.
+// Every frame with a valid CRC is answered with an Ack frame carrying the same sequence number.
+// A frame repeating the previous sequence number is a retransmit after a lost ack, it is acked again without being executed.
+// Log output is not suppressed and may end up between frames, hosts should drop anything that fails the CRC.
+// Binary mode is left after 30 seconds without any received byte, so a host that dies mid-session doesn't leave the console unusable.
+// Idle hosts keep the session open by sending a lone 0x00 delimiter, which is dropped as an empty frame.
+namespace OpenShock::Serial::BinaryProtocol {
+  enum class FrameType : uint8_t {
+    ShockerCommandList = 0x01,  // Payload is a Gateway::ShockerCommandList flatbuffer
+    Exit               = 0x02,  // Returns to the text console, no payload
+    Ack                = 0x80,  // Status byte holds an AckStatus, no payload
+  };
+
+  enum class AckStatus : uint8_t {
+    Ok             = 0,
+    UnknownType    = 1,
+    InvalidPayload = 2,
+    CommandFailed  = 3,  // At least one command in the list was rejected
+  };
+
+  /// @brief Reassembles COBS frames from a byte stream, bytes beyond MaxFrameSize discard the frame they belong to
+  class FrameDecoder {
+    DISABLE_COPY(FrameDecoder);
+    DISABLE_MOVE(FrameDecoder);
+
+  public:
+    static const std::size_t MaxFrameSize = 512;
+
+    FrameDecoder();
+
+    /// @brief Discards any partially received frame
+    void reset();
+
+    /// @brief Feeds one received byte, returns true once a complete frame is available through data() and size()
+    bool feed(uint8_t byte);
+
+    inline const uint8_t* data() const { return m_buffer; }
+    inline std::size_t size() const { return m_size; }
+
+  private:
+    uint8_t m_blockCode;       // Code byte of the current block, 0 before the first block of a frame
+    uint8_t m_blockRemaining;  // Data bytes left in the current block
+    bool m_overflow;
+    bool m_complete;
+    std::size_t m_size;
+    alignas(4) uint8_t m_buffer[MaxFrameSize];
+  };
+
+  /// @brief COBS-encodes data into out and appends the frame delimiter, out must hold at least EncodedSize(len) bytes
+  std::size_t Encode(const uint8_t* data, std::size_t len, uint8_t* out);
+  constexpr std::size_t EncodedSize(std::size_t len) { return len + (len / 254) + 2; }
+
+  /// @brief Forgets the last received sequence number, called whenever binary mode is entered
+  void Reset();
+
+  /// @brief Executes a decoded frame and writes its acknowledgement to serial
+  /// @return False if the frame asked to leave binary mode
+  bool HandleFrame(const uint8_t* data, std::size_t len);
+}  // namespace OpenShock::Serial::BinaryProtocol
@@ -8,6 +8,10 @@ namespace OpenShock::SerialInputHandler {
   bool SerialEchoEnabled();
   void SetSerialEchoEnabled(bool enabled);
 
+  /// @brief Switches the port between the text console and framed binary commands, see serial/BinaryProtocol.h
+  bool BinaryModeEnabled();
+  void SetBinaryModeEnabled(bool enabled);
+
   void PrintWelcomeHeader();
   void PrintVersionInfo();
 }  // namespace OpenShock::SerialInputHandler
@@ -11,4 +11,7 @@
 #define SERPR_SUCCESS(format, ...)  SERPR_SYS("Success|" format, ##__VA_ARGS__)
 #define SERPR_ERROR(format, ...)    SERPR_SYS("Error|" format, ##__VA_ARGS__)
 
+// Starts a response line without ending it, for responses streamed in pieces. The caller writes the rest and the newline.
+#define SERPR_RESPONSE_BEGIN(format, ...) ::Serial.printf("$SYS$|Response|" format, ##__VA_ARGS__)
+
 using namespace std::string_view_literals;
@@ -21,7 +21,10 @@ namespace OpenShock::Serial::CommandHandlers {
   OpenShock::Serial::CommandGroup JsonConfigHandler();
   OpenShock::Serial::CommandGroup RawConfigHandler();
   OpenShock::Serial::CommandGroup RfTransmitHandler();
+  OpenShock::Serial::CommandGroup BinaryHandler();
   OpenShock::Serial::CommandGroup FactoryResetHandler();
+  OpenShock::Serial::CommandGroup LogLevelHandler();
+  OpenShock::Serial::CommandGroup HeapHandler();
 
   inline std::vector<OpenShock::Serial::CommandGroup> AllCommandHandlers()
   {
@@ -42,7 +45,10 @@ namespace OpenShock::Serial::CommandHandlers {
       JsonConfigHandler(),
       RawConfigHandler(),
       RfTransmitHandler(),
+      BinaryHandler(),
       FactoryResetHandler(),
+      LogLevelHandler(),
+      HeapHandler(),
     };
   }
 }  // namespace OpenShock::Serial::CommandHandlers
@@ -1,9 +1,8 @@
 #pragma once
 
+#include "serialization/JsonStream.h"
 #include "ShockerModelType.h"
 
-#include <cJSON.h>
-
 #include <cstdint>
 #include <string>
 #include <vector>
@@ -39,9 +38,72 @@ namespace OpenShock::Serialization::JsonAPI {
     std::string country;
   };
 
-  bool ParseLcgInstanceDetailsJsonResponse(int code, const cJSON* root, LcgInstanceDetailsResponse& out);
-  bool ParseBackendVersionJsonResponse(int code, const cJSON* root, BackendVersionResponse& out);
-  bool ParseAccountLinkJsonResponse(int code, const cJSON* root, AccountLinkResponse& out);
-  bool ParseDeviceInfoJsonResponse(int code, const cJSON* root, DeviceInfoResponse& out);
-  bool ParseAssignLcgJsonResponse(int code, const cJSON* root, AssignLcgResponse& out);
+  // Streaming parsers, these populate the response struct token by token as the body is downloaded (see HTTP::GetJSON)
+
+  class LcgInstanceDetailsJsonParser : public JsonStream::Handler {
+  public:
+    LcgInstanceDetailsJsonParser(LcgInstanceDetailsResponse& out) : m_out(out), m_seen(0) { }
+
+    bool onToken(const JsonStream::Token& token) override;
+    bool onEnd() override;
+
+  private:
+    LcgInstanceDetailsResponse& m_out;
+    uint8_t m_seen;
+  };
+
+  class BackendVersionJsonParser : public JsonStream::Handler {
+  public:
+    BackendVersionJsonParser(BackendVersionResponse& out) : m_out(out), m_inData(false), m_seen(0) { }
+
+    bool onToken(const JsonStream::Token& token) override;
+    bool onEnd() override;
+
+  private:
+    BackendVersionResponse& m_out;
+    bool m_inData;
+    uint8_t m_seen;
+  };
+
+  class AccountLinkJsonParser : public JsonStream::Handler {
+  public:
+    AccountLinkJsonParser(AccountLinkResponse& out) : m_out(out), m_seen(0) { }
+
+    bool onToken(const JsonStream::Token& token) override;
+    bool onEnd() override;
+
+  private:
+    AccountLinkResponse& m_out;
+    uint8_t m_seen;
+  };
+
+  class DeviceInfoJsonParser : public JsonStream::Handler {
+  public:
+    DeviceInfoJsonParser(DeviceInfoResponse& out) : m_out(out), m_inData(false), m_inShockers(false), m_seen(0), m_shockerSeen(0) { }
+
+    bool onToken(const JsonStream::Token& token) override;
+    bool onEnd() override;
+
+  private:
+    bool _onShockerToken(const JsonStream::Token& token);
+
+    DeviceInfoResponse& m_out;
+    bool m_inData;
+    bool m_inShockers;
+    uint8_t m_seen;
+    uint8_t m_shockerSeen;
+  };
+
+  class AssignLcgJsonParser : public JsonStream::Handler {
+  public:
+    AssignLcgJsonParser(AssignLcgResponse& out) : m_out(out), m_inData(false), m_seen(0) { }
+
+    bool onToken(const JsonStream::Token& token) override;
+    bool onEnd() override;
+
+  private:
+    AssignLcgResponse& m_out;
+    bool m_inData;
+    uint8_t m_seen;
+  };
 }  // namespace OpenShock::Serialization::JsonAPI
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <string_view>
+
+namespace OpenShock::Serialization::JsonStream {
+  enum class TokenType : uint8_t {
+    ObjectStart,
+    ObjectEnd,
+    ArrayStart,
+    ArrayEnd,
+    String,
+    Number,
+    True,
+    False,
+    Null,
+  };
+
+  struct Token {
+    TokenType type;
+    uint8_t depth;          // 0 for the root value, 1 for its members/elements, and so on. End tokens carry the depth of their start token
+    std::string_view key;   // Member name this value belongs to, empty for array elements, the root value and end tokens
+    std::string_view value; // Unescaped string contents, or the raw number text. Always null-terminated
+  };
+
+  class Handler {
+  public:
+    virtual ~Handler() = default;
+
+    /// @brief Called for every token in document order, returning false cancels parsing
+    virtual bool onToken(const Token& token) = 0;
+
+    /// @brief Called once the root value has been fully parsed, returning false marks the document as invalid
+    virtual bool onEnd() { return true; }
+  };
+
+  /// @brief Parses a Number token value written with a fraction or exponent, such as 1.0 or 1e2, returns false unless it is a whole number
+  bool NumberToIntegralDouble(std::string_view number, double& out);
+
+  /// @brief Parses a Number token value into an integer through a converter such as Convert::ToUint16
+  /// @remark Whole numbers written with a fraction or exponent are accepted too, the cJSON based parsers did the same. out is left untouched on failure
+  template<typename T>
+  bool NumberToInteger(std::string_view number, T& out, bool (*converter)(std::string_view, T&))
+  {
+    T parsed;
+    if (converter(number, parsed)) {
+      out = parsed;
+      return true;
+    }
+
+    double value;
+    if (!NumberToIntegralDouble(number, value) || value < static_cast<double>(std::numeric_limits<T>::min()) || value >= static_cast<double>(std::numeric_limits<T>::max()) + 1.0) {
+      return false;
+    }
+
+    out = static_cast<T>(value);
+
+    return true;
+  }
+
+  /// @brief Incremental SAX-style JSON tokenizer with bounded memory
+  ///
+  /// Input can be fed in arbitrarily sized pieces, tokens are emitted to the handler as soon as they are complete.
+  /// Memory usage is fixed: strings longer than MaxValueLength, keys longer than MaxKeyLength, or nesting deeper than MaxDepth make the document invalid.
+  class Parser {
+  public:
+    static const std::size_t MaxDepth       = 32;
+    static const std::size_t MaxKeyLength   = 32;
+    static const std::size_t MaxValueLength = 512;
+
+    enum class Result : uint8_t {
+      NeedMoreData,
+      Done,
+      Invalid,
+      Cancelled,
+    };
+
+    Parser(Handler& handler);
+
+    void reset();
+
+    Result feed(const uint8_t* data, std::size_t len);
+
+    /// @brief Signals end of input, flushing a trailing root-level number and running the handler's end validation
+    Result finish();
+
+  private:
+    enum class State : uint8_t {
+      Value,             // Expecting any value
+      ValueOrArrayEnd,   // Right after '['
+      KeyOrObjectEnd,    // Right after '{'
+      Key,               // Expecting a member name after ','
+      Colon,             // Expecting ':' after a member name
+      CommaOrEnd,        // After a member/element value
+      String,            // Inside a string
+      StringEscape,      // After a backslash inside a string
+      StringUnicode,     // Reading the hex digits of a \u escape
+      Number,            // Inside a number
+      Literal,           // Inside true, false or null
+      Done,
+      Invalid,
+      Cancelled,
+    };
+
+    bool _consume(uint8_t c);
+    bool _beginValue(uint8_t c);
+    bool _endValue();
+    bool _endNumber();
+    bool _endContainer(bool isObject);
+    bool _appendChar(char c);
+    bool _appendCodepoint(uint32_t codepoint);
+    bool _emit(TokenType type, std::string_view value = {});
+    bool _inObject() const { return m_depth > 0 && (m_objectBits & (1UL << (m_depth - 1))) != 0; }
+
+    Handler& m_handler;
+    State m_state;
+    uint8_t m_depth;
+    uint32_t m_objectBits;  // Bit (n - 1) is set if the container at depth n is an object
+    bool m_stringIsKey;
+    bool m_hasKey;
+    uint8_t m_unicodeDigits;
+    uint32_t m_unicodeValue;
+    uint16_t m_highSurrogate;
+    const char* m_literal;
+    uint8_t m_literalPos;
+    TokenType m_literalType;
+    uint8_t m_keyLen;
+    uint16_t m_valueLen;
+    char m_key[MaxKeyLength + 1];
+    char m_value[MaxValueLength + 1];
+  };
+
+  /// @brief Incremental JSON emitter, output goes through a small fixed buffer into a sink as it is produced
+  ///
+  /// Object members are written by calling key() before the member's value, e.g. beginObject(), key("a"), number(1), endObject().
+  /// Errors are sticky: after a sink failure or misuse every call is a no-op and finish() returns false.
+  class Writer {
+  public:
+    static const std::size_t MaxDepth   = 32;
+    static const std::size_t BufferSize = 128;
+
+    /// @brief Receives output in pieces of at most BufferSize bytes, returning false aborts writing
+    using Sink = std::function<bool(const char* data, std::size_t len)>;
+
+    Writer(Sink sink);
+
+    void key(std::string_view key);
+
+    void beginObject();
+    void endObject();
+    void beginArray();
+    void endArray();
+
+    void string(std::string_view value);
+    void number(int64_t value);
+    void boolean(bool value);
+    void null();
+
+    /// @brief Flushes buffered output, returns whether a single complete value was written
+    bool finish();
+
+    inline bool ok() const { return !m_failed; }
+
+  private:
+    bool _beginValue();
+    void _endContainer(bool isObject);
+    void _writeRaw(std::string_view data);
+    void _writeChar(char c);
+    void _writeEscaped(std::string_view str);
+    void _flush();
+
+    Sink m_sink;
+    bool m_failed;
+    bool m_hasKey;
+    bool m_done;
+    uint8_t m_depth;
+    uint32_t m_objectBits;     // Bit (n - 1) is set if the container at depth n is an object
+    uint32_t m_hasMemberBits;  // Bit (n - 1) is set once the container at depth n has its first member/element
+    std::size_t m_bufferLen;
+    char m_buffer[BufferSize];
+  };
+}  // namespace OpenShock::Serialization::JsonStream
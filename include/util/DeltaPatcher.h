@@ -0,0 +1,84 @@
+#pragma once
+
+#include "Common.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace OpenShock {
+  /// @brief Streaming applier for delta patches produced by scripts/make_delta_patch.py
+  ///
+  /// A patch rebuilds a target image from a base image (the running firmware) using bsdiff-style records:
+  /// "add diffLen patch bytes to the base bytes at the base cursor, copy extraLen patch bytes verbatim, move the base cursor by seek".
+  ///
+  /// Wire format (little endian):
+  ///   header:  "OSDELTA1" | baseSize u32 | targetSize u32 | baseHash[32] (SHA-256 of the base image)
+  ///   records: diffLen u32 | extraLen u32 | seek i32 | diff bytes | extra bytes
+  /// The patch ends once targetSize bytes have been produced.
+  class DeltaPatcher {
+    DISABLE_COPY(DeltaPatcher);
+    DISABLE_MOVE(DeltaPatcher);
+
+  public:
+    enum class Result : uint8_t {
+      NeedMoreData,
+      Done,
+      Invalid,
+      BaseMismatch,
+      Cancelled,
+    };
+
+    struct Header {
+      uint32_t baseSize;
+      uint32_t targetSize;
+      uint8_t baseHash[32];
+    };
+
+    /// @brief Reads base image bytes, only called with ranges inside the base size announced by the header
+    using ReadCallback   = std::function<bool(std::size_t offset, uint8_t* data, std::size_t len)>;
+    /// @brief Checks the patch was made against the base image this device has, returning false aborts with Result::BaseMismatch
+    using HeaderCallback = std::function<bool(const Header& header)>;
+    using OutputCallback = std::function<bool(const uint8_t* data, std::size_t len)>;
+
+    DeltaPatcher(ReadCallback readBase, HeaderCallback onHeader);
+
+    Result feed(const uint8_t* data, std::size_t len, const OutputCallback& onOutput);
+
+    inline bool isDone() const { return m_state == State::Done; }
+
+    /// @brief Size of the image the patch produces, only valid once the header has been parsed
+    inline std::size_t targetSize() const { return m_header.targetSize; }
+
+    /// @brief Number of target bytes produced so far
+    inline std::size_t outputSize() const { return m_targetOffset; }
+
+  private:
+    enum class State : uint8_t {
+      Header,
+      Control,
+      Diff,
+      Extra,
+      Done,
+      Invalid,
+    };
+
+    bool parseHeader();
+    bool parseControl();
+    void nextRecordOrDone();
+
+    ReadCallback m_readBase;
+    HeaderCallback m_onHeader;
+    State m_state;
+    Header m_header;
+    std::array<uint8_t, 48> m_scratch;  // Header and control record accumulator
+    std::size_t m_scratchFill;
+    std::size_t m_baseOffset;
+    std::size_t m_targetOffset;
+    uint32_t m_diffRemaining;
+    uint32_t m_extraRemaining;
+    int32_t m_seek;
+    std::array<uint8_t, 1024> m_buffer;  // Base bytes the diff is applied to
+  };
+}  // namespace OpenShock
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "Common.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+struct tinfl_decompressor_tag;
+
+namespace OpenShock {
+  /// @brief Streaming gzip (RFC 1952) decompressor backed by the ROM inflater
+  ///
+  /// Input can be fed in arbitrarily sized pieces, decompressed output is handed to the callback in pieces of at most 32KB.
+  /// Needs roughly 43KB of heap (decompressor state plus the 32KB LZ dictionary), which is taken from PSRAM when available.
+  class GzipDecompressor {
+    DISABLE_COPY(GzipDecompressor);
+    DISABLE_MOVE(GzipDecompressor);
+
+  public:
+    enum class Result : uint8_t {
+      NeedMoreData,
+      Done,
+      Invalid,
+      Cancelled,
+    };
+
+    using OutputCallback = std::function<bool(const uint8_t* data, std::size_t len)>;
+
+    GzipDecompressor();
+    ~GzipDecompressor();
+
+    inline bool ok() const { return m_inflator != nullptr && m_dict != nullptr; }
+
+    Result feed(const uint8_t* data, std::size_t len, const OutputCallback& onOutput);
+
+    inline bool isDone() const { return m_state == State::Trailer || m_state == State::Done; }
+
+    /// @brief Total number of decompressed bytes produced so far
+    inline std::size_t outputSize() const { return m_outputSize; }
+
+  private:
+    enum class State : uint8_t {
+      Magic1,
+      Magic2,
+      Method,
+      Flags,
+      Skip,  // Fixed-size header fields (MTIME, XFL, OS, XLEN payload, header CRC)
+      ExtraLen1,
+      ExtraLen2,
+      FileName,
+      Comment,
+      Deflate,
+      Trailer,
+      Done,
+      Invalid,
+    };
+
+    bool consumeHeaderByte(uint8_t c);
+    void advanceHeader();
+
+    State m_state;
+    State m_afterSkip;
+    uint8_t m_flags;
+    uint16_t m_skipRemaining;
+    uint8_t m_trailerRemaining;
+    tinfl_decompressor_tag* m_inflator;
+    uint8_t* m_dict;
+    std::size_t m_dictOffset;
+    std::size_t m_outputSize;
+  };
+}  // namespace OpenShock
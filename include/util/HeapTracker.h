@@ -0,0 +1,80 @@
+#pragma once
+
+#include "Common.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Define as 1 to account every malloc and new by allocation site, listed by the heap serial command.
+// Needs malloc, calloc, realloc and free wrapped at link time, scripts/embed_env_vars.py adds the linker flags when this is set.
+#ifndef OPENSHOCK_HEAP_TRACKING
+#define OPENSHOCK_HEAP_TRACKING 0
+#endif
+
+#if OPENSHOCK_HEAP_TRACKING
+/// @brief Attributes allocations made by this task until the end of the enclosing scope to a TAG instead of the calling PC
+#define OS_HEAP_SITE(tag) OpenShock::HeapTracker::ScopedSite heapSite__(tag)
+#else
+#define OS_HEAP_SITE(tag) static_cast<void>(0)
+#endif
+
+namespace OpenShock::HeapTracker {
+  struct HeapInfo {
+    uint32_t freeBytes;
+    uint32_t minFreeBytes;
+    uint32_t largestFreeBlock;
+  };
+
+  /// @brief Free, lowest free and largest free block of the 8-bit capable heap, available in every build
+  HeapInfo GetHeapInfo();
+
+#if OPENSHOCK_HEAP_TRACKING
+  struct SiteStats {
+    const char* tag;  // nullptr if the site is a PC
+    uintptr_t pc;     // Return address of the allocating call, decode with addr2line
+    uint32_t liveBytes;
+    uint32_t liveCount;
+    uint32_t allocs;  // Since the last reset
+    uint64_t allocBytes;
+  };
+
+  struct Totals {
+    uint32_t liveBytes;
+    uint32_t liveCount;
+    uint32_t peakLiveBytes;
+    uint32_t allocs;     // Since the last reset
+    uint32_t frees;      // Since the last reset
+    uint32_t untracked;  // Allocations that didn't fit in the pointer table since the last reset
+  };
+
+  struct TrendSample {
+    uint32_t uptimeS;
+    uint32_t freeBytes;
+    uint32_t largestFreeBlock;
+    uint32_t liveBytes;
+    uint32_t allocsPerMinute;
+  };
+
+  class ScopedSite {
+    DISABLE_COPY(ScopedSite);
+    DISABLE_MOVE(ScopedSite);
+  public:
+    ScopedSite(const char* tag);
+    ~ScopedSite();
+  private:
+    const char* m_previous;
+  };
+
+  /// @brief Starts sampling the heap trend, allocations are tracked from boot regardless
+  bool Init();
+
+  Totals GetTotals();
+  /// @brief Every site that allocated since boot, most live bytes first
+  std::vector<SiteStats> GetSites();
+  /// @brief Oldest sample first
+  std::vector<TrendSample> GetTrend();
+  /// @brief Clears the counters and the trend, live allocations stay tracked
+  void Reset();
+#endif
+}  // namespace OpenShock::HeapTracker
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "OtaImageEncoding.h"
+
 #include <esp_partition.h>
 
 #include <cstdint>
@@ -8,5 +10,12 @@
 
 namespace OpenShock {
   bool TryGetPartitionHash(const esp_partition_t* partition, char (&hash)[65]);
-  bool FlashPartitionFromUrl(const esp_partition_t* partition, std::string_view remoteUrl, const uint8_t (&remoteHash)[32], std::function<bool(std::size_t, std::size_t, float)> progressCallback = nullptr);
+  /// @brief Gets the SHA-256 of the image in a partition, as listed in a release's hashes.sha256.txt, from the config cache when it is still valid
+  /// @note Data partitions are hashed and cached on a miss, app partitions are only known once an image has been flashed through CachePartitionImageHash
+  bool TryGetPartitionImageHash(const esp_partition_t* partition, uint8_t (&hash)[32]);
+  /// @brief Records the SHA-256 of an image that was just flashed and verified, along with the firmware version it belongs to
+  bool CachePartitionImageHash(const esp_partition_t* partition, const uint8_t (&hash)[32], std::string_view firmwareVersion);
+  bool FlashPartitionFromUrl(const esp_partition_t* partition, std::string_view remoteUrl, const uint8_t (&remoteHash)[32], std::function<bool(std::size_t, std::size_t, float)> progressCallback = nullptr, OtaImageEncoding encoding = OtaImageEncoding::Raw);
+  /// @brief Rebuilds an image from a delta patch against the image in basePartition (normally the running app), fails if the patch was made for a different base
+  bool FlashPartitionFromPatchUrl(const esp_partition_t* partition, const esp_partition_t* basePartition, std::string_view patchUrl, const uint8_t (&remoteHash)[32], std::function<bool(std::size_t, std::size_t, float)> progressCallback = nullptr);
 }
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "Common.h"
+
+#include <esp_partition.h>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+#include <atomic>
+#include <cstdint>
+
+namespace OpenShock {
+  /// @brief Pipelined partition writer, buffers are filled by the caller and flashed by a dedicated writer task
+  ///
+  /// The writer task erases flash sectors just ahead of the write cursor instead of erasing the whole partition up front, so the caller can keep receiving (and hashing) data while the previous buffers are being erased and written.
+  class PartitionWriter {
+    DISABLE_COPY(PartitionWriter);
+    DISABLE_MOVE(PartitionWriter);
+
+  public:
+    struct Stats {
+      std::size_t bytesWritten;  // Bytes written since startOffset
+      int64_t eraseUs;           // Time spent erasing flash
+      int64_t writeUs;           // Time spent writing flash
+      int64_t stallUs;           // Time the caller spent waiting for a free buffer (i.e. flash was the bottleneck)
+    };
+
+    /// @param partition The partition to write to
+    /// @param startOffset Offset into the partition to start writing at, everything before it is left untouched
+    PartitionWriter(const esp_partition_t* partition, std::size_t startOffset = 0);
+    ~PartitionWriter();
+
+    inline bool ok() const { return m_taskHandle != nullptr && !m_failed.load(); }
+
+    /// @brief Copies data into the pipeline, blocks only if all buffers are waiting to be flashed
+    bool write(const uint8_t* data, std::size_t length);
+
+    /// @brief Flushes all pending data and waits for the writer task to finish, the rest of a data partition is erased after the image
+    /// @remark Only call this once the whole image arrived and was verified, use abort() otherwise
+    bool finish();
+
+    /// @brief Drops all pending data and stops the writer task, without erasing anything past what was already written
+    void abort();
+
+    /// @brief Offset of the next byte to be written (including bytes still in flight)
+    inline std::size_t offset() const { return m_offset; }
+
+    /// @brief Returns pipeline timing statistics, only valid after finish()
+    inline const Stats& stats() const { return m_stats; }
+
+  private:
+    struct Block {
+      uint8_t index;
+      uint32_t length;  // 0 marks end of stream
+    };
+
+    void destroy();
+    bool submitCurrent();
+    bool stop();
+    void WriterTask();
+    bool eraseUpTo(std::size_t end);
+
+    const esp_partition_t* m_partition;
+    std::size_t m_startOffset;
+    std::size_t m_offset;       // Producer side cursor
+    std::size_t m_writeOffset;  // Writer task cursor
+    std::size_t m_erasedUpTo;   // Writer task erase cursor
+    uint8_t* m_buffers;
+    std::size_t m_bufferSize;
+    uint8_t m_bufferCount;
+    int16_t m_currentIndex;
+    std::size_t m_currentFill;
+    QueueHandle_t m_freeQueue;
+    QueueHandle_t m_fullQueue;
+    SemaphoreHandle_t m_doneSemaphore;
+    TaskHandle_t m_taskHandle;
+    std::atomic<bool> m_failed;
+    std::atomic<bool> m_aborting;
+    bool m_stopped;
+    Stats m_stats;
+  };
+}  // namespace OpenShock
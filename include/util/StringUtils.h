@@ -2,7 +2,10 @@
 
 #include <WString.h>
 
+#include <cctype>
+#include <cstddef>
 #include <cstdint>
+#include <iterator>
 #include <limits>
 #include <string>
 #include <string_view>
@@ -58,9 +61,217 @@ namespace OpenShock {
 
     return idx == N;
   }
-  std::vector<std::string_view> StringSplit(const std::string_view view, char delimiter, std::size_t maxSplits = std::numeric_limits<std::size_t>::max());
-  std::vector<std::string_view> StringSplit(const std::string_view view, bool (*predicate)(char delimiter), std::size_t maxSplits = std::numeric_limits<std::size_t>::max());
-  std::vector<std::string_view> StringSplitNewLines(const std::string_view view, std::size_t maxSplits = std::numeric_limits<std::size_t>::max());
-  std::vector<std::string_view> StringSplitWhiteSpace(const std::string_view view, std::size_t maxSplits = std::numeric_limits<std::size_t>::max());
+
+  /// @brief Lazy range over the parts of a view split on a delimiter, the parts are views into it so iterating never allocates.
+  /// @remark Empty parts between adjacent delimiters are kept, a trailing delimiter does not add an empty part, and after maxSplits parts the unsplit remainder is the last part.
+  class StringSplitRange {
+  public:
+    class Iterator {
+    public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type        = std::string_view;
+      using difference_type   = std::ptrdiff_t;
+      using pointer           = const std::string_view*;
+      using reference         = const std::string_view&;
+
+      constexpr Iterator()
+        : m_rest()
+        , m_part()
+        , m_delimiter('\0')
+        , m_splitsLeft(0)
+        , m_done(true)
+      {
+      }
+      constexpr Iterator(std::string_view view, char delimiter, std::size_t maxSplits)
+        : m_rest(view)
+        , m_part()
+        , m_delimiter(delimiter)
+        , m_splitsLeft(maxSplits)
+        , m_done(false)
+      {
+        advance();
+      }
+
+      constexpr reference operator*() const { return m_part; }
+      constexpr pointer operator->() const { return &m_part; }
+
+      constexpr Iterator& operator++() {
+        advance();
+        return *this;
+      }
+      constexpr Iterator operator++(int) {
+        Iterator it = *this;
+        advance();
+        return it;
+      }
+
+      constexpr bool operator==(const Iterator& other) const { return m_done == other.m_done && (m_done || (m_part.data() == other.m_part.data() && m_part.size() == other.m_part.size())); }
+      constexpr bool operator!=(const Iterator& other) const { return !(*this == other); }
+
+    private:
+      constexpr void advance() {
+        if (m_rest.empty()) {
+          m_done = true;
+          return;
+        }
+
+        std::size_t pos = m_splitsLeft != 0 ? m_rest.find(m_delimiter) : std::string_view::npos;
+        if (pos == std::string_view::npos) {
+          m_part = m_rest;
+          m_rest = std::string_view();
+          return;
+        }
+
+        m_part = m_rest.substr(0, pos);
+        m_rest = m_rest.substr(pos + 1);
+        --m_splitsLeft;
+      }
+
+      std::string_view m_rest;
+      std::string_view m_part;
+      char m_delimiter;
+      std::size_t m_splitsLeft;
+      bool m_done;
+    };
+
+    constexpr StringSplitRange(std::string_view view, char delimiter, std::size_t maxSplits)
+      : m_view(view)
+      , m_delimiter(delimiter)
+      , m_maxSplits(maxSplits)
+    {
+    }
+
+    constexpr Iterator begin() const { return Iterator(m_view, m_delimiter, m_maxSplits); }
+    constexpr Iterator end() const { return Iterator(); }
+
+  private:
+    std::string_view m_view;
+    char m_delimiter;
+    std::size_t m_maxSplits;
+  };
+
+  /// @brief Lazy range over the runs of a view between characters matching a predicate, the parts are views into it so iterating never allocates.
+  /// @remark Runs of delimiters are skipped, so no part is ever empty, and after maxSplits parts the remainder, without its leading delimiters, is the last part.
+  class StringTokenRange {
+  public:
+    using Predicate = bool (*)(char c);
+
+    class Iterator {
+    public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type        = std::string_view;
+      using difference_type   = std::ptrdiff_t;
+      using pointer           = const std::string_view*;
+      using reference         = const std::string_view&;
+
+      constexpr Iterator()
+        : m_rest()
+        , m_part()
+        , m_predicate(nullptr)
+        , m_splitsLeft(0)
+        , m_done(true)
+      {
+      }
+      constexpr Iterator(std::string_view view, Predicate predicate, std::size_t maxSplits)
+        : m_rest(view)
+        , m_part()
+        , m_predicate(predicate)
+        , m_splitsLeft(maxSplits)
+        , m_done(false)
+      {
+        advance();
+      }
+
+      constexpr reference operator*() const { return m_part; }
+      constexpr pointer operator->() const { return &m_part; }
+
+      constexpr Iterator& operator++() {
+        advance();
+        return *this;
+      }
+      constexpr Iterator operator++(int) {
+        Iterator it = *this;
+        advance();
+        return it;
+      }
+
+      constexpr bool operator==(const Iterator& other) const { return m_done == other.m_done && (m_done || (m_part.data() == other.m_part.data() && m_part.size() == other.m_part.size())); }
+      constexpr bool operator!=(const Iterator& other) const { return !(*this == other); }
+
+    private:
+      constexpr void advance() {
+        std::size_t start = 0;
+        while (start < m_rest.size() && m_predicate(m_rest[start])) {
+          ++start;
+        }
+
+        if (start == m_rest.size()) {
+          m_done = true;
+          return;
+        }
+
+        std::size_t end = start;
+        if (m_splitsLeft != 0) {
+          while (end < m_rest.size() && !m_predicate(m_rest[end])) {
+            ++end;
+          }
+          --m_splitsLeft;
+        } else {
+          end = m_rest.size();
+        }
+
+        m_part = m_rest.substr(start, end - start);
+        m_rest = m_rest.substr(end);
+      }
+
+      std::string_view m_rest;
+      std::string_view m_part;
+      Predicate m_predicate;
+      std::size_t m_splitsLeft;
+      bool m_done;
+    };
+
+    constexpr StringTokenRange(std::string_view view, Predicate predicate, std::size_t maxSplits)
+      : m_view(view)
+      , m_predicate(predicate)
+      , m_maxSplits(maxSplits)
+    {
+    }
+
+    constexpr Iterator begin() const { return Iterator(m_view, m_predicate, m_maxSplits); }
+    constexpr Iterator end() const { return Iterator(); }
+
+  private:
+    std::string_view m_view;
+    Predicate m_predicate;
+    std::size_t m_maxSplits;
+  };
+
+  constexpr StringSplitRange StringSplit(const std::string_view view, char delimiter, std::size_t maxSplits = std::numeric_limits<std::size_t>::max()) {
+    return StringSplitRange(view, delimiter, maxSplits);
+  }
+  constexpr StringTokenRange StringSplit(const std::string_view view, bool (*predicate)(char delimiter), std::size_t maxSplits = std::numeric_limits<std::size_t>::max()) {
+    return StringTokenRange(view, predicate, maxSplits);
+  }
+  constexpr StringTokenRange StringSplitNewLines(const std::string_view view, std::size_t maxSplits = std::numeric_limits<std::size_t>::max()) {
+    return StringTokenRange(view, [](char c) { return c == '\r' || c == '\n'; }, maxSplits);
+  }
+  inline StringTokenRange StringSplitWhiteSpace(const std::string_view view, std::size_t maxSplits = std::numeric_limits<std::size_t>::max()) {
+    return StringTokenRange(view, [](char c) { return isspace(c) != 0; }, maxSplits);
+  }
+  /// @brief Copies the first N parts of a split into out, without allocating.
+  /// @return The number of parts in the whole split, which is larger than N if some did not fit.
+  template<typename Range, std::size_t N>
+  constexpr std::size_t StringSplitInto(const Range& range, std::string_view (&out)[N]) {
+    std::size_t count = 0;
+    for (std::string_view part : range) {
+      if (count < N) {
+        out[count] = part;
+      }
+      ++count;
+    }
+
+    return count;
+  }
   String StringToArduinoString(std::string_view view);
 }  // namespace OpenShock
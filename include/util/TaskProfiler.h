@@ -0,0 +1,28 @@
+#pragma once
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Tracks the tasks created through TaskUtils so their stack budgets can be sized from measurements instead of guesses.
+// Sampling lists every task the scheduler knows about, tasks that weren't created through TaskUtils just have no stack size.
+namespace OpenShock::TaskProfiler {
+  struct TaskStats {
+    std::string name;
+    BaseType_t core;          // tskNO_AFFINITY if the task may run on either core
+    UBaseType_t priority;
+    uint32_t stackSize;       // Bytes, 0 if the task wasn't created through TaskUtils
+    uint32_t stackHighWater;  // Bytes of stack never used since the task started
+    int32_t cpuPermille;      // Share of one core since the previous sample, -1 if runtime stats aren't compiled in
+    int32_t heapBytes;        // Heap currently allocated by the task, -1 if heap task tracking isn't compiled in
+  };
+
+  /// @brief Called by TaskUtils for every task it creates
+  void RegisterTask(TaskHandle_t handle, const char* name, uint32_t stackSize, BaseType_t core);
+
+  /// @brief Samples every running task, CPU usage is measured since the previous call
+  bool GetTaskStats(std::vector<TaskStats>& out);
+}  // namespace OpenShock::TaskProfiler
@@ -21,7 +21,8 @@ namespace OpenShock {
     int8_t rssi;
     wifi_auth_mode_t authMode;
     uint8_t credentialsID;
-    uint16_t connectAttempts;  // TODO: Add connectSuccesses as well, so we can track the success rate of a network
+    uint16_t connectAttempts;
+    uint16_t connectSuccesses;
     int64_t lastConnectAttempt;
     uint8_t scansMissed;
   };
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Common.h"
+#include "wifi/WiFiNetwork.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <set>
+#include <vector>
+
+namespace OpenShock {
+  /// @brief Discovered networks keyed by BSSID, kept ranked by how attractive they are to connect to
+  ///
+  /// Lookups by BSSID go through an open-addressing index, and the ranking is kept up to date one entry at a time,
+  /// so merging a scan record or picking a network to connect to stays O(log n) however many access points are around.
+  /// Entries must only be changed through modify() and modifyAll(), which keep the ranking consistent.
+  class WiFiNetworkTable {
+    DISABLE_COPY(WiFiNetworkTable);
+    DISABLE_MOVE(WiFiNetworkTable);
+
+  public:
+    WiFiNetworkTable();
+
+    inline std::size_t size() const { return m_rank.size(); }
+    inline bool empty() const { return m_rank.empty(); }
+
+    const WiFiNetwork* find(const uint8_t (&bssid)[6]) const;
+
+    /// @brief Inserts the network, or replaces the scan info of the entry with the same BSSID while keeping its connection statistics
+    /// @return True if the network was not in the table yet
+    bool upsert(const WiFiNetwork& network);
+
+    bool remove(const uint8_t (&bssid)[6]);
+    void removeIf(const std::function<bool(const WiFiNetwork&)>& predicate);
+
+    bool modify(const uint8_t (&bssid)[6], const std::function<void(WiFiNetwork&)>& fn);
+    void modifyAll(const std::function<void(WiFiNetwork&)>& fn);
+
+    /// @brief Returns the most attractive network matching the predicate, or nullptr
+    const WiFiNetwork* findBest(const std::function<bool(const WiFiNetwork&)>& predicate) const;
+
+    /// @brief Copies all networks, most attractive first
+    std::vector<WiFiNetwork> toVector() const;
+
+    /// @brief Strict weak ordering by attractivity: saved networks first, then fewest failed connects, then strongest signal
+    static bool IsMoreAttractive(const WiFiNetwork& a, const WiFiNetwork& b);
+
+  private:
+    struct RankCompare {
+      const std::vector<WiFiNetwork>* entries;
+      inline bool operator()(uint16_t a, uint16_t b) const { return IsMoreAttractive((*entries)[a], (*entries)[b]); }
+    };
+
+    static constexpr uint16_t EmptySlot = 0xFFFF;
+
+    std::size_t _findSlot(const uint8_t (&bssid)[6]) const;
+    void _insertIndex(uint16_t entry);
+    void _removeIndex(std::size_t slot);
+    void _growIndex();
+
+    std::vector<WiFiNetwork> m_entries;  // Stable storage, indices stay valid until the entry is removed
+    std::vector<uint16_t> m_freeEntries;
+    std::vector<uint16_t> m_slots;       // Open-addressing index from BSSID to entry, linear probing, power-of-two size
+    std::set<uint16_t, RankCompare> m_rank;
+  };
+}  // namespace OpenShock
@@ -12,7 +12,8 @@ namespace OpenShock::WiFiScanManager {
 
   bool IsScanning();
 
-  bool StartScan();
+  /// @param channelMask Channels to scan, bit n selects channel n. 0 scans every channel
+  bool StartScan(uint16_t channelMask = 0);
   bool AbortScan();
 
   typedef std::function<void(OpenShock::WiFiScanStatus)> StatusChangedHandler;
@@ -0,0 +1,202 @@
+#!/bin/python3
+#
+# Decodes the output of a firmware built with OPENSHOCK_LOG_BINARY=1 (see include/BinaryLog.h) back into text log lines.
+#
+# Usage: decode_binary_log.py <firmware.elf> [<serial port> | <capture file> | -]
+#
+# Format strings, file names, function names and TAGs are read from the ELF the firmware was built from, so it must be the exact
+# same build (.pio/build/<board>/firmware.elf). Anything on the stream that isn't a valid frame is passed through as text.
+# Requires pyelftools, and pyserial when reading from a serial port.
+
+import re
+import struct
+import sys
+import zlib
+
+from elftools.elf.elffile import ELFFile
+
+BAUD_RATE = 115200
+
+ARG_U32 = 1
+ARG_U64 = 2
+ARG_F64 = 3
+ARG_PTR = 4
+ARG_ROM_STR = 5
+ARG_RAM_STR = 6
+
+CONVERSION = re.compile(rb'%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d*))?(hh|h|ll|l|L|z|j|t|q)?([diouxXeEfFgGaAcspn%])')
+
+
+class Rom:
+    def __init__(self, path: str):
+        self.segments = []
+        with open(path, 'rb') as f:
+            elf = ELFFile(f)
+            for section in elf.iter_sections():
+                if section['sh_type'] == 'SHT_PROGBITS' and section['sh_flags'] & 0x2 and section['sh_addr'] != 0:  # SHF_ALLOC
+                    self.segments.append((section['sh_addr'], section.data()))
+
+    def string(self, addr: int) -> bytes:
+        for start, data in self.segments:
+            if start <= addr < start + len(data):
+                end = data.find(b'\x00', addr - start)
+                return data[addr - start : end if end >= 0 else len(data)]
+        return b'<unknown string 0x%08x>' % addr
+
+
+def cobs_decode(data: bytes) -> bytes:
+    out = bytearray()
+    pos = 0
+    while pos < len(data):
+        code = data[pos]
+        if code == 0 or pos + code > len(data):
+            raise ValueError('Malformed COBS frame')
+        out += data[pos + 1 : pos + code]
+        pos += code
+        if code != 0xFF and pos < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def parse_args(data: bytes, rom: Rom) -> list:
+    args = []
+    pos = 0
+    while pos < len(data):
+        arg_type = data[pos]
+        pos += 1
+        if arg_type == ARG_U32 or arg_type == ARG_PTR:
+            args.append((arg_type, struct.unpack_from('<I', data, pos)[0]))
+            pos += 4
+        elif arg_type == ARG_U64:
+            args.append((arg_type, struct.unpack_from('<Q', data, pos)[0]))
+            pos += 8
+        elif arg_type == ARG_F64:
+            args.append((arg_type, struct.unpack_from('<d', data, pos)[0]))
+            pos += 8
+        elif arg_type == ARG_ROM_STR:
+            args.append((arg_type, rom.string(struct.unpack_from('<I', data, pos)[0])))
+            pos += 4
+        elif arg_type == ARG_RAM_STR:
+            length = data[pos]
+            args.append((arg_type, data[pos + 1 : pos + 1 + length]))
+            pos += 1 + length
+        else:
+            raise ValueError('Unknown argument type %d' % arg_type)
+    return args
+
+
+def to_signed(arg_type: int, value: int) -> int:
+    bits = 64 if arg_type == ARG_U64 else 32
+    return value - (1 << bits) if value >= 1 << (bits - 1) else value
+
+
+def format_c(fmt: bytes, args: list) -> bytes:
+    args = list(args)
+
+    def next_arg():
+        return args.pop(0) if args else (ARG_U32, 0)
+
+    def convert(match) -> bytes:
+        flags, width, precision, _, conversion = match.groups()
+        if conversion == b'%':
+            return b'%'
+        if conversion == b'n':
+            return b''
+
+        if width == b'*':
+            width = b'%d' % to_signed(*next_arg())
+        if precision == b'*':
+            precision = b'%d' % max(to_signed(*next_arg()), 0)
+
+        arg_type, value = next_arg()
+
+        if conversion == b's':
+            if not isinstance(value, bytes):
+                value = b'%d' % value
+            if precision is not None:
+                value = value[: int(precision or b'0')]
+            return (b'%' + flags + (width or b'') + b's') % value
+        if conversion == b'p':
+            return b'0x%08x' % value
+        if conversion == b'c':
+            return bytes([value & 0xFF])
+        if conversion in b'di':
+            value = to_signed(arg_type, value)
+            conversion = b'd'
+        elif conversion == b'u':
+            conversion = b'd'
+        elif conversion in b'aA':
+            return float(value).hex().encode()
+
+        spec = b'%' + flags + (width or b'') + (b'.' + precision if precision is not None else b'') + conversion
+        return spec % value
+
+    return CONVERSION.sub(convert, fmt)
+
+
+def decode_frame(frame: bytes, rom: Rom) -> bytes:
+    fmt_addr, timestamp, core = struct.unpack_from('<IqB', frame)
+    args = parse_args(frame[13:], rom)
+    millis = timestamp // 1000
+
+    if fmt_addr == 0:
+        return b'[%d][W] %d log records dropped on core %d\r\n' % (millis, args[0][1], core)
+
+    return b'[%d]' % millis + format_c(rom.string(fmt_addr), args)
+
+
+def handle_chunk(chunk: bytes, rom: Rom, out):
+    if not chunk:
+        return
+
+    try:
+        frame = cobs_decode(chunk)
+        valid = len(frame) >= 17 and zlib.crc32(frame[:-4]) == struct.unpack_from('<I', frame, len(frame) - 4)[0]
+    except ValueError:
+        valid = False
+
+    out.write(decode_frame(frame[:-4], rom) if valid else chunk)
+    out.flush()
+
+
+def open_input(path: str):
+    if path == '-':
+        return sys.stdin.buffer
+    if path.startswith('/dev/') or path.upper().startswith('COM'):
+        import serial
+
+        return serial.Serial(path, BAUD_RATE, timeout=1)
+    return open(path, 'rb')
+
+
+def main():
+    if len(sys.argv) not in (2, 3):
+        print('Usage: %s <firmware.elf> [<serial port> | <capture file> | -]' % sys.argv[0])
+        sys.exit(1)
+
+    rom = Rom(sys.argv[1])
+    source = open_input(sys.argv[2] if len(sys.argv) == 3 else '-')
+    out = sys.stdout.buffer
+
+    read = getattr(source, 'read1', source.read)  # Don't wait for a full block from a pipe
+
+    chunk = bytearray()
+    while True:
+        data = read(256)
+        if not data:
+            if not hasattr(source, 'in_waiting'):
+                break
+            continue
+
+        for byte in data:
+            if byte == 0:
+                handle_chunk(bytes(chunk), rom, out)
+                chunk.clear()
+            else:
+                chunk.append(byte)
+
+    handle_chunk(bytes(chunk), rom, out)
+
+
+if __name__ == '__main__':
+    main()
@@ -156,6 +156,31 @@ def serialize_cpp_defines(raw_defines: dict[str, str | int | bool]) -> dict[str,
     return result_defines
 
 
+# The firmware stores prerelease and build in fixed buffers (SemVer::MaxPrereleaseLength and SemVer::MaxBuildLength in include/SemVer.h),
+# a version that doesn't fit fails to compile. .github/scripts/get-vars.js applies the same limit to the branch name it puts in the prerelease.
+SEMVER_MAX_IDENTIFIER_LENGTH = 63
+
+
+def truncate_semver_identifiers(version: str) -> str:
+    match = re.match(r'^([^-+]+)(?:-([^+]*))?(?:\+(.*))?$', version)
+    if match is None:
+        return version
+
+    core, prerelease, build = match.groups()
+
+    result = core
+    if prerelease:
+        prerelease = prerelease[:SEMVER_MAX_IDENTIFIER_LENGTH].rstrip('-.')
+        if prerelease:
+            result += '-' + prerelease
+    if build:
+        build = build[:SEMVER_MAX_IDENTIFIER_LENGTH].rstrip('-.')
+        if build:
+            result += '+' + build
+
+    return result
+
+
 # Copy key/value pairs from "src" into "dest" only if those keys don't exist in "dest" yet.
 def merge_missing_keys(dest: dict[str, str | int | bool], src: Mapping[str, str | int | bool]):
     for k, v in src.items():
@@ -202,14 +227,35 @@ if 'OPENSHOCK_FW_VERSION' not in cpp_defines:
     # If not set, get the latest tag.
     cpp_defines['OPENSHOCK_FW_VERSION'] = version
 
+# Branch names can make the CI version longer than the firmware can hold.
+fw_version = truncate_semver_identifiers(str(cpp_defines['OPENSHOCK_FW_VERSION']))
+if fw_version != cpp_defines['OPENSHOCK_FW_VERSION']:
+    print(f'Truncated OPENSHOCK_FW_VERSION to {fw_version}')
+    cpp_defines['OPENSHOCK_FW_VERSION'] = fw_version
+
 # Gets the log level from environment variables.
 # TODO: Delete get_loglevel and use... something more generic.
 log_level_int = dot.get_loglevel('LOG_LEVEL')
 if log_level_int is None:
     raise ValueError('LOG_LEVEL must be set in environment variables.')
 cpp_defines['OPENSHOCK_LOG_LEVEL'] = log_level_int
+
+# Optional runtime default level, individual TAGs can then be raised up to LOG_LEVEL over serial without reflashing.
+log_default_level_int = dot.get_loglevel('LOG_DEFAULT_LEVEL')
+if log_default_level_int is not None:
+    if log_default_level_int > log_level_int:
+        raise ValueError('LOG_DEFAULT_LEVEL must not be more verbose than LOG_LEVEL.')
+    cpp_defines['OPENSHOCK_LOG_DEFAULT_LEVEL'] = log_default_level_int
 cpp_defines['CORE_DEBUG_LEVEL'] = 2 # Warning level. (FUCK Arduino)
 
+# Heap tracking accounts allocations in wrappers around the libc allocator, the linker has to route every call through them.
+if str(cpp_defines.get('OPENSHOCK_HEAP_TRACKING', '0')).lower() in ('1', 'true'):
+    env.Append(LINKFLAGS=['-Wl,--wrap=' + fn for fn in ('malloc', 'calloc', 'realloc', 'free')])
+
+# Debug builds panic on a task re-entering a ReadWriteMutex it holds, instead of deadlocking silently.
+if not is_release_build:
+    cpp_defines.setdefault('OPENSHOCK_RWMUTEX_CHECK_REENTRY', 1)
+
 # Serialize and inject CPP Defines.
 print_dump('CPP Defines', cpp_defines)
 
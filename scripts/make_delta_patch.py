@@ -0,0 +1,167 @@
+#!/bin/python3
+#
+# Creates a delta patch that turns one app image into another, applied on-device by OpenShock::DeltaPatcher.
+#
+# Usage: make_delta_patch.py <base app.bin> <target app.bin> <output .patch.gz>
+#
+# Exits successfully without writing the output if the patch fails self-verification, callers treat a missing patch as "no delta".
+#
+# The patch is a sequence of bsdiff-style records (diff bytes added to the base, extra bytes copied verbatim, base seek),
+# see include/util/DeltaPatcher.h for the wire format. It is gzip-compressed, the diff bytes of relocated code are mostly zeroes.
+
+import gzip
+import hashlib
+import struct
+import sys
+
+MAGIC = b'OSDELTA1'
+KEY_SIZE = 8  # Bytes used to look up match candidates in the base image
+MIN_MATCH = 16  # Shortest exact match worth starting a record for
+APPROX_LOOKAHEAD = 1024  # Give up extending a match after this many bytes without improvement
+
+
+def build_index(base: bytes) -> dict:
+    index = {}
+    for i in range(len(base) - KEY_SIZE + 1):
+        index.setdefault(base[i : i + KEY_SIZE], i)
+    return index
+
+
+def exact_length(base: bytes, base_pos: int, target: bytes, target_pos: int) -> int:
+    n = 0
+    limit = min(len(base) - base_pos, len(target) - target_pos)
+    while n < limit and base[base_pos + n] == target[target_pos + n]:
+        n += 1
+    return n
+
+
+def approximate_length(base: bytes, base_pos: int, target: bytes, target_pos: int) -> int:
+    # Same scoring as bsdiff: extend the match as long as more than half of the bytes still agree
+    matches = 0
+    best_score = 0
+    best_len = 0
+    limit = min(len(base) - base_pos, len(target) - target_pos)
+    for i in range(limit):
+        if base[base_pos + i] == target[target_pos + i]:
+            matches += 1
+        score = matches * 2 - (i + 1)
+        if score > best_score:
+            best_score = score
+            best_len = i + 1
+        elif i + 1 - best_len > APPROX_LOOKAHEAD:
+            break
+    return best_len
+
+
+def find_match(base: bytes, target: bytes, target_pos: int, index: dict, predicted_base_pos: int):
+    candidates = []
+    if 0 <= predicted_base_pos < len(base):
+        candidates.append(predicted_base_pos)  # Keep following the previous match, e.g. code that only moved
+    found = index.get(target[target_pos : target_pos + KEY_SIZE])
+    if found is not None:
+        candidates.append(found)
+
+    best = None
+    for base_pos in candidates:
+        length = exact_length(base, base_pos, target, target_pos)
+        if length >= MIN_MATCH and (best is None or length > best[1]):
+            best = (base_pos, length)
+    return best
+
+
+def make_patch(base: bytes, target: bytes) -> bytes:
+    index = build_index(base)
+
+    out = bytearray()
+    out += MAGIC
+    out += struct.pack('<II', len(base), len(target))
+    out += hashlib.sha256(base).digest()
+
+    # Current record: diff region [diff_base, diff_base + diff_len) applied at [diff_target, ...)
+    diff_base = 0
+    diff_target = 0
+    diff_len = 0
+
+    def emit(extra_end: int, next_base: int):
+        extra_start = diff_target + diff_len
+        seek = next_base - (diff_base + diff_len)
+        out.extend(struct.pack('<IIi', diff_len, extra_end - extra_start, seek))
+        out.extend((target[diff_target + i] - base[diff_base + i]) & 0xFF for i in range(diff_len))
+        out.extend(target[extra_start:extra_end])
+
+    target_pos = 0
+    while target_pos < len(target):
+        predicted = diff_base + (target_pos - diff_target)
+        match = find_match(base, target, target_pos, index, predicted)
+        if match is None:
+            target_pos += 1
+            continue
+
+        base_pos = match[0]
+        length = max(match[1], approximate_length(base, base_pos, target, target_pos))
+
+        emit(target_pos, base_pos)
+
+        diff_base = base_pos
+        diff_target = target_pos
+        diff_len = length
+        target_pos += length
+
+    emit(len(target), diff_base + diff_len)
+
+    return bytes(out)
+
+
+def apply_patch(base: bytes, patch: bytes) -> bytes:
+    assert patch[:8] == MAGIC
+    base_size, target_size = struct.unpack_from('<II', patch, 8)
+    assert base_size == len(base) and patch[16:48] == hashlib.sha256(base).digest()
+
+    out = bytearray()
+    pos = 48
+    base_pos = 0
+    while len(out) < target_size:
+        diff_len, extra_len, seek = struct.unpack_from('<IIi', patch, pos)
+        pos += 12
+        out.extend((patch[pos + i] + base[base_pos + i]) & 0xFF for i in range(diff_len))
+        pos += diff_len
+        base_pos += diff_len
+        out.extend(patch[pos : pos + extra_len])
+        pos += extra_len
+        base_pos += seek
+    assert pos == len(patch)
+
+    return bytes(out)
+
+
+def main():
+    if len(sys.argv) != 4:
+        print('Usage: %s <base app.bin> <target app.bin> <output .patch.gz>' % sys.argv[0])
+        sys.exit(1)
+
+    with open(sys.argv[1], 'rb') as f:
+        base = f.read()
+    with open(sys.argv[2], 'rb') as f:
+        target = f.read()
+
+    patch = make_patch(base, target)
+
+    # Never publish a patch that does not reproduce the target. A bad patch is skipped rather than failing the release,
+    # without it devices simply download the full image.
+    try:
+        verified = apply_patch(base, patch) == target
+    except (AssertionError, struct.error, IndexError):
+        verified = False
+    if not verified:
+        print('Warning: patch verification failed, no delta patch written')
+        sys.exit(0)
+
+    compressed = gzip.compress(patch, compresslevel=9, mtime=0)
+    with open(sys.argv[3], 'wb') as f:
+        f.write(compressed)
+
+    print('Delta patch: %d bytes (%d compressed) for a %d byte image' % (len(patch), len(compressed), len(target)))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,161 @@
+#!/bin/python3
+#
+# Measures shocker command round trips over USB serial, text console vs binary mode (see include/serial/BinaryProtocol.h).
+#
+# Usage: serial_binary_bench.py <port> [count]
+#
+# Sends zero-intensity vibrate commands, each one is timed until its "$SYS$|Success" line or its ack arrives.
+# Requires pyserial, which is installed alongside esptool.
+
+import struct
+import sys
+import time
+import zlib
+
+import serial
+
+BAUD_RATE = 115200
+SHOCKER_ID = 0
+MODEL_CAIXIANLIN = 0
+TYPE_VIBRATE = 2
+
+FRAME_SHOCKER_COMMAND_LIST = 0x01
+FRAME_EXIT = 0x02
+FRAME_ACK = 0x80
+
+
+def cobs_encode(data: bytes) -> bytes:
+    out = bytearray([0])
+    code_pos = 0
+    code = 1
+    for byte in data:
+        if byte != 0:
+            out.append(byte)
+            code += 1
+        if byte == 0 or code == 0xFF:
+            out[code_pos] = code
+            code_pos = len(out)
+            out.append(0)
+            code = 1
+    out[code_pos] = code
+    out.append(0)
+    return bytes(out)
+
+
+def cobs_decode(data: bytes) -> bytes:
+    out = bytearray()
+    pos = 0
+    while pos < len(data):
+        code = data[pos]
+        if code == 0 or pos + code > len(data):
+            raise ValueError('Malformed COBS frame')
+        out += data[pos + 1 : pos + code]
+        pos += code
+        if code != 0xFF and pos < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def shocker_command_list(commands) -> bytes:
+    # Hand-built ShockerCommandList flatbuffer: root offset, vtable, table with one vector field, vector of 8 byte structs
+    out = bytearray()
+    out += struct.pack('<I', 12)  # Root table offset
+    out += struct.pack('<HHH', 6, 8, 4)  # vtable: its size, table size, commands field offset
+    out += b'\x00\x00'  # Align table to 4 bytes
+    out += struct.pack('<i', 12 - 4)  # Table: offset back to the vtable
+    out += struct.pack('<I', 20 - 16)  # Table: offset to the commands vector
+    out += struct.pack('<I', len(commands))
+    for model, shocker_id, command_type, intensity, duration in commands:
+        out += struct.pack('<BxHBBH', model, shocker_id, command_type, intensity, duration)
+    return bytes(out)
+
+
+def make_frame(frame_type: int, sequence: int, payload: bytes = b'') -> bytes:
+    body = struct.pack('<BBH', frame_type, 0, sequence) + payload
+    return cobs_encode(body + struct.pack('<I', zlib.crc32(body)))
+
+
+def read_ack(port: serial.Serial, sequence: int) -> int:
+    buffer = bytearray()
+    while True:
+        byte = port.read(1)
+        if not byte:
+            raise TimeoutError('No ack for frame %d' % sequence)
+        if byte != b'\x00':
+            buffer += byte
+            continue
+
+        # Log text shares the port, anything that does not decode to a valid ack is skipped
+        try:
+            frame = cobs_decode(bytes(buffer))
+        except ValueError:
+            frame = b''
+        buffer.clear()
+
+        if len(frame) != 8 or zlib.crc32(frame[:4]) != struct.unpack_from('<I', frame, 4)[0]:
+            continue
+        frame_type, status, ack_sequence = struct.unpack_from('<BBH', frame)
+        if frame_type == FRAME_ACK and ack_sequence == sequence:
+            return status
+
+
+def bench_text(port: serial.Serial, count: int) -> list:
+    line = b'$rftransmit {"model":"caixianlin","id":%d,"type":"vibrate","intensity":0,"durationMs":300}\n' % SHOCKER_ID
+    timings = []
+    for _ in range(count):
+        start = time.perf_counter()
+        port.write(line)
+        while True:
+            response = port.readline()
+            if not response:
+                raise TimeoutError('No response to rftransmit')
+            if response.startswith(b'$SYS$|Success') or response.startswith(b'$SYS$|Error'):
+                break
+        timings.append(time.perf_counter() - start)
+    return timings
+
+
+def bench_binary(port: serial.Serial, count: int) -> list:
+    port.write(b'$binary\n')
+    while not port.readline().startswith(b'$SYS$|Success'):
+        pass
+
+    payload = shocker_command_list([(MODEL_CAIXIANLIN, SHOCKER_ID, TYPE_VIBRATE, 0, 300)])
+
+    timings = []
+    for sequence in range(1, count + 1):
+        start = time.perf_counter()
+        port.write(make_frame(FRAME_SHOCKER_COMMAND_LIST, sequence, payload))
+        status = read_ack(port, sequence)
+        timings.append(time.perf_counter() - start)
+        if status != 0:
+            print('Frame %d was acked with status %d' % (sequence, status))
+
+    port.write(make_frame(FRAME_EXIT, count + 1))
+    read_ack(port, count + 1)
+
+    return timings
+
+
+def summarize(name: str, timings: list):
+    timings = sorted(timings)
+    mean = sum(timings) / len(timings)
+    p99 = timings[min(len(timings) - 1, int(len(timings) * 0.99))]
+    print('%-6s mean %6.2f ms, p99 %6.2f ms, %6.1f commands/s' % (name, mean * 1000, p99 * 1000, 1 / mean))
+
+
+def main():
+    if len(sys.argv) not in (2, 3):
+        print('Usage: %s <port> [count]' % sys.argv[0])
+        sys.exit(1)
+
+    count = int(sys.argv[2]) if len(sys.argv) == 3 else 200
+
+    with serial.Serial(sys.argv[1], BAUD_RATE, timeout=2) as port:
+        port.reset_input_buffer()
+        summarize('text', bench_text(port, count))
+        summarize('binary', bench_binary(port, count))
+
+
+if __name__ == '__main__':
+    main()
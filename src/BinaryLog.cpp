@@ -0,0 +1,213 @@
+#include <freertos/FreeRTOS.h>
+
+#include "BinaryLog.h"
+
+// Compiled out entirely otherwise, the ring buffers would cost RAM for nothing
+#if OPENSHOCK_LOG_BINARY
+
+const char* const TAG = "BinaryLog";
+
+#include "Logging.h"
+#include "serial/BinaryProtocol.h"
+#include "util/TaskUtils.h"
+
+#include <Arduino.h>
+
+#include <esp_rom_crc.h>
+#include <esp_timer.h>
+
+#include <atomic>
+
+#ifndef OPENSHOCK_LOG_BINARY_BUFFER_SIZE
+#define OPENSHOCK_LOG_BINARY_BUFFER_SIZE 4096
+#endif
+
+using namespace OpenShock;
+
+const uint32_t BINARY_LOG_BUFFER_SIZE = OPENSHOCK_LOG_BINARY_BUFFER_SIZE;  // Per core
+const uint32_t BINARY_LOG_BUFFER_MASK = BINARY_LOG_BUFFER_SIZE - 1;
+const uint32_t RECORD_HEADER_SIZE     = 16;           // commit word + format address + timestamp
+const uint32_t RECORD_PADDING_FLAG    = 0x8000'0000;  // Set in the commit word of the filler before a wrap-around
+const std::size_t FRAME_MAX_SIZE      = BinaryLog::MaxRecordSize + 1 + 4;  // + core - commit word + crc32
+
+static_assert((BINARY_LOG_BUFFER_SIZE & BINARY_LOG_BUFFER_MASK) == 0, "OPENSHOCK_LOG_BINARY_BUFFER_SIZE must be a power of two");
+static_assert(BINARY_LOG_BUFFER_SIZE >= 2 * BinaryLog::MaxRecordSize, "OPENSHOCK_LOG_BINARY_BUFFER_SIZE is too small to hold records");
+
+// Records are 4-byte aligned and never wrap, each starts with a commit word holding its unpadded size once it is fully written.
+// Writers reserve space by advancing head with a CAS, the drain task consumes committed records from tail and zeroes them again.
+struct RingBuffer {
+  std::atomic<uint32_t> head;  // Total bytes ever reserved
+  std::atomic<uint32_t> tail;  // Total bytes ever drained
+  std::atomic<uint32_t> dropped;
+  alignas(8) uint8_t data[BINARY_LOG_BUFFER_SIZE];
+};
+
+static RingBuffer s_buffers[portNUM_PROCESSORS];
+static BinaryLog::Sink s_sink = nullptr;
+
+static uint32_t _alignRecordSize(uint32_t size)
+{
+  return (size + 3) & ~3U;
+}
+
+bool BinaryLog::Internal::BeginRecord(const char* format, std::size_t argsSize, Reservation& reservation)
+{
+  RingBuffer& ring = s_buffers[xPortGetCoreID()];
+
+  uint32_t size = RECORD_HEADER_SIZE + argsSize;
+  if (size > MaxRecordSize) {
+    ring.dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  uint32_t stride = _alignRecordSize(size);
+
+  uint32_t head = ring.head.load(std::memory_order_relaxed);
+  uint32_t padding;
+  do {
+    uint32_t offset = head & BINARY_LOG_BUFFER_MASK;
+    padding         = offset + stride > BINARY_LOG_BUFFER_SIZE ? BINARY_LOG_BUFFER_SIZE - offset : 0;
+
+    if (head + padding + stride - ring.tail.load(std::memory_order_acquire) > BINARY_LOG_BUFFER_SIZE) {
+      ring.dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+  } while (!ring.head.compare_exchange_weak(head, head + padding + stride, std::memory_order_acq_rel, std::memory_order_relaxed));
+
+  if (padding != 0) {
+    __atomic_store_n(reinterpret_cast<uint32_t*>(ring.data + (head & BINARY_LOG_BUFFER_MASK)), padding | RECORD_PADDING_FLAG, __ATOMIC_RELEASE);
+  }
+
+  uint8_t* record = ring.data + ((head + padding) & BINARY_LOG_BUFFER_MASK);
+
+  uint32_t formatAddr = reinterpret_cast<uintptr_t>(format);
+  int64_t timestamp   = esp_timer_get_time();
+  memcpy(record + 4, &formatAddr, sizeof(formatAddr));
+  memcpy(record + 8, &timestamp, sizeof(timestamp));
+
+  reservation.record = record;
+  reservation.size   = size;
+
+  return true;
+}
+
+uint8_t* BinaryLog::Internal::RecordArgs(const Reservation& reservation)
+{
+  return reservation.record + RECORD_HEADER_SIZE;
+}
+
+void BinaryLog::Internal::CommitRecord(const Reservation& reservation)
+{
+  __atomic_store_n(reinterpret_cast<uint32_t*>(reservation.record), reservation.size, __ATOMIC_RELEASE);
+}
+
+static void _sendFrame(uint8_t* frame, std::size_t len)
+{
+  uint32_t crc = esp_rom_crc32_le(0, frame, len);
+  memcpy(frame + len, &crc, sizeof(crc));
+  len += sizeof(crc);
+
+  // Leading delimiter flushes any text the host received since the last frame
+  uint8_t encoded[1 + Serial::BinaryProtocol::EncodedSize(FRAME_MAX_SIZE)];
+  encoded[0]             = 0x00;
+  std::size_t encodedLen = 1 + Serial::BinaryProtocol::Encode(frame, len, encoded + 1);
+
+  s_sink(encoded, encodedLen);
+}
+
+static void _sendDropped(uint8_t core, uint32_t count)
+{
+  uint8_t frame[FRAME_MAX_SIZE];
+
+  uint32_t formatAddr = 0;
+  int64_t timestamp   = esp_timer_get_time();
+  memcpy(frame, &formatAddr, sizeof(formatAddr));
+  memcpy(frame + 4, &timestamp, sizeof(timestamp));
+  frame[12] = core;
+  frame[13] = static_cast<uint8_t>(BinaryLog::ArgType::U32);
+  memcpy(frame + 14, &count, sizeof(count));
+
+  _sendFrame(frame, 18);
+}
+
+/// @brief Sends every committed record of a core's buffer, returns true if there were any
+static bool _drainBuffer(uint8_t core)
+{
+  RingBuffer& ring = s_buffers[core];
+
+  bool drained = false;
+
+  uint32_t tail = ring.tail.load(std::memory_order_relaxed);
+  while (true) {
+    uint8_t* record = ring.data + (tail & BINARY_LOG_BUFFER_MASK);
+
+    uint32_t commit = __atomic_load_n(reinterpret_cast<uint32_t*>(record), __ATOMIC_ACQUIRE);
+    if (commit == 0) {
+      break;
+    }
+
+    uint32_t stride;
+    if ((commit & RECORD_PADDING_FLAG) != 0) {
+      stride = commit & ~RECORD_PADDING_FLAG;
+    } else {
+      stride = _alignRecordSize(commit);
+
+      uint8_t frame[FRAME_MAX_SIZE];
+      memcpy(frame, record + 4, 12);  // format address + timestamp
+      frame[12] = core;
+      memcpy(frame + 13, record + RECORD_HEADER_SIZE, commit - RECORD_HEADER_SIZE);
+
+      _sendFrame(frame, 13 + commit - RECORD_HEADER_SIZE);
+    }
+
+    // Writers only find zeroes past the tail, a record they reserve there reads as uncommitted until they finish it
+    memset(record, 0, stride);
+    tail += stride;
+    ring.tail.store(tail, std::memory_order_release);
+
+    drained = true;
+  }
+
+  uint32_t dropped = ring.dropped.exchange(0, std::memory_order_relaxed);
+  if (dropped != 0) {
+    _sendDropped(core, dropped);
+  }
+
+  return drained;
+}
+
+static void _drainTask(void*)
+{
+  while (true) {
+    bool drained = false;
+    for (uint8_t core = 0; core < portNUM_PROCESSORS; core++) {
+      drained |= _drainBuffer(core);
+    }
+
+    if (!drained) {
+      vTaskDelay(pdMS_TO_TICKS(10));
+    }
+  }
+}
+
+void BinaryLog::SetSink(Sink sink)
+{
+  s_sink = std::move(sink);
+}
+
+bool BinaryLog::Init()
+{
+  if (s_sink == nullptr) {
+    s_sink = [](const uint8_t* data, std::size_t len) { ::Serial.write(data, len); };
+  }
+
+  // Lowest priority above idle, logging must never compete with the work being logged
+  if (TaskUtils::TaskCreateExpensive(_drainTask, TAG, 3072, nullptr, 1, nullptr) != pdPASS) {
+    log_printf("[%s] Failed to create drain task\r\n", TAG);  // Can't log through the buffers it would have drained
+    return false;
+  }
+
+  return true;
+}
+
+#endif  // OPENSHOCK_LOG_BINARY
@@ -61,13 +61,11 @@ bool _startCaptive()
     return false;
   }
 
-  std::string hostname;
-  if (!Config::GetWiFiHostname(hostname)) {
-    OS_LOGE(TAG, "Failed to get WiFi hostname, reverting to default");
-    hostname = OPENSHOCK_FW_HOSTNAME;
+  {
+    // Strings in the snapshot are null-terminated, and mdns_hostname_set copies it
+    Config::Snapshot config = Config::GetSnapshot();
+    err = mdns_hostname_set(config != nullptr ? config->wifiHostname().data() : OPENSHOCK_FW_HOSTNAME);
   }
-
-  err = mdns_hostname_set(hostname.c_str());
   if (err != ESP_OK) {
     OS_LOGE(TAG, "Failed to set mDNS hostname");
     WiFi.softAPdisconnect(true);
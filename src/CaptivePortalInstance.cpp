@@ -51,11 +51,15 @@ const char* _getPartitionHash()
     return nullptr;
   }
 
-  static char hash[65];
-  if (!OpenShock::TryGetPartitionHash(partition, hash)) {
+  // Cached in config, hashing the whole partition on every portal start is slow
+  uint8_t hashBytes[32];
+  if (!OpenShock::TryGetPartitionImageHash(partition, hashBytes)) {
     return nullptr;
   }
 
+  static char hash[65];
+  HexUtils::ToHex<32>(hashBytes, hash, false);
+
   return hash;
 }
 
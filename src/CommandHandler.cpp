@@ -38,12 +38,12 @@ struct KnownShocker {
   int64_t lastActivityTimestamp;
 };
 
-static OpenShock::ReadWriteMutex s_rfTransmitterMutex            = {};
+static OpenShock::ReadWriteMutex s_rfTransmitterMutex            = {"rfTransmitter"};
 static std::unique_ptr<OpenShock::RFTransmitter> s_rfTransmitter = nullptr;
 
 static OpenShock::SimpleMutex s_estopManagerMutex = {};
 
-static OpenShock::ReadWriteMutex s_keepAliveMutex = {};
+static OpenShock::ReadWriteMutex s_keepAliveMutex = {"keepAlive"};
 static QueueHandle_t s_keepAliveQueue             = nullptr;
 static TaskHandle_t s_keepAliveTaskHandle         = nullptr;
 
@@ -5,6 +5,7 @@ const char* const TAG = "GatewayClient";
 #include "Common.h"
 #include "config/Config.h"
 #include "events/Events.h"
+#include "FirmwareVersion.h"
 #include "Logging.h"
 #include "message_handlers/WebSocket.h"
 #include "OtaUpdateManager.h"
@@ -153,13 +154,7 @@ void GatewayClient::_sendBootStatus()
     return;
   }
 
-  OpenShock::SemVer version;
-  if (!OpenShock::TryParseSemVer(OPENSHOCK_FW_VERSION, version)) {
-    OS_LOGE(TAG, "Failed to parse firmware version");
-    return;
-  }
-
-  s_bootStatusSent = Serialization::Gateway::SerializeBootStatusMessage(updateId, OtaUpdateManager::GetFirmwareBootType(), version, [this](const uint8_t* data, std::size_t len) { return m_webSocket.sendBIN(data, len); });
+  s_bootStatusSent = Serialization::Gateway::SerializeBootStatusMessage(updateId, OtaUpdateManager::GetFirmwareBootType(), FirmwareVersion, [this](const uint8_t* data, std::size_t len) { return m_webSocket.sendBIN(data, len); });
 
   if (s_bootStatusSent && updateStep != OpenShock::OtaUpdateStep::None) {
     if (!Config::SetOtaUpdateStep(OpenShock::OtaUpdateStep::None)) {
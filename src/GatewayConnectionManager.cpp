@@ -218,26 +218,25 @@ bool StartConnectingToLCG()
 
   _lastConnectionAttempt = msNow;
 
-  if (Config::HasBackendLCGOverride()) {
-    std::string lcgOverride;
-    Config::GetBackendLCGOverride(lcgOverride);
+  Config::Snapshot config = Config::GetSnapshot();
+  if (config == nullptr) {
+    OS_LOGE(TAG, "Failed to get config");
+    return false;
+  }
 
-    OS_LOGD(TAG, "Connecting to overridden LCG endpoint %s", lcgOverride.c_str());
-    s_wsClient->connect(lcgOverride.c_str());
+  std::string_view lcgOverride = config->backendLCGOverride();
+  if (!lcgOverride.empty()) {
+    OS_LOGD(TAG, "Connecting to overridden LCG endpoint %s", lcgOverride.data());
+    s_wsClient->connect(lcgOverride.data());
     return true;
   }
 
-  if (!Config::HasBackendAuthToken()) {
+  std::string_view authToken = config->backendAuthToken();
+  if (authToken.empty()) {
     OS_LOGD(TAG, "No auth token, can't connect to LCG");
     return false;
   }
 
-  std::string authToken;
-  if (!Config::GetBackendAuthToken(authToken)) {
-    OS_LOGE(TAG, "Failed to get auth token");
-    return false;
-  }
-
   auto response = HTTP::JsonAPI::AssignLcg(authToken);
 
   if (response.result == HTTP::RequestResult::RateLimited) {
@@ -269,25 +268,26 @@ void GatewayConnectionManager::Update()
 {
   if (s_wsClient == nullptr) {
     // Can't connect to the API without WiFi or an auth token
-    if ((s_flags & FLAG_HAS_IP) == 0 || !Config::HasBackendAuthToken()) {
+    if ((s_flags & FLAG_HAS_IP) == 0) {
       return;
     }
 
-    std::string authToken;
-    if (!Config::GetBackendAuthToken(authToken)) {
-      OS_LOGE(TAG, "Failed to get auth token");
+    Config::Snapshot config = Config::GetSnapshot();
+    if (config == nullptr || config->backendAuthToken().empty()) {
       return;
     }
 
+    std::string_view authToken = config->backendAuthToken();
+
     // Fetch device info
-    if (!FetchDeviceInfo(authToken.c_str())) {
+    if (!FetchDeviceInfo(authToken)) {
       return;
     }
 
     s_flags |= FLAG_LINKED;
     OS_LOGD(TAG, "Successfully verified auth token");
 
-    s_wsClient = std::make_unique<GatewayClient>(authToken);
+    s_wsClient = std::make_unique<GatewayClient>(std::string(authToken));
   }
 
   if (s_wsClient->loop()) {
@@ -0,0 +1,124 @@
+#include <freertos/FreeRTOS.h>
+
+#include "LedAnimationEngine.h"
+
+const char* const TAG = "LedAnimationEngine";
+
+#include "Logging.h"
+#include "SimpleMutex.h"
+
+#include <esp_timer.h>
+
+#include <algorithm>
+#include <vector>
+
+using namespace OpenShock;
+
+const int64_t LED_ENGINE_BUSY_RETRY_US = 1000;  // Delay before the timer retries a frame it found the engine locked for
+
+struct ChannelEntry {
+  LedAnimationEngine::Channel* channel;
+  int64_t nextFrame;  // -1 while idle
+};
+
+static OpenShock::SimpleMutex s_engineMutex = {};
+static std::vector<ChannelEntry> s_channels;
+static esp_timer_handle_t s_engineTimer = nullptr;
+
+static void _scheduleNextFrame(int64_t now)
+{
+  int64_t nextFrame = -1;
+  for (const auto& entry : s_channels) {
+    if (entry.nextFrame >= 0 && (nextFrame < 0 || entry.nextFrame < nextFrame)) {
+      nextFrame = entry.nextFrame;
+    }
+  }
+
+  esp_timer_stop(s_engineTimer);  // Fails harmlessly if the timer isn't armed
+
+  if (nextFrame < 0) {
+    return;
+  }
+
+  // ESP_ERR_INVALID_STATE means the timer callback armed a retry in between, that retry reschedules everything anyway
+  esp_err_t err = esp_timer_start_once(s_engineTimer, std::max<int64_t>(nextFrame - now, 1));
+  if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+    OS_LOGE(TAG, "Failed to arm LED timer: %s", esp_err_to_name(err));
+  }
+}
+
+static void _engineTimerCallback(void*)
+{
+  // Whoever holds the lock reschedules before releasing it, but may already have done so when this fired, so never wait on it here and retry instead
+  ScopedLock lock__(&s_engineMutex, 0);
+  if (!lock__.isLocked()) {
+    esp_timer_start_once(s_engineTimer, LED_ENGINE_BUSY_RETRY_US);
+    return;
+  }
+
+  int64_t now = esp_timer_get_time();
+
+  for (auto& entry : s_channels) {
+    if (entry.nextFrame >= 0 && entry.nextFrame <= now) {
+      entry.nextFrame = entry.channel->renderFrame(now);
+    }
+  }
+
+  _scheduleNextFrame(now);
+}
+
+bool LedAnimationEngine::Attach(Channel* channel)
+{
+  ScopedLock lock__(&s_engineMutex);
+
+  if (s_engineTimer == nullptr) {
+    esp_timer_create_args_t args = {
+      .callback              = _engineTimerCallback,
+      .arg                   = nullptr,
+      .dispatch_method       = ESP_TIMER_TASK,
+      .name                  = "led_animation",
+      .skip_unhandled_events = true,
+    };
+
+    esp_err_t err = esp_timer_create(&args, &s_engineTimer);
+    if (err != ESP_OK) {
+      OS_LOGE(TAG, "Failed to create LED timer: %s", esp_err_to_name(err));
+      s_engineTimer = nullptr;
+      return false;
+    }
+  }
+
+  s_channels.push_back({channel, -1});
+
+  _scheduleNextFrame(esp_timer_get_time());
+
+  return true;
+}
+
+void LedAnimationEngine::Detach(Channel* channel)
+{
+  ScopedLock lock__(&s_engineMutex);
+
+  s_channels.erase(std::remove_if(s_channels.begin(), s_channels.end(), [channel](const ChannelEntry& entry) { return entry.channel == channel; }), s_channels.end());
+
+  if (s_engineTimer != nullptr) {
+    _scheduleNextFrame(esp_timer_get_time());
+  }
+}
+
+void LedAnimationEngine::Update(Channel* channel, const std::function<void()>& fn)
+{
+  ScopedLock lock__(&s_engineMutex);
+
+  fn();
+
+  auto it = std::find_if(s_channels.begin(), s_channels.end(), [channel](const ChannelEntry& entry) { return entry.channel == channel; });
+  if (it == s_channels.end()) {
+    return;
+  }
+
+  // Due right away, the frame is rendered by the timer like every other one rather than on the caller's stack
+  it->nextFrame = 0;
+
+  _scheduleNextFrame(esp_timer_get_time());
+}
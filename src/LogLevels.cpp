@@ -0,0 +1,303 @@
+#include <freertos/FreeRTOS.h>
+
+#include "LogLevels.h"
+
+const char* const TAG = "LogLevels";
+
+#include "config/Config.h"
+#include "Logging.h"
+#include "util/StringUtils.h"
+
+#include <cstring>
+
+#ifndef OPENSHOCK_LOG_DEFAULT_LEVEL
+#define OPENSHOCK_LOG_DEFAULT_LEVEL OPENSHOCK_LOG_LEVEL
+#endif
+
+using namespace OpenShock;
+using namespace std::string_literals;
+using namespace std::string_view_literals;
+
+const uint8_t OVERFLOW_TAG_ID = 0xFF;  // Bound without being interned, the tag table was full
+const char* const LEVEL_NAMES[] = {"none", "error", "warn", "info", "debug", "verbose"};
+
+struct TagEntry {
+  const char* name;  // TAG string of the first unit that logged, or a heap copy if the level was set before that
+  uint8_t level;
+  LogLevels::TagBinding* bindings;
+};
+
+// Entries are only ever appended and their names never change, readers may walk the first s_tagCount entries without the lock
+static TagEntry s_tags[LogLevels::MaxTags];
+static uint8_t s_tagCount                        = 0;
+static uint8_t s_defaultLevel                    = OPENSHOCK_LOG_DEFAULT_LEVEL;
+static LogLevels::TagBinding* s_overflowBindings = nullptr;
+static portMUX_TYPE s_tagsLock                   = portMUX_INITIALIZER_UNLOCKED;  // Spinlock, logging can happen before the scheduler runs
+
+static int _findTag(const char* name, std::size_t nameLen)
+{
+  for (int i = 0; i < s_tagCount; i++) {
+    const char* entryName = s_tags[i].name;
+    if (strncmp(entryName, name, nameLen) == 0 && entryName[nameLen] == '\0') {
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+static uint8_t _effectiveLevel(const TagEntry& entry)
+{
+  return entry.level == LogLevels::Inherit ? s_defaultLevel : entry.level;
+}
+
+static void _applyLevel(LogLevels::TagBinding* bindings, uint8_t level)
+{
+  for (LogLevels::TagBinding* binding = bindings; binding != nullptr; binding = binding->next) {
+    binding->level = level;
+  }
+}
+
+static void _applyDefaultLevel()
+{
+  for (int i = 0; i < s_tagCount; i++) {
+    if (s_tags[i].level == LogLevels::Inherit) {
+      _applyLevel(s_tags[i].bindings, s_defaultLevel);
+    }
+  }
+
+  _applyLevel(s_overflowBindings, s_defaultLevel);
+}
+
+uint8_t LogLevels::Bind(TagBinding& binding, const char* tag)
+{
+  // Must not log, it runs inside the first log call of a unit
+  portENTER_CRITICAL_SAFE(&s_tagsLock);
+
+  // Another task of the same unit may have bound it while this one waited
+  if (binding.tagId == 0) {
+    int index = _findTag(tag, strlen(tag));
+    if (index < 0 && s_tagCount < MaxTags) {
+      index                  = s_tagCount;
+      s_tags[index].name     = tag;
+      s_tags[index].level    = Inherit;
+      s_tags[index].bindings = nullptr;
+      s_tagCount++;
+    }
+
+    if (index >= 0) {
+      binding.next           = s_tags[index].bindings;
+      binding.level          = _effectiveLevel(s_tags[index]);
+      binding.tagId          = static_cast<uint8_t>(index + 1);
+      s_tags[index].bindings = &binding;
+    } else {
+      binding.next       = s_overflowBindings;
+      binding.level      = s_defaultLevel;
+      binding.tagId      = OVERFLOW_TAG_ID;
+      s_overflowBindings = &binding;
+    }
+  }
+
+  uint8_t level = binding.level;
+
+  portEXIT_CRITICAL_SAFE(&s_tagsLock);
+
+  return level;
+}
+
+static bool _isValidTag(std::string_view tag)
+{
+  if (tag.empty()) {
+    return false;
+  }
+
+  for (char c : tag) {
+    if (c <= ' ' || c == '=' || c > '~') {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool LogLevels::Init()
+{
+  std::string levels;
+  if (!Config::GetLogLevels(levels)) {
+    OS_LOGE(TAG, "Failed to read persisted log levels");
+    return false;
+  }
+
+  for (std::string_view line : StringSplitNewLines(levels)) {
+    line = StringTrim(line);
+    if (line.empty()) {
+      continue;
+    }
+
+    std::string_view parts[2];
+    uint8_t level;
+    if (!TryStringSplit(line, '=', parts) || !LevelFromString(StringTrim(parts[1]), level)) {
+      OS_LOGW(TAG, "Ignoring invalid log level entry: %.*s", line.size(), line.data());
+      continue;
+    }
+
+    std::string_view tag = StringTrim(parts[0]);
+    if (tag == "*"sv ? !SetDefaultLevel(level) : !SetLevel(tag, level)) {
+      OS_LOGW(TAG, "Failed to restore log level of %.*s", tag.size(), tag.data());
+    }
+  }
+
+  return true;
+}
+
+uint8_t LogLevels::GetDefaultLevel()
+{
+  return s_defaultLevel;
+}
+
+bool LogLevels::SetDefaultLevel(uint8_t level)
+{
+  if (level > OPENSHOCK_LOG_LEVEL_VERBOSE) {
+    return false;
+  }
+
+  portENTER_CRITICAL_SAFE(&s_tagsLock);
+
+  s_defaultLevel = level;
+  _applyDefaultLevel();
+
+  portEXIT_CRITICAL_SAFE(&s_tagsLock);
+
+  return true;
+}
+
+bool LogLevels::SetLevel(std::string_view tag, uint8_t level)
+{
+  if (!_isValidTag(tag) || (level > OPENSHOCK_LOG_LEVEL_VERBOSE && level != Inherit)) {
+    return false;
+  }
+
+  // Copied before taking the lock in case the TAG hasn't logged yet, no allocation happens inside it
+  char* name = nullptr;
+
+  portENTER_CRITICAL_SAFE(&s_tagsLock);
+  bool known = _findTag(tag.data(), tag.size()) >= 0;
+  portEXIT_CRITICAL_SAFE(&s_tagsLock);
+
+  if (!known) {
+    name = strndup(tag.data(), tag.size());
+    if (name == nullptr) {
+      return false;
+    }
+  }
+
+  portENTER_CRITICAL_SAFE(&s_tagsLock);
+
+  int index = _findTag(tag.data(), tag.size());
+  if (index < 0 && name != nullptr && s_tagCount < MaxTags) {
+    index                  = s_tagCount;
+    s_tags[index].name     = name;
+    s_tags[index].bindings = nullptr;
+    s_tagCount++;
+
+    name = nullptr;  // Owned by the table now
+  }
+
+  if (index >= 0) {
+    s_tags[index].level = level;
+    _applyLevel(s_tags[index].bindings, _effectiveLevel(s_tags[index]));
+  }
+
+  portEXIT_CRITICAL_SAFE(&s_tagsLock);
+
+  free(name);  // Raced with the TAG being bound, or the table was full
+
+  if (index < 0) {
+    OS_LOGW(TAG, "Tag table is full, can't set the level of %.*s", tag.size(), tag.data());
+    return false;
+  }
+
+  return true;
+}
+
+std::vector<LogLevels::TagLevel> LogLevels::GetLevels()
+{
+  portENTER_CRITICAL_SAFE(&s_tagsLock);
+  uint8_t count = s_tagCount;
+  portEXIT_CRITICAL_SAFE(&s_tagsLock);
+
+  std::vector<TagLevel> levels;
+  levels.reserve(count);
+
+  for (uint8_t i = 0; i < count; i++) {
+    levels.push_back({s_tags[i].name, s_tags[i].level});
+  }
+
+  return levels;
+}
+
+void LogLevels::Reset()
+{
+  portENTER_CRITICAL_SAFE(&s_tagsLock);
+
+  for (int i = 0; i < s_tagCount; i++) {
+    s_tags[i].level = Inherit;
+  }
+
+  s_defaultLevel = OPENSHOCK_LOG_DEFAULT_LEVEL;
+  _applyDefaultLevel();
+
+  portEXIT_CRITICAL_SAFE(&s_tagsLock);
+}
+
+bool LogLevels::Persist()
+{
+  std::string levels;
+  for (const auto& entry : GetLevels()) {
+    if (entry.level != Inherit) {
+      levels.append(entry.tag).append("=").append(LevelToString(entry.level)).append("\n");
+    }
+  }
+
+  // Nothing to restore when everything is at its default
+  if (levels.empty() && s_defaultLevel == OPENSHOCK_LOG_DEFAULT_LEVEL) {
+    return Config::SetLogLevels(levels);
+  }
+
+  return Config::SetLogLevels("*="s + LevelToString(s_defaultLevel) + "\n" + levels);
+}
+
+const char* LogLevels::LevelToString(uint8_t level)
+{
+  if (level == Inherit) {
+    return "inherit";
+  }
+
+  if (level >= sizeof(LEVEL_NAMES) / sizeof(LEVEL_NAMES[0])) {
+    return "unknown";
+  }
+
+  return LEVEL_NAMES[level];
+}
+
+bool LogLevels::LevelFromString(std::string_view str, uint8_t& out)
+{
+  if (str == "inherit"sv) {
+    out = Inherit;
+    return true;
+  }
+
+  for (uint8_t i = 0; i < sizeof(LEVEL_NAMES) / sizeof(LEVEL_NAMES[0]); i++) {
+    if (str == LEVEL_NAMES[i]) {
+      out = i;
+      return true;
+    }
+  }
+
+  if (str.size() == 1 && str[0] >= '0' && str[0] <= '5') {
+    out = static_cast<uint8_t>(str[0] - '0');
+    return true;
+  }
+
+  return false;
+}
@@ -5,6 +5,7 @@ const char* const TAG = "OtaUpdateManager";
 #include "CaptivePortal.h"
 #include "Common.h"
 #include "config/Config.h"
+#include "FirmwareVersion.h"
 #include "GatewayConnectionManager.h"
 #include "Hashing.h"
 #include "http/HTTPRequestManager.h"
@@ -20,11 +21,11 @@ const char* const TAG = "OtaUpdateManager";
 #include "wifi/WiFiManager.h"
 
 #include <esp_ota_ops.h>
-#include <esp_task_wdt.h>
 
 #include <LittleFS.h>
 #include <WiFi.h>
 
+#include <functional>
 #include <sstream>
 #include <string_view>
 
@@ -36,13 +37,15 @@ using namespace std::string_view_literals;
 #define OPENSHOCK_FW_CDN_BETA_URL    OPENSHOCK_FW_CDN_CHANNEL_URL("beta")
 #define OPENSHOCK_FW_CDN_DEVELOP_URL OPENSHOCK_FW_CDN_CHANNEL_URL("develop")
 
-#define OPENSHOCK_FW_CDN_BOARDS_BASE_URL_FORMAT  OPENSHOCK_FW_CDN_URL("/%s")
-#define OPENSHOCK_FW_CDN_BOARDS_INDEX_URL_FORMAT OPENSHOCK_FW_CDN_BOARDS_BASE_URL_FORMAT "/boards.txt"
+#define OPENSHOCK_FW_CDN_BOARDS_BASE_URL_FORMAT OPENSHOCK_FW_CDN_URL("/%s")
 
 #define OPENSHOCK_FW_CDN_VERSION_BASE_URL_FORMAT OPENSHOCK_FW_CDN_BOARDS_BASE_URL_FORMAT "/" OPENSHOCK_FW_BOARD
 
 #define OPENSHOCK_FW_CDN_APP_URL_FORMAT           OPENSHOCK_FW_CDN_VERSION_BASE_URL_FORMAT "/app.bin"
 #define OPENSHOCK_FW_CDN_FILESYSTEM_URL_FORMAT    OPENSHOCK_FW_CDN_VERSION_BASE_URL_FORMAT "/staticfs.bin"
+#define OPENSHOCK_FW_CDN_GZIP_SUFFIX              ".gz"
+#define OPENSHOCK_FW_CDN_APP_PATCH_FILE           "app.from-" OPENSHOCK_FW_VERSION ".patch.gz"
+#define OPENSHOCK_FW_CDN_APP_PATCH_URL_FORMAT     OPENSHOCK_FW_CDN_VERSION_BASE_URL_FORMAT "/" OPENSHOCK_FW_CDN_APP_PATCH_FILE
 #define OPENSHOCK_FW_CDN_SHA256_HASHES_URL_FORMAT OPENSHOCK_FW_CDN_VERSION_BASE_URL_FORMAT "/hashes.sha256.txt"
 
 /// @brief Stops initArduino() from handling OTA rollbacks
@@ -159,8 +162,55 @@ bool _sendFailureMessage(std::string_view message, bool fatal = false)
   return true;
 }
 
-bool _flashAppPartition(const esp_partition_t* partition, std::string_view remoteUrl, const uint8_t (&remoteHash)[32])
+/// @brief Flashes the compressed image if the release has one, falling back to the raw image if that fails (e.g. not enough memory to decompress)
+bool _flashPartitionImage(const esp_partition_t* partition, const std::string& remoteUrl, const uint8_t (&remoteHash)[32], OtaImageEncoding encoding, std::function<bool(std::size_t, std::size_t, float)> onProgress)
 {
+  if (encoding == OtaImageEncoding::Gzip) {
+    if (OpenShock::FlashPartitionFromUrl(partition, remoteUrl + OPENSHOCK_FW_CDN_GZIP_SUFFIX, remoteHash, onProgress, encoding)) {
+      return true;
+    }
+
+    OS_LOGW(TAG, "Failed to flash %s image, retrying with raw image", OtaImageEncodingToString(encoding));
+  }
+
+  return OpenShock::FlashPartitionFromUrl(partition, remoteUrl, remoteHash, onProgress);
+}
+
+bool _markAppPartitionBootable(const esp_partition_t* partition)
+{
+  if (!_sendProgressMessage(Serialization::Gateway::OtaInstallProgressTask::MarkingApplicationBootable, 0.0f)) {
+    return false;
+  }
+
+  // Set app partition bootable.
+  if (esp_ota_set_boot_partition(partition) != ESP_OK) {
+    OS_LOGE(TAG, "Failed to set app partition bootable");
+    _sendFailureMessage("Failed to set app partition bootable"sv);
+    return false;
+  }
+
+  return true;
+}
+
+/// @brief Checks whether a partition already holds the image with the given hash, using the hash cached in config
+bool _isPartitionImageInstalled(const esp_partition_t* partition, const uint8_t (&remoteHash)[32])
+{
+  uint8_t installedHash[32];
+  if (!OpenShock::TryGetPartitionImageHash(partition, installedHash)) {
+    return false;
+  }
+
+  return memcmp(installedHash, remoteHash, 32) == 0;
+}
+
+bool _flashAppPartition(const esp_partition_t* partition, const std::string& remoteUrl, const uint8_t (&remoteHash)[32], OtaImageEncoding encoding, const std::string& patchUrl, std::string_view version)
+{
+  // The update partition may still hold this release from an earlier attempt, e.g. one that failed after flashing the app
+  if (_isPartitionImageInstalled(partition, remoteHash)) {
+    OS_LOGI(TAG, "App partition already contains this release, skipping flash");
+    return _markAppPartitionBootable(partition);
+  }
+
   OS_LOGD(TAG, "Flashing app partition");
 
   if (!_sendProgressMessage(Serialization::Gateway::OtaInstallProgressTask::FlashingApplication, 0.0f)) {
@@ -175,28 +225,42 @@ bool _flashAppPartition(const esp_partition_t* partition, std::string_view remot
     return true;
   };
 
-  if (!OpenShock::FlashPartitionFromUrl(partition, remoteUrl, remoteHash, onProgress)) {
-    OS_LOGE(TAG, "Failed to flash app partition");
-    _sendFailureMessage("Failed to flash app partition"sv);
-    return false;
+  // Prefer the delta patch against the running firmware, a full image is only needed if the patch can't be applied
+  bool flashed = false;
+  if (!patchUrl.empty()) {
+    flashed = OpenShock::FlashPartitionFromPatchUrl(partition, esp_ota_get_running_partition(), patchUrl, remoteHash, onProgress);
+    if (!flashed) {
+      OS_LOGW(TAG, "Failed to apply delta patch, falling back to full image");
+    }
   }
 
-  if (!_sendProgressMessage(Serialization::Gateway::OtaInstallProgressTask::MarkingApplicationBootable, 0.0f)) {
+  if (!flashed && !_flashPartitionImage(partition, remoteUrl, remoteHash, encoding, onProgress)) {
+    OS_LOGE(TAG, "Failed to flash app partition");
+    _sendFailureMessage("Failed to flash app partition"sv);
     return false;
   }
 
-  // Set app partition bootable.
-  if (esp_ota_set_boot_partition(partition) != ESP_OK) {
-    OS_LOGE(TAG, "Failed to set app partition bootable");
-    _sendFailureMessage("Failed to set app partition bootable"sv);
-    return false;
+  if (!OpenShock::CachePartitionImageHash(partition, remoteHash, version)) {
+    OS_LOGW(TAG, "Failed to cache app partition hash");
   }
 
-  return true;
+  return _markAppPartitionBootable(partition);
 }
 
-bool _flashFilesystemPartition(const esp_partition_t* parition, std::string_view remoteUrl, const uint8_t (&remoteHash)[32])
+bool _flashFilesystemPartition(const esp_partition_t* parition, const std::string& remoteUrl, const uint8_t (&remoteHash)[32], OtaImageEncoding encoding, std::string_view version)
 {
+  // Most releases only change the app, leave the filesystem (and the captive portal serving it) alone if it is identical
+  if (_isPartitionImageInstalled(parition, remoteHash)) {
+    OS_LOGI(TAG, "Filesystem partition is up to date, skipping flash");
+
+    // Re-tag the cached hash for the new firmware version, so it stays valid after rebooting into it
+    if (!OpenShock::CachePartitionImageHash(parition, remoteHash, version)) {
+      OS_LOGW(TAG, "Failed to cache filesystem partition hash");
+    }
+
+    return true;
+  }
+
   if (!_sendProgressMessage(Serialization::Gateway::OtaInstallProgressTask::PreparingForInstall, 0.0f)) {
     return false;
   }
@@ -222,7 +286,7 @@ bool _flashFilesystemPartition(const esp_partition_t* parition, std::string_view
     return true;
   };
 
-  if (!OpenShock::FlashPartitionFromUrl(parition, remoteUrl, remoteHash, onProgress)) {
+  if (!_flashPartitionImage(parition, remoteUrl, remoteHash, encoding, onProgress)) {
     OS_LOGE(TAG, "Failed to flash filesystem partition");
     _sendFailureMessage("Failed to flash filesystem partition"sv);
     return false;
@@ -241,6 +305,10 @@ bool _flashFilesystemPartition(const esp_partition_t* parition, std::string_view
   }
   test.end();
 
+  if (!OpenShock::CachePartitionImageHash(parition, remoteHash, version)) {
+    OS_LOGW(TAG, "Failed to cache filesystem partition hash");
+  }
+
   OpenShock::CaptivePortal::ForceClose(false);
 
   return true;
@@ -323,7 +391,7 @@ void _otaUpdateTask(void* arg)
         continue;
       }
 
-      OS_LOGD(TAG, "Update requested for version %s", version.toString().c_str());  // TODO: This is abusing the SemVer::toString() method causing alot of string copies, fix this
+      OS_LOGD(TAG, "Update requested for version %s", version.toString().data());
     } else {
       OS_LOGD(TAG, "Checking for updates");
 
@@ -333,10 +401,10 @@ void _otaUpdateTask(void* arg)
         continue;
       }
 
-      OS_LOGD(TAG, "Remote version: %s", version.toString().c_str());  // TODO: This is abusing the SemVer::toString() method causing alot of string copies, fix this
+      OS_LOGD(TAG, "Remote version: %s", version.toString().data());
     }
 
-    if (version.toString() == OPENSHOCK_FW_VERSION) {  // TODO: This is abusing the SemVer::toString() method causing alot of string copies, fix this
+    if (version == FirmwareVersion) {
       OS_LOGI(TAG, "Requested version is already installed");
       continue;
     }
@@ -371,11 +439,14 @@ void _otaUpdateTask(void* arg)
 
     // Print release.
     OS_LOGD(TAG, "Firmware release:");
-    OS_LOGD(TAG, "  Version:                %s", version.toString().c_str());  // TODO: This is abusing the SemVer::toString() method causing alot of string copies, fix this
+    OS_LOGD(TAG, "  Version:                %s", version.toString().data());
     OS_LOGD(TAG, "  App binary URL:         %s", release.appBinaryUrl.c_str());
     OS_LOGD(TAG, "  App binary hash:        %s", HexUtils::ToHex<32>(release.appBinaryHash).data());
+    OS_LOGD(TAG, "  App binary encoding:    %s", OtaImageEncodingToString(release.appBinaryEncoding));
+    OS_LOGD(TAG, "  App delta patch URL:    %s", release.appPatchUrl.empty() ? "(none)" : release.appPatchUrl.c_str());
     OS_LOGD(TAG, "  Filesystem binary URL:  %s", release.filesystemBinaryUrl.c_str());
     OS_LOGD(TAG, "  Filesystem binary hash: %s", HexUtils::ToHex<32>(release.filesystemBinaryHash).data());
+    OS_LOGD(TAG, "  Filesystem encoding:    %s", OtaImageEncodingToString(release.filesystemBinaryEncoding));
 
     // Get available app update partition.
     const esp_partition_t* appPartition = esp_ota_get_next_update_partition(nullptr);
@@ -393,13 +464,11 @@ void _otaUpdateTask(void* arg)
       continue;
     }
 
-    // Increase task watchdog timeout.
-    // Prevents panics on some ESP32s when clearing large partitions.
-    esp_task_wdt_init(15, true);
+    auto versionStr = version.toString();
 
-    // Flash app and filesystem partitions.
-    if (!_flashFilesystemPartition(filesystemPartition, release.filesystemBinaryUrl, release.filesystemBinaryHash)) continue;
-    if (!_flashAppPartition(appPartition, release.appBinaryUrl, release.appBinaryHash)) continue;
+    // Flash app and filesystem partitions, partitions that already hold the release's image are skipped.
+    if (!_flashFilesystemPartition(filesystemPartition, release.filesystemBinaryUrl, release.filesystemBinaryHash, release.filesystemBinaryEncoding, versionStr.data())) continue;
+    if (!_flashAppPartition(appPartition, release.appBinaryUrl, release.appBinaryHash, release.appBinaryEncoding, release.appPatchUrl, versionStr.data())) continue;
 
     // Set OTA boot type in config.
     if (!Config::SetOtaUpdateStep(OpenShock::OtaUpdateStep::Updated)) {
@@ -408,9 +477,6 @@ void _otaUpdateTask(void* arg)
       continue;
     }
 
-    // Set task watchdog timeout back to default.
-    esp_task_wdt_init(5, true);
-
     // Send reboot message.
     _sendProgressMessage(Serialization::Gateway::OtaInstallProgressTask::Rebooting, 0.0f);
 
@@ -424,40 +490,6 @@ void _otaUpdateTask(void* arg)
   esp_restart();
 }
 
-bool _tryGetStringList(std::string_view url, std::vector<std::string>& list)
-{
-  auto response = OpenShock::HTTP::GetString(
-    url,
-    {
-      {"Accept", "text/plain"}
-  },
-    {200, 304}
-  );
-  if (response.result != OpenShock::HTTP::RequestResult::Success) {
-    OS_LOGE(TAG, "Failed to fetch list: [%u] %s", response.code, response.data.c_str());
-    return false;
-  }
-
-  list.clear();
-
-  std::string_view data = response.data;
-
-  auto lines = OpenShock::StringSplitNewLines(data);
-  list.reserve(lines.size());
-
-  for (auto line : lines) {
-    line = OpenShock::StringTrim(line);
-
-    if (line.empty()) {
-      continue;
-    }
-
-    list.push_back(std::string(line));
-  }
-
-  return true;
-}
-
 bool OtaUpdateManager::Init()
 {
   esp_err_t err;
@@ -557,7 +589,8 @@ bool OtaUpdateManager::TryGetFirmwareVersion(OtaUpdateChannel channel, OpenShock
     return false;
   }
 
-  if (!OpenShock::TryParseSemVer(response.data, version)) {
+  // Ranked rather than parsed whole, so trailing newlines and listings of several versions both work
+  if (!OpenShock::TryParseHighestSemVer(response.data, version)) {
     OS_LOGE(TAG, "Failed to parse firmware version: %.*s", response.data.size(), response.data.data());
     return false;
   }
@@ -565,24 +598,6 @@ bool OtaUpdateManager::TryGetFirmwareVersion(OtaUpdateChannel channel, OpenShock
   return true;
 }
 
-bool OtaUpdateManager::TryGetFirmwareBoards(const OpenShock::SemVer& version, std::vector<std::string>& boards)
-{
-  std::string channelIndexUrl;
-  if (!FormatToString(channelIndexUrl, OPENSHOCK_FW_CDN_BOARDS_INDEX_URL_FORMAT, version.toString().c_str())) {  // TODO: This is abusing the SemVer::toString() method causing alot of string copies, fix this
-    OS_LOGE(TAG, "Failed to format URL");
-    return false;
-  }
-
-  OS_LOGD(TAG, "Fetching firmware boards from %s", channelIndexUrl.c_str());
-
-  if (!_tryGetStringList(channelIndexUrl, boards)) {
-    OS_LOGE(TAG, "Failed to fetch firmware boards");
-    return false;
-  }
-
-  return true;
-}
-
 bool _tryParseIntoHash(std::string_view hash, uint8_t (&hashBytes)[32])
 {
   if (!HexUtils::TryParseHex(hash.data(), hash.size(), hashBytes, 32)) {
@@ -595,21 +610,21 @@ bool _tryParseIntoHash(std::string_view hash, uint8_t (&hashBytes)[32])
 
 bool OtaUpdateManager::TryGetFirmwareRelease(const OpenShock::SemVer& version, FirmwareRelease& release)
 {
-  auto versionStr = version.toString();  // TODO: This is abusing the SemVer::toString() method causing alot of string copies, fix this
+  auto versionStr = version.toString();
 
-  if (!FormatToString(release.appBinaryUrl, OPENSHOCK_FW_CDN_APP_URL_FORMAT, versionStr.c_str())) {
+  if (!FormatToString(release.appBinaryUrl, OPENSHOCK_FW_CDN_APP_URL_FORMAT, versionStr.data())) {
     OS_LOGE(TAG, "Failed to format URL");
     return false;
   }
 
-  if (!FormatToString(release.filesystemBinaryUrl, OPENSHOCK_FW_CDN_FILESYSTEM_URL_FORMAT, versionStr.c_str())) {
+  if (!FormatToString(release.filesystemBinaryUrl, OPENSHOCK_FW_CDN_FILESYSTEM_URL_FORMAT, versionStr.data())) {
     OS_LOGE(TAG, "Failed to format URL");
     return false;
   }
 
   // Construct hash URLs.
   std::string sha256HashesUrl;
-  if (!FormatToString(sha256HashesUrl, OPENSHOCK_FW_CDN_SHA256_HASHES_URL_FORMAT, versionStr.c_str())) {
+  if (!FormatToString(sha256HashesUrl, OPENSHOCK_FW_CDN_SHA256_HASHES_URL_FORMAT, versionStr.data())) {
     OS_LOGE(TAG, "Failed to format URL");
     return false;
   }
@@ -627,13 +642,16 @@ bool OtaUpdateManager::TryGetFirmwareRelease(const OpenShock::SemVer& version, F
     return false;
   }
 
-  auto hashesLines = OpenShock::StringSplitNewLines(sha256HashesResponse.data);
+  // The hashes of app.bin and staticfs.bin are verified against the flashed image, a listed app.bin.gz or staticfs.bin.gz only advertises that a compressed copy is available
+  release.appBinaryEncoding        = OtaImageEncoding::Raw;
+  release.filesystemBinaryEncoding = OtaImageEncoding::Raw;
+  release.appPatchUrl.clear();
 
   // Parse hashes.
   bool foundAppHash = false, foundFilesystemHash = false;
-  for (std::string_view line : hashesLines) {
-    auto parts = OpenShock::StringSplitWhiteSpace(line);
-    if (parts.size() != 2) {
+  for (std::string_view line : OpenShock::StringSplitNewLines(sha256HashesResponse.data)) {
+    std::string_view parts[2];
+    if (OpenShock::StringSplitInto(OpenShock::StringSplitWhiteSpace(line), parts) != 2) {
       OS_LOGE(TAG, "Invalid hashes entry: %.*s", line.size(), line.data());
       return false;
     }
@@ -672,6 +690,15 @@ bool OtaUpdateManager::TryGetFirmwareRelease(const OpenShock::SemVer& version, F
       }
 
       foundFilesystemHash = true;
+    } else if (file == "app.bin" OPENSHOCK_FW_CDN_GZIP_SUFFIX) {
+      release.appBinaryEncoding = OtaImageEncoding::Gzip;
+    } else if (file == "staticfs.bin" OPENSHOCK_FW_CDN_GZIP_SUFFIX) {
+      release.filesystemBinaryEncoding = OtaImageEncoding::Gzip;
+    } else if (file == OPENSHOCK_FW_CDN_APP_PATCH_FILE) {
+      if (!FormatToString(release.appPatchUrl, OPENSHOCK_FW_CDN_APP_PATCH_URL_FORMAT, versionStr.data())) {
+        OS_LOGE(TAG, "Failed to format URL");
+        return false;
+      }
     }
   }
 
@@ -680,7 +707,7 @@ bool OtaUpdateManager::TryGetFirmwareRelease(const OpenShock::SemVer& version, F
 
 bool OtaUpdateManager::TryStartFirmwareInstallation(const OpenShock::SemVer& version)
 {
-  OS_LOGD(TAG, "Requesting firmware version %s", version.toString().c_str());  // TODO: This is abusing the SemVer::toString() method causing alot of string copies, fix this
+  OS_LOGD(TAG, "Requesting firmware version %s", version.toString().data());
 
   return _tryQueueUpdateRequest(version);
 }
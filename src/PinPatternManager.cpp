@@ -6,16 +6,16 @@ const char* const TAG = "PinPatternManager";
 
 #include "Chipset.h"
 #include "Logging.h"
-#include "util/FnProxy.h"
-#include "util/TaskUtils.h"
+
+#include <algorithm>
 
 using namespace OpenShock;
 
 PinPatternManager::PinPatternManager(gpio_num_t gpioPin)
   : m_gpioPin(GPIO_NUM_NC)
   , m_pattern()
-  , m_taskHandle(nullptr)
-  , m_taskMutex()
+  , m_stepIndex(0)
+  , m_stepStart(-1)
 {
   if (gpioPin == GPIO_NUM_NC) {
     OS_LOGE(TAG, "Pin is not set");
@@ -38,68 +38,62 @@ PinPatternManager::PinPatternManager(gpio_num_t gpioPin)
     return;
   }
 
+  if (!LedAnimationEngine::Attach(this)) {
+    OS_LOGE(TAG, "[pin-%hhi] Failed to attach to LED animation engine", gpioPin);
+    gpio_reset_pin(gpioPin);
+    return;
+  }
+
   m_gpioPin = gpioPin;
 }
 
 PinPatternManager::~PinPatternManager()
 {
-  ClearPattern();
-
   if (m_gpioPin != GPIO_NUM_NC) {
+    LedAnimationEngine::Detach(this);
     gpio_reset_pin(m_gpioPin);
   }
 }
 
 void PinPatternManager::SetPattern(const State* pattern, std::size_t patternLength)
 {
-  m_taskMutex.lock(portMAX_DELAY);
-
-  ClearPatternInternal();
-
-  // Set new values
-  m_pattern.resize(patternLength);
-  std::copy(pattern, pattern + patternLength, m_pattern.begin());
-
-  char name[32];
-  snprintf(name, sizeof(name), "PinPatternManager-%hhi", m_gpioPin);
-
-  // Start the task
-  BaseType_t result = TaskUtils::TaskCreateUniversal(&Util::FnProxy<&PinPatternManager::RunPattern>, name, 1024, this, 1, &m_taskHandle, 1);  // PROFILED: 0.5KB stack usage
-  if (result != pdPASS) {
-    OS_LOGE(TAG, "[pin-%hhi] Failed to create task: %d", m_gpioPin, result);
-
-    m_taskHandle = nullptr;
-    m_pattern.clear();
+  // Steps are advanced until one ends in the future, which never happens if none of them take any time
+  if (patternLength > 0 && std::all_of(pattern, pattern + patternLength, [](const State& state) { return state.duration == 0; })) {
+    OS_LOGE(TAG, "Pattern has no duration, ignoring it");
+    return;
   }
 
-  m_taskMutex.unlock();
+  LedAnimationEngine::Update(this, [this, pattern, patternLength]() {
+    m_pattern.assign(pattern, pattern + patternLength);
+    m_stepIndex = 0;
+    m_stepStart = -1;
+  });
 }
 
 void PinPatternManager::ClearPattern()
 {
-  m_taskMutex.lock(portMAX_DELAY);
-
-  ClearPatternInternal();
-
-  m_taskMutex.unlock();
+  LedAnimationEngine::Update(this, [this]() { m_pattern.clear(); });
 }
 
-void PinPatternManager::ClearPatternInternal()
+int64_t PinPatternManager::renderFrame(int64_t now)
 {
-  if (m_taskHandle != nullptr) {
-    vTaskDelete(m_taskHandle);
-    m_taskHandle = nullptr;
+  if (m_pattern.empty()) {
+    return -1;
   }
 
-  m_pattern.clear();
-}
-
-void PinPatternManager::RunPattern()
-{
-  while (true) {
-    for (const auto& state : m_pattern) {
-      gpio_set_level(m_gpioPin, state.level);
-      vTaskDelay(pdMS_TO_TICKS(state.duration));
+  if (m_stepStart < 0) {
+    m_stepStart = now;
+  } else {
+    // Advance from the previous deadline rather than from now, so timer latency doesn't accumulate over the pattern
+    while (now >= m_stepStart + static_cast<int64_t>(m_pattern[m_stepIndex].duration) * 1000) {
+      m_stepStart += static_cast<int64_t>(m_pattern[m_stepIndex].duration) * 1000;
+      m_stepIndex = (m_stepIndex + 1) % m_pattern.size();
     }
   }
+
+  const State& state = m_pattern[m_stepIndex];
+
+  gpio_set_level(m_gpioPin, state.level);
+
+  return m_stepStart + static_cast<int64_t>(state.duration) * 1000;
 }
@@ -6,23 +6,64 @@ const char* const TAG = "RGBPatternManager";
 
 #include "Chipset.h"
 #include "Logging.h"
-#include "util/TaskUtils.h"
 
+#include <algorithm>
 #include <array>
 
 using namespace OpenShock;
 
-// Currently this assumes a single WS2812B LED
-// TODO: Support multiple LEDs ?
 // TODO: Support other LED types ?
 
-RGBPatternManager::RGBPatternManager(gpio_num_t gpioPin)
+const std::size_t LED_BITS_PER_LED       = 24;      // 8 bits per color * 3 colors
+const int64_t LED_FADE_FRAME_INTERVAL_US = 20'000;  // 50 FPS while fading, steady colours are only sent once per step
+
+static void _encodeColor(uint8_t r, uint8_t g, uint8_t b, uint8_t brightness, rmt_data_t* ledData)
+{
+  // WS2812B usually takes commands in GRB order
+  // https://cdn-shop.adafruit.com/datasheets/WS2812B.pdf - Page 5
+  // But some actually expect RGB!
+
+  r = static_cast<uint8_t>(static_cast<uint16_t>(r) * brightness / 255);
+  g = static_cast<uint8_t>(static_cast<uint16_t>(g) * brightness / 255);
+  b = static_cast<uint8_t>(static_cast<uint16_t>(b) * brightness / 255);
+#if OPENSHOCK_LED_FLIP_RG_CHANNELS
+  std::swap(r, g);
+#endif
+
+  const uint32_t colors = (static_cast<uint32_t>(g) << 16) | (static_cast<uint32_t>(r) << 8) | static_cast<uint32_t>(b);
+
+  for (std::size_t bit = 0; bit < LED_BITS_PER_LED; bit++) {
+    if (colors & (1 << (23 - bit))) {
+      ledData[bit].level0    = 1;
+      ledData[bit].duration0 = 8;
+      ledData[bit].level1    = 0;
+      ledData[bit].duration1 = 4;
+    } else {
+      ledData[bit].level0    = 1;
+      ledData[bit].duration0 = 4;
+      ledData[bit].level1    = 0;
+      ledData[bit].duration1 = 8;
+    }
+  }
+}
+
+static uint8_t _lerp(uint8_t from, uint8_t to, uint32_t progress)
+{
+  // progress: 0-256
+  return static_cast<uint8_t>(from + ((static_cast<int32_t>(to) - static_cast<int32_t>(from)) * static_cast<int32_t>(progress)) / 256);
+}
+
+RGBPatternManager::RGBPatternManager(gpio_num_t gpioPin, uint16_t ledCount)
   : m_gpioPin(GPIO_NUM_NC)
+  , m_ledCount(ledCount)
   , m_brightness(255)
   , m_pattern()
+  , m_encodedPattern()
+  , m_txBuffer()
   , m_rmtHandle(nullptr)
-  , m_taskHandle(nullptr)
-  , m_taskMutex()
+  , m_stepIndex(0)
+  , m_stepStart(-1)
+  , m_stepShown(false)
 {
   if (gpioPin == GPIO_NUM_NC) {
     OS_LOGE(TAG, "Pin is not set");
@@ -34,6 +75,11 @@ RGBPatternManager::RGBPatternManager(gpio_num_t gpioPin)
     return;
   }
 
+  if (ledCount == 0) {
+    OS_LOGE(TAG, "LED count for pin %hhi must be at least 1", gpioPin);
+    return;
+  }
+
   m_rmtHandle = rmtInit(gpioPin, RMT_TX_MODE, RMT_MEM_64);
   if (m_rmtHandle == NULL) {
     OS_LOGE(TAG, "Failed to initialize RMT for pin %hhi", gpioPin);
@@ -43,108 +89,123 @@ RGBPatternManager::RGBPatternManager(gpio_num_t gpioPin)
   float realTick = rmtSetTick(m_rmtHandle, 100.F);
   OS_LOGD(TAG, "RMT tick is %f ns for pin %hhi", realTick, gpioPin);
 
+  m_txBuffer.resize(LED_BITS_PER_LED * ledCount);
+
   SetBrightness(20);
 
+  if (!LedAnimationEngine::Attach(this)) {
+    OS_LOGE(TAG, "[pin-%hhi] Failed to attach to LED animation engine", gpioPin);
+    rmtDeinit(m_rmtHandle);
+    m_rmtHandle = nullptr;
+    return;
+  }
+
   m_gpioPin = gpioPin;
 }
 
 RGBPatternManager::~RGBPatternManager()
 {
-  ClearPattern();
+  if (m_gpioPin != GPIO_NUM_NC) {
+    LedAnimationEngine::Detach(this);
+  }
 
-  rmtDeinit(m_rmtHandle);
+  if (m_rmtHandle != nullptr) {
+    rmtDeinit(m_rmtHandle);
+  }
 }
 
 void RGBPatternManager::SetPattern(const RGBState* pattern, std::size_t patternLength)
 {
-  m_taskMutex.lock(portMAX_DELAY);
-
-  ClearPatternInternal();
-
-  // Set new values
-  m_pattern.resize(patternLength);
-  std::copy(pattern, pattern + patternLength, m_pattern.begin());
-
-  // Start the task
-  BaseType_t result = TaskUtils::TaskCreateExpensive(RunPattern, TAG, 4096, this, 1, &m_taskHandle);  // PROFILED: 1.7KB stack usage
-  if (result != pdPASS) {
-    OS_LOGE(TAG, "[pin-%hhi] Failed to create task: %d", m_gpioPin, result);
-
-    m_taskHandle = nullptr;
-    m_pattern.clear();
+  // Steps are advanced until one ends in the future, which never happens if none of them take any time
+  if (patternLength > 0 && std::all_of(pattern, pattern + patternLength, [](const RGBState& state) { return state.duration == 0; })) {
+    OS_LOGE(TAG, "Pattern has no duration, ignoring it");
+    return;
   }
 
-  m_taskMutex.unlock();
+  LedAnimationEngine::Update(this, [this, pattern, patternLength]() {
+    m_pattern.assign(pattern, pattern + patternLength);
+    m_stepIndex = 0;
+    m_stepStart = -1;
+
+    encodePattern();
+  });
 }
 
 void RGBPatternManager::ClearPattern()
 {
-  m_taskMutex.lock(portMAX_DELAY);
+  LedAnimationEngine::Update(this, [this]() {
+    m_pattern.clear();
+    m_encodedPattern.clear();
+  });
+}
 
-  ClearPatternInternal();
+// Range: 0-255
+void RGBPatternManager::SetBrightness(uint8_t brightness)
+{
+  LedAnimationEngine::Update(this, [this, brightness]() {
+    m_brightness = brightness;
+    m_stepShown  = false;
 
-  m_taskMutex.unlock();
+    encodePattern();
+  });
 }
 
-void RGBPatternManager::ClearPatternInternal()
+void RGBPatternManager::encodePattern()
 {
-  if (m_taskHandle != nullptr) {
-    vTaskDelete(m_taskHandle);
-    m_taskHandle = nullptr;
-  }
+  m_encodedPattern.resize(m_pattern.size() * LED_BITS_PER_LED);
 
-  m_pattern.clear();
+  for (std::size_t i = 0; i < m_pattern.size(); i++) {
+    const RGBState& state = m_pattern[i];
+    _encodeColor(state.red, state.green, state.blue, m_brightness, &m_encodedPattern[i * LED_BITS_PER_LED]);
+  }
 }
 
-// Range: 0-255
-void RGBPatternManager::SetBrightness(uint8_t brightness)
+void RGBPatternManager::transmit(const rmt_data_t* ledData)
 {
-  m_brightness = brightness;
+  for (std::size_t led = 0; led < m_ledCount; led++) {
+    std::copy(ledData, ledData + LED_BITS_PER_LED, m_txBuffer.begin() + led * LED_BITS_PER_LED);
+  }
+
+  rmtWriteBlocking(m_rmtHandle, m_txBuffer.data(), m_txBuffer.size());
 }
 
-void RGBPatternManager::RunPattern(void* arg)
+int64_t RGBPatternManager::renderFrame(int64_t now)
 {
-  RGBPatternManager* thisPtr = reinterpret_cast<RGBPatternManager*>(arg);
+  if (m_pattern.empty()) {
+    return -1;
+  }
 
-  rmt_obj_t* rmtHandle           = thisPtr->m_rmtHandle;
-  uint8_t brightness             = thisPtr->m_brightness;
-  std::vector<RGBState>& pattern = thisPtr->m_pattern;
+  if (m_stepStart < 0) {
+    m_stepStart = now;
+    m_stepShown = false;
+  } else {
+    // Advance from the previous deadline rather than from now, so timer latency doesn't accumulate over the pattern
+    while (now >= m_stepStart + static_cast<int64_t>(m_pattern[m_stepIndex].duration) * 1000) {
+      m_stepStart += static_cast<int64_t>(m_pattern[m_stepIndex].duration) * 1000;
+      m_stepIndex = (m_stepIndex + 1) % m_pattern.size();
+      m_stepShown = false;
+    }
+  }
 
-  std::array<rmt_data_t, 24> led_data;  // 24 bits per LED (8 bits per color * 3 colors)
+  const RGBState& state = m_pattern[m_stepIndex];
 
-  while (true) {
-    for (const auto& state : pattern) {
-      // WS2812B usually takes commands in GRB order
-      // https://cdn-shop.adafruit.com/datasheets/WS2812B.pdf - Page 5
-      // But some actually expect RGB!
+  int64_t fadeEnd = m_stepStart + static_cast<int64_t>(std::min(state.fade, state.duration)) * 1000;
+  if (now < fadeEnd) {
+    const RGBState& prev = m_pattern[(m_stepIndex + m_pattern.size() - 1) % m_pattern.size()];
 
-      uint8_t r = static_cast<uint8_t>(static_cast<uint16_t>(state.red) * brightness / 255);
-      uint8_t g = static_cast<uint8_t>(static_cast<uint16_t>(state.green) * brightness / 255);
-      uint8_t b = static_cast<uint8_t>(static_cast<uint16_t>(state.blue) * brightness / 255);
-#if OPENSHOCK_LED_FLIP_RG_CHANNELS
-      std::swap(r, g);
-#endif
+    uint32_t progress = static_cast<uint32_t>((now - m_stepStart) * 256 / (fadeEnd - m_stepStart));
 
-      const uint32_t colors = (static_cast<uint32_t>(g) << 16) | (static_cast<uint32_t>(r) << 8) | static_cast<uint32_t>(b);
-
-      // Encode the data
-      for (std::size_t bit = 0; bit < 24; bit++) {
-        if (colors & (1 << (23 - bit))) {
-          led_data[bit].level0    = 1;
-          led_data[bit].duration0 = 8;
-          led_data[bit].level1    = 0;
-          led_data[bit].duration1 = 4;
-        } else {
-          led_data[bit].level0    = 1;
-          led_data[bit].duration0 = 4;
-          led_data[bit].level1    = 0;
-          led_data[bit].duration1 = 8;
-        }
-      }
-
-      // Send the data
-      rmtWriteBlocking(rmtHandle, led_data.data(), led_data.size());
-      vTaskDelay(pdMS_TO_TICKS(state.duration));
-    }
+    std::array<rmt_data_t, LED_BITS_PER_LED> ledData;
+    _encodeColor(_lerp(prev.red, state.red, progress), _lerp(prev.green, state.green, progress), _lerp(prev.blue, state.blue, progress), m_brightness, ledData.data());
+    transmit(ledData.data());
+
+    return std::min(now + LED_FADE_FRAME_INTERVAL_US, fadeEnd);
   }
+
+  if (!m_stepShown) {
+    transmit(&m_encodedPattern[m_stepIndex * LED_BITS_PER_LED]);
+    m_stepShown = true;
+  }
+
+  return m_stepStart + static_cast<int64_t>(state.duration) * 1000;
 }
@@ -6,55 +6,473 @@ const char* const TAG = "ReadWriteMutex";
 
 #include "Logging.h"
 
-OpenShock::ReadWriteMutex::ReadWriteMutex() : m_mutex(xSemaphoreCreateMutex()), m_readSem(xSemaphoreCreateBinary()), m_readers(0) {
-  xSemaphoreGive(m_readSem);
+#if OPENSHOCK_RWMUTEX_METRICS
+#include <esp_timer.h>
+#endif
+
+// m_state layout, every transition is a single CAS so the fast paths never need a lock:
+//   bits  0-11  readers holding the lock
+//   bit     12  writer holding the lock
+//   bits 13-21  writers waiting on m_writerGate
+//   bits 22-31  readers waiting on m_readerGate
+// Whoever makes a transition that lets waiters in also updates the counts on their behalf, then gives them one token each.
+// Tokens are interchangeable, so a waiter that times out either takes its place out of the waiting count or, if it was already let in, takes the lock anyway.
+const uint32_t RWMUTEX_READERS_MASK         = 0x0000'0FFF;
+const uint32_t RWMUTEX_WRITER               = 0x0000'1000;
+const uint32_t RWMUTEX_WAITING_WRITER       = 0x0000'2000;
+const uint32_t RWMUTEX_WAITING_WRITERS_MASK = 0x003F'E000;
+const uint32_t RWMUTEX_WAITING_READER       = 0x0040'0000;
+const uint32_t RWMUTEX_WAITING_READERS_MASK = 0xFFC0'0000;
+
+static uint32_t _readers(uint32_t state)
+{
+  return state & RWMUTEX_READERS_MASK;
+}
+
+static uint32_t _waitingWriters(uint32_t state)
+{
+  return (state & RWMUTEX_WAITING_WRITERS_MASK) / RWMUTEX_WAITING_WRITER;
+}
+
+static uint32_t _waitingReaders(uint32_t state)
+{
+  return (state & RWMUTEX_WAITING_READERS_MASK) / RWMUTEX_WAITING_READER;
+}
+
+/// @brief Moves every waiting reader into the lock
+static uint32_t _admitWaitingReaders(uint32_t state, uint32_t& admitted)
+{
+  admitted = _waitingReaders(state);
+  return (state & ~RWMUTEX_WAITING_READERS_MASK) + admitted;
+}
+
+#if OPENSHOCK_RWMUTEX_METRICS
+static OpenShock::ReadWriteMutex* s_namedMutexes = nullptr;
+static portMUX_TYPE s_namedMutexesLock           = portMUX_INITIALIZER_UNLOCKED;
+
+template<typename T>
+static void _atomicMax(std::atomic<T>& target, T value)
+{
+  T current = target.load(std::memory_order_relaxed);
+  while (current < value && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) { }
+}
+#endif
+
+using namespace OpenShock;
+
+ReadWriteMutex::ReadWriteMutex() : ReadWriteMutex(nullptr) { }
+
+ReadWriteMutex::ReadWriteMutex(const char* name)
+  : m_name(name)
+  , m_state(0)
+  , m_readerGate(xSemaphoreCreateCounting(_waitingReaders(RWMUTEX_WAITING_READERS_MASK), 0))
+  , m_writerGate(xSemaphoreCreateCounting(_waitingWriters(RWMUTEX_WAITING_WRITERS_MASK), 0))
+#if OPENSHOCK_RWMUTEX_CHECK_REENTRY
+  , m_writerTask(nullptr)
+  , m_readerTasks()
+#endif
+#if OPENSHOCK_RWMUTEX_METRICS
+  , m_readLocks(0)
+  , m_readContended(0)
+  , m_readWaitUs(0)
+  , m_readHeldUs(0)
+  , m_readersSince(0)
+  , m_writeLocks(0)
+  , m_writeContended(0)
+  , m_writeWaitUs(0)
+  , m_writeWaitMaxUs(0)
+  , m_writeHeldUs(0)
+  , m_writeHeldMaxUs(0)
+  , m_writerSince(0)
+  , m_nextNamed(nullptr)
+#endif
+{
+#if OPENSHOCK_RWMUTEX_METRICS
+  if (m_name != nullptr) {
+    portENTER_CRITICAL_SAFE(&s_namedMutexesLock);
+    m_nextNamed    = s_namedMutexes;
+    s_namedMutexes = this;
+    portEXIT_CRITICAL_SAFE(&s_namedMutexesLock);
+  }
+#endif
 }
 
-OpenShock::ReadWriteMutex::~ReadWriteMutex() {
-  vSemaphoreDelete(m_mutex);
-  vSemaphoreDelete(m_readSem);
+ReadWriteMutex::~ReadWriteMutex() {
+#if OPENSHOCK_RWMUTEX_METRICS
+  if (m_name != nullptr) {
+    portENTER_CRITICAL_SAFE(&s_namedMutexesLock);
+    for (ReadWriteMutex** it = &s_namedMutexes; *it != nullptr; it = &(*it)->m_nextNamed) {
+      if (*it == this) {
+        *it = m_nextNamed;
+        break;
+      }
+    }
+    portEXIT_CRITICAL_SAFE(&s_namedMutexesLock);
+  }
+#endif
+
+  vSemaphoreDelete(m_readerGate);
+  vSemaphoreDelete(m_writerGate);
 }
 
-bool OpenShock::ReadWriteMutex::lockRead(TickType_t xTicksToWait) {
-  if (xSemaphoreTake(m_readSem, xTicksToWait) == pdFALSE) {
-    OS_LOGE(TAG, "Failed to take read semaphore");
+bool ReadWriteMutex::lockRead(TickType_t xTicksToWait) {
+#if OPENSHOCK_RWMUTEX_CHECK_REENTRY
+  checkNotHeld("read");
+#endif
+
+  uint32_t state = m_state.load(std::memory_order_relaxed);
+  if ((state & (RWMUTEX_WRITER | RWMUTEX_WAITING_WRITERS_MASK)) == 0 && m_state.compare_exchange_weak(state, state + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+#if OPENSHOCK_RWMUTEX_METRICS
+    m_readLocks.fetch_add(1, std::memory_order_relaxed);
+    if (_readers(state) == 0) {
+      onReadersEntered(esp_timer_get_time());
+    }
+#endif
+  } else if (!lockReadSlow(xTicksToWait)) {
     return false;
   }
 
-  if (++m_readers == 1) {
-    if (xSemaphoreTake(m_mutex, xTicksToWait) == pdFALSE) {
-      xSemaphoreGive(m_readSem);
-      return false;
+#if OPENSHOCK_RWMUTEX_CHECK_REENTRY
+  addReaderTask();
+#endif
+  return true;
+}
+
+bool ReadWriteMutex::lockReadSlow(TickType_t xTicksToWait) {
+#if OPENSHOCK_RWMUTEX_METRICS
+  int64_t since = esp_timer_get_time();
+  m_readLocks.fetch_add(1, std::memory_order_relaxed);
+#endif
+
+  uint32_t state = m_state.load(std::memory_order_relaxed);
+  while (true) {
+    if ((state & (RWMUTEX_WRITER | RWMUTEX_WAITING_WRITERS_MASK)) == 0) {
+      if (m_state.compare_exchange_weak(state, state + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+#if OPENSHOCK_RWMUTEX_METRICS
+        if (_readers(state) == 0) {
+          onReadersEntered(esp_timer_get_time());
+        }
+#endif
+        return true;
+      }
+      continue;
     }
+
+    // A writer holds or wants the lock, queue behind it
+    if (m_state.compare_exchange_weak(state, state + RWMUTEX_WAITING_READER, std::memory_order_relaxed, std::memory_order_relaxed)) {
+      break;
+    }
+  }
+
+  if (xSemaphoreTake(m_readerGate, xTicksToWait) == pdTRUE) {
+    std::atomic_thread_fence(std::memory_order_acquire);
+#if OPENSHOCK_RWMUTEX_METRICS
+    addReadWait(since);
+#endif
+    return true;
   }
 
-  xSemaphoreGive(m_readSem);
+  state = m_state.load(std::memory_order_relaxed);
+  while (_waitingReaders(state) != 0) {
+    if (m_state.compare_exchange_weak(state, state - RWMUTEX_WAITING_READER, std::memory_order_relaxed, std::memory_order_relaxed)) {
+      OS_LOGE(TAG, "Timed out waiting for read lock");
+      return false;
+    }
+  }
 
+  // Let in after timing out, the token is given right after the transition
+  xSemaphoreTake(m_readerGate, portMAX_DELAY);
+  std::atomic_thread_fence(std::memory_order_acquire);
+#if OPENSHOCK_RWMUTEX_METRICS
+  addReadWait(since);
+#endif
   return true;
 }
 
-void OpenShock::ReadWriteMutex::unlockRead() {
-  if (xSemaphoreTake(m_readSem, portMAX_DELAY) == pdFALSE) {
-    OS_LOGE(TAG, "Failed to take read semaphore");
-    return;
+void ReadWriteMutex::unlockRead() {
+#if OPENSHOCK_RWMUTEX_CHECK_REENTRY
+  removeReaderTask();
+#endif
+
+  uint32_t previous = m_state.fetch_sub(1, std::memory_order_release);
+
+#if OPENSHOCK_RWMUTEX_METRICS
+  if (_readers(previous) == 1) {
+    onReadersLeft();
   }
+#endif
 
-  if (--m_readers == 0) {
-    xSemaphoreGive(m_mutex);
+  // Last reader out lets the first waiting writer in
+  if (_readers(previous) == 1 && _waitingWriters(previous) != 0) {
+    unlockReadSlow();
   }
+}
 
-  xSemaphoreGive(m_readSem);
+void ReadWriteMutex::unlockReadSlow() {
+  uint32_t state = m_state.load(std::memory_order_relaxed);
+  while (_readers(state) == 0 && (state & RWMUTEX_WRITER) == 0 && _waitingWriters(state) != 0) {
+    if (m_state.compare_exchange_weak(state, (state - RWMUTEX_WAITING_WRITER) | RWMUTEX_WRITER, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+      grant(0, true);
+      return;
+    }
+  }
 }
 
-bool OpenShock::ReadWriteMutex::lockWrite(TickType_t xTicksToWait) {
-  if (xSemaphoreTake(m_mutex, xTicksToWait) == pdFALSE) {
-    OS_LOGE(TAG, "Failed to take mutex");
+bool ReadWriteMutex::lockWrite(TickType_t xTicksToWait) {
+#if OPENSHOCK_RWMUTEX_CHECK_REENTRY
+  checkNotHeld("write");
+#endif
+
+  uint32_t expected = 0;
+  if (m_state.compare_exchange_strong(expected, RWMUTEX_WRITER, std::memory_order_acquire, std::memory_order_relaxed)) {
+#if OPENSHOCK_RWMUTEX_METRICS
+    m_writeLocks.fetch_add(1, std::memory_order_relaxed);
+    onWriterEntered();
+#endif
+  } else if (!lockWriteSlow(xTicksToWait)) {
     return false;
   }
 
+#if OPENSHOCK_RWMUTEX_CHECK_REENTRY
+  m_writerTask.store(xTaskGetCurrentTaskHandle(), std::memory_order_relaxed);
+#endif
+  return true;
+}
+
+bool ReadWriteMutex::lockWriteSlow(TickType_t xTicksToWait) {
+#if OPENSHOCK_RWMUTEX_METRICS
+  int64_t since = esp_timer_get_time();
+  m_writeLocks.fetch_add(1, std::memory_order_relaxed);
+#endif
+
+  uint32_t state = m_state.load(std::memory_order_relaxed);
+  while (true) {
+    if (_readers(state) == 0 && (state & RWMUTEX_WRITER) == 0 && _waitingWriters(state) == 0) {
+      if (m_state.compare_exchange_weak(state, state | RWMUTEX_WRITER, std::memory_order_acquire, std::memory_order_relaxed)) {
+#if OPENSHOCK_RWMUTEX_METRICS
+        onWriterEntered();
+#endif
+        return true;
+      }
+      continue;
+    }
+
+    // Also keeps new readers out from here on
+    if (m_state.compare_exchange_weak(state, state + RWMUTEX_WAITING_WRITER, std::memory_order_relaxed, std::memory_order_relaxed)) {
+      break;
+    }
+  }
+
+  if (xSemaphoreTake(m_writerGate, xTicksToWait) == pdTRUE) {
+    std::atomic_thread_fence(std::memory_order_acquire);
+#if OPENSHOCK_RWMUTEX_METRICS
+    addWriteWait(since);
+    onWriterEntered();
+#endif
+    return true;
+  }
+
+  state = m_state.load(std::memory_order_relaxed);
+  while (_waitingWriters(state) != 0) {
+    uint32_t next     = state - RWMUTEX_WAITING_WRITER;
+    uint32_t admitted = 0;
+
+    // Readers only waited because of this writer
+    if (_waitingWriters(next) == 0 && (next & RWMUTEX_WRITER) == 0) {
+      next = _admitWaitingReaders(next, admitted);
+    }
+
+    if (m_state.compare_exchange_weak(state, next, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+      grant(admitted, false);
+      OS_LOGE(TAG, "Timed out waiting for write lock");
+      return false;
+    }
+  }
+
+  // Let in after timing out, the token is given right after the transition
+  xSemaphoreTake(m_writerGate, portMAX_DELAY);
+  std::atomic_thread_fence(std::memory_order_acquire);
+#if OPENSHOCK_RWMUTEX_METRICS
+  addWriteWait(since);
+  onWriterEntered();
+#endif
   return true;
 }
 
-void OpenShock::ReadWriteMutex::unlockWrite() {
-  xSemaphoreGive(m_mutex);
+void ReadWriteMutex::unlockWrite() {
+#if OPENSHOCK_RWMUTEX_CHECK_REENTRY
+  m_writerTask.store(nullptr, std::memory_order_relaxed);
+#endif
+#if OPENSHOCK_RWMUTEX_METRICS
+  onWriterLeft();
+#endif
+
+  uint32_t expected = RWMUTEX_WRITER;
+  if (m_state.compare_exchange_strong(expected, 0, std::memory_order_release, std::memory_order_relaxed)) {
+    return;
+  }
+
+  unlockWriteSlow();
+}
+
+void ReadWriteMutex::unlockWriteSlow() {
+  uint32_t state = m_state.load(std::memory_order_relaxed);
+  while (true) {
+    uint32_t next     = state & ~RWMUTEX_WRITER;
+    uint32_t admitted = 0;
+    bool writer       = false;
+
+    // Readers that queued behind this writer go before the next writer, so neither side starves
+    if (_waitingReaders(next) != 0) {
+      next = _admitWaitingReaders(next, admitted);
+    } else if (_waitingWriters(next) != 0) {
+      next   = (next - RWMUTEX_WAITING_WRITER) | RWMUTEX_WRITER;
+      writer = true;
+    }
+
+    if (m_state.compare_exchange_weak(state, next, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+      grant(admitted, writer);
+      return;
+    }
+  }
+}
+
+void ReadWriteMutex::grant(uint32_t readers, bool writer) {
+#if OPENSHOCK_RWMUTEX_METRICS
+  if (readers != 0) {
+    onReadersEntered(esp_timer_get_time());
+  }
+#endif
+
+  for (uint32_t i = 0; i < readers; i++) {
+    xSemaphoreGive(m_readerGate);
+  }
+
+  if (writer) {
+    xSemaphoreGive(m_writerGate);
+  }
+}
+
+#if OPENSHOCK_RWMUTEX_CHECK_REENTRY
+// Only the calling task ever stores its own handle, so it always finds its own entries even though other tasks update theirs concurrently
+void ReadWriteMutex::checkNotHeld(const char* lockType) const {
+  TaskHandle_t task = xTaskGetCurrentTaskHandle();
+  const char* name  = m_name != nullptr ? m_name : "unnamed mutex";
+
+  if (m_writerTask.load(std::memory_order_relaxed) == task) {
+    OS_PANIC_INSTANT(TAG, "Task took the %s lock of %s while holding its write lock, this deadlocks", lockType, name);
+  }
+
+  for (const auto& reader : m_readerTasks) {
+    if (reader.load(std::memory_order_relaxed) == task) {
+      OS_PANIC_INSTANT(TAG, "Task took the %s lock of %s while holding its read lock, this deadlocks once a writer waits", lockType, name);
+    }
+  }
+}
+
+void ReadWriteMutex::addReaderTask() {
+  TaskHandle_t task = xTaskGetCurrentTaskHandle();
+
+  for (auto& reader : m_readerTasks) {
+    TaskHandle_t expected = nullptr;
+    if (reader.compare_exchange_strong(expected, task, std::memory_order_relaxed)) {
+      return;
+    }
+  }
+}
+
+void ReadWriteMutex::removeReaderTask() {
+  TaskHandle_t task = xTaskGetCurrentTaskHandle();
+
+  for (auto& reader : m_readerTasks) {
+    TaskHandle_t expected = task;
+    if (reader.compare_exchange_strong(expected, nullptr, std::memory_order_relaxed)) {
+      return;
+    }
+  }
+}
+#endif
+
+#if OPENSHOCK_RWMUTEX_METRICS
+void ReadWriteMutex::addReadWait(int64_t since) {
+  m_readContended.fetch_add(1, std::memory_order_relaxed);
+  m_readWaitUs.fetch_add(static_cast<uint64_t>(esp_timer_get_time() - since), std::memory_order_relaxed);
+}
+
+void ReadWriteMutex::addWriteWait(int64_t since) {
+  uint32_t waited = static_cast<uint32_t>(esp_timer_get_time() - since);
+
+  m_writeContended.fetch_add(1, std::memory_order_relaxed);
+  m_writeWaitUs.fetch_add(waited, std::memory_order_relaxed);
+  _atomicMax(m_writeWaitMaxUs, waited);
+}
+
+void ReadWriteMutex::onReadersEntered(int64_t now) {
+  m_readersSince.store(now, std::memory_order_relaxed);
+}
+
+void ReadWriteMutex::onReadersLeft() {
+  m_readHeldUs.fetch_add(static_cast<uint64_t>(esp_timer_get_time() - m_readersSince.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+}
+
+void ReadWriteMutex::onWriterEntered() {
+  m_writerSince = esp_timer_get_time();
+}
+
+void ReadWriteMutex::onWriterLeft() {
+  uint32_t held = static_cast<uint32_t>(esp_timer_get_time() - m_writerSince);
+
+  m_writeHeldUs.fetch_add(held, std::memory_order_relaxed);
+  _atomicMax(m_writeHeldMaxUs, held);
+}
+
+ReadWriteMutex::Metrics ReadWriteMutex::getMetrics() const {
+  return Metrics {
+    .readLocks      = m_readLocks.load(std::memory_order_relaxed),
+    .readContended  = m_readContended.load(std::memory_order_relaxed),
+    .readWaitUs     = m_readWaitUs.load(std::memory_order_relaxed),
+    .readHeldUs     = m_readHeldUs.load(std::memory_order_relaxed),
+    .writeLocks     = m_writeLocks.load(std::memory_order_relaxed),
+    .writeContended = m_writeContended.load(std::memory_order_relaxed),
+    .writeWaitUs    = m_writeWaitUs.load(std::memory_order_relaxed),
+    .writeWaitMaxUs = m_writeWaitMaxUs.load(std::memory_order_relaxed),
+    .writeHeldUs    = m_writeHeldUs.load(std::memory_order_relaxed),
+    .writeHeldMaxUs = m_writeHeldMaxUs.load(std::memory_order_relaxed),
+  };
+}
+
+void ReadWriteMutex::resetMetrics() {
+  m_readLocks.store(0, std::memory_order_relaxed);
+  m_readContended.store(0, std::memory_order_relaxed);
+  m_readWaitUs.store(0, std::memory_order_relaxed);
+  m_readHeldUs.store(0, std::memory_order_relaxed);
+  m_writeLocks.store(0, std::memory_order_relaxed);
+  m_writeContended.store(0, std::memory_order_relaxed);
+  m_writeWaitUs.store(0, std::memory_order_relaxed);
+  m_writeWaitMaxUs.store(0, std::memory_order_relaxed);
+  m_writeHeldUs.store(0, std::memory_order_relaxed);
+  m_writeHeldMaxUs.store(0, std::memory_order_relaxed);
+}
+
+std::vector<ReadWriteMutex::NamedMetrics> ReadWriteMutex::GetAllMetrics() {
+  std::size_t count = 0;
+
+  portENTER_CRITICAL_SAFE(&s_namedMutexesLock);
+  for (ReadWriteMutex* it = s_namedMutexes; it != nullptr; it = it->m_nextNamed) {
+    count++;
+  }
+  portEXIT_CRITICAL_SAFE(&s_namedMutexesLock);
+
+  // Reserved up front, nothing may allocate inside the critical section
+  std::vector<NamedMetrics> metrics;
+  metrics.reserve(count);
+
+  portENTER_CRITICAL_SAFE(&s_namedMutexesLock);
+  for (ReadWriteMutex* it = s_namedMutexes; it != nullptr && metrics.size() < count; it = it->m_nextNamed) {
+    metrics.push_back({it->name(), it->getMetrics()});
+  }
+  portEXIT_CRITICAL_SAFE(&s_namedMutexesLock);
+
+  return metrics;
 }
+#endif
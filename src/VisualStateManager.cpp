@@ -19,6 +19,9 @@ const char* const TAG = "VisualStateManager";
 #ifndef OPENSHOCK_LED_WS2812B
 #define OPENSHOCK_LED_WS2812B GPIO_NUM_NC
 #endif  // OPENSHOCK_LED_WS2812B
+#ifndef OPENSHOCK_LED_WS2812B_COUNT
+#define OPENSHOCK_LED_WS2812B_COUNT 1
+#endif  // OPENSHOCK_LED_WS2812B_COUNT
 
 const uint64_t kCriticalErrorFlag                = 1 << 0;
 const uint64_t kEmergencyStoppedFlag             = 1 << 1;
@@ -159,8 +162,8 @@ const PinPatternManager::State kWebSocketConnectedPattern[] = {
   {false, 10'000}
 };
 const RGBPatternManager::RGBState kWebSocketConnectedRGBPattern[] = {
-  {0, 255, 0,    100},
-  {0,   0, 0, 10'000},
+  {0, 255, 0,    100,  50}, // Fade in over 50 ms
+  {0,   0, 0, 10'000, 300}, // Fade out over 300 ms
 };
 
 const PinPatternManager::State kSolidOnPattern[] = {
@@ -346,7 +349,7 @@ bool VisualStateManager::Init()
   }
 
   if (OPENSHOCK_LED_WS2812B != GPIO_NUM_NC) {
-    s_RGBLedManager = std::make_shared<RGBPatternManager>(static_cast<gpio_num_t>(OPENSHOCK_LED_WS2812B));
+    s_RGBLedManager = std::make_shared<RGBPatternManager>(static_cast<gpio_num_t>(OPENSHOCK_LED_WS2812B), OPENSHOCK_LED_WS2812B_COUNT);
     if (!s_RGBLedManager->IsValid()) {
       OS_LOGE(TAG, "Failed to initialize RGB LED manager");
       return false;
@@ -3,6 +3,7 @@
 const char* const TAG = "WebSocketDeFragger";
 
 #include "Logging.h"
+#include "util/HeapTracker.h"
 
 #include <cstring>
 
@@ -25,6 +26,8 @@ WebSocketDeFragger::~WebSocketDeFragger() {
 }
 
 void WebSocketDeFragger::handler(uint8_t socketId, WStype_t type, const uint8_t* payload, std::size_t length) {
+  OS_HEAP_SITE(TAG);
+
   switch (type) {
     case WStype_FRAGMENT_BIN_START:
       start(socketId, WebSocketMessageType::Binary, payload, length);
@@ -88,3 +88,18 @@ cJSON* BackendConfig::ToJSON(bool withSensitiveData) const {
 
   return root;
 }
+
+void BackendConfig::ToJSON(Serialization::JsonStream::Writer& writer, bool withSensitiveData) const {
+  writer.beginObject();
+  writer.key("domain");
+  writer.string(domain);
+
+  if (withSensitiveData) {
+    writer.key("authToken");
+    writer.string(authToken);
+  }
+
+  writer.key("lcgOverride");
+  writer.string(lcgOverride);
+  writer.endObject();
+}
@@ -61,3 +61,10 @@ cJSON* CaptivePortalConfig::ToJSON(bool withSensitiveData) const {
 
   return root;
 }
+
+void CaptivePortalConfig::ToJSON(Serialization::JsonStream::Writer& writer, bool withSensitiveData) const {
+  writer.beginObject();
+  writer.key("alwaysEnabled");
+  writer.boolean(alwaysEnabled);
+  writer.endObject();
+}
@@ -6,22 +6,86 @@ const char* const TAG = "Config";
 
 #include "Chipset.h"
 #include "Common.h"
+#include "config/ConfigSnapshot.h"
+#include "config/internal/JsonConfigReader.h"
+#include "config/internal/utils.h"
 #include "config/RootConfig.h"
 #include "Logging.h"
 #include "ReadWriteMutex.h"
+#include "SimpleMutex.h"
+#include "Time.h"
+#include "util/HeapTracker.h"
+#include "util/HexUtils.h"
+#include "util/StringUtils.h"
+#include "util/TaskUtils.h"
+
+#include <esp_rom_crc.h>
+#include <esp_system.h>
 
 #include <FS.h>
 #include <LittleFS.h>
 
 #include <cJSON.h>
 
+#include <atomic>
 #include <bitset>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <string>
+
+const char* const CONFIG_FILE_PATH            = "/config";
+const char* const CONFIG_JOURNAL_PATH         = "/config.journal";
+const char* const CONFIG_TEMP_PATH            = "/config.tmp";
+const char* const PARTITION_HASHES_PATH       = "/partition_hashes";
+const char* const WIFI_LAST_CONNECTION_PATH   = "/wifi_last_connection";
+const char* const LOG_LEVELS_PATH             = "/log_levels";
+const uint8_t WIFI_LAST_CONNECTION_VERSION    = 1;           // Bump when WiFiLastConnectionRecord changes, older records are then ignored
+const uint32_t CONFIG_JOURNAL_RECORD_MAGIC    = 0x524A534F;  // "OSJR"
+const std::size_t CONFIG_JOURNAL_COMPACT_SIZE = 8192;        // Journal size at which it is folded back into the config file
+const uint32_t CONFIG_PERSIST_DEBOUNCE_MS     = 1000;        // Quiet time after a change before it is written
+const int64_t CONFIG_PERSIST_MAX_DELAY_MS     = 5000;        // Upper bound on how long a steady stream of changes delays the write
+
+// Sections of the config, a change only decodes and re-encodes the sections it touches
+const uint8_t CONFIG_SECTION_RF             = 1 << 0;
+const uint8_t CONFIG_SECTION_WIFI           = 1 << 1;
+const uint8_t CONFIG_SECTION_CAPTIVE_PORTAL = 1 << 2;
+const uint8_t CONFIG_SECTION_BACKEND        = 1 << 3;
+const uint8_t CONFIG_SECTION_SERIAL_INPUT   = 1 << 4;
+const uint8_t CONFIG_SECTION_OTA_UPDATE     = 1 << 5;
+const uint8_t CONFIG_SECTION_ESTOP          = 1 << 6;
+const uint8_t CONFIG_SECTIONS_ALL           = 0x7F;
+
+/// @brief Precedes every serialized config appended to the journal
+struct ConfigJournalRecordHeader {
+  uint32_t magic;
+  uint32_t size;
+  uint32_t crc;  // CRC-32 of the record data, detects records torn by a power loss
+};
+
+/// @brief Contents of the last connection cache file
+struct WiFiLastConnectionRecord {
+  uint8_t version;
+  uint8_t credentialsID;
+  uint8_t channel;
+  uint8_t bssid[6];
+  uint8_t reserved[3];
+  uint32_t crc;  // CRC-32 of everything before it, a torn or corrupted record must not steer the fast connect to a wrong channel
+};
+static_assert(sizeof(WiFiLastConnectionRecord) == 16, "WiFiLastConnectionRecord layout is stored on flash");
 
 using namespace OpenShock;
 
 static fs::LittleFSFS _configFS;
-static Config::RootConfig _configData;
-static ReadWriteMutex _configMutex;
+static SnapshotPublisher<Config::ConfigSnapshot> _configSnapshot;  // Published config, readers never lock
+static uint32_t _configGeneration = 0;                             // Generation of the newest snapshot, only changed under the write lock
+static std::unique_ptr<Config::RootConfig> _configOverlay;         // Sections writers modify, only exists while changes are being made
+static uint8_t _configOverlaySections = 0;                         // Sections of the overlay that were decoded to be changed, the rest is carried over from the snapshot
+static ReadWriteMutex _configMutex("config");
+static SimpleMutex _persistMutex;            // Serializes writes to the config file and journal, and any other use of the temp file
+static uint32_t _persistedGeneration = 0;    // Generation of the snapshot last written to flash, only accessed under the persist lock
+static std::size_t _journalSize = 0;
+static TaskHandle_t _persistTaskHandle = nullptr;
 
 #define CONFIG_LOCK_READ_ACTION(retval, action)  \
   ScopedReadLock lock__(&_configMutex);          \
@@ -42,82 +106,342 @@ static ReadWriteMutex _configMutex;
 #define CONFIG_LOCK_READ(retval)  CONFIG_LOCK_READ_ACTION(retval, {})
 #define CONFIG_LOCK_WRITE(retval) CONFIG_LOCK_WRITE_ACTION(retval, {})
 
-bool _tryDeserializeConfig(const uint8_t* buffer, std::size_t bufferLen, OpenShock::Config::RootConfig& config)
+#define CONFIG_LOCK_CHANGE(retval, sections)                 \
+  CONFIG_LOCK_WRITE(retval);                                 \
+  Config::RootConfig* overlay = _getConfigOverlay(sections); \
+  if (overlay == nullptr) {                                  \
+    return retval;                                           \
+  }
+
+#define CONFIG_READ_SNAPSHOT(retval)                   \
+  OS_HEAP_SITE(TAG);                                   \
+  Config::Snapshot snapshot = Config::GetSnapshot();   \
+  if (snapshot == nullptr) {                           \
+    OS_LOGE(TAG, "Config has not been initialized");   \
+    return retval;                                     \
+  }
+
+bool _tryReadFile(const char* path, std::vector<uint8_t>& buffer)
 {
-  if (buffer == nullptr || bufferLen == 0) {
-    OS_LOGE(TAG, "Buffer is null or empty");
+  File file = _configFS.open(path, "rb");
+  if (!file) {
+    OS_LOGE(TAG, "Failed to open %s for reading", path);
     return false;
   }
 
-  // Deserialize
-  auto fbsConfig = flatbuffers::GetRoot<Serialization::Configuration::HubConfig>(buffer);
-  if (fbsConfig == nullptr) {
-    OS_LOGE(TAG, "Failed to get deserialization root for config file");
+  // Get file size
+  std::size_t size = file.size();
+
+  // Resize buffer
+  buffer.resize(size);
+
+  // Read file
+  if (file.read(buffer.data(), buffer.size()) != buffer.size()) {
+    OS_LOGE(TAG, "Failed to read %s, size mismatch", path);
     return false;
   }
 
-  // Validate buffer
-  flatbuffers::Verifier::Options verifierOptions {
-    .max_size = 4096,  // Should be enough
+  file.close();
+
+  return true;
+}
+/// @brief Finds the newest intact record in the journal, a power loss while appending only ever tears the tail
+/// @return Whether the journal ends in a torn record, which makes later appends unreachable until it is compacted
+bool _findLastJournalRecord(const std::vector<uint8_t>& journal, const uint8_t*& record, std::size_t& recordSize, std::size_t& validSize)
+{
+  record     = nullptr;
+  recordSize = 0;
+  validSize  = 0;
+
+  while (journal.size() - validSize >= sizeof(ConfigJournalRecordHeader)) {
+    ConfigJournalRecordHeader header;
+    memcpy(&header, journal.data() + validSize, sizeof(header));
+
+    std::size_t available = journal.size() - validSize - sizeof(header);
+    if (header.magic != CONFIG_JOURNAL_RECORD_MAGIC || header.size > available) {
+      break;
+    }
+
+    const uint8_t* data = journal.data() + validSize + sizeof(header);
+    if (esp_rom_crc32_le(0, data, header.size) != header.crc) {
+      break;
+    }
+
+    record     = data;
+    recordSize = header.size;
+    validSize += sizeof(header) + header.size;
+  }
+
+  return validSize != journal.size();
+}
+/// @brief Loads the config file and replays the journal on top of it, without deserializing either
+std::unique_ptr<Config::ConfigSnapshot> _tryReadConfig(bool& journalTorn)
+{
+  std::unique_ptr<Config::ConfigSnapshot> loaded;
+  journalTorn = false;
+
+  std::vector<uint8_t> buffer;
+  if (_configFS.exists(CONFIG_FILE_PATH) && _tryReadFile(CONFIG_FILE_PATH, buffer)) {
+    auto snapshot = std::make_unique<Config::ConfigSnapshot>(std::move(buffer), ++_configGeneration);
+    if (snapshot->ok()) {
+      loaded = std::move(snapshot);
+    } else {
+      OS_LOGW(TAG, "Config file is unreadable, relying on journal");
+    }
+  }
+
+  _journalSize = 0;
+
+  if (!_configFS.exists(CONFIG_JOURNAL_PATH) || !_tryReadFile(CONFIG_JOURNAL_PATH, buffer)) {
+    return loaded;
+  }
+
+  const uint8_t* record;
+  std::size_t recordSize;
+  journalTorn = _findLastJournalRecord(buffer, record, recordSize, _journalSize);
+  if (journalTorn) {
+    OS_LOGW(TAG, "Discarding %zu bytes of incomplete config journal", buffer.size() - _journalSize);
+  }
+
+  if (record == nullptr) {
+    return loaded;
+  }
+
+  auto snapshot = std::make_unique<Config::ConfigSnapshot>(std::vector<uint8_t>(record, record + recordSize), ++_configGeneration);
+  if (!snapshot->ok()) {
+    OS_LOGW(TAG, "Failed to read newest config journal record");
+    journalTorn = true;
+    return loaded;
+  }
+
+  return snapshot;
+}
+/// @brief Checks what the verifier can't, credentials without an SSID are dropped when deserializing and must not be carried over verbatim
+bool _isConfigSane(const Serialization::Configuration::HubConfig* root)
+{
+  auto wifi = root->wifi();
+  if (wifi == nullptr || wifi->credentials() == nullptr) {
+    return true;
+  }
+
+  for (auto fbsCreds : *wifi->credentials()) {
+    if (fbsCreds == nullptr || fbsCreds->ssid() == nullptr || fbsCreds->ssid()->size() == 0) {
+      return false;
+    }
+  }
+
+  return true;
+}
+/// @brief Rebuilds a config through a full deserialize, which drops whatever _isConfigSane rejects
+std::unique_ptr<Config::ConfigSnapshot> _repairConfig(const Config::ConfigSnapshot& snapshot)
+{
+  Config::RootConfig config;
+  if (!config.FromFlatbuffers(snapshot.root())) {
+    return nullptr;
+  }
+
+  flatbuffers::FlatBufferBuilder builder;
+
+  Serialization::Configuration::FinishHubConfigBuffer(builder, config.ToFlatbuffers(builder, true));
+
+  auto repaired = std::make_unique<Config::ConfigSnapshot>(std::vector<uint8_t>(builder.GetBufferPointer(), builder.GetBufferPointer() + builder.GetSize()), snapshot.generation());
+  if (!repaired->ok()) {
+    return nullptr;
+  }
+
+  return repaired;
+}
+/// @brief Loads the config and checks it, a config that had to be repaired or a torn journal has to be written back
+std::unique_ptr<Config::ConfigSnapshot> _tryLoadConfig(bool& needsRewrite)
+{
+  bool journalTorn;
+  std::unique_ptr<Config::ConfigSnapshot> snapshot = _tryReadConfig(journalTorn);
+
+  needsRewrite = journalTorn;
+
+  if (snapshot == nullptr || _isConfigSane(snapshot->root())) {
+    return snapshot;
+  }
+
+  OS_LOGW(TAG, "Config contains invalid WiFi credentials, dropping them");
+
+  auto repaired = _repairConfig(*snapshot);
+  if (repaired == nullptr) {
+    OS_LOGE(TAG, "Failed to repair config");
+    return nullptr;
+  }
+
+  // Written back so the next boot skips the repair
+  needsRewrite = true;
+
+  return repaired;
+}
+/// @brief Appends a serialized config to the journal
+bool _tryAppendConfigJournal(const uint8_t* data, std::size_t dataLen)
+{
+  ConfigJournalRecordHeader header {
+    .magic = CONFIG_JOURNAL_RECORD_MAGIC,
+    .size  = static_cast<uint32_t>(dataLen),
+    .crc   = esp_rom_crc32_le(0, data, dataLen),
   };
-  flatbuffers::Verifier verifier(buffer, bufferLen, verifierOptions);
-  if (!fbsConfig->Verify(verifier)) {
-    OS_LOGE(TAG, "Failed to verify config file integrity");
+
+  File file = _configFS.open(CONFIG_JOURNAL_PATH, "ab");
+  if (!file) {
+    OS_LOGE(TAG, "Failed to open config journal for appending");
     return false;
   }
 
-  // Read config
-  if (!config.FromFlatbuffers(fbsConfig)) {
-    OS_LOGE(TAG, "Failed to read config file");
+  bool written = file.write(reinterpret_cast<const uint8_t*>(&header), sizeof(header)) == sizeof(header) && file.write(data, dataLen) == dataLen;
+
+  file.close();
+
+  if (!written) {
+    OS_LOGE(TAG, "Failed to append to config journal");
+    _journalSize = CONFIG_JOURNAL_COMPACT_SIZE;  // The tail may be torn now, compact on the next write
     return false;
   }
 
+  _journalSize += sizeof(header) + dataLen;
+
   return true;
 }
-bool _tryLoadConfig(std::vector<uint8_t>& buffer)
+/// @brief Replaces a file through the temp file, the rename replaces it atomically so a power loss never leaves a partial file
+bool _tryReplaceFile(const char* path, const uint8_t* prefix, std::size_t prefixLen, const uint8_t* data, std::size_t dataLen)
 {
-  File file = _configFS.open("/config", "rb");
+  File file = _configFS.open(CONFIG_TEMP_PATH, "wb");
   if (!file) {
-    OS_LOGE(TAG, "Failed to open config file for reading");
+    OS_LOGE(TAG, "Failed to open %s for writing", CONFIG_TEMP_PATH);
     return false;
   }
 
-  // Get file size
-  std::size_t size = file.size();
+  // Write file
+  if (file.write(prefix, prefixLen) != prefixLen || file.write(data, dataLen) != dataLen) {
+    OS_LOGE(TAG, "Failed to write %s", CONFIG_TEMP_PATH);
+    file.close();
+    return false;
+  }
 
-  // Resize buffer
-  buffer.resize(size);
+  file.close();
 
-  // Read file
-  if (file.read(buffer.data(), buffer.size()) != buffer.size()) {
-    OS_LOGE(TAG, "Failed to read config file, size mismatch");
+  if (!_configFS.rename(CONFIG_TEMP_PATH, path)) {
+    OS_LOGE(TAG, "Failed to replace %s", path);
     return false;
   }
 
-  file.close();
+  return true;
+}
+/// @brief Replaces the config file with a serialized config and drops the journal
+bool _tryCompactConfig(const uint8_t* data, std::size_t dataLen)
+{
+  ConfigJournalRecordHeader header {
+    .magic = CONFIG_JOURNAL_RECORD_MAGIC,
+    .size  = static_cast<uint32_t>(dataLen),
+    .crc   = esp_rom_crc32_le(0, data, dataLen),
+  };
+
+  // Boot applies the newest journal record on top of the config file, so the new config has to be the only record before the config file changes.
+  // Otherwise a power loss between replacing the config file and removing the journal would replay an older record over it.
+  if (!_tryReplaceFile(CONFIG_JOURNAL_PATH, reinterpret_cast<const uint8_t*>(&header), sizeof(header), data, dataLen)) {
+    _journalSize = CONFIG_JOURNAL_COMPACT_SIZE;  // The journal is unchanged, retry on the next write
+    return false;
+  }
+
+  _journalSize = sizeof(header) + dataLen;
+
+  if (!_tryReplaceFile(CONFIG_FILE_PATH, nullptr, 0, data, dataLen)) {
+    OS_LOGW(TAG, "Config remains in the journal until the next compaction");
+    return true;
+  }
+
+  // Replaying a leftover journal yields this same config, losing power before this point is harmless
+  if (!_configFS.remove(CONFIG_JOURNAL_PATH)) {
+    OS_LOGW(TAG, "Failed to remove config journal");
+    return true;
+  }
+
+  _journalSize = 0;
 
   return true;
 }
-bool _tryLoadConfig()
+/// @brief Writes the published config to flash unless it already is, appending to the journal or compacting it once it grows too large
+bool _tryPersistConfig(bool compact = false)
 {
-  std::vector<uint8_t> buffer;
-  if (!_tryLoadConfig(buffer)) {
+  ScopedLock lock__(&_persistMutex);
+  if (!lock__.isLocked()) {
+    OS_LOGE(TAG, "Failed to acquire persist lock");
     return false;
   }
 
-  return _tryDeserializeConfig(buffer.data(), buffer.size(), _configData);
+  Config::Snapshot snapshot = _configSnapshot.load();
+  if (snapshot == nullptr) {
+    OS_LOGE(TAG, "Config has not been initialized");
+    return false;
+  }
+
+  // Changes made while a previous write was pending have been coalesced into it
+  if (snapshot->generation() == _persistedGeneration && !compact) {
+    return true;
+  }
+
+  // Snapshots already are the serialized config, written as is
+  const std::vector<uint8_t>& buffer = snapshot->buffer();
+
+  compact |= _journalSize + sizeof(ConfigJournalRecordHeader) + buffer.size() > CONFIG_JOURNAL_COMPACT_SIZE;
+
+  bool result = compact ? _tryCompactConfig(buffer.data(), buffer.size()) : _tryAppendConfigJournal(buffer.data(), buffer.size());
+  if (result) {
+    _persistedGeneration = snapshot->generation();
+  }
+
+  return result;
 }
-bool _trySaveConfig(const uint8_t* data, std::size_t dataLen)
+void _persistTask(void* arg)
 {
-  File file = _configFS.open("/config", "wb");
+  (void)arg;
+
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    // Coalesce bursts of changes into a single write, but don't let a steady stream of them postpone it forever
+    int64_t firstChange = OpenShock::millis();
+    while (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(CONFIG_PERSIST_DEBOUNCE_MS)) != 0) {
+      if (OpenShock::millis() - firstChange >= CONFIG_PERSIST_MAX_DELAY_MS) {
+        break;
+      }
+    }
+
+    if (!_tryPersistConfig()) {
+      OS_LOGE(TAG, "Failed to persist config");
+    }
+
+    // Configs replaced while a reader was active are only deleted once none is, retry now that things have settled
+    _configSnapshot.reclaim();
+  }
+}
+void _persistOnShutdown()
+{
+  if (!_tryPersistConfig()) {
+    OS_LOGE(TAG, "Failed to persist config before restart");
+  }
+}
+/// @brief Reads the partition hash cache, one "<label> <tag> <sha256 hex>" entry per line
+bool _tryLoadPartitionHashes(std::string& data)
+{
+  if (!_configFS.exists(PARTITION_HASHES_PATH)) {
+    data.clear();
+    return true;
+  }
+
+  File file = _configFS.open(PARTITION_HASHES_PATH, "rb");
   if (!file) {
-    OS_LOGE(TAG, "Failed to open config file for writing");
+    OS_LOGE(TAG, "Failed to open partition hash cache for reading");
     return false;
   }
 
-  // Write file
-  if (file.write(data, dataLen) != dataLen) {
-    OS_LOGE(TAG, "Failed to write config file");
+  data.resize(file.size());
+
+  if (file.read(reinterpret_cast<uint8_t*>(data.data()), data.size()) != data.size()) {
+    OS_LOGE(TAG, "Failed to read partition hash cache, size mismatch");
     return false;
   }
 
@@ -125,15 +449,313 @@ bool _trySaveConfig(const uint8_t* data, std::size_t dataLen)
 
   return true;
 }
-bool _trySaveConfig()
+/// @brief Replaces the partition hash cache entry of a partition, an empty entry only drops the existing one
+bool _tryStorePartitionHash(std::string_view label, std::string_view entry)
+{
+  std::string data;
+  if (!_tryLoadPartitionHashes(data)) {
+    data.clear();  // Rebuild a corrupt cache from scratch
+  }
+
+  // Keep the entries of all other partitions
+  std::string updated;
+  for (std::string_view line : OpenShock::StringSplitNewLines(data)) {
+    std::string_view parts[3];
+    if (OpenShock::StringSplitInto(OpenShock::StringSplitWhiteSpace(line), parts) != 3 || parts[0] == label) {
+      continue;
+    }
+
+    updated.append(line.data(), line.size());
+    updated.push_back('\n');
+  }
+
+  updated.append(entry.data(), entry.size());
+
+  // The persist task replaces files through the same temp file without holding the config lock
+  ScopedLock lock__(&_persistMutex);
+  if (!lock__.isLocked()) {
+    OS_LOGE(TAG, "Failed to acquire persist lock");
+    return false;
+  }
+
+  return _tryReplaceFile(PARTITION_HASHES_PATH, nullptr, 0, reinterpret_cast<const uint8_t*>(updated.data()), updated.size());
+}
+/// @brief Reverts a partially applied change by dropping the overlay
+void _discardConfigChanges()
+{
+  _configOverlay.reset();
+  _configOverlaySections = 0;
+}
+/// @brief Decodes one section of the published config into the overlay
+bool _readConfigSection(const Serialization::Configuration::HubConfig* root, uint8_t section)
+{
+  switch (section) {
+    case CONFIG_SECTION_RF:
+      return _configOverlay->rf.FromFlatbuffers(root->rf());
+    case CONFIG_SECTION_WIFI:
+      return _configOverlay->wifi.FromFlatbuffers(root->wifi());
+    case CONFIG_SECTION_CAPTIVE_PORTAL:
+      return _configOverlay->captivePortal.FromFlatbuffers(root->captive_portal());
+    case CONFIG_SECTION_BACKEND:
+      return _configOverlay->backend.FromFlatbuffers(root->backend());
+    case CONFIG_SECTION_SERIAL_INPUT:
+      return _configOverlay->serialInput.FromFlatbuffers(root->serial_input());
+    case CONFIG_SECTION_OTA_UPDATE:
+      return _configOverlay->otaUpdate.FromFlatbuffers(root->ota_update());
+    case CONFIG_SECTION_ESTOP:
+      return _configOverlay->estop.FromFlatbuffers(root->estop());
+    default:
+      return false;
+  }
+}
+/// @brief Gets the overlay writers modify, decoding the given sections of the published config into it unless a change in progress already did
+Config::RootConfig* _getConfigOverlay(uint8_t sections)
 {
+  uint8_t missing = sections & ~_configOverlaySections;
+  if (_configOverlay != nullptr && missing == 0) {
+    return _configOverlay.get();
+  }
+
+  Config::Snapshot snapshot = _configSnapshot.load();
+  if (snapshot == nullptr) {
+    OS_LOGE(TAG, "Config has not been initialized");
+    return nullptr;
+  }
+
+  if (_configOverlay == nullptr) {
+    _configOverlay = std::make_unique<Config::RootConfig>();
+  }
+
+  for (uint8_t section = 1; section < CONFIG_SECTIONS_ALL; section <<= 1) {
+    if ((missing & section) == 0) {
+      continue;
+    }
+
+    if (!_readConfigSection(snapshot->root(), section)) {
+      OS_LOGE(TAG, "Failed to read config");
+      _discardConfigChanges();
+      return nullptr;
+    }
+
+    _configOverlaySections |= section;
+  }
+
+  return _configOverlay.get();
+}
+
+// Carry an unchanged section over from the published buffer into the next one, copying its fields without decoding them into owned strings and vectors first
+
+flatbuffers::Offset<Serialization::Configuration::RFConfig> _copyRFConfig(flatbuffers::FlatBufferBuilder& builder, const Serialization::Configuration::RFConfig* config)
+{
+  if (config == nullptr) {
+    return 0;
+  }
+
+  return Serialization::Configuration::CreateRFConfig(builder, config->tx_pin(), config->keepalive_enabled());
+}
+flatbuffers::Offset<Serialization::Configuration::WiFiConfig> _copyWiFiConfig(flatbuffers::FlatBufferBuilder& builder, const Serialization::Configuration::WiFiConfig* config)
+{
+  if (config == nullptr) {
+    return 0;
+  }
+
+  flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Serialization::Configuration::WiFiCredentials>>> credentialsOffset = 0;
+
+  auto fbsCredentialsList = config->credentials();
+  if (fbsCredentialsList != nullptr) {
+    std::vector<flatbuffers::Offset<Serialization::Configuration::WiFiCredentials>> fbsCredentialsOffsets;
+    fbsCredentialsOffsets.reserve(fbsCredentialsList->size());
+
+    for (auto fbsCreds : *fbsCredentialsList) {
+      auto ssidOffset     = builder.CreateString(fbsCreds->ssid());
+      auto passwordOffset = builder.CreateString(fbsCreds->password());
+
+      fbsCredentialsOffsets.push_back(Serialization::Configuration::CreateWiFiCredentials(builder, fbsCreds->id(), ssidOffset, passwordOffset));
+    }
+
+    credentialsOffset = builder.CreateVector(fbsCredentialsOffsets);
+  }
+
+  auto apSsidOffset   = builder.CreateString(config->ap_ssid());
+  auto hostnameOffset = builder.CreateString(config->hostname());
+
+  return Serialization::Configuration::CreateWiFiConfig(builder, apSsidOffset, hostnameOffset, credentialsOffset);
+}
+flatbuffers::Offset<Serialization::Configuration::CaptivePortalConfig> _copyCaptivePortalConfig(flatbuffers::FlatBufferBuilder& builder, const Serialization::Configuration::CaptivePortalConfig* config)
+{
+  if (config == nullptr) {
+    return 0;
+  }
+
+  return Serialization::Configuration::CreateCaptivePortalConfig(builder, config->always_enabled());
+}
+flatbuffers::Offset<Serialization::Configuration::BackendConfig> _copyBackendConfig(flatbuffers::FlatBufferBuilder& builder, const Serialization::Configuration::BackendConfig* config)
+{
+  if (config == nullptr) {
+    return 0;
+  }
+
+  auto domainOffset      = builder.CreateString(config->domain());
+  auto authTokenOffset   = builder.CreateString(config->auth_token());
+  auto lcgOverrideOffset = builder.CreateString(config->lcg_override());
+
+  return Serialization::Configuration::CreateBackendConfig(builder, domainOffset, authTokenOffset, lcgOverrideOffset);
+}
+flatbuffers::Offset<Serialization::Configuration::SerialInputConfig> _copySerialInputConfig(flatbuffers::FlatBufferBuilder& builder, const Serialization::Configuration::SerialInputConfig* config)
+{
+  if (config == nullptr) {
+    return 0;
+  }
+
+  return Serialization::Configuration::CreateSerialInputConfig(builder, config->echo_enabled());
+}
+flatbuffers::Offset<Serialization::Configuration::OtaUpdateConfig> _copyOtaUpdateConfig(flatbuffers::FlatBufferBuilder& builder, const Serialization::Configuration::OtaUpdateConfig* config)
+{
+  if (config == nullptr) {
+    return 0;
+  }
+
+  auto cdnDomainOffset = builder.CreateString(config->cdn_domain());
+
+  return Serialization::Configuration::CreateOtaUpdateConfig(
+    builder,
+    config->is_enabled(),
+    cdnDomainOffset,
+    config->update_channel(),
+    config->check_on_startup(),
+    config->check_periodically(),
+    config->check_interval(),
+    config->allow_backend_management(),
+    config->require_manual_approval(),
+    config->update_id(),
+    config->update_step()
+  );
+}
+flatbuffers::Offset<Serialization::Configuration::EStopConfig> _copyEStopConfig(flatbuffers::FlatBufferBuilder& builder, const Serialization::Configuration::EStopConfig* config)
+{
+  if (config == nullptr) {
+    return 0;
+  }
+
+  return Serialization::Configuration::CreateEStopConfig(builder, config->enabled(), config->gpio_pin());
+}
+/// @brief Builds the next snapshot from the changed sections of the overlay and the unchanged sections of the published snapshot, then publishes it
+///
+/// Snapshots readers still hold stay valid until released.
+bool _publishConfig()
+{
+  Config::Snapshot previous = _configSnapshot.load();
+  if (previous == nullptr && _configOverlaySections != CONFIG_SECTIONS_ALL) {
+    OS_LOGE(TAG, "Config has not been initialized");
+    return false;
+  }
+
+  const Config::RootConfig& overlay                   = *_configOverlay;
+  const Serialization::Configuration::HubConfig* root = previous != nullptr ? previous->root() : nullptr;
+
+  auto changed = [](uint8_t section) { return (_configOverlaySections & section) != 0; };
+
   flatbuffers::FlatBufferBuilder builder;
 
-  auto fbsConfig = _configData.ToFlatbuffers(builder, true);
+  auto rfOffset            = changed(CONFIG_SECTION_RF) ? overlay.rf.ToFlatbuffers(builder, true) : _copyRFConfig(builder, root->rf());
+  auto wifiOffset          = changed(CONFIG_SECTION_WIFI) ? overlay.wifi.ToFlatbuffers(builder, true) : _copyWiFiConfig(builder, root->wifi());
+  auto captivePortalOffset = changed(CONFIG_SECTION_CAPTIVE_PORTAL) ? overlay.captivePortal.ToFlatbuffers(builder, true) : _copyCaptivePortalConfig(builder, root->captive_portal());
+  auto backendOffset       = changed(CONFIG_SECTION_BACKEND) ? overlay.backend.ToFlatbuffers(builder, true) : _copyBackendConfig(builder, root->backend());
+  auto serialInputOffset   = changed(CONFIG_SECTION_SERIAL_INPUT) ? overlay.serialInput.ToFlatbuffers(builder, true) : _copySerialInputConfig(builder, root->serial_input());
+  auto otaUpdateOffset     = changed(CONFIG_SECTION_OTA_UPDATE) ? overlay.otaUpdate.ToFlatbuffers(builder, true) : _copyOtaUpdateConfig(builder, root->ota_update());
+  auto estopOffset         = changed(CONFIG_SECTION_ESTOP) ? overlay.estop.ToFlatbuffers(builder, true) : _copyEStopConfig(builder, root->estop());
+
+  auto fbsConfig = Serialization::Configuration::CreateHubConfig(builder, rfOffset, wifiOffset, captivePortalOffset, backendOffset, serialInputOffset, otaUpdateOffset, estopOffset);
 
   Serialization::Configuration::FinishHubConfigBuffer(builder, fbsConfig);
 
-  return _trySaveConfig(builder.GetBufferPointer(), builder.GetSize());
+  // Nothing may be read from the previous snapshot past this point
+  previous.release();
+
+  auto snapshot = std::make_unique<Config::ConfigSnapshot>(std::vector<uint8_t>(builder.GetBufferPointer(), builder.GetBufferPointer() + builder.GetSize()), _configGeneration + 1);
+  if (!snapshot->ok()) {
+    OS_LOGE(TAG, "Failed to serialize config");
+    return false;
+  }
+
+  _configGeneration = snapshot->generation();
+  _configSnapshot.publish(std::move(snapshot));
+
+  // Published configs are read in place, the overlay is only rebuilt for the next change
+  _configOverlay.reset();
+  _configOverlaySections = 0;
+
+  return true;
+}
+/// @brief Publishes the overlay and schedules persisting it, must be called with the write lock held
+///
+/// Writes are coalesced by the persist task, pass flush for changes that have to survive an imminent reboot or power loss.
+bool _commitConfig(bool flush = false)
+{
+  if (!_publishConfig()) {
+    _discardConfigChanges();
+    return false;
+  }
+
+  if (flush || _persistTaskHandle == nullptr) {
+    return _tryPersistConfig();
+  }
+
+  xTaskNotifyGive(_persistTaskHandle);
+
+  return true;
+}
+/// @brief Publishes the default config and writes it as a fresh config file
+bool _resetConfig()
+{
+  _configOverlay = std::make_unique<Config::RootConfig>();
+  _configOverlay->ToDefault();
+  _configOverlaySections = CONFIG_SECTIONS_ALL;
+
+  return _publishConfig() && _tryPersistConfig(true);
+}
+
+const flatbuffers::Vector<flatbuffers::Offset<Serialization::Configuration::WiFiCredentials>>* _getWiFiCredentials(const Config::Snapshot& snapshot)
+{
+  auto wifi = snapshot->root()->wifi();
+  if (wifi == nullptr) {
+    return nullptr;
+  }
+
+  return wifi->credentials();
+}
+/// @brief Searches the stored credentials without deserializing them
+template<typename Predicate>
+const Serialization::Configuration::WiFiCredentials* _findWiFiCredentials(const Config::Snapshot& snapshot, Predicate predicate)
+{
+  auto fbsCredentialsList = _getWiFiCredentials(snapshot);
+  if (fbsCredentialsList == nullptr) {
+    return nullptr;
+  }
+
+  for (auto fbsCreds : *fbsCredentialsList) {
+    if (fbsCreds != nullptr && predicate(fbsCreds)) {
+      return fbsCreds;
+    }
+  }
+
+  return nullptr;
+}
+bool _isWiFiCredentialsSSID(const Serialization::Configuration::WiFiCredentials* creds, const char* ssid)
+{
+  auto fbsSsid = creds->ssid();
+
+  return fbsSsid != nullptr && strcmp(fbsSsid->c_str(), ssid) == 0;
+}
+
+Config::Snapshot Config::GetSnapshot()
+{
+  return _configSnapshot.load();
+}
+
+bool Config::Flush()
+{
+  return _tryPersistConfig();
 }
 
 void Config::Init()
@@ -144,112 +766,170 @@ void Config::Init()
     OS_PANIC(TAG, "Unable to mount config LittleFS partition!");
   }
 
-  if (_tryLoadConfig()) {
-    return;
+  // Leftover of an interrupted file replacement, the file it was meant to replace is still intact
+  if (_configFS.exists(CONFIG_TEMP_PATH)) {
+    _configFS.remove(CONFIG_TEMP_PATH);
   }
 
-  OS_LOGW(TAG, "Failed to load config, writing default config");
+  bool needsRewrite;
+  std::unique_ptr<Config::ConfigSnapshot> snapshot = _tryLoadConfig(needsRewrite);
+  if (snapshot != nullptr) {
+    _persistedGeneration = snapshot->generation();
 
-  _configData.ToDefault();
+    _configSnapshot.publish(std::move(snapshot));
 
-  if (!_trySaveConfig()) {
-    OS_PANIC(TAG, "Failed to save default config. Recommend formatting microcontroller and re-flashing firmware");
+    // Appends after a torn record would never be replayed, and a repaired config only exists in memory so far
+    if (needsRewrite && !_tryPersistConfig(true)) {
+      OS_LOGE(TAG, "Failed to compact config journal");
+    }
+  } else {
+    OS_LOGW(TAG, "Failed to load config, writing default config");
+
+    if (!_resetConfig()) {
+      OS_PANIC(TAG, "Failed to save default config. Recommend formatting microcontroller and re-flashing firmware");
+    }
   }
-}
 
-cJSON* _getAsCJSON(bool withSensitiveData)
-{
-  CONFIG_LOCK_READ(nullptr);
+  if (TaskUtils::TaskCreateExpensive(_persistTask, "ConfigPersist", 4096, nullptr, 1, &_persistTaskHandle) != pdPASS) {
+    OS_LOGE(TAG, "Failed to create config persist task, config changes will be written immediately");
+    _persistTaskHandle = nullptr;
+  }
 
-  return _configData.ToJSON(withSensitiveData);
+  // Changes still waiting for the persist task must not be lost to a software restart
+  esp_err_t err = esp_register_shutdown_handler(_persistOnShutdown);
+  if (err != ESP_OK) {
+    OS_LOGE(TAG, "Failed to register config shutdown handler: %s", esp_err_to_name(err));
+  }
 }
 
-std::string Config::GetAsJSON(bool withSensitiveData)
+bool Config::WriteAsJSON(Serialization::JsonStream::Writer::Sink sink, bool withSensitiveData)
 {
-  cJSON* root = _getAsCJSON(withSensitiveData);
+  CONFIG_READ_SNAPSHOT(false);
+
+  Config::RootConfig config;
+  if (!config.FromFlatbuffers(snapshot->root())) {
+    OS_LOGE(TAG, "Failed to read config");
+    return false;
+  }
+
+  Serialization::JsonStream::Writer writer(std::move(sink));
 
-  char* json = cJSON_PrintUnformatted(root);
+  config.ToJSON(writer, withSensitiveData);
 
-  std::string result(json);
+  return writer.finish();
+}
 
-  free(json);
+std::string Config::GetAsJSON(bool withSensitiveData)
+{
+  std::string result;
 
-  cJSON_Delete(root);
+  bool success = WriteAsJSON(
+    [&result](const char* data, std::size_t len) {
+      result.append(data, len);
+      return true;
+    },
+    withSensitiveData
+  );
+  if (!success) {
+    return {};
+  }
 
   return result;
 }
+
 bool Config::SaveFromJSON(std::string_view json)
 {
-  cJSON* root = cJSON_ParseWithLength(json.data(), json.size());
-  if (root == nullptr) {
-    OS_LOGE(TAG, "Failed to parse JSON: %s", cJSON_GetErrorPtr());
-    return false;
-  }
+  CONFIG_LOCK_CHANGE(false, CONFIG_SECTIONS_ALL);
 
-  CONFIG_LOCK_WRITE_ACTION(false, cJSON_Delete(root));
+  Config::Internal::JsonConfigReader reader(*overlay);
+  Serialization::JsonStream::Parser parser(reader);
 
-  bool result = _configData.FromJSON(root);
+  parser.feed(reinterpret_cast<const uint8_t*>(json.data()), json.size());
 
-  cJSON_Delete(root);
-
-  if (!result) {
+  if (parser.finish() != Serialization::JsonStream::Parser::Result::Done) {
     OS_LOGE(TAG, "Failed to read JSON");
+    _discardConfigChanges();
     return false;
   }
 
-  return _trySaveConfig();
+  return _commitConfig();
 }
 
 flatbuffers::Offset<Serialization::Configuration::HubConfig> Config::GetAsFlatBuffer(flatbuffers::FlatBufferBuilder& builder, bool withSensitiveData)
 {
-  CONFIG_LOCK_READ(0);
+  CONFIG_READ_SNAPSHOT(0);
+
+  // Copying the snapshot's tables would carry the sensitive fields along, rebuild it instead
+  Config::RootConfig config;
+  if (!config.FromFlatbuffers(snapshot->root())) {
+    OS_LOGE(TAG, "Failed to read config");
+    return 0;
+  }
 
-  return _configData.ToFlatbuffers(builder, withSensitiveData);
+  return config.ToFlatbuffers(builder, withSensitiveData);
 }
 
 bool Config::SaveFromFlatBuffer(const Serialization::Configuration::HubConfig* config)
 {
-  CONFIG_LOCK_WRITE(false);
+  CONFIG_LOCK_CHANGE(false, CONFIG_SECTIONS_ALL);
 
-  if (!_configData.FromFlatbuffers(config)) {
+  if (!overlay->FromFlatbuffers(config)) {
     OS_LOGE(TAG, "Failed to read config file");
+    _discardConfigChanges();
     return false;
   }
 
-  return _trySaveConfig();
+  return _commitConfig();
 }
 
 bool Config::GetRaw(std::vector<uint8_t>& buffer)
 {
-  CONFIG_LOCK_READ(false);
+  CONFIG_READ_SNAPSHOT(false);
 
-  return _tryLoadConfig(buffer);
+  // From memory, the config file alone misses changes that are still in the journal or pending
+  buffer = snapshot->buffer();
+
+  return true;
 }
 
 bool Config::SetRaw(const uint8_t* buffer, std::size_t size)
 {
   CONFIG_LOCK_WRITE(false);
 
-  OpenShock::Config::RootConfig config;
-  if (!_tryDeserializeConfig(buffer, size, config)) {
+  auto snapshot = std::make_unique<Config::ConfigSnapshot>(std::vector<uint8_t>(buffer, buffer + size), _configGeneration + 1);
+  if (!snapshot->ok()) {
     OS_LOGE(TAG, "Failed to deserialize config");
     return false;
   }
 
-  return _trySaveConfig(buffer, size);
+  _discardConfigChanges();
+
+  _configGeneration = snapshot->generation();
+  _configSnapshot.publish(std::move(snapshot));
+
+  // Written as a fresh config file, the journal would otherwise override it on the next boot
+  return _tryPersistConfig(true);
 }
 
 void Config::FactoryReset()
 {
   CONFIG_LOCK_WRITE();
 
-  _configData.ToDefault();
-
-  if (!_configFS.remove("/config") && _configFS.exists("/config")) {
+  if (!_configFS.remove(CONFIG_FILE_PATH) && _configFS.exists(CONFIG_FILE_PATH)) {
     OS_PANIC(TAG, "Failed to remove existing config file for factory reset. Reccomend formatting microcontroller and re-flashing firmware");
   }
 
-  if (!_trySaveConfig()) {
+  if (!_configFS.remove(CONFIG_JOURNAL_PATH) && _configFS.exists(CONFIG_JOURNAL_PATH)) {
+    OS_PANIC(TAG, "Failed to remove existing config journal for factory reset. Reccomend formatting microcontroller and re-flashing firmware");
+  }
+
+  // Only a cache, missing entries are recomputed or cause a full flash
+  _configFS.remove(PARTITION_HASHES_PATH);
+  _configFS.remove(WIFI_LAST_CONNECTION_PATH);
+
+  _configFS.remove(LOG_LEVELS_PATH);
+
+  if (!_resetConfig()) {
     OS_PANIC(TAG, "Failed to save default config. Recommend formatting microcontroller and re-flashing firmware");
   }
 
@@ -258,137 +938,143 @@ void Config::FactoryReset()
 
 bool Config::GetRFConfig(Config::RFConfig& out)
 {
-  CONFIG_LOCK_READ(false);
+  CONFIG_READ_SNAPSHOT(false);
 
-  out = _configData.rf;
+  out = snapshot->rf();
 
   return true;
 }
 
 bool Config::GetWiFiConfig(Config::WiFiConfig& out)
 {
-  CONFIG_LOCK_READ(false);
-
-  out = _configData.wifi;
+  CONFIG_READ_SNAPSHOT(false);
 
-  return true;
+  return out.FromFlatbuffers(snapshot->root()->wifi());
 }
 
 bool Config::GetCaptivePortalConfig(Config::CaptivePortalConfig& out)
 {
-  CONFIG_LOCK_READ(false);
+  CONFIG_READ_SNAPSHOT(false);
 
-  out = _configData.captivePortal;
+  out = snapshot->captivePortal();
 
   return true;
 }
 
 bool Config::GetBackendConfig(Config::BackendConfig& out)
 {
-  CONFIG_LOCK_READ(false);
-
-  out = _configData.backend;
+  CONFIG_READ_SNAPSHOT(false);
 
-  return true;
+  return out.FromFlatbuffers(snapshot->root()->backend());
 }
 
 bool Config::GetSerialInputConfig(Config::SerialInputConfig& out)
 {
-  CONFIG_LOCK_READ(false);
+  CONFIG_READ_SNAPSHOT(false);
 
-  out = _configData.serialInput;
+  out = snapshot->serialInput();
 
   return true;
 }
 
 bool Config::GetOtaUpdateConfig(Config::OtaUpdateConfig& out)
 {
-  CONFIG_LOCK_READ(false);
+  CONFIG_READ_SNAPSHOT(false);
 
-  out = _configData.otaUpdate;
+  out = snapshot->otaUpdate();
 
   return true;
 }
 
 bool Config::GetEStop(Config::EStopConfig& out)
 {
-  CONFIG_LOCK_READ(false);
+  CONFIG_READ_SNAPSHOT(false);
 
-  out = _configData.estop;
+  out = snapshot->estop();
 
   return true;
 }
 
 bool Config::SetRFConfig(const Config::RFConfig& config)
 {
-  CONFIG_LOCK_WRITE(false);
+  CONFIG_LOCK_CHANGE(false, CONFIG_SECTION_RF);
 
-  _configData.rf = config;
-  return _trySaveConfig();
+  overlay->rf = config;
+  return _commitConfig();
 }
 
 bool Config::SetWiFiConfig(const Config::WiFiConfig& config)
 {
-  CONFIG_LOCK_WRITE(false);
+  CONFIG_LOCK_CHANGE(false, CONFIG_SECTION_WIFI);
 
-  _configData.wifi = config;
-  return _trySaveConfig();
+  overlay->wifi = config;
+  return _commitConfig();
 }
 
 bool Config::SetCaptivePortalConfig(const Config::CaptivePortalConfig& config)
 {
-  CONFIG_LOCK_WRITE(false);
+  CONFIG_LOCK_CHANGE(false, CONFIG_SECTION_CAPTIVE_PORTAL);
 
-  _configData.captivePortal = config;
-  return _trySaveConfig();
+  overlay->captivePortal = config;
+  return _commitConfig();
 }
 
 bool Config::SetBackendConfig(const Config::BackendConfig& config)
 {
-  CONFIG_LOCK_WRITE(false);
+  CONFIG_LOCK_CHANGE(false, CONFIG_SECTION_BACKEND);
 
-  _configData.backend = config;
-  return _trySaveConfig();
+  overlay->backend = config;
+  return _commitConfig();
 }
 
 bool Config::SetSerialInputConfig(const Config::SerialInputConfig& config)
 {
-  CONFIG_LOCK_WRITE(false);
+  CONFIG_LOCK_CHANGE(false, CONFIG_SECTION_SERIAL_INPUT);
 
-  _configData.serialInput = config;
-  return _trySaveConfig();
+  overlay->serialInput = config;
+  return _commitConfig();
 }
 
 bool Config::SetOtaUpdateConfig(const Config::OtaUpdateConfig& config)
 {
-  CONFIG_LOCK_WRITE(false);
+  CONFIG_LOCK_CHANGE(false, CONFIG_SECTION_OTA_UPDATE);
 
-  _configData.otaUpdate = config;
-  return _trySaveConfig();
+  overlay->otaUpdate = config;
+  return _commitConfig();
 }
 
 bool Config::SetEStop(const Config::EStopConfig& config)
 {
-  CONFIG_LOCK_WRITE(false);
+  CONFIG_LOCK_CHANGE(false, CONFIG_SECTION_ESTOP);
 
-  _configData.estop = config;
-  return _trySaveConfig();
+  overlay->estop = config;
+  return _commitConfig();
 }
 
 bool Config::GetWiFiCredentials(std::vector<Config::WiFiCredentials>& out)
 {
-  CONFIG_LOCK_READ(false);
+  CONFIG_READ_SNAPSHOT(false);
 
-  out = _configData.wifi.credentialsList;
+  Internal::Utils::FromFbsVec(out, _getWiFiCredentials(snapshot));
 
   return true;
 }
 
 bool Config::GetWiFiCredentials(cJSON* array, bool withSensitiveData)
 {
-  CONFIG_LOCK_READ(false);
+  CONFIG_READ_SNAPSHOT(false);
+
+  auto fbsCredentialsList = _getWiFiCredentials(snapshot);
+  if (fbsCredentialsList == nullptr) {
+    return true;
+  }
+
+  for (auto fbsCreds : *fbsCredentialsList) {
+    Config::WiFiCredentials creds;
+    if (!creds.FromFlatbuffers(fbsCreds)) {
+      continue;
+    }
 
-  for (auto& creds : _configData.wifi.credentialsList) {
     cJSON* jsonCreds = creds.ToJSON(withSensitiveData);
 
     cJSON_AddItemToArray(array, jsonCreds);
@@ -405,84 +1091,94 @@ bool Config::SetWiFiCredentials(const std::vector<Config::WiFiCredentials>& cred
     return false;
   }
 
-  CONFIG_LOCK_WRITE(false);
+  CONFIG_LOCK_CHANGE(false, CONFIG_SECTION_WIFI);
 
-  _configData.wifi.credentialsList = credentials;
-  return _trySaveConfig();
+  overlay->wifi.credentialsList = credentials;
+  return _commitConfig();
 }
 
 bool Config::GetRFConfigTxPin(gpio_num_t& out)
 {
-  CONFIG_LOCK_READ(false);
+  CONFIG_READ_SNAPSHOT(false);
 
-  out = _configData.rf.txPin;
+  out = snapshot->rf().txPin;
 
   return true;
 }
 
 bool Config::SetRFConfigTxPin(gpio_num_t txPin)
 {
-  CONFIG_LOCK_WRITE(false);
+  CONFIG_LOCK_CHANGE(false, CONFIG_SECTION_RF);
 
-  _configData.rf.txPin = txPin;
-  return _trySaveConfig();
+  overlay->rf.txPin = txPin;
+  return _commitConfig();
 }
 
 bool Config::GetRFConfigKeepAliveEnabled(bool& out)
 {
-  CONFIG_LOCK_READ(false);
+  CONFIG_READ_SNAPSHOT(false);
 
-  out = _configData.rf.keepAliveEnabled;
+  out = snapshot->rf().keepAliveEnabled;
 
   return true;
 }
 
 bool Config::SetRFConfigKeepAliveEnabled(bool enabled)
 {
-  CONFIG_LOCK_WRITE(false);
+  CONFIG_LOCK_CHANGE(false, CONFIG_SECTION_RF);
 
-  _configData.rf.keepAliveEnabled = enabled;
-  return _trySaveConfig();
+  overlay->rf.keepAliveEnabled = enabled;
+  return _commitConfig();
 }
 
 bool Config::AnyWiFiCredentials(std::function<bool(const Config::WiFiCredentials&)> predicate)
 {
-  CONFIG_LOCK_READ(false);
+  CONFIG_READ_SNAPSHOT(false);
+
+  auto fbsCredentialsList = _getWiFiCredentials(snapshot);
+  if (fbsCredentialsList == nullptr) {
+    return false;
+  }
 
-  auto& creds = _configData.wifi.credentialsList;
+  for (auto fbsCreds : *fbsCredentialsList) {
+    Config::WiFiCredentials creds;
+    if (creds.FromFlatbuffers(fbsCreds) && predicate(creds)) {
+      return true;
+    }
+  }
 
-  return std::any_of(creds.begin(), creds.end(), predicate);
+  return false;
 }
 
 uint8_t Config::AddWiFiCredentials(std::string_view ssid, std::string_view password)
 {
-  CONFIG_LOCK_WRITE(0);
-
-  uint8_t id = 0;
+  CONFIG_LOCK_CHANGE(0, CONFIG_SECTION_WIFI);
 
   std::bitset<255> bits;
-  for (auto it = _configData.wifi.credentialsList.begin(); it != _configData.wifi.credentialsList.end(); ++it) {
+  for (auto it = overlay->wifi.credentialsList.begin(); it != overlay->wifi.credentialsList.end();) {
     auto& creds = *it;
 
     if (std::string_view(creds.ssid) == ssid) {
       creds.password = password;
 
-      id = creds.id;
+      uint8_t id = creds.id;  // Committing drops the overlay creds lives in
 
-      break;
+      return _commitConfig() ? id : 0;
     }
 
     if (creds.id == 0) {
       OS_LOGW(TAG, "Found WiFi credentials with ID 0, removing");
-      it = _configData.wifi.credentialsList.erase(it);
+      it = overlay->wifi.credentialsList.erase(it);
       continue;
     }
 
     // Mark ID as used
     bits[creds.id - 1] = true;
+    ++it;
   }
 
   // Get first available ID
+  uint8_t id = 0;
   for (std::size_t i = 0; i < bits.size(); ++i) {
     if (!bits[i]) {
       id = i + 1;
@@ -492,69 +1188,63 @@ uint8_t Config::AddWiFiCredentials(std::string_view ssid, std::string_view passw
 
   if (id == 0) {
     OS_LOGE(TAG, "Failed to add WiFi credentials: no available IDs");
+    _discardConfigChanges();  // Don't let the next change publish the entries erased above
     return 0;
   }
 
-  _configData.wifi.credentialsList.push_back({
+  overlay->wifi.credentialsList.push_back({
     .id       = id,
     .ssid     = std::string(ssid),
     .password = std::string(password),
   });
-  _trySaveConfig();
 
-  return id;
+  return _commitConfig() ? id : 0;
 }
 
 bool Config::TryGetWiFiCredentialsByID(uint8_t id, Config::WiFiCredentials& credentials)
 {
-  CONFIG_LOCK_READ(false);
+  CONFIG_READ_SNAPSHOT(false);
 
-  for (const auto& creds : _configData.wifi.credentialsList) {
-    if (creds.id == id) {
-      credentials = creds;
-      return true;
-    }
+  auto fbsCreds = _findWiFiCredentials(snapshot, [id](const Serialization::Configuration::WiFiCredentials* creds) { return creds->id() == id; });
+  if (fbsCreds == nullptr) {
+    return false;
   }
 
-  return false;
+  return credentials.FromFlatbuffers(fbsCreds);
 }
 
 bool Config::TryGetWiFiCredentialsBySSID(const char* ssid, Config::WiFiCredentials& credentials)
 {
-  CONFIG_LOCK_READ(false);
+  CONFIG_READ_SNAPSHOT(false);
 
-  for (const auto& creds : _configData.wifi.credentialsList) {
-    if (creds.ssid == ssid) {
-      credentials = creds;
-      return true;
-    }
+  auto fbsCreds = _findWiFiCredentials(snapshot, [ssid](const Serialization::Configuration::WiFiCredentials* creds) { return _isWiFiCredentialsSSID(creds, ssid); });
+  if (fbsCreds == nullptr) {
+    return false;
   }
 
-  return false;
+  return credentials.FromFlatbuffers(fbsCreds);
 }
 
 uint8_t Config::GetWiFiCredentialsIDbySSID(const char* ssid)
 {
-  CONFIG_LOCK_READ(0);
+  CONFIG_READ_SNAPSHOT(0);
 
-  for (const auto& creds : _configData.wifi.credentialsList) {
-    if (creds.ssid == ssid) {
-      return creds.id;
-    }
+  auto fbsCreds = _findWiFiCredentials(snapshot, [ssid](const Serialization::Configuration::WiFiCredentials* creds) { return _isWiFiCredentialsSSID(creds, ssid); });
+  if (fbsCreds == nullptr) {
+    return 0;
   }
 
-  return 0;
+  return fbsCreds->id();
 }
 
 bool Config::RemoveWiFiCredentials(uint8_t id)
 {
-  CONFIG_LOCK_WRITE(false);
+  CONFIG_LOCK_CHANGE(false, CONFIG_SECTION_WIFI);
 
-  for (auto it = _configData.wifi.credentialsList.begin(); it != _configData.wifi.credentialsList.end(); ++it) {
+  for (auto it = overlay->wifi.credentialsList.begin(); it != overlay->wifi.credentialsList.end(); ++it) {
     if (it->id == id) {
-      _configData.wifi.credentialsList.erase(it);
-      _trySaveConfig();
-      return true;
+      overlay->wifi.credentialsList.erase(it);
+      return _commitConfig();
     }
   }
 
@@ -563,205 +1253,343 @@ bool Config::RemoveWiFiCredentials(uint8_t id)
 
 bool Config::ClearWiFiCredentials()
 {
-  CONFIG_LOCK_WRITE(false);
-
-  _configData.wifi.credentialsList.clear();
-
-  return _trySaveConfig();
-}
-
-bool Config::GetWiFiHostname(std::string& out)
-{
-  CONFIG_LOCK_READ(false);
+  CONFIG_LOCK_CHANGE(false, CONFIG_SECTION_WIFI);
 
-  out = _configData.wifi.hostname;
+  overlay->wifi.credentialsList.clear();
 
-  return true;
+  return _commitConfig();
 }
 
 bool Config::SetWiFiHostname(std::string_view hostname)
 {
-  CONFIG_LOCK_WRITE(false);
+  CONFIG_LOCK_CHANGE(false, CONFIG_SECTION_WIFI);
 
-  _configData.wifi.hostname = std::string(hostname);
+  overlay->wifi.hostname = std::string(hostname);
 
-  return _trySaveConfig();
-}
-
-bool Config::GetBackendDomain(std::string& out)
-{
-  CONFIG_LOCK_READ(false);
-
-  out = _configData.backend.domain;
-
-  return true;
+  return _commitConfig();
 }
 
 bool Config::SetBackendDomain(std::string_view domain)
 {
-  CONFIG_LOCK_WRITE(false);
+  CONFIG_LOCK_CHANGE(false, CONFIG_SECTION_BACKEND);
 
-  _configData.backend.domain = std::string(domain);
-  return _trySaveConfig();
+  overlay->backend.domain = std::string(domain);
+  return _commitConfig();
 }
 
 bool Config::HasBackendAuthToken()
 {
-  CONFIG_LOCK_READ(false);
+  CONFIG_READ_SNAPSHOT(false);
 
-  return !_configData.backend.authToken.empty();
-}
-
-bool Config::GetBackendAuthToken(std::string& out)
-{
-  CONFIG_LOCK_READ(false);
-
-  out = _configData.backend.authToken;
-
-  return true;
+  return !snapshot->backendAuthToken().empty();
 }
 
 bool Config::SetBackendAuthToken(std::string_view token)
 {
-  CONFIG_LOCK_WRITE(false);
+  CONFIG_LOCK_CHANGE(false, CONFIG_SECTION_BACKEND);
 
-  _configData.backend.authToken = std::string(token);
-  return _trySaveConfig();
+  overlay->backend.authToken = std::string(token);
+  return _commitConfig(true);  // Losing a fresh token to a power cut would unpair the hub
 }
 
 bool Config::ClearBackendAuthToken()
 {
-  CONFIG_LOCK_WRITE(false);
+  CONFIG_LOCK_CHANGE(false, CONFIG_SECTION_BACKEND);
 
-  _configData.backend.authToken.clear();
-  return _trySaveConfig();
+  overlay->backend.authToken.clear();
+  return _commitConfig(true);
 }
 
 bool Config::HasBackendLCGOverride()
 {
-  CONFIG_LOCK_READ(false);
+  CONFIG_READ_SNAPSHOT(false);
 
-  return !_configData.backend.lcgOverride.empty();
-}
-
-bool Config::GetBackendLCGOverride(std::string& out)
-{
-  CONFIG_LOCK_READ(false);
-
-  out = _configData.backend.lcgOverride;
-
-  return true;
+  return !snapshot->backendLCGOverride().empty();
 }
 
 bool Config::SetBackendLCGOverride(std::string_view lcgOverride)
 {
-  CONFIG_LOCK_WRITE(false);
+  CONFIG_LOCK_CHANGE(false, CONFIG_SECTION_BACKEND);
 
-  _configData.backend.lcgOverride = std::string(lcgOverride);
-  return _trySaveConfig();
+  overlay->backend.lcgOverride = std::string(lcgOverride);
+  return _commitConfig();
 }
 
 bool Config::ClearBackendLCGOverride()
 {
-  CONFIG_LOCK_WRITE(false);
+  CONFIG_LOCK_CHANGE(false, CONFIG_SECTION_BACKEND);
 
-  _configData.backend.lcgOverride.clear();
-  return _trySaveConfig();
+  overlay->backend.lcgOverride.clear();
+  return _commitConfig();
 }
 
 bool Config::GetSerialInputConfigEchoEnabled(bool& out)
 {
-  CONFIG_LOCK_READ(false);
+  CONFIG_READ_SNAPSHOT(false);
+
+  out = snapshot->serialInput().echoEnabled;
 
-  out = _configData.serialInput.echoEnabled;
   return true;
 }
 
 bool Config::SetSerialInputConfigEchoEnabled(bool enabled)
 {
-  CONFIG_LOCK_WRITE(false);
+  CONFIG_LOCK_CHANGE(false, CONFIG_SECTION_SERIAL_INPUT);
 
-  _configData.serialInput.echoEnabled = enabled;
-  return _trySaveConfig();
+  overlay->serialInput.echoEnabled = enabled;
+  return _commitConfig();
 }
 
 bool Config::GetOtaUpdateId(int32_t& out)
 {
-  CONFIG_LOCK_READ(false);
+  CONFIG_READ_SNAPSHOT(false);
 
-  out = _configData.otaUpdate.updateId;
+  out = snapshot->otaUpdate().updateId;
 
   return true;
 }
 
 bool Config::SetOtaUpdateId(int32_t updateId)
 {
-  CONFIG_LOCK_WRITE(false);
+  CONFIG_LOCK_CHANGE(false, CONFIG_SECTION_OTA_UPDATE);
 
-  if (_configData.otaUpdate.updateId == updateId) {
+  if (overlay->otaUpdate.updateId == updateId) {
     return true;
   }
 
-  _configData.otaUpdate.updateId = updateId;
-  return _trySaveConfig();
+  overlay->otaUpdate.updateId = updateId;
+  return _commitConfig(true);  // The OTA flow reboots shortly after, its state has to be on flash by then
 }
 
 bool Config::GetOtaUpdateStep(OtaUpdateStep& out)
 {
-  CONFIG_LOCK_READ(false);
+  CONFIG_READ_SNAPSHOT(false);
 
-  out = _configData.otaUpdate.updateStep;
+  out = snapshot->otaUpdate().updateStep;
 
   return true;
 }
 
 bool Config::SetOtaUpdateStep(OtaUpdateStep updateStep)
 {
-  CONFIG_LOCK_WRITE(false);
+  CONFIG_LOCK_CHANGE(false, CONFIG_SECTION_OTA_UPDATE);
 
-  if (_configData.otaUpdate.updateStep == updateStep) {
+  if (overlay->otaUpdate.updateStep == updateStep) {
     return true;
   }
 
-  _configData.otaUpdate.updateStep = updateStep;
-  return _trySaveConfig();
+  overlay->otaUpdate.updateStep = updateStep;
+  return _commitConfig(true);
 }
 
 bool Config::GetEStopEnabled(bool& out)
 {
-  CONFIG_LOCK_READ(false);
+  CONFIG_READ_SNAPSHOT(false);
 
-  out = _configData.estop.enabled;
+  out = snapshot->estop().enabled;
 
   return true;
 }
 
 bool Config::SetEStopEnabled(bool enabled)
 {
-  CONFIG_LOCK_WRITE(false);
+  CONFIG_LOCK_CHANGE(false, CONFIG_SECTION_ESTOP);
 
-  _configData.estop.enabled = enabled;
-  return _trySaveConfig();
+  overlay->estop.enabled = enabled;
+  return _commitConfig();
 }
 
 bool Config::GetEStopGpioPin(gpio_num_t& out)
 {
-  CONFIG_LOCK_READ(false);
+  CONFIG_READ_SNAPSHOT(false);
 
-  out = _configData.estop.gpioPin;
+  out = snapshot->estop().gpioPin;
 
   return true;
 }
 
 bool Config::SetEStopGpioPin(gpio_num_t gpioPin)
 {
-  CONFIG_LOCK_WRITE(false);
+  CONFIG_LOCK_CHANGE(false, CONFIG_SECTION_ESTOP);
 
   if (!OpenShock::IsValidInputPin(gpioPin)) {
     OS_LOGE(TAG, "Invalid EStop GPIO Pin: %d", gpioPin);
     return false;
   }
 
-  _configData.estop.gpioPin = gpioPin;
-  return _trySaveConfig();
+  overlay->estop.gpioPin = gpioPin;
+  return _commitConfig();
+}
+
+bool Config::GetPartitionHash(std::string_view label, uint8_t (&hash)[32], std::string& tag)
+{
+  CONFIG_LOCK_READ(false);
+
+  std::string data;
+  if (!_tryLoadPartitionHashes(data)) {
+    return false;
+  }
+
+  for (std::string_view line : OpenShock::StringSplitNewLines(data)) {
+    std::string_view parts[3];
+    if (OpenShock::StringSplitInto(OpenShock::StringSplitWhiteSpace(line), parts) != 3 || parts[0] != label) {
+      continue;
+    }
+
+    if (parts[2].size() != 64 || HexUtils::TryParseHex(parts[2].data(), parts[2].size(), hash, 32) != 32) {
+      OS_LOGW(TAG, "Invalid partition hash cache entry for %.*s", label.size(), label.data());
+      return false;
+    }
+
+    tag.assign(parts[1].data(), parts[1].size());
+
+    return true;
+  }
+
+  return false;
+}
+
+bool Config::SetPartitionHash(std::string_view label, const uint8_t (&hash)[32], std::string_view tag)
+{
+  CONFIG_LOCK_WRITE(false);
+
+  std::string entry;
+  entry.append(label.data(), label.size());
+  entry.push_back(' ');
+  entry.append(tag.data(), tag.size());
+  entry.push_back(' ');
+  entry.append(HexUtils::ToHex<32>(hash, false).data(), 64);
+  entry.push_back('\n');
+
+  return _tryStorePartitionHash(label, entry);
+}
+
+bool Config::ClearPartitionHash(std::string_view label)
+{
+  CONFIG_LOCK_WRITE(false);
+
+  return _tryStorePartitionHash(label, std::string_view());
+}
+
+bool Config::GetWiFiLastConnection(uint8_t& credentialsID, uint8_t (&bssid)[6], uint8_t& channel)
+{
+  CONFIG_LOCK_READ(false);
+
+  if (!_configFS.exists(WIFI_LAST_CONNECTION_PATH)) {
+    return false;
+  }
+
+  File file = _configFS.open(WIFI_LAST_CONNECTION_PATH, "rb");
+  if (!file) {
+    OS_LOGE(TAG, "Failed to open WiFi last connection cache for reading");
+    return false;
+  }
+
+  WiFiLastConnectionRecord record;
+  if (file.size() != sizeof(record) || file.read(reinterpret_cast<uint8_t*>(&record), sizeof(record)) != sizeof(record)) {
+    OS_LOGW(TAG, "Invalid WiFi last connection cache");
+    return false;
+  }
+
+  file.close();
+
+  if (record.version != WIFI_LAST_CONNECTION_VERSION || record.crc != esp_rom_crc32_le(0, reinterpret_cast<const uint8_t*>(&record), offsetof(WiFiLastConnectionRecord, crc))) {
+    OS_LOGW(TAG, "Ignoring outdated or corrupted WiFi last connection cache");
+    return false;
+  }
+
+  credentialsID = record.credentialsID;
+  channel       = record.channel;
+  memcpy(bssid, record.bssid, sizeof(bssid));
+
+  return credentialsID != 0;
+}
+
+bool Config::SetWiFiLastConnection(uint8_t credentialsID, const uint8_t (&bssid)[6], uint8_t channel)
+{
+  uint8_t currentCredentialsID;
+  uint8_t currentBSSID[6];
+  uint8_t currentChannel;
+  if (GetWiFiLastConnection(currentCredentialsID, currentBSSID, currentChannel) && currentCredentialsID == credentialsID && currentChannel == channel && memcmp(currentBSSID, bssid, sizeof(bssid)) == 0) {
+    return true;  // Reconnecting to the same access point is the common case, don't wear the flash
+  }
+
+  CONFIG_LOCK_WRITE(false);
+
+  WiFiLastConnectionRecord record {
+    .version       = WIFI_LAST_CONNECTION_VERSION,
+    .credentialsID = credentialsID,
+    .channel       = channel,
+    .bssid         = {},
+    .reserved      = {},
+    .crc           = 0,
+  };
+  memcpy(record.bssid, bssid, sizeof(bssid));
+  record.crc = esp_rom_crc32_le(0, reinterpret_cast<const uint8_t*>(&record), offsetof(WiFiLastConnectionRecord, crc));
+
+  File file = _configFS.open(WIFI_LAST_CONNECTION_PATH, "wb");
+  if (!file) {
+    OS_LOGE(TAG, "Failed to open WiFi last connection cache for writing");
+    return false;
+  }
+
+  if (file.write(reinterpret_cast<const uint8_t*>(&record), sizeof(record)) != sizeof(record)) {
+    OS_LOGE(TAG, "Failed to write WiFi last connection cache");
+    return false;
+  }
+
+  file.close();
+
+  return true;
+}
+
+bool Config::GetLogLevels(std::string& out)
+{
+  CONFIG_LOCK_READ(false);
+
+  if (!_configFS.exists(LOG_LEVELS_PATH)) {
+    out.clear();
+    return true;
+  }
+
+  File file = _configFS.open(LOG_LEVELS_PATH, "rb");
+  if (!file) {
+    OS_LOGE(TAG, "Failed to open log levels for reading");
+    return false;
+  }
+
+  out.resize(file.size());
+
+  if (file.read(reinterpret_cast<uint8_t*>(out.data()), out.size()) != out.size()) {
+    OS_LOGE(TAG, "Failed to read log levels, size mismatch");
+    return false;
+  }
+
+  file.close();
+
+  return true;
+}
+
+bool Config::SetLogLevels(std::string_view levels)
+{
+  CONFIG_LOCK_WRITE(false);
+
+  if (levels.empty()) {
+    return _configFS.remove(LOG_LEVELS_PATH) || !_configFS.exists(LOG_LEVELS_PATH);
+  }
+
+  File file = _configFS.open(LOG_LEVELS_PATH, "wb");
+  if (!file) {
+    OS_LOGE(TAG, "Failed to open log levels for writing");
+    return false;
+  }
+
+  if (file.write(reinterpret_cast<const uint8_t*>(levels.data()), levels.size()) != levels.size()) {
+    OS_LOGE(TAG, "Failed to write log levels");
+    return false;
+  }
+
+  file.close();
+
+  return true;
 }
@@ -0,0 +1,81 @@
+#include "config/ConfigSnapshot.h"
+
+const char* const TAG = "Config::ConfigSnapshot";
+
+#include "Logging.h"
+
+using namespace OpenShock::Config;
+
+const std::size_t CONFIG_SNAPSHOT_MAX_SIZE = 4096;  // Should be enough
+
+static std::string_view _fbsStringView(const flatbuffers::String* str, std::string_view defaultStr)
+{
+  if (str == nullptr) {
+    return defaultStr;
+  }
+
+  return std::string_view(str->c_str(), str->size());
+}
+
+ConfigSnapshot::ConfigSnapshot(std::vector<uint8_t> buffer, uint32_t generation)
+  : m_buffer(std::move(buffer))
+  , m_root(nullptr)
+  , m_generation(generation)
+  , m_rf()
+  , m_captivePortal()
+  , m_serialInput()
+  , m_otaUpdate()
+  , m_estop()
+{
+  if (m_buffer.empty()) {
+    OS_LOGE(TAG, "Buffer is empty");
+    return;
+  }
+
+  // Validate buffer
+  flatbuffers::Verifier::Options verifierOptions {
+    .max_size = CONFIG_SNAPSHOT_MAX_SIZE,
+  };
+  flatbuffers::Verifier verifier(m_buffer.data(), m_buffer.size(), verifierOptions);
+  if (!Serialization::Configuration::VerifyHubConfigBuffer(verifier)) {
+    OS_LOGE(TAG, "Failed to verify config integrity");
+    return;
+  }
+
+  auto root = Serialization::Configuration::GetHubConfig(m_buffer.data());
+
+  if (!m_rf.FromFlatbuffers(root->rf()) || !m_captivePortal.FromFlatbuffers(root->captive_portal()) || !m_serialInput.FromFlatbuffers(root->serial_input()) || !m_otaUpdate.FromFlatbuffers(root->ota_update()) || !m_estop.FromFlatbuffers(root->estop())) {
+    OS_LOGE(TAG, "Failed to read config");
+    return;
+  }
+
+  m_root = root;
+}
+
+std::string_view ConfigSnapshot::wifiHostname() const
+{
+  auto wifi = m_root->wifi();
+
+  return _fbsStringView(wifi != nullptr ? wifi->hostname() : nullptr, OPENSHOCK_FW_HOSTNAME);
+}
+
+std::string_view ConfigSnapshot::backendDomain() const
+{
+  auto backend = m_root->backend();
+
+  return _fbsStringView(backend != nullptr ? backend->domain() : nullptr, OPENSHOCK_API_DOMAIN);
+}
+
+std::string_view ConfigSnapshot::backendAuthToken() const
+{
+  auto backend = m_root->backend();
+
+  return _fbsStringView(backend != nullptr ? backend->auth_token() : nullptr, "");
+}
+
+std::string_view ConfigSnapshot::backendLCGOverride() const
+{
+  auto backend = m_root->backend();
+
+  return _fbsStringView(backend != nullptr ? backend->lcg_override() : nullptr, "");
+}
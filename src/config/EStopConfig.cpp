@@ -81,3 +81,13 @@ cJSON* EStopConfig::ToJSON(bool withSensitiveData) const
 
   return root;
 }
+
+void EStopConfig::ToJSON(Serialization::JsonStream::Writer& writer, bool withSensitiveData) const
+{
+  writer.beginObject();
+  writer.key("enabled");
+  writer.boolean(enabled);
+  writer.key("gpioPin");
+  writer.number(gpioPin);
+  writer.endObject();
+}
@@ -126,3 +126,28 @@ cJSON* OtaUpdateConfig::ToJSON(bool withSensitiveData) const {
 
   return root;
 }
+
+void OtaUpdateConfig::ToJSON(Serialization::JsonStream::Writer& writer, bool withSensitiveData) const {
+  writer.beginObject();
+  writer.key("isEnabled");
+  writer.boolean(isEnabled);
+  writer.key("cdnDomain");
+  writer.string(cdnDomain);
+  writer.key("updateChannel");
+  writer.string(OpenShock::Serialization::Configuration::EnumNameOtaUpdateChannel(updateChannel));
+  writer.key("checkOnStartup");
+  writer.boolean(checkOnStartup);
+  writer.key("checkPeriodically");
+  writer.boolean(checkPeriodically);
+  writer.key("checkInterval");
+  writer.number(checkInterval);
+  writer.key("allowBackendManagement");
+  writer.boolean(allowBackendManagement);
+  writer.key("requireManualApproval");
+  writer.boolean(requireManualApproval);
+  writer.key("updateId");
+  writer.number(updateId);
+  writer.key("updateStep");
+  writer.string(OpenShock::Serialization::Configuration::EnumNameOtaUpdateStep(updateStep));
+  writer.endObject();
+}
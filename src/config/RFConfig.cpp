@@ -73,3 +73,13 @@ cJSON* RFConfig::ToJSON(bool withSensitiveData) const
 
   return root;
 }
+
+void RFConfig::ToJSON(Serialization::JsonStream::Writer& writer, bool withSensitiveData) const
+{
+  writer.beginObject();
+  writer.key("txPin");
+  writer.number(txPin);
+  writer.key("keepAliveEnabled");
+  writer.boolean(keepAliveEnabled);
+  writer.endObject();
+}
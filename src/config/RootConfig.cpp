@@ -152,3 +152,23 @@ cJSON* RootConfig::ToJSON(bool withSensitiveData) const
 
   return root;
 }
+
+void RootConfig::ToJSON(Serialization::JsonStream::Writer& writer, bool withSensitiveData) const
+{
+  writer.beginObject();
+  writer.key("rf");
+  rf.ToJSON(writer, withSensitiveData);
+  writer.key("wifi");
+  wifi.ToJSON(writer, withSensitiveData);
+  writer.key("captivePortal");
+  captivePortal.ToJSON(writer, withSensitiveData);
+  writer.key("backend");
+  backend.ToJSON(writer, withSensitiveData);
+  writer.key("serialInput");
+  serialInput.ToJSON(writer, withSensitiveData);
+  writer.key("otaUpdate");
+  otaUpdate.ToJSON(writer, withSensitiveData);
+  writer.key("estop");
+  estop.ToJSON(writer, withSensitiveData);
+  writer.endObject();
+}
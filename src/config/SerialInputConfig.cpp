@@ -61,3 +61,10 @@ cJSON* SerialInputConfig::ToJSON(bool withSensitiveData) const {
 
   return root;
 }
+
+void SerialInputConfig::ToJSON(Serialization::JsonStream::Writer& writer, bool withSensitiveData) const {
+  writer.beginObject();
+  writer.key("echoEnabled");
+  writer.boolean(echoEnabled);
+  writer.endObject();
+}
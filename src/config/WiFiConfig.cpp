@@ -99,3 +99,20 @@ cJSON* WiFiConfig::ToJSON(bool withSensitiveData) const {
 
   return root;
 }
+
+void WiFiConfig::ToJSON(Serialization::JsonStream::Writer& writer, bool withSensitiveData) const {
+  writer.beginObject();
+  writer.key("accessPointSSID");
+  writer.string(accessPointSSID);
+  writer.key("hostname");
+  writer.string(hostname);
+
+  writer.key("credentials");
+  writer.beginArray();
+  for (auto& credentials : credentialsList) {
+    credentials.ToJSON(writer, withSensitiveData);
+  }
+  writer.endArray();
+
+  writer.endObject();
+}
@@ -95,3 +95,16 @@ cJSON* WiFiCredentials::ToJSON(bool withSensitiveData) const {
 
   return root;
 }
+
+void WiFiCredentials::ToJSON(Serialization::JsonStream::Writer& writer, bool withSensitiveData) const {
+  writer.beginObject();
+  writer.key("id");
+  writer.number(id);
+  writer.key("ssid");
+  writer.string(ssid);
+  if (withSensitiveData) {
+    writer.key("password");
+    writer.string(password);
+  }
+  writer.endObject();
+}
@@ -0,0 +1,355 @@
+#include "config/internal/JsonConfigReader.h"
+
+const char* const TAG = "Config::Internal::JsonConfigReader";
+
+#include "Chipset.h"
+#include "config/internal/utils.h"
+#include "Convert.h"
+#include "Logging.h"
+
+using namespace OpenShock;
+using namespace std::string_view_literals;
+
+using Serialization::JsonStream::Token;
+using Serialization::JsonStream::TokenType;
+
+// Depths of the tokens this reader cares about, the root object is at depth 0
+const uint8_t SECTION_DEPTH           = 1;
+const uint8_t MEMBER_DEPTH            = 2;
+const uint8_t CREDENTIALS_DEPTH       = 3;
+const uint8_t CREDENTIAL_MEMBER_DEPTH = 4;
+
+static bool _readBool(bool& val, const Token& token)
+{
+  if (token.type != TokenType::True && token.type != TokenType::False) {
+    OS_LOGE(TAG, "value at '%.*s' is not a bool", static_cast<int>(token.key.size()), token.key.data());
+    return false;
+  }
+
+  val = token.type == TokenType::True;
+
+  return true;
+}
+
+static bool _readStr(std::string& str, const Token& token)
+{
+  if (token.type != TokenType::String) {
+    OS_LOGE(TAG, "value at '%.*s' is not a string", static_cast<int>(token.key.size()), token.key.data());
+    return false;
+  }
+
+  str = token.value;
+
+  return true;
+}
+
+template<typename T>
+static bool _readInt(T& val, const Token& token, bool (*converter)(std::string_view, T&))
+{
+  if (token.type != TokenType::Number) {
+    OS_LOGE(TAG, "value at '%.*s' is not a number", static_cast<int>(token.key.size()), token.key.data());
+    return false;
+  }
+
+  if (Serialization::JsonStream::NumberToInteger(token.value, val, converter)) {
+    return true;
+  }
+
+  OS_LOGE(TAG, "value at '%.*s' is out of range or not an integer", static_cast<int>(token.key.size()), token.key.data());
+  return false;
+}
+
+static bool _readGpioNum(gpio_num_t& val, const Token& token)
+{
+  uint8_t u8Val;
+  if (!_readInt(u8Val, token, Convert::ToUint8)) {
+    return false;
+  }
+
+  return Config::Internal::Utils::FromU8GpioNum(val, u8Val);
+}
+
+template<typename T>
+static bool _readStrParsed(T& val, const Token& token, bool (*parser)(T&, const char*))
+{
+  if (token.type != TokenType::String) {
+    OS_LOGE(TAG, "value at '%.*s' is not a string", static_cast<int>(token.key.size()), token.key.data());
+    return false;
+  }
+
+  // Token values are always null-terminated
+  return parser(val, token.value.data());
+}
+
+Config::Internal::JsonConfigReader::JsonConfigReader(RootConfig& config)
+  : m_config(config)
+  , m_section(Section::None)
+  , m_hasRoot(false)
+  , m_hasCredentials(false)
+  , m_inCredentials(false)
+  , m_hasEStopEnabled(false)
+  , m_credentials()
+{
+}
+
+bool Config::Internal::JsonConfigReader::onToken(const Token& token)
+{
+  if (token.depth == 0) {
+    if (token.type == TokenType::ObjectStart) {
+      m_config.ToDefault();
+      m_hasRoot = true;
+      return true;
+    }
+
+    if (token.type == TokenType::ObjectEnd) {
+      return true;
+    }
+
+    OS_LOGE(TAG, "json is not an object");
+    return false;
+  }
+
+  if (token.depth == SECTION_DEPTH) {
+    if (token.type == TokenType::ObjectEnd || token.type == TokenType::ArrayEnd) {
+      return _endSection();
+    }
+
+    return _beginSection(token);
+  }
+
+  switch (m_section) {
+    case Section::None:
+    case Section::Unknown:
+      return true;
+    case Section::WiFi:
+      return _readWiFiToken(token);
+    default:
+      return _readSectionMember(token);
+  }
+}
+
+bool Config::Internal::JsonConfigReader::onEnd()
+{
+  return m_hasRoot && m_section == Section::None;
+}
+
+bool Config::Internal::JsonConfigReader::_beginSection(const Token& token)
+{
+  Section section = Section::Unknown;
+  if (token.key == "rf"sv) {
+    section = Section::RF;
+  } else if (token.key == "wifi"sv) {
+    section = Section::WiFi;
+  } else if (token.key == "captivePortal"sv) {
+    section = Section::CaptivePortal;
+  } else if (token.key == "backend"sv) {
+    section = Section::Backend;
+  } else if (token.key == "serialInput"sv) {
+    section = Section::SerialInput;
+  } else if (token.key == "otaUpdate"sv) {
+    section = Section::OtaUpdate;
+  } else if (token.key == "estop"sv) {
+    section = Section::EStop;
+  }
+
+  if (section == Section::Unknown) {
+    // Skip over unknown members, containers are tracked so their end token is not mistaken for a section end
+    if (token.type == TokenType::ObjectStart || token.type == TokenType::ArrayStart) {
+      m_section = Section::Unknown;
+    }
+    return true;
+  }
+
+  if (token.type != TokenType::ObjectStart) {
+    OS_LOGE(TAG, "Unable to load %.*s config, json is not an object", static_cast<int>(token.key.size()), token.key.data());
+    return false;
+  }
+
+  m_section = section;
+
+  switch (section) {
+    case Section::RF:
+      m_config.rf.ToDefault();
+      break;
+    case Section::WiFi:
+      m_config.wifi.ToDefault();
+      m_hasCredentials = false;
+      m_inCredentials  = false;
+      break;
+    case Section::CaptivePortal:
+      m_config.captivePortal.ToDefault();
+      break;
+    case Section::Backend:
+      m_config.backend.ToDefault();
+      break;
+    case Section::SerialInput:
+      m_config.serialInput.ToDefault();
+      break;
+    case Section::OtaUpdate:
+      m_config.otaUpdate.ToDefault();
+      break;
+    case Section::EStop:
+      m_config.estop.ToDefault();
+      m_hasEStopEnabled = false;
+      break;
+    default:
+      break;
+  }
+
+  return true;
+}
+
+bool Config::Internal::JsonConfigReader::_endSection()
+{
+  Section section = m_section;
+  m_section       = Section::None;
+
+  if (section == Section::WiFi && !m_hasCredentials) {
+    OS_LOGE(TAG, "Unable to load wifi config, credentials is null");
+    return false;
+  }
+
+  if (section == Section::EStop && !m_hasEStopEnabled) {
+    m_config.estop.enabled = OpenShock::IsValidInputPin(m_config.estop.gpioPin);
+  }
+
+  return true;
+}
+
+bool Config::Internal::JsonConfigReader::_readWiFiToken(const Token& token)
+{
+  WiFiConfig& wifi = m_config.wifi;
+
+  if (token.depth == MEMBER_DEPTH) {
+    if (token.key == "credentials"sv) {
+      if (token.type != TokenType::ArrayStart) {
+        OS_LOGE(TAG, "Unable to load wifi config, credentials is not an array");
+        return false;
+      }
+
+      wifi.credentialsList.clear();
+      m_hasCredentials = true;
+      m_inCredentials  = true;
+    } else if (token.type == TokenType::ArrayEnd) {
+      m_inCredentials = false;
+    } else if (token.key == "accessPointSSID"sv) {
+      _readStr(wifi.accessPointSSID, token);
+    } else if (token.key == "hostname"sv) {
+      _readStr(wifi.hostname, token);
+    }
+
+    return true;
+  }
+
+  if (!m_inCredentials) {
+    return true;
+  }
+
+  if (token.depth == CREDENTIALS_DEPTH) {
+    if (token.type == TokenType::ObjectStart) {
+      m_credentials.ToDefault();
+    } else if (token.type == TokenType::ObjectEnd) {
+      if (m_credentials.ssid.empty()) {
+        OS_LOGE(TAG, "ssid is empty");
+      } else {
+        wifi.credentialsList.emplace_back(std::move(m_credentials));
+      }
+    }
+
+    return true;
+  }
+
+  if (token.depth == CREDENTIAL_MEMBER_DEPTH) {
+    if (token.key == "id"sv) {
+      _readInt(m_credentials.id, token, Convert::ToUint8);
+    } else if (token.key == "ssid"sv) {
+      _readStr(m_credentials.ssid, token);
+    } else if (token.key == "password"sv) {
+      _readStr(m_credentials.password, token);
+    }
+  }
+
+  return true;
+}
+
+bool Config::Internal::JsonConfigReader::_readSectionMember(const Token& token)
+{
+  if (token.depth != MEMBER_DEPTH) {
+    return true;
+  }
+
+  switch (m_section) {
+    case Section::RF: {
+      RFConfig& rf = m_config.rf;
+      if (token.key == "txPin"sv) {
+        _readGpioNum(rf.txPin, token);
+      } else if (token.key == "keepAliveEnabled"sv) {
+        _readBool(rf.keepAliveEnabled, token);
+      }
+      break;
+    }
+    case Section::CaptivePortal:
+      if (token.key == "alwaysEnabled"sv) {
+        _readBool(m_config.captivePortal.alwaysEnabled, token);
+      }
+      break;
+    case Section::Backend: {
+      BackendConfig& backend = m_config.backend;
+      if (token.key == "domain"sv) {
+        _readStr(backend.domain, token);
+      } else if (token.key == "authToken"sv) {
+        _readStr(backend.authToken, token);
+      } else if (token.key == "lcgOverride"sv) {
+        _readStr(backend.lcgOverride, token);
+      }
+      break;
+    }
+    case Section::SerialInput:
+      if (token.key == "echoEnabled"sv) {
+        _readBool(m_config.serialInput.echoEnabled, token);
+      }
+      break;
+    case Section::OtaUpdate: {
+      OtaUpdateConfig& otaUpdate = m_config.otaUpdate;
+      if (token.key == "isEnabled"sv) {
+        _readBool(otaUpdate.isEnabled, token);
+      } else if (token.key == "cdnDomain"sv) {
+        _readStr(otaUpdate.cdnDomain, token);
+      } else if (token.key == "updateChannel"sv) {
+        _readStrParsed(otaUpdate.updateChannel, token, OpenShock::TryParseOtaUpdateChannel);
+      } else if (token.key == "checkOnStartup"sv) {
+        _readBool(otaUpdate.checkOnStartup, token);
+      } else if (token.key == "checkPeriodically"sv) {
+        _readBool(otaUpdate.checkPeriodically, token);
+      } else if (token.key == "checkInterval"sv) {
+        _readInt(otaUpdate.checkInterval, token, Convert::ToUint16);
+      } else if (token.key == "allowBackendManagement"sv) {
+        _readBool(otaUpdate.allowBackendManagement, token);
+      } else if (token.key == "requireManualApproval"sv) {
+        _readBool(otaUpdate.requireManualApproval, token);
+      } else if (token.key == "updateId"sv) {
+        _readInt(otaUpdate.updateId, token, Convert::ToInt32);
+      } else if (token.key == "updateStep"sv) {
+        _readStrParsed(otaUpdate.updateStep, token, OpenShock::TryParseOtaUpdateStep);
+      }
+      break;
+    }
+    case Section::EStop: {
+      EStopConfig& estop = m_config.estop;
+      if (token.key == "gpioPin"sv) {
+        _readGpioNum(estop.gpioPin, token);
+      } else if (token.key == "enabled"sv) {
+        if (!_readBool(estop.enabled, token)) {
+          OS_LOGE(TAG, "Unable to load estop config, failed to parse enabled");
+          return false;
+        }
+        m_hasEStopEnabled = true;
+      }
+      break;
+    }
+    default:
+      break;
+  }
+
+  return true;
+}
@@ -0,0 +1,95 @@
+#include "http/ChunkedDecoder.h"
+
+using namespace OpenShock::HTTP;
+
+constexpr int8_t _hexValue(uint8_t c)
+{
+  if (c >= '0' && c <= '9') return static_cast<int8_t>(c - '0');
+  if (c >= 'a' && c <= 'f') return static_cast<int8_t>(c - 'a' + 10);
+  if (c >= 'A' && c <= 'F') return static_cast<int8_t>(c - 'A' + 10);
+  return -1;
+}
+
+void ChunkedDecoder::reset()
+{
+  m_state      = State::Size;
+  m_sizeDigits = 0;
+  m_remaining  = 0;
+}
+
+void ChunkedDecoder::_consumeControlByte(uint8_t c)
+{
+  switch (m_state) {
+    case State::Size: {
+      int8_t digit = _hexValue(c);
+      if (digit >= 0) {
+        // Reject sizes that would overflow std::size_t
+        if (m_sizeDigits >= sizeof(std::size_t) * 2) {
+          m_state = State::Invalid;
+          return;
+        }
+
+        m_remaining = (m_remaining << 4) | static_cast<std::size_t>(digit);
+        ++m_sizeDigits;
+        return;
+      }
+
+      // Size field must have at least one digit
+      if (m_sizeDigits == 0) {
+        m_state = State::Invalid;
+        return;
+      }
+
+      if (c == '\r') {
+        m_state = State::SizeLF;
+      } else if (c == ';' || c == ' ' || c == '\t') {
+        m_state = State::Extension;
+      } else {
+        m_state = State::Invalid;
+      }
+      return;
+    }
+    case State::Extension:
+      if (c == '\r') {
+        m_state = State::SizeLF;
+      }
+      return;
+    case State::SizeLF:
+      if (c != '\n') {
+        m_state = State::Invalid;
+        return;
+      }
+
+      m_state = m_remaining == 0 ? State::TrailerStart : State::Payload;
+      return;
+    case State::PayloadCR:
+      m_state = c == '\r' ? State::PayloadLF : State::Invalid;
+      return;
+    case State::PayloadLF:
+      if (c != '\n') {
+        m_state = State::Invalid;
+        return;
+      }
+
+      m_state      = State::Size;
+      m_sizeDigits = 0;
+      m_remaining  = 0;
+      return;
+    case State::TrailerStart:
+      m_state = c == '\r' ? State::TrailerLF : State::TrailerLine;
+      return;
+    case State::TrailerLine:
+      if (c == '\n') {
+        m_state = State::TrailerStart;
+      }
+      return;
+    case State::TrailerLF:
+      m_state = c == '\n' ? State::Done : State::Invalid;
+      return;
+    case State::Payload:  // Handled by feed()
+    case State::Done:
+    case State::Invalid:
+    default:
+      return;
+  }
+}
@@ -0,0 +1,46 @@
+#include "http/ContentRange.h"
+
+#include "Convert.h"
+#include "util/StringUtils.h"
+
+using namespace std::string_view_literals;
+
+bool OpenShock::HTTP::TryParseContentRangeStart(std::string_view contentRange, std::size_t& start)
+{
+  if (!OpenShock::StringStartsWith(contentRange, "bytes "sv)) {
+    return false;
+  }
+
+  contentRange = contentRange.substr(6);
+
+  auto dash = contentRange.find('-');
+  if (dash == std::string_view::npos) {
+    return false;
+  }
+
+  uint32_t value;
+  if (!OpenShock::Convert::ToUint32(contentRange.substr(0, dash), value)) {
+    return false;
+  }
+
+  start = value;
+
+  return true;
+}
+
+bool OpenShock::HTTP::TrimToResumeOffset(std::size_t resumeOffset, std::size_t& offset, const uint8_t*& data, std::size_t& len)
+{
+  if (offset + len <= resumeOffset) {
+    return false;
+  }
+
+  if (offset < resumeOffset) {
+    std::size_t skip = resumeOffset - offset;
+
+    data += skip;
+    len -= skip;
+    offset = resumeOffset;
+  }
+
+  return true;
+}
@@ -3,12 +3,16 @@
 const char* const TAG = "HTTPRequestManager";
 
 #include "Common.h"
+#include "http/ChunkedDecoder.h"
+#include "http/ContentRange.h"
 #include "Logging.h"
 #include "SimpleMutex.h"
 #include "Time.h"
 #include "util/StringUtils.h"
 
+#include <esp_heap_caps.h>
 #include <HTTPClient.h>
+#include <lwip/sockets.h>
 
 #include <algorithm>
 #include <memory>
@@ -19,8 +23,15 @@ const char* const TAG = "HTTPRequestManager";
 
 using namespace std::string_view_literals;
 
-const std::size_t HTTP_BUFFER_SIZE = 4096LLU;
-const int HTTP_DOWNLOAD_SIZE_LIMIT = 200 * 1024 * 1024;  // 200 MB
+#ifndef OPENSHOCK_HTTP_BUFFER_SIZE
+#define OPENSHOCK_HTTP_BUFFER_SIZE 16384
+#endif
+
+const std::size_t HTTP_BUFFER_SIZE          = OPENSHOCK_HTTP_BUFFER_SIZE;
+const std::size_t HTTP_BUFFER_SIZE_FALLBACK = 4096LLU;
+const uint32_t HTTP_SOCKET_POLL_MAX_MS      = 100;                // Upper bound for a single select() call, so timeouts and disconnects are noticed
+const uint32_t HTTP_TLS_POLL_INTERVAL_MS    = 10;                 // TLS streams can't be select()ed, sleep this long between polls instead
+const int HTTP_DOWNLOAD_SIZE_LIMIT          = 200 * 1024 * 1024;  // 200 MB
 
 struct RateLimit {
   RateLimit()
@@ -203,139 +214,70 @@ struct StreamReaderResult {
   std::size_t nWritten;
 };
 
-constexpr bool _isCRLF(const uint8_t* buffer)
-{
-  return buffer[0] == '\r' && buffer[1] == '\n';
-}
-constexpr bool _tryFindCRLF(std::size_t& pos, const uint8_t* buffer, std::size_t len)
-{
-  const uint8_t* cur = buffer;
-  const uint8_t* end = buffer + len - 1;
-
-  while (cur < end) {
-    if (_isCRLF(cur)) {
-      pos = static_cast<std::size_t>(cur - buffer);
-      return true;
-    }
-
-    ++cur;
-  }
+struct StreamBuffer {
+  uint8_t* data;
+  std::size_t size;
+};
 
-  return false;
-}
-constexpr bool _tryParseHexSizeT(std::size_t& result, std::string_view str)
+StreamBuffer _allocStreamBuffer()
 {
-  if (str.empty() || str.size() > sizeof(std::size_t) * 2) {
-    return false;
+  // Only the large buffer goes in PSRAM, boards without it (most 4MB boards) can't spare that much internal RAM per download
+  uint8_t* buffer = static_cast<uint8_t*>(heap_caps_malloc(HTTP_BUFFER_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT));
+  if (buffer != nullptr) {
+    return {buffer, HTTP_BUFFER_SIZE};
   }
 
-  result = 0;
-
-  for (char c : str) {
-    if (c >= '0' && c <= '9') {
-      result = (result << 4) | (c - '0');
-    } else if (c >= 'a' && c <= 'f') {
-      result = (result << 4) | (c - 'a' + 10);
-    } else if (c >= 'A' && c <= 'F') {
-      result = (result << 4) | (c - 'A' + 10);
-    } else {
-      return false;
-    }
+  buffer = static_cast<uint8_t*>(malloc(HTTP_BUFFER_SIZE_FALLBACK));
+  if (buffer != nullptr) {
+    return {buffer, HTTP_BUFFER_SIZE_FALLBACK};
   }
 
-  return true;
+  return {nullptr, 0};
 }
 
-enum ParserState : uint8_t {
-  Ok,
-  NeedMoreData,
-  Invalid,
+enum class StreamWaitResult : uint8_t {
+  DataAvailable,
+  Disconnected,
+  TimedOut,
 };
 
-ParserState _parseChunkHeader(const uint8_t* buffer, std::size_t bufferLen, std::size_t& headerLen, std::size_t& payloadLen)
+/// @brief Blocks until the stream has data to read, the connection closes, or the deadline passes
+///
+/// Plain sockets block in select() until readable. TLS streams don't expose their socket, so for those we sleep HTTP_TLS_POLL_INTERVAL_MS between polls.
+StreamWaitResult _waitForStreamData(HTTPClient& client, WiFiClient* stream, int64_t deadline)
 {
-  if (bufferLen < 5) {  // Bare minimum: "0\r\n\r\n"
-    return ParserState::NeedMoreData;
-  }
-
-  // Find the first CRLF
-  if (!_tryFindCRLF(headerLen, buffer, bufferLen)) {
-    return ParserState::NeedMoreData;
-  }
-
-  // Header must have at least one character
-  if (headerLen == 0) {
-    OS_LOGW(TAG, "Invalid chunk header length");
-    return ParserState::Invalid;
-  }
-
-  // Check for end of size field (possibly followed by extensions which is separated by a semicolon)
-  std::size_t sizeFieldEnd = headerLen;
-  for (std::size_t i = 0; i < headerLen; ++i) {
-    if (buffer[i] == ';') {
-      sizeFieldEnd = i;
-      break;
+  while (stream->available() <= 0) {
+    if (!client.connected()) {
+      return StreamWaitResult::Disconnected;
     }
-  }
-
-  // Bounds check
-  if (sizeFieldEnd == 0 || sizeFieldEnd > 16) {
-    OS_LOGW(TAG, "Invalid chunk size field length");
-    return ParserState::Invalid;
-  }
 
-  std::string_view sizeField(reinterpret_cast<const char*>(buffer), sizeFieldEnd);
+    int64_t remaining = deadline - OpenShock::millis();
+    if (remaining <= 0) {
+      return StreamWaitResult::TimedOut;
+    }
 
-  // Parse the chunk size
-  if (!_tryParseHexSizeT(payloadLen, sizeField)) {
-    OS_LOGW(TAG, "Failed to parse chunk size");
-    return ParserState::Invalid;
-  }
+    int fd = stream->fd();
+    if (fd < 0) {
+      vTaskDelay(pdMS_TO_TICKS(std::min<int64_t>(remaining, HTTP_TLS_POLL_INTERVAL_MS)));
+      continue;
+    }
 
-  if (payloadLen > HTTP_DOWNLOAD_SIZE_LIMIT) {
-    OS_LOGW(TAG, "Chunk size too large");
-    return ParserState::Invalid;
-  }
+    uint32_t waitMs = static_cast<uint32_t>(std::min<int64_t>(remaining, HTTP_SOCKET_POLL_MAX_MS));
 
-  // Set the header length to the end of the CRLF
-  headerLen += 2;
+    fd_set readSet;
+    FD_ZERO(&readSet);
+    FD_SET(fd, &readSet);
 
-  return ParserState::Ok;
-}
+    timeval tv;
+    tv.tv_sec  = waitMs / 1000;
+    tv.tv_usec = (waitMs % 1000) * 1000;
 
-ParserState _parseChunk(const uint8_t* buffer, std::size_t bufferLen, std::size_t& payloadPos, std::size_t& payloadLen)
-{
-  if (payloadPos == 0) {
-    ParserState state = _parseChunkHeader(buffer, bufferLen, payloadPos, payloadLen);
-    if (state != ParserState::Ok) {
-      return state;
+    if (select(fd + 1, &readSet, nullptr, nullptr, &tv) < 0) {
+      return StreamWaitResult::Disconnected;
     }
   }
 
-  std::size_t totalLen = payloadPos + payloadLen + 2;  // +2 for CRLF
-  if (bufferLen < totalLen) {
-    return ParserState::NeedMoreData;
-  }
-
-  // Check for CRLF
-  if (!_isCRLF(buffer + totalLen - 2)) {
-    OS_LOGW(TAG, "Invalid chunk payload CRLF");
-    return ParserState::Invalid;
-  }
-
-  return ParserState::Ok;
-}
-
-void _alignChunk(uint8_t* buffer, std::size_t& bufferCursor, std::size_t payloadPos, std::size_t payloadLen)
-{
-  std::size_t totalLen  = payloadPos + payloadLen + 2;  // +2 for CRLF
-  std::size_t remaining = bufferCursor - totalLen;
-  if (remaining > 0) {
-    memmove(buffer, buffer + totalLen, remaining);
-    bufferCursor = remaining;
-  } else {
-    bufferCursor = 0;
-  }
+  return StreamWaitResult::DataAvailable;
 }
 
 StreamReaderResult _readStreamDataChunked(HTTPClient& client, WiFiClient* stream, HTTP::DownloadCallback downloadCallback, int64_t begin, uint32_t timeoutMs)
@@ -343,78 +285,70 @@ StreamReaderResult _readStreamDataChunked(HTTPClient& client, WiFiClient* stream
   std::size_t totalWritten   = 0;
   HTTP::RequestResult result = HTTP::RequestResult::Success;
 
-  uint8_t* buffer = static_cast<uint8_t*>(malloc(HTTP_BUFFER_SIZE));
-  if (buffer == nullptr) {
+  StreamBuffer buffer = _allocStreamBuffer();
+  if (buffer.data == nullptr) {
     OS_LOGE(TAG, "Out of memory");
     return {HTTP::RequestResult::RequestFailed, 0};
   }
 
-  ParserState state        = ParserState::NeedMoreData;
-  std::size_t bufferCursor = 0, payloadPos = 0, payloadSize = 0;
+  int64_t deadline = begin + timeoutMs;
 
-  while (client.connected() && state != ParserState::Invalid) {
-    if (begin + timeoutMs < OpenShock::millis()) {
-      OS_LOGW(TAG, "Request timed out");
-      result = HTTP::RequestResult::TimedOut;
-      break;
-    }
+  // The decoder reports any false return as Cancelled, this tells an oversized response apart so it fails like the Content-Length path
+  bool tooLarge = false;
 
-    std::size_t bytesAvailable = stream->available();
-    if (bytesAvailable == 0) {
-      vTaskDelay(pdMS_TO_TICKS(5));
-      continue;
+  auto onPayload = [&downloadCallback, &totalWritten, &tooLarge](const uint8_t* data, std::size_t len) -> bool {
+    if (totalWritten + len > HTTP_DOWNLOAD_SIZE_LIMIT) {
+      OS_LOGE(TAG, "Chunked response too large");
+      tooLarge = true;
+      return false;
     }
 
-    std::size_t bytesRead = stream->readBytes(buffer + bufferCursor, HTTP_BUFFER_SIZE - bufferCursor);
-    if (bytesRead == 0) {
-      OS_LOGW(TAG, "No bytes read");
-      result = HTTP::RequestResult::RequestFailed;
-      break;
+    if (!downloadCallback(totalWritten, data, len)) {
+      OS_LOGW(TAG, "Request cancelled by callback");
+      return false;
     }
 
-    bufferCursor += bytesRead;
+    totalWritten += len;
 
-parseMore:
-    state = _parseChunk(buffer, bufferCursor, payloadPos, payloadSize);
-    if (state == ParserState::Invalid) {
-      OS_LOGE(TAG, "Failed to parse chunk");
-      result = HTTP::RequestResult::RequestFailed;
+    return true;
+  };
+
+  HTTP::ChunkedDecoder decoder;
+
+  while (!decoder.isDone()) {
+    StreamWaitResult waitResult = _waitForStreamData(client, stream, deadline);
+    if (waitResult == StreamWaitResult::TimedOut) {
+      OS_LOGW(TAG, "Request timed out");
+      result = HTTP::RequestResult::TimedOut;
       break;
     }
-    OS_LOGD(TAG, "Chunk parsed: %zu %zu", payloadPos, payloadSize);
-
-    if (state == ParserState::NeedMoreData) {
-      if (bufferCursor == HTTP_BUFFER_SIZE) {
-        OS_LOGE(TAG, "Chunk too large");
-        result = HTTP::RequestResult::RequestFailed;
-        break;
-      }
-      continue;
+    if (waitResult == StreamWaitResult::Disconnected) {
+      OS_LOGW(TAG, "Connection closed before final chunk");
+      result = HTTP::RequestResult::RequestFailed;
+      break;
     }
 
-    // Check for zero chunk size (end of transfer)
-    if (payloadSize == 0) {
+    int bytesRead = stream->read(buffer.data, buffer.size);
+    if (bytesRead <= 0) {
+      OS_LOGW(TAG, "No bytes read");
+      result = HTTP::RequestResult::RequestFailed;
       break;
     }
 
-    if (!downloadCallback(totalWritten, buffer + payloadPos, payloadSize)) {
-      result = HTTP::RequestResult::Cancelled;
+    std::size_t consumed;
+    HTTP::ChunkedDecoder::Result decodeResult = decoder.feed(buffer.data, bytesRead, consumed, onPayload);
+    if (decodeResult == HTTP::ChunkedDecoder::Result::Invalid) {
+      OS_LOGE(TAG, "Failed to parse chunk at body offset %zu", totalWritten);
+      result = HTTP::RequestResult::RequestFailed;
       break;
     }
-
-    totalWritten += payloadSize;
-    _alignChunk(buffer, bufferCursor, payloadPos, payloadSize);
-    payloadSize = 0;
-    payloadPos  = 0;
-
-    if (bufferCursor > 0) {
-      goto parseMore;
+    if (decodeResult == HTTP::ChunkedDecoder::Result::Cancelled) {
+      result = tooLarge ? HTTP::RequestResult::RequestFailed : HTTP::RequestResult::Cancelled;
+      break;
     }
-
-    vTaskDelay(pdMS_TO_TICKS(5));
   }
 
-  free(buffer);
+  free(buffer.data);
 
   return {result, totalWritten};
 }
@@ -424,42 +358,46 @@ StreamReaderResult _readStreamData(HTTPClient& client, WiFiClient* stream, std::
   std::size_t nWritten       = 0;
   HTTP::RequestResult result = HTTP::RequestResult::Success;
 
-  uint8_t* buffer = static_cast<uint8_t*>(malloc(HTTP_BUFFER_SIZE));
+  StreamBuffer buffer = _allocStreamBuffer();
+  if (buffer.data == nullptr) {
+    OS_LOGE(TAG, "Out of memory");
+    return {HTTP::RequestResult::RequestFailed, 0};
+  }
+
+  int64_t deadline = begin + timeoutMs;
 
-  while (client.connected() && nWritten < contentLength) {
-    if (begin + timeoutMs < OpenShock::millis()) {
+  while (nWritten < contentLength) {
+    StreamWaitResult waitResult = _waitForStreamData(client, stream, deadline);
+    if (waitResult == StreamWaitResult::TimedOut) {
       OS_LOGW(TAG, "Request timed out");
       result = HTTP::RequestResult::TimedOut;
       break;
     }
-
-    std::size_t bytesAvailable = stream->available();
-    if (bytesAvailable == 0) {
-      vTaskDelay(pdMS_TO_TICKS(5));
-      continue;
+    if (waitResult == StreamWaitResult::Disconnected) {
+      OS_LOGW(TAG, "Connection closed after %zu of %zu bytes", nWritten, contentLength);
+      result = HTTP::RequestResult::RequestFailed;
+      break;
     }
 
-    std::size_t bytesToRead = std::min(bytesAvailable, HTTP_BUFFER_SIZE);
+    std::size_t bytesToRead = std::min(buffer.size, contentLength - nWritten);
 
-    std::size_t bytesRead = stream->readBytes(buffer, bytesToRead);
-    if (bytesRead == 0) {
+    int bytesRead = stream->read(buffer.data, bytesToRead);
+    if (bytesRead <= 0) {
       OS_LOGW(TAG, "No bytes read");
       result = HTTP::RequestResult::RequestFailed;
       break;
     }
 
-    if (!downloadCallback(nWritten, buffer, bytesRead)) {
+    if (!downloadCallback(nWritten, buffer.data, bytesRead)) {
       OS_LOGW(TAG, "Request cancelled by callback");
       result = HTTP::RequestResult::Cancelled;
       break;
     }
 
     nWritten += bytesRead;
-
-    vTaskDelay(pdMS_TO_TICKS(10));
   }
 
-  free(buffer);
+  free(buffer.data);
 
   return {result, nWritten};
 }
@@ -470,6 +408,7 @@ HTTP::Response<std::size_t> _doGetStream(
   const std::map<String, String>& headers,
   const std::vector<int>& acceptedCodes,
   std::shared_ptr<RateLimit> rateLimiter,
+  std::size_t rangeStart,
   HTTP::GotContentLengthCallback contentLengthCallback,
   HTTP::DownloadCallback downloadCallback,
   uint32_t timeoutMs
@@ -485,6 +424,13 @@ HTTP::Response<std::size_t> _doGetStream(
     client.addHeader(header.first, header.second);
   }
 
+  if (rangeStart > 0) {
+    const char* collectedHeaders[] = {"Content-Range"};
+    client.collectHeaders(collectedHeaders, 1);
+
+    client.addHeader("Range", "bytes=" + String(static_cast<uint32_t>(rangeStart)) + "-");
+  }
+
   int responseCode = client.GET();
 
   if (responseCode == HTTP_CODE_REQUEST_TIMEOUT || begin + timeoutMs < OpenShock::millis()) {
@@ -522,11 +468,24 @@ HTTP::Response<std::size_t> _doGetStream(
     OS_LOGW(TAG, "The server refused to brew coffee because it is, permanently, a teapot.");
   }
 
-  if (std::find(acceptedCodes.begin(), acceptedCodes.end(), responseCode) == acceptedCodes.end()) {
+  bool isPartial = rangeStart > 0 && responseCode == HTTP_CODE_PARTIAL_CONTENT;
+  if (!isPartial && std::find(acceptedCodes.begin(), acceptedCodes.end(), responseCode) == acceptedCodes.end()) {
     OS_LOGE(TAG, "Received unexpected response code %d", responseCode);
     return {HTTP::RequestResult::CodeRejected, responseCode, 0};
   }
 
+  // Offset of the first body byte within the resource, servers are free to ignore the Range header and send everything
+  std::size_t responseStart = 0;
+  if (isPartial) {
+    String contentRange = client.header("Content-Range");
+    if (!HTTP::TryParseContentRangeStart(std::string_view(contentRange.c_str(), contentRange.length()), responseStart) || responseStart != rangeStart) {
+      OS_LOGE(TAG, "Received unexpected Content-Range: %s", contentRange.c_str());
+      return {HTTP::RequestResult::RequestFailed, responseCode, 0};
+    }
+  } else if (rangeStart > 0) {
+    OS_LOGW(TAG, "Server ignored Range request, skipping %zu bytes", rangeStart);
+  }
+
   int contentLength = client.getSize();
   if (contentLength == 0) {
     return {HTTP::RequestResult::Success, responseCode, 0};
@@ -538,7 +497,7 @@ HTTP::Response<std::size_t> _doGetStream(
       return {HTTP::RequestResult::RequestFailed, responseCode, 0};
     }
 
-    if (!contentLengthCallback(contentLength)) {
+    if (!contentLengthCallback(responseStart + contentLength)) {
       OS_LOGW(TAG, "Request cancelled by callback");
       return {HTTP::RequestResult::Cancelled, responseCode, 0};
     }
@@ -550,11 +509,33 @@ HTTP::Response<std::size_t> _doGetStream(
     return {HTTP::RequestResult::RequestFailed, 0};
   }
 
+  // Callback offsets are relative to the start of the resource, bytes before rangeStart were already received by the caller
+  HTTP::DownloadCallback rangeCallback = downloadCallback;
+  if (rangeStart > 0) {
+    rangeCallback = [&downloadCallback, responseStart, rangeStart](std::size_t offset, const uint8_t* data, std::size_t len) -> bool {
+      std::size_t absolute = responseStart + offset;
+      if (!HTTP::TrimToResumeOffset(rangeStart, absolute, data, len)) {
+        return true;
+      }
+
+      return downloadCallback(absolute, data, len);
+    };
+  }
+
+  int64_t readBegin = OpenShock::millis();
+
   StreamReaderResult result;
   if (contentLength > 0) {
-    result = _readStreamData(client, stream, contentLength, downloadCallback, begin, timeoutMs);
+    result = _readStreamData(client, stream, contentLength, rangeCallback, begin, timeoutMs);
   } else {
-    result = _readStreamDataChunked(client, stream, downloadCallback, begin, timeoutMs);
+    result = _readStreamDataChunked(client, stream, rangeCallback, begin, timeoutMs);
+  }
+
+  int64_t readDuration = OpenShock::millis() - readBegin;
+  if (readDuration > 0) {
+    OS_LOGI(TAG, "Downloaded %zu bytes in %lli ms (%.1f KiB/s)", result.nWritten, readDuration, (static_cast<float>(result.nWritten) / 1024.0f) / (static_cast<float>(readDuration) / 1000.0f));
+  } else {
+    OS_LOGI(TAG, "Downloaded %zu bytes in <1 ms", result.nWritten);
   }
 
   return {result.result, responseCode, result.nWritten};
@@ -562,6 +543,19 @@ HTTP::Response<std::size_t> _doGetStream(
 
 HTTP::Response<std::size_t>
   HTTP::Download(std::string_view url, const std::map<String, String>& headers, HTTP::GotContentLengthCallback contentLengthCallback, HTTP::DownloadCallback downloadCallback, const std::vector<int>& acceptedCodes, uint32_t timeoutMs)
+{
+  return ResumeDownload(url, headers, 0, contentLengthCallback, downloadCallback, acceptedCodes, timeoutMs);
+}
+
+HTTP::Response<std::size_t> HTTP::ResumeDownload(
+  std::string_view url,
+  const std::map<String, String>& headers,
+  std::size_t resumeOffset,
+  HTTP::GotContentLengthCallback contentLengthCallback,
+  HTTP::DownloadCallback downloadCallback,
+  const std::vector<int>& acceptedCodes,
+  uint32_t timeoutMs
+)
 {
   std::shared_ptr<RateLimit> rateLimiter = _getRateLimiter(url);
   if (rateLimiter == nullptr) {
@@ -575,7 +569,7 @@ HTTP::Response<std::size_t>
   HTTPClient client;
   _setupClient(client);
 
-  return _doGetStream(client, url, headers, acceptedCodes, rateLimiter, contentLengthCallback, downloadCallback, timeoutMs);
+  return _doGetStream(client, url, headers, acceptedCodes, rateLimiter, resumeOffset, contentLengthCallback, downloadCallback, timeoutMs);
 }
 
 HTTP::Response<std::string> HTTP::GetString(std::string_view url, const std::map<String, String>& headers, const std::vector<int>& acceptedCodes, uint32_t timeoutMs)
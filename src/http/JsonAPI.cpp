@@ -7,60 +7,72 @@
 using namespace OpenShock;
 
 HTTP::Response<Serialization::JsonAPI::AccountLinkResponse> HTTP::JsonAPI::LinkAccount(std::string_view accountLinkCode) {
-  std::string domain;
-  if (!Config::GetBackendDomain(domain)) {
+  Config::Snapshot config = Config::GetSnapshot();
+  if (config == nullptr) {
     return {HTTP::RequestResult::InternalError, 0, {}};
   }
 
+  std::string_view domain = config->backendDomain();
+
   char uri[OPENSHOCK_URI_BUFFER_SIZE];
-  sprintf(uri, "https://%s/1/device/pair/%.*s", domain.c_str(), accountLinkCode.length(), accountLinkCode.data());
+  int uriLength = snprintf(uri, sizeof(uri), "https://%.*s/1/device/pair/%.*s", static_cast<int>(domain.size()), domain.data(), static_cast<int>(accountLinkCode.size()), accountLinkCode.data());
+  if (uriLength < 0 || static_cast<std::size_t>(uriLength) >= sizeof(uri)) {
+    return {HTTP::RequestResult::InternalError, 0, {}};
+  }
 
-  return HTTP::GetJSON<Serialization::JsonAPI::AccountLinkResponse>(
+  return HTTP::GetJSON<Serialization::JsonAPI::AccountLinkResponse, Serialization::JsonAPI::AccountLinkJsonParser>(
     uri,
     {
       {"Accept", "application/json"}
   },
-    Serialization::JsonAPI::ParseAccountLinkJsonResponse,
     {200, 404}
   );
 }
 
 HTTP::Response<Serialization::JsonAPI::DeviceInfoResponse> HTTP::JsonAPI::GetDeviceInfo(std::string_view deviceToken) {
-  std::string domain;
-  if (!Config::GetBackendDomain(domain)) {
+  Config::Snapshot config = Config::GetSnapshot();
+  if (config == nullptr) {
     return {HTTP::RequestResult::InternalError, 0, {}};
   }
 
+  std::string_view domain = config->backendDomain();
+
   char uri[OPENSHOCK_URI_BUFFER_SIZE];
-  sprintf(uri, "https://%s/1/device/self", domain.c_str());
+  int uriLength = snprintf(uri, sizeof(uri), "https://%.*s/1/device/self", static_cast<int>(domain.size()), domain.data());
+  if (uriLength < 0 || static_cast<std::size_t>(uriLength) >= sizeof(uri)) {
+    return {HTTP::RequestResult::InternalError, 0, {}};
+  }
 
-  return HTTP::GetJSON<Serialization::JsonAPI::DeviceInfoResponse>(
+  return HTTP::GetJSON<Serialization::JsonAPI::DeviceInfoResponse, Serialization::JsonAPI::DeviceInfoJsonParser>(
     uri,
     {
       {     "Accept",            "application/json"},
       {"DeviceToken", OpenShock::StringToArduinoString(deviceToken)}
   },
-    Serialization::JsonAPI::ParseDeviceInfoJsonResponse,
     {200, 401}
   );
 }
 
 HTTP::Response<Serialization::JsonAPI::AssignLcgResponse> HTTP::JsonAPI::AssignLcg(std::string_view deviceToken) {
-  std::string domain;
-  if (!Config::GetBackendDomain(domain)) {
+  Config::Snapshot config = Config::GetSnapshot();
+  if (config == nullptr) {
     return {HTTP::RequestResult::InternalError, 0, {}};
   }
 
+  std::string_view domain = config->backendDomain();
+
   char uri[OPENSHOCK_URI_BUFFER_SIZE];
-  sprintf(uri, "https://%s/1/device/assignLCG", domain.c_str());
+  int uriLength = snprintf(uri, sizeof(uri), "https://%.*s/1/device/assignLCG", static_cast<int>(domain.size()), domain.data());
+  if (uriLength < 0 || static_cast<std::size_t>(uriLength) >= sizeof(uri)) {
+    return {HTTP::RequestResult::InternalError, 0, {}};
+  }
 
-  return HTTP::GetJSON<Serialization::JsonAPI::AssignLcgResponse>(
+  return HTTP::GetJSON<Serialization::JsonAPI::AssignLcgResponse, Serialization::JsonAPI::AssignLcgJsonParser>(
     uri,
     {
       {     "Accept",            "application/json"},
       {"DeviceToken", OpenShock::StringToArduinoString(deviceToken)}
   },
-    Serialization::JsonAPI::ParseAssignLcgJsonResponse,
     {200, 401}
   );
 }
@@ -10,8 +10,10 @@ const char* const TAG = "main";
 #include "events/Events.h"
 #include "GatewayConnectionManager.h"
 #include "Logging.h"
+#include "LogLevels.h"
 #include "OtaUpdateManager.h"
 #include "serial/SerialInputHandler.h"
+#include "util/HeapTracker.h"
 #include "util/TaskUtils.h"
 #include "VisualStateManager.h"
 #include "wifi/WiFiManager.h"
@@ -92,10 +94,27 @@ void appSetup()
 // Arduino setup function
 void setup()
 {
+  ::Serial.setRxBufferSize(4096);  // Must precede begin(), holds a pasted rawconfig line while the RX task catches up
   ::Serial.begin(115'200);
 
+#if OPENSHOCK_LOG_BINARY
+  if (!OpenShock::BinaryLog::Init()) {
+    OS_PANIC(TAG, "Unable to initialize binary logging");
+  }
+#endif
+
+#if OPENSHOCK_HEAP_TRACKING
+  if (!OpenShock::HeapTracker::Init()) {
+    OS_LOGE(TAG, "Unable to start heap trend sampling");
+  }
+#endif
+
   OpenShock::Config::Init();
 
+  if (!OpenShock::LogLevels::Init()) {
+    OS_LOGE(TAG, "Unable to restore log levels");
+  }
+
   if (!OpenShock::Events::Init()) {
     OS_PANIC(TAG, "Unable to initialize Events");
   }
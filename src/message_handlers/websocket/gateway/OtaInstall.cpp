@@ -32,9 +32,18 @@ void _Private::HandleOtaInstall(const OpenShock::Serialization::Gateway::Gateway
     build = std::string_view(semver->build()->c_str(), semver->build()->size());
   }
 
+  if (prerelease.length() > OpenShock::SemVer::MaxPrereleaseLength || build.length() > OpenShock::SemVer::MaxBuildLength) {
+    OS_LOGE(TAG, "Version prerelease or build is too long");
+    return;
+  }
+
   OpenShock::SemVer version(semver->major(), semver->minor(), semver->patch(), prerelease, build);
+  if (!version.isValid()) {
+    OS_LOGE(TAG, "Version is not a valid semantic version");
+    return;
+  }
 
-  OS_LOGI(TAG, "OTA install requested for version %s", version.toString().c_str());  // TODO: This is abusing the SemVer::toString() method causing alot of string copies, fix this
+  OS_LOGI(TAG, "OTA install requested for version %s", version.toString().data());
 
   if (!OpenShock::OtaUpdateManager::TryStartFirmwareInstallation(version)) {
     OS_LOGE(TAG, "Failed to install firmware");  // TODO: Send error message to server
@@ -0,0 +1,75 @@
+#include "radio/RFCommandScheduler.h"
+
+using namespace OpenShock;
+
+RFCommandScheduler::RFCommandScheduler()
+  : m_commands()
+{
+}
+
+bool RFCommandScheduler::add(std::unique_ptr<Command> command)
+{
+  // Replace the command if it already exists
+  for (auto& existing : m_commands) {
+    if (existing->shockerId != command->shockerId) {
+      continue;
+    }
+
+    // Only replace the command if it should be overwritten
+    if (!existing->overwrite) {
+      return false;
+    }
+
+    existing = std::move(command);
+    return true;
+  }
+
+  m_commands.push_back(std::move(command));
+
+  return true;
+}
+
+void RFCommandScheduler::endAll(int64_t until)
+{
+  for (auto& command : m_commands) {
+    command->until = until;
+  }
+}
+
+void RFCommandScheduler::clear()
+{
+  m_commands.clear();
+}
+
+void RFCommandScheduler::transmitRound(const std::function<int64_t()>& millis, const std::function<void(const Command& command, bool stopping)>& transmit)
+{
+  for (auto it = m_commands.begin(); it != m_commands.end();) {
+    const Command& command = **it;
+
+    bool expired = command.until < millis();
+    bool empty   = command.sequence.empty();
+
+    // Remove expired or empty commands, else send the command.
+    // After sending/receiving a command, move to the next one.
+    if (expired || empty) {
+      // If the command is not empty, send the zero sequence to stop the shocker
+      if (!empty) {
+        transmit(command, true);
+      }
+
+      if (command.until + TransmitEndDuration < millis()) {
+        // Remove the command and move to the next one
+        it = m_commands.erase(it);
+      } else {
+        // Move to the next command
+        ++it;
+      }
+    } else {
+      // Send the command
+      transmit(command, false);
+
+      // Move to the next command
+      ++it;
+    }
+  }
+}
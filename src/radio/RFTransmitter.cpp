@@ -7,9 +7,11 @@ const char* const TAG = "RFTransmitter";
 #include "EStopManager.h"
 
 #include "Logging.h"
+#include "radio/RFCommandScheduler.h"
 #include "radio/rmt/MainEncoder.h"
 #include "Time.h"
 #include "util/FnProxy.h"
+#include "util/HeapTracker.h"
 #include "util/TaskUtils.h"
 
 #include <freertos/queue.h>
@@ -18,17 +20,10 @@ const UBaseType_t RFTRANSMITTER_QUEUE_SIZE   = 64;
 const BaseType_t RFTRANSMITTER_TASK_PRIORITY = 1;
 const uint32_t RFTRANSMITTER_TASK_STACK_SIZE = 4096;  // PROFILED: 1.4KB stack usage
 const float RFTRANSMITTER_TICKRATE_NS        = 1000;
-const int64_t TRANSMIT_END_DURATION          = 300;
 
 using namespace OpenShock;
 
-struct command_t {
-  int64_t until;
-  std::vector<rmt_data_t> sequence;
-  std::vector<rmt_data_t> zeroSequence;
-  uint16_t shockerId;
-  bool overwrite;
-};
+typedef RFCommandScheduler::Command command_t;
 
 RFTransmitter::RFTransmitter(gpio_num_t gpioPin)
   : m_txPin(gpioPin)
@@ -72,6 +67,8 @@ RFTransmitter::~RFTransmitter()
 
 bool RFTransmitter::SendCommand(ShockerModelType model, uint16_t shockerId, ShockerCommandType type, uint8_t intensity, uint16_t durationMs, bool overwriteExisting)
 {
+  OS_HEAP_SITE(TAG);
+
   if (m_queueHandle == nullptr) {
     OS_LOGE(TAG, "[pin-%hhi] Queue is null", m_txPin);
     return false;
@@ -144,17 +141,17 @@ void RFTransmitter::TransmitTask()
 {
   OS_LOGD(TAG, "[pin-%hhi] RMT loop running on core %d", m_txPin, xPortGetCoreID());
 
-  std::vector<command_t*> commands;
+  OS_HEAP_SITE(TAG);
+
+  RFCommandScheduler scheduler;
   while (true) {
     // Receive commands
     command_t* cmd = nullptr;
-    while (xQueueReceive(m_queueHandle, &cmd, commands.empty() ? portMAX_DELAY : 0) == pdTRUE) {
+    while (xQueueReceive(m_queueHandle, &cmd, scheduler.empty() ? portMAX_DELAY : 0) == pdTRUE) {
       if (cmd == nullptr) {
         OS_LOGD(TAG, "[pin-%hhi] Received nullptr (stop command), cleaning up...", m_txPin);
 
-        for (auto it = commands.begin(); it != commands.end(); ++it) {
-          delete *it;
-        }
+        scheduler.clear();
 
         OS_LOGD(TAG, "[pin-%hhi] Cleanup done, stopping task", m_txPin);
 
@@ -162,71 +159,18 @@ void RFTransmitter::TransmitTask()
         return;
       }
 
-      // Replace the command if it already exists
-      for (auto it = commands.begin(); it != commands.end(); ++it) {
-        const command_t* existingCmd = *it;
-
-        if (existingCmd->shockerId == cmd->shockerId) {
-          // Only replace the command if it should be overwritten
-          if (existingCmd->overwrite) {
-            delete *it;
-            *it = cmd;
-          } else {
-            delete cmd;
-          }
-
-          cmd = nullptr;
-
-          break;
-        }
-      }
-
-      // If the command was not replaced, add it to the queue
-      if (cmd != nullptr) {
-        commands.push_back(cmd);
-      }
+      scheduler.add(std::unique_ptr<command_t>(cmd));
     }
 
     if (OpenShock::EStopManager::IsEStopped()) {
-      int64_t whenEStoppedTime = EStopManager::LastEStopped();
-
-      for (auto it = commands.begin(); it != commands.end(); ++it) {
-        cmd = *it;
-
-        cmd->until = whenEStoppedTime;
-      }
+      scheduler.endAll(EStopManager::LastEStopped());
     }
 
     // Send queued commands
-    for (auto it = commands.begin(); it != commands.end();) {
-      cmd = *it;
-
-      bool expired = cmd->until < OpenShock::millis();
-      bool empty   = cmd->sequence.empty();
-
-      // Remove expired or empty commands, else send the command.
-      // After sending/receiving a command, move to the next one.
-      if (expired || empty) {
-        // If the command is not empty, send the zero sequence to stop the shocker
-        if (!empty) {
-          rmtWriteBlocking(m_rmtHandle, cmd->zeroSequence.data(), cmd->zeroSequence.size());
-        }
-
-        if (cmd->until + TRANSMIT_END_DURATION < OpenShock::millis()) {
-          // Remove the command and move to the next one
-          it = commands.erase(it);
-          delete cmd;
-        } else {
-          // Move to the next command
-          ++it;
-        }
-      } else {
-        // Send the command
-        rmtWriteBlocking(m_rmtHandle, cmd->sequence.data(), cmd->sequence.size());
-
-        // Move to the next command
-        ++it;
-      }
-    }
+    scheduler.transmitRound(OpenShock::millis, [this](const command_t& command, bool stopping) {
+      const std::vector<rmt_data_t>& sequence = stopping ? command.zeroSequence : command.sequence;
+
+      rmtWriteBlocking(m_rmtHandle, sequence.data(), sequence.size());
+    });
   }
 }
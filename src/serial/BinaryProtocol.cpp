@@ -0,0 +1,121 @@
+#include "serial/BinaryProtocol.h"
+
+const char* const TAG = "Serial::BinaryProtocol";
+
+#include "CommandHandler.h"
+#include "Logging.h"
+
+#include "serialization/_fbs/GatewayToHubMessage_generated.h"
+
+#include <Arduino.h>
+
+#include <esp_rom_crc.h>
+
+#include <cstring>
+
+using namespace OpenShock::Serial;
+
+const std::size_t FRAME_HEADER_SIZE  = 4;  // type + status + sequence
+const std::size_t FRAME_TRAILER_SIZE = 4;  // crc32
+const std::size_t ACK_FRAME_SIZE     = FRAME_HEADER_SIZE + FRAME_TRAILER_SIZE;
+
+static bool s_hasLastSequence                 = false;
+static uint16_t s_lastSequence                = 0;
+static BinaryProtocol::AckStatus s_lastStatus = BinaryProtocol::AckStatus::Ok;
+
+static void _writeAck(uint16_t sequence, BinaryProtocol::AckStatus status)
+{
+  uint8_t frame[ACK_FRAME_SIZE];
+  frame[0] = static_cast<uint8_t>(BinaryProtocol::FrameType::Ack);
+  frame[1] = static_cast<uint8_t>(status);
+  frame[2] = static_cast<uint8_t>(sequence);
+  frame[3] = static_cast<uint8_t>(sequence >> 8);
+
+  uint32_t crc = esp_rom_crc32_le(0, frame, FRAME_HEADER_SIZE);
+  std::memcpy(frame + FRAME_HEADER_SIZE, &crc, sizeof(crc));  // Little-endian target
+
+  uint8_t encoded[BinaryProtocol::EncodedSize(ACK_FRAME_SIZE)];
+  std::size_t encodedLen = BinaryProtocol::Encode(frame, sizeof(frame), encoded);
+
+  ::Serial.write(encoded, encodedLen);
+}
+
+static BinaryProtocol::AckStatus _handleShockerCommandList(const uint8_t* payload, std::size_t len)
+{
+  flatbuffers::Verifier::Options verifierOptions {
+    .max_size = BinaryProtocol::FrameDecoder::MaxFrameSize,
+  };
+  flatbuffers::Verifier verifier(payload, len, verifierOptions);
+  if (!verifier.VerifyBuffer<OpenShock::Serialization::Gateway::ShockerCommandList>(nullptr)) {
+    OS_LOGE(TAG, "Failed to verify shocker command list");
+    return BinaryProtocol::AckStatus::InvalidPayload;
+  }
+
+  auto msg = flatbuffers::GetRoot<OpenShock::Serialization::Gateway::ShockerCommandList>(payload);
+
+  BinaryProtocol::AckStatus status = BinaryProtocol::AckStatus::Ok;
+  for (auto command : *msg->commands()) {
+    if (!OpenShock::CommandHandler::HandleCommand(command->model(), command->id(), command->type(), command->intensity(), command->duration())) {
+      status = BinaryProtocol::AckStatus::CommandFailed;
+    }
+  }
+
+  return status;
+}
+
+void BinaryProtocol::Reset()
+{
+  s_hasLastSequence = false;
+}
+
+bool BinaryProtocol::HandleFrame(const uint8_t* data, std::size_t len)
+{
+  if (len < FRAME_HEADER_SIZE + FRAME_TRAILER_SIZE) {
+    OS_LOGW(TAG, "Dropping runt frame (%zu bytes)", len);
+    return true;
+  }
+
+  std::size_t bodyLen = len - FRAME_TRAILER_SIZE;
+
+  uint32_t crc;
+  std::memcpy(&crc, data + bodyLen, sizeof(crc));
+  if (esp_rom_crc32_le(0, data, bodyLen) != crc) {
+    // The sequence number can't be trusted either, the host retransmits once its ack times out
+    OS_LOGW(TAG, "Dropping frame with bad CRC");
+    return true;
+  }
+
+  FrameType type    = static_cast<FrameType>(data[0]);
+  uint16_t sequence = static_cast<uint16_t>(data[2] | (data[3] << 8));
+
+  if (s_hasLastSequence && sequence == s_lastSequence) {
+    _writeAck(sequence, s_lastStatus);
+    return true;
+  }
+
+  const uint8_t* payload = data + FRAME_HEADER_SIZE;
+  std::size_t payloadLen = bodyLen - FRAME_HEADER_SIZE;
+
+  AckStatus status;
+  bool keepBinaryMode = true;
+  switch (type) {
+    case FrameType::ShockerCommandList:
+      status = _handleShockerCommandList(payload, payloadLen);
+      break;
+    case FrameType::Exit:
+      status         = AckStatus::Ok;
+      keepBinaryMode = false;
+      break;
+    default:
+      status = AckStatus::UnknownType;
+      break;
+  }
+
+  s_hasLastSequence = true;
+  s_lastSequence    = sequence;
+  s_lastStatus      = status;
+
+  _writeAck(sequence, status);
+
+  return keepBinaryMode;
+}
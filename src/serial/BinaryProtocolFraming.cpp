@@ -0,0 +1,97 @@
+#include "serial/BinaryProtocol.h"
+
+// COBS framing only, kept apart from the frame handling so it builds without the Arduino core
+
+using namespace OpenShock::Serial;
+
+BinaryProtocol::FrameDecoder::FrameDecoder()
+  : m_blockCode(0)
+  , m_blockRemaining(0)
+  , m_overflow(false)
+  , m_complete(false)
+  , m_size(0)
+  , m_buffer()
+{
+}
+
+void BinaryProtocol::FrameDecoder::reset()
+{
+  m_blockCode      = 0;
+  m_blockRemaining = 0;
+  m_overflow       = false;
+  m_complete       = false;
+  m_size           = 0;
+}
+
+bool BinaryProtocol::FrameDecoder::feed(uint8_t byte)
+{
+  if (m_complete) {
+    reset();
+  }
+
+  if (byte == 0x00) {
+    // A frame cut short by a missing block, an overflow or an empty frame is dropped
+    bool valid = !m_overflow && m_blockRemaining == 0 && m_size > 0;
+    if (!valid) {
+      reset();
+      return false;
+    }
+
+    m_complete = true;
+    return true;
+  }
+
+  if (m_overflow) {
+    return false;
+  }
+
+  if (m_blockRemaining == 0) {
+    // Every block except a full one (0xFF) and the last one stands for a zero byte after its data
+    if (m_blockCode != 0 && m_blockCode != 0xFF) {
+      if (m_size >= MaxFrameSize) {
+        m_overflow = true;
+        return false;
+      }
+      m_buffer[m_size++] = 0x00;
+    }
+
+    m_blockCode      = byte;
+    m_blockRemaining = byte - 1;
+    return false;
+  }
+
+  if (m_size >= MaxFrameSize) {
+    m_overflow = true;
+    return false;
+  }
+
+  m_buffer[m_size++] = byte;
+  m_blockRemaining--;
+
+  return false;
+}
+
+std::size_t BinaryProtocol::Encode(const uint8_t* data, std::size_t len, uint8_t* out)
+{
+  std::size_t codePos = 0;
+  std::size_t outPos  = 1;
+  uint8_t code        = 1;
+
+  for (std::size_t i = 0; i < len; ++i) {
+    if (data[i] != 0x00) {
+      out[outPos++] = data[i];
+      code++;
+    }
+
+    if (data[i] == 0x00 || code == 0xFF) {
+      out[codePos] = code;
+      codePos      = outPos++;
+      code         = 1;
+    }
+  }
+
+  out[codePos]  = code;
+  out[outPos++] = 0x00;
+
+  return outPos;
+}
@@ -11,6 +11,7 @@ const char* const TAG = "SerialInputHandler";
 #include "FormatHelpers.h"
 #include "http/HTTPRequestManager.h"
 #include "Logging.h"
+#include "serial/BinaryProtocol.h"
 #include "serial/command_handlers/CommandEntry.h"
 #include "serial/command_handlers/common.h"
 #include "serial/command_handlers/index.h"
@@ -61,8 +62,20 @@ using namespace OpenShock;
 
 const int64_t PASTE_INTERVAL_THRESHOLD_MS       = 20;
 const std::size_t SERIAL_BUFFER_CLEAR_THRESHOLD = 512;
-
-static bool s_echoEnabled = true;
+const std::size_t SERIAL_RX_CHUNK_SIZE          = 128;
+const int64_t BINARY_MODE_IDLE_TIMEOUT_MS       = 30'000;  // Returns to the text console if a binary mode host goes silent, e.g. because it died mid-session
+#if ARDUINO_USB_CDC_ON_BOOT
+const TickType_t SERIAL_POLL_INTERVAL_TICKS = pdMS_TO_TICKS(20);
+#endif
+
+static bool s_echoEnabled           = true;
+static bool s_binaryMode            = false;
+static int64_t s_binaryLastActivity = 0;
+static OpenShock::Serial::BinaryProtocol::FrameDecoder s_frameDecoder;  // Too large for the RX task stack
+static TaskHandle_t s_rxTaskHandle = nullptr;
+static uint8_t s_rxChunk[SERIAL_RX_CHUNK_SIZE];
+static std::size_t s_rxChunkPos = 0;
+static std::size_t s_rxChunkLen = 0;
 static std::vector<OpenShock::Serial::CommandGroup> s_commandGroups;
 static std::unordered_map<std::string_view, OpenShock::Serial::CommandGroup, std::hash_ci, std::equals_ci> s_commandHandlers;
 
@@ -329,7 +342,7 @@ public:
   inline void push_back(char c)
   {
     if (m_size >= m_capacity) {
-      reserve(m_capacity + 16);
+      reserve(std::max<std::size_t>(m_capacity * 2, 32));  // Grow geometrically, pasted lines can be several KB
     }
 
     m_data[m_size++] = c;
@@ -357,20 +370,40 @@ enum class SerialReadResult {
   AutoCompleteRequest,
 };
 
-SerialReadResult _tryReadSerialLine(SerialBuffer& buffer)
+/// @brief Takes the next received byte, refilling from the serial driver in chunks rather than a driver call per byte
+bool _readSerialByte(uint8_t& byte)
 {
-  // Check if there's any data available
-  int available = ::Serial.available();
-  if (available <= 0) {
-    return SerialReadResult::NoData;
+  if (s_rxChunkPos >= s_rxChunkLen) {
+    int available = ::Serial.available();
+    if (available <= 0) {
+      return false;
+    }
+
+    s_rxChunkLen = ::Serial.read(s_rxChunk, std::min<std::size_t>(available, SERIAL_RX_CHUNK_SIZE));
+    s_rxChunkPos = 0;
+    if (s_rxChunkLen == 0) {
+      return false;
+    }
   }
 
-  // Reserve space for the new data
-  buffer.reserve(buffer.size() + available);
+  byte = s_rxChunk[s_rxChunkPos++];
+
+  return true;
+}
+
+bool _hasSerialData()
+{
+  return s_rxChunkPos < s_rxChunkLen || ::Serial.available() > 0;
+}
+
+SerialReadResult _tryReadSerialLine(SerialBuffer& buffer)
+{
+  SerialReadResult result = SerialReadResult::NoData;
 
-  // Read the data into the buffer
-  while (available-- > 0) {
-    char c = ::Serial.read();
+  uint8_t byte;
+  while (_readSerialByte(byte)) {
+    char c = static_cast<char>(byte);
+    result = SerialReadResult::Data;
 
     // Handle backspace
     if (c == '\b') {
@@ -401,15 +434,14 @@ SerialReadResult _tryReadSerialLine(SerialBuffer& buffer)
     }
   }
 
-  return SerialReadResult::Data;
+  return result;
 }
 
 void _skipSerialWhitespaces(SerialBuffer& buffer)
 {
-  int available = ::Serial.available();
-
-  while (available-- > 0) {
-    char c = ::Serial.read();
+  uint8_t byte;
+  while (_readSerialByte(byte)) {
+    char c = static_cast<char>(byte);
 
     if (c != ' ' && c != '\r' && c != '\n') {
       buffer.push_back(c);
@@ -423,19 +455,20 @@ void _echoBuffer(std::string_view buffer)
   ::Serial.printf(CLEAR_LINE "> %.*s", buffer.size(), buffer.data());
 }
 
-void _echoHandleSerialInput(std::string_view buffer, bool hasData)
+/// @return Whether there is input left to echo once the paste interval passes
+bool _echoHandleSerialInput(std::string_view buffer, bool hasData)
 {
   static int64_t lastActivity = 0;
   static bool hasChanges      = false;
 
   // If serial echo is disabled, don't do anything past this point
   if (!s_echoEnabled) {
-    return;
+    return false;
   }
 
   // If the command starts with a $, it's a automated command, don't echo it
   if (!buffer.empty() && buffer[0] == '$') {
-    return;
+    return false;
   }
 
   // Update activity state
@@ -450,6 +483,8 @@ void _echoHandleSerialInput(std::string_view buffer, bool hasData)
     hasChanges   = false;
     lastActivity = OpenShock::millis();
   }
+
+  return hasChanges;
 }
 
 void _processSerialLine(std::string_view line)
@@ -470,9 +505,10 @@ void _processSerialLine(std::string_view line)
     ::Serial.println();
   }
 
-  auto parts                 = OpenShock::StringSplit(line, ' ', 1);
+  std::string_view parts[2];
+  std::size_t partCount      = OpenShock::StringSplitInto(OpenShock::StringSplit(line, ' ', 1), parts);
   std::string_view command   = OpenShock::StringTrim(parts[0]);
-  std::string_view arguments = parts.size() > 1 ? parts[1] : std::string_view();
+  std::string_view arguments = partCount > 1 ? parts[1] : std::string_view();
 
   if (command == "help"sv) {
     _handleHelpCommand(arguments, isAutomated);
@@ -486,9 +522,10 @@ void _processSerialLine(std::string_view line)
   }
 
   // Get potential subcommand
+  // Only whether there is more than one argument matters, so the split stops after the first
   std::string_view firstArg;
-  parts = OpenShock::StringSplit(arguments, ' ');
-  if (parts.size() > 1) {
+  partCount = OpenShock::StringSplitInto(OpenShock::StringSplit(arguments, ' ', 1), parts);
+  if (partCount > 1) {
     firstArg = OpenShock::StringTrim(parts[0]);
   } else {
     firstArg = arguments;
@@ -503,7 +540,7 @@ void _processSerialLine(std::string_view line)
       }
 
       // Check if the subcommand requires arguments
-      if (cmd.arguments().size() > 1 && parts.size() < 2) {
+      if (cmd.arguments().size() > 1 && partCount < 2) {
         _printCommandHelp(it->second);
         return;
       }
@@ -538,18 +575,74 @@ void _processSerialLine(std::string_view line)
   SERPR_ERROR("Command \"%.*s\" not found", command.size(), command.data());
 }
 
+void _processSerialFrames()
+{
+  uint8_t byte;
+  while (s_binaryMode && _readSerialByte(byte)) {
+    s_binaryLastActivity = OpenShock::millis();
+
+    if (!s_frameDecoder.feed(byte)) {
+      continue;
+    }
+
+    if (!OpenShock::Serial::BinaryProtocol::HandleFrame(s_frameDecoder.data(), s_frameDecoder.size())) {
+      OS_LOGI(TAG, "Leaving binary mode");
+      s_binaryMode = false;
+    }
+  }
+}
+
+#if !ARDUINO_USB_CDC_ON_BOOT
+void _serialRxCallback()
+{
+  xTaskNotifyGive(s_rxTaskHandle);
+}
+#endif
+
+/// @brief Blocks until new input arrives or the timeout passes
+void _waitForSerialData(TickType_t timeout)
+{
+  if (_hasSerialData()) {
+    return;
+  }
+
+#if ARDUINO_USB_CDC_ON_BOOT
+  // USB CDC doesn't go through the UART driver, so there is no receive event to wait on
+  vTaskDelay(std::min(timeout, s_binaryMode ? 1 : SERIAL_POLL_INTERVAL_TICKS));
+#else
+  ulTaskNotifyTake(pdTRUE, timeout);
+#endif
+}
+
 void _serialRxTask(void*)
 {
-  SerialBuffer buffer(32);
+  SerialBuffer buffer(SERIAL_BUFFER_CLEAR_THRESHOLD);
 
   while (true) {
+    if (s_binaryMode) {
+      _processSerialFrames();
+
+      int64_t idleMs = OpenShock::millis() - s_binaryLastActivity;
+      if (s_binaryMode && idleMs >= BINARY_MODE_IDLE_TIMEOUT_MS) {
+        OS_LOGW(TAG, "Nothing received for %lld ms, leaving binary mode", idleMs);
+        s_binaryMode = false;
+        continue;
+      }
+
+      _waitForSerialData(pdMS_TO_TICKS(BINARY_MODE_IDLE_TIMEOUT_MS - idleMs) + 1);
+      continue;
+    }
+
+    bool echoPending = true;
+
     switch (_tryReadSerialLine(buffer)) {
       case SerialReadResult::LineEnd:
         _processSerialLine(buffer);
 
-        // Deallocate memory if the buffer is too large
+        // Shrink back to the preallocated size if a long line grew the buffer
         if (buffer.capacity() > SERIAL_BUFFER_CLEAR_THRESHOLD) {
           buffer.destroy();
+          buffer.reserve(SERIAL_BUFFER_CLEAR_THRESHOLD);
         } else {
           buffer.clear();
         }
@@ -561,14 +654,15 @@ void _serialRxTask(void*)
         ::Serial.printf(CLEAR_LINE "> %.*s [AutoComplete is not implemented]", buffer.size(), buffer.data());
         break;
       case SerialReadResult::Data:
-        _echoHandleSerialInput(buffer, true);
+        echoPending = _echoHandleSerialInput(buffer, true);
         break;
       default:
-        _echoHandleSerialInput(buffer, false);
+        echoPending = _echoHandleSerialInput(buffer, false);
         break;
     }
 
-    vTaskDelay(pdMS_TO_TICKS(20));  // 50 Hz update rate
+    // Only wake up without new input to echo a finished paste
+    _waitForSerialData(echoPending ? pdMS_TO_TICKS(PASTE_INTERVAL_THRESHOLD_MS) + 1 : portMAX_DELAY);
   }
 }
 
@@ -597,11 +691,16 @@ bool SerialInputHandler::Init()
     return false;
   }
 
-  if (TaskUtils::TaskCreateExpensive(_serialRxTask, "SerialRX", 3200, nullptr, 1, nullptr) != pdPASS) {  // Profiled: 2.96KB stack usage
+  if (TaskUtils::TaskCreateExpensive(_serialRxTask, "SerialRX", 3200, nullptr, 1, &s_rxTaskHandle) != pdPASS) {  // Profiled: 2.96KB stack usage
     OS_LOGE(TAG, "Failed to create serial RX task");
     return false;
   }
 
+#if !ARDUINO_USB_CDC_ON_BOOT
+  // Called from the UART driver's event task whenever the RX FIFO fills up or the line goes idle
+  ::Serial.onReceive(_serialRxCallback);
+#endif
+
   return true;
 }
 bool SerialInputHandler::SerialEchoEnabled()
@@ -614,6 +713,22 @@ void SerialInputHandler::SetSerialEchoEnabled(bool enabled)
   s_echoEnabled = enabled;
 }
 
+bool SerialInputHandler::BinaryModeEnabled()
+{
+  return s_binaryMode;
+}
+
+void SerialInputHandler::SetBinaryModeEnabled(bool enabled)
+{
+  if (enabled && !s_binaryMode) {
+    s_frameDecoder.reset();
+    OpenShock::Serial::BinaryProtocol::Reset();
+    s_binaryLastActivity = OpenShock::millis();
+  }
+
+  s_binaryMode = enabled;
+}
+
 void SerialInputHandler::PrintWelcomeHeader()
 {
   ::Serial.print(R"(
@@ -2,18 +2,16 @@
 
 #include "config/Config.h"
 
-#include <string>
-
 void _handleAuthtokenCommand(std::string_view arg, bool isAutomated) {
   if (arg.empty()) {
-    std::string authToken;
-    if (!OpenShock::Config::GetBackendAuthToken(authToken)) {
+    OpenShock::Config::Snapshot config = OpenShock::Config::GetSnapshot();
+    if (config == nullptr) {
       SERPR_ERROR("Failed to get auth token from config");
       return;
     }
 
     // Get auth token
-    SERPR_RESPONSE("AuthToken|%s", authToken.c_str());
+    SERPR_RESPONSE("AuthToken|%s", config->backendAuthToken().data());
     return;
   }
 
@@ -0,0 +1,20 @@
+#include "serial/command_handlers/common.h"
+
+#include "serial/SerialInputHandler.h"
+
+void _handleBinaryCommand(std::string_view arg, bool isAutomated) {
+  (void)arg;
+
+  // The response is the last text the host reads before switching to frames
+  SERPR_SUCCESS("Entering binary mode");
+
+  OpenShock::SerialInputHandler::SetBinaryModeEnabled(true);
+}
+
+OpenShock::Serial::CommandGroup OpenShock::Serial::CommandHandlers::BinaryHandler() {
+  auto group = OpenShock::Serial::CommandGroup("binary"sv);
+
+  auto& cmd = group.addCommand("Switch to framed binary commands until the host sends an exit frame or stays silent for 30 seconds"sv, _handleBinaryCommand);
+
+  return group;
+}
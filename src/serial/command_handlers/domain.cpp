@@ -4,20 +4,18 @@
 #include "http/HTTPRequestManager.h"
 #include "serialization/JsonAPI.h"
 
-#include <string>
-
 const char* const TAG = "Serial::CommandHandlers::Domain";
 
 void _handleDomainCommand(std::string_view arg, bool isAutomated) {
   if (arg.empty()) {
-    std::string domain;
-    if (!OpenShock::Config::GetBackendDomain(domain)) {
+    OpenShock::Config::Snapshot config = OpenShock::Config::GetSnapshot();
+    if (config == nullptr) {
       SERPR_ERROR("Failed to get domain from config");
       return;
     }
 
     // Get domain
-    SERPR_RESPONSE("Domain|%s", domain.c_str());
+    SERPR_RESPONSE("Domain|%s", config->backendDomain().data());
     return;
   }
 
@@ -31,12 +29,11 @@ void _handleDomainCommand(std::string_view arg, bool isAutomated) {
   char uri[OPENSHOCK_URI_BUFFER_SIZE];
   sprintf(uri, "https://%.*s/1", arg.length(), arg.data());
 
-  auto resp = OpenShock::HTTP::GetJSON<OpenShock::Serialization::JsonAPI::BackendVersionResponse>(
+  auto resp = OpenShock::HTTP::GetJSON<OpenShock::Serialization::JsonAPI::BackendVersionResponse, OpenShock::Serialization::JsonAPI::BackendVersionJsonParser>(
     uri,
     {
       {"Accept", "application/json"}
   },
-    OpenShock::Serialization::JsonAPI::ParseBackendVersionJsonResponse,
     {200}
   );
 
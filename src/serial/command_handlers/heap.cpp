@@ -0,0 +1,84 @@
+#include "serial/command_handlers/common.h"
+
+#include "util/HeapTracker.h"
+
+const std::size_t HEAP_SITES_LISTED = 16;
+
+void _handleHeapInfoCommand(std::string_view arg, bool isAutomated)
+{
+  if (!arg.empty()) {
+    SERPR_ERROR("Invalid command (info command should not have any arguments)");
+    return;
+  }
+
+  auto info = OpenShock::HeapTracker::GetHeapInfo();
+
+  // Share of free memory outside the largest block, rises as the heap fragments
+  uint32_t fragmentationPermille = info.freeBytes != 0 ? 1000 - static_cast<uint32_t>(static_cast<uint64_t>(info.largestFreeBlock) * 1000 / info.freeBytes) : 0;
+
+  SERPR_RESPONSE("HeapInfo|free=%u,minFree=%u,largestFreeBlock=%u,fragmentation=%u.%u%%", info.freeBytes, info.minFreeBytes, info.largestFreeBlock, fragmentationPermille / 10, fragmentationPermille % 10);
+
+#if OPENSHOCK_HEAP_TRACKING
+  auto totals = OpenShock::HeapTracker::GetTotals();
+  SERPR_RESPONSE("HeapTotals|live=%u,liveCount=%u,peakLive=%u,allocs=%u,frees=%u,untracked=%u", totals.liveBytes, totals.liveCount, totals.peakLiveBytes, totals.allocs, totals.frees, totals.untracked);
+
+  auto sites = OpenShock::HeapTracker::GetSites();
+  for (std::size_t i = 0; i < sites.size() && i < HEAP_SITES_LISTED; i++) {
+    const auto& site = sites[i];
+
+    char name[24];
+    if (site.tag != nullptr) {
+      snprintf(name, sizeof(name), "%s", site.tag);
+    } else {
+      snprintf(name, sizeof(name), "0x%08x", static_cast<unsigned int>(site.pc));
+    }
+
+    SERPR_RESPONSE("HeapSite|%s|live=%u,liveCount=%u,allocs=%u,allocBytes=%llu", name, site.liveBytes, site.liveCount, site.allocs, site.allocBytes);
+  }
+#endif
+}
+
+void _handleHeapTrendCommand(std::string_view arg, bool isAutomated)
+{
+  if (!arg.empty()) {
+    SERPR_ERROR("Invalid command (trend command should not have any arguments)");
+    return;
+  }
+
+#if OPENSHOCK_HEAP_TRACKING
+  for (const auto& sample : OpenShock::HeapTracker::GetTrend()) {
+    SERPR_RESPONSE("HeapTrend|%u|free=%u,largestFreeBlock=%u,live=%u,allocsPerMinute=%u", sample.uptimeS, sample.freeBytes, sample.largestFreeBlock, sample.liveBytes, sample.allocsPerMinute);
+  }
+#else
+  SERPR_ERROR("Heap tracking is not compiled into this build, set OPENSHOCK_HEAP_TRACKING=1");
+#endif
+}
+
+void _handleHeapResetCommand(std::string_view arg, bool isAutomated)
+{
+  if (!arg.empty()) {
+    SERPR_ERROR("Invalid command (reset command should not have any arguments)");
+    return;
+  }
+
+#if OPENSHOCK_HEAP_TRACKING
+  OpenShock::HeapTracker::Reset();
+
+  SERPR_SUCCESS("Reset heap counters");
+#else
+  SERPR_ERROR("Heap tracking is not compiled into this build, set OPENSHOCK_HEAP_TRACKING=1");
+#endif
+}
+
+OpenShock::Serial::CommandGroup OpenShock::Serial::CommandHandlers::HeapHandler()
+{
+  auto group = OpenShock::Serial::CommandGroup("heap"sv);
+
+  auto& infoCommand = group.addCommand("Show free heap and fragmentation, and with heap tracking the sites holding the most memory (PCs decode with addr2line)"sv, _handleHeapInfoCommand);
+
+  auto& trendCommand = group.addCommand("trend"sv, "List the free heap, largest free block, live bytes and allocation rate sampled every minute over the last hour"sv, _handleHeapTrendCommand);
+
+  auto& resetCommand = group.addCommand("reset"sv, "Reset the allocation counters and the trend, live allocations stay tracked"sv, _handleHeapResetCommand);
+
+  return group;
+}
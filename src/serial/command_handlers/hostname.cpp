@@ -2,19 +2,17 @@
 
 #include "config/Config.h"
 
-#include <string>
-
 const char* const TAG = "Serial::CommandHandlers::Domain";
 
 void _handleHostnameCommand(std::string_view arg, bool isAutomated) {
   if (arg.empty()) {
-    std::string hostname;
-    if (!OpenShock::Config::GetWiFiHostname(hostname)) {
+    OpenShock::Config::Snapshot config = OpenShock::Config::GetSnapshot();
+    if (config == nullptr) {
       SERPR_ERROR("Failed to get hostname from config");
       return;
     }
     // Get hostname
-    SERPR_RESPONSE("Hostname|%s", hostname.c_str());
+    SERPR_RESPONSE("Hostname|%s", config->wifiHostname().data());
     return;
   }
 
@@ -4,10 +4,29 @@
 
 void _handleJsonConfigCommand(std::string_view arg, bool isAutomated) {
   if (arg.empty()) {
-    // Get raw config
-    std::string json = OpenShock::Config::GetAsJSON(true);
+    // Stream the config straight to serial instead of building the whole string first, the response line starts with the first piece so an early failure prints only the error
+    bool started = false;
+
+    bool success = OpenShock::Config::WriteAsJSON(
+      [&started](const char* data, std::size_t len) {
+        if (!started) {
+          SERPR_RESPONSE_BEGIN("JsonConfig|");
+          started = true;
+        }
+        ::Serial.write(reinterpret_cast<const uint8_t*>(data), len);
+        return true;
+      },
+      true
+    );
+
+    if (started) {
+      ::Serial.print("\n");
+    }
+
+    if (!success) {
+      SERPR_ERROR("Failed to serialize config");
+    }
 
-    SERPR_RESPONSE("JsonConfig|%s", json.c_str());
     return;
   }
 
@@ -9,14 +9,14 @@ const char* TAG = "Serial::CommandHandlers::LcgOverride";
 
 void _handleLcgOverrideCommand(std::string_view arg, bool isAutomated) {
   if (arg.empty()) {
-    std::string lcgOverride;
-    if (!OpenShock::Config::GetBackendLCGOverride(lcgOverride)) {
+    OpenShock::Config::Snapshot config = OpenShock::Config::GetSnapshot();
+    if (config == nullptr) {
       SERPR_ERROR("Failed to get LCG override from config");
       return;
     }
 
     // Get LCG override
-    SERPR_RESPONSE("LcgOverride|%s", lcgOverride.c_str());
+    SERPR_RESPONSE("LcgOverride|%s", config->backendLCGOverride().data());
     return;
   }
 
@@ -51,12 +51,11 @@ void _handleLcgOverrideCommand(std::string_view arg, bool isAutomated) {
     char uri[OPENSHOCK_URI_BUFFER_SIZE];
     sprintf(uri, "https://%.*s/1", static_cast<int>(domain.size()), domain.data());
 
-    auto resp = OpenShock::HTTP::GetJSON<OpenShock::Serialization::JsonAPI::LcgInstanceDetailsResponse>(
+    auto resp = OpenShock::HTTP::GetJSON<OpenShock::Serialization::JsonAPI::LcgInstanceDetailsResponse, OpenShock::Serialization::JsonAPI::LcgInstanceDetailsJsonParser>(
       uri,
       {
         {"Accept", "application/json"}
     },
-      OpenShock::Serialization::JsonAPI::ParseLcgInstanceDetailsJsonResponse,
       {200}
     );
 
@@ -0,0 +1,153 @@
+#include "serial/command_handlers/common.h"
+
+#include "LogLevels.h"
+#include "util/StringUtils.h"
+
+#include <freertos/task.h>
+
+const char* const TAG = "Serial::CommandHandlers::LogLevel";
+
+const uint32_t LOGLEVEL_BENCH_ITERATIONS = 100'000;
+
+void _handleLogLevelListCommand(std::string_view arg, bool isAutomated)
+{
+  if (!arg.empty()) {
+    SERPR_ERROR("Invalid command (list command should not have any arguments)");
+    return;
+  }
+
+  std::string levels = std::string("max=") + OpenShock::LogLevels::LevelToString(OPENSHOCK_LOG_LEVEL) + ",*=" + OpenShock::LogLevels::LevelToString(OpenShock::LogLevels::GetDefaultLevel());
+  for (const auto& entry : OpenShock::LogLevels::GetLevels()) {
+    levels.append(",").append(entry.tag).append("=").append(OpenShock::LogLevels::LevelToString(entry.level));
+  }
+
+  SERPR_RESPONSE("LogLevels|%s", levels.c_str());
+}
+
+void _handleLogLevelSetCommand(std::string_view arg, bool isAutomated)
+{
+  std::string_view parts[2];
+  if (!OpenShock::TryStringSplit(arg, ' ', parts)) {
+    SERPR_ERROR("Invalid command (set command should have a tag and a level)");
+    return;
+  }
+
+  std::string_view tag = OpenShock::StringTrim(parts[0]);
+
+  uint8_t level;
+  if (!OpenShock::LogLevels::LevelFromString(OpenShock::StringTrim(parts[1]), level)) {
+    SERPR_ERROR("Invalid argument (level must be none, error, warn, info, debug, verbose or inherit)");
+    return;
+  }
+
+  bool result = tag == "*"sv ? OpenShock::LogLevels::SetDefaultLevel(level) : OpenShock::LogLevels::SetLevel(tag, level);
+  if (!result) {
+    SERPR_ERROR("Failed to set log level");
+    return;
+  }
+
+  if (level != OpenShock::LogLevels::Inherit && level > OPENSHOCK_LOG_LEVEL) {
+    SERPR_SUCCESS("Set log level, messages above %s are not compiled into this build", OpenShock::LogLevels::LevelToString(OPENSHOCK_LOG_LEVEL));
+    return;
+  }
+
+  SERPR_SUCCESS("Set log level");
+}
+
+void _handleLogLevelSaveCommand(std::string_view arg, bool isAutomated)
+{
+  if (!arg.empty()) {
+    SERPR_ERROR("Invalid command (save command should not have any arguments)");
+    return;
+  }
+
+  if (!OpenShock::LogLevels::Persist()) {
+    SERPR_ERROR("Failed to save log levels");
+    return;
+  }
+
+  SERPR_SUCCESS("Saved log levels");
+}
+
+void _handleLogLevelResetCommand(std::string_view arg, bool isAutomated)
+{
+  if (!arg.empty()) {
+    SERPR_ERROR("Invalid command (reset command should not have any arguments)");
+    return;
+  }
+
+  OpenShock::LogLevels::Reset();
+
+  if (!OpenShock::LogLevels::Persist()) {
+    SERPR_ERROR("Reset log levels, but failed to clear the saved ones");
+    return;
+  }
+
+  SERPR_SUCCESS("Reset log levels");
+}
+
+void _handleLogLevelBenchCommand(std::string_view arg, bool isAutomated)
+{
+  if (!arg.empty()) {
+    SERPR_ERROR("Invalid command (bench command should not have any arguments)");
+    return;
+  }
+
+#if OPENSHOCK_LOG_LEVEL >= OPENSHOCK_LOG_LEVEL_ERROR
+  uint8_t previousLevel = OpenShock::LogLevels::Inherit;
+  for (const auto& entry : OpenShock::LogLevels::GetLevels()) {
+    if (entry.tag == TAG) {
+      previousLevel = entry.level;
+    }
+  }
+
+  // Filters out everything this unit logs, the loop then measures the same check every OS_LOG* call compiles to (e.g. the ones in RFTransmitter::TransmitTask)
+  OpenShock::LogLevels::SetLevel(TAG, OPENSHOCK_LOG_LEVEL_NONE);
+  OS_LOGE(TAG, "Binds this unit's TAG, never printed");
+
+  vTaskSuspendAll();
+
+  uint32_t start = ESP.getCycleCount();
+  for (uint32_t i = 0; i < LOGLEVEL_BENCH_ITERATIONS; i++) {
+    asm volatile("" ::: "memory");
+  }
+  uint32_t baselineCycles = ESP.getCycleCount() - start;
+
+  start = ESP.getCycleCount();
+  for (uint32_t i = 0; i < LOGLEVEL_BENCH_ITERATIONS; i++) {
+    asm volatile("" ::: "memory");
+    OS_LOGE(TAG, "Benchmark iteration %u", i);
+  }
+  uint32_t filteredCycles = ESP.getCycleCount() - start;
+
+  xTaskResumeAll();
+
+  OpenShock::LogLevels::SetLevel(TAG, previousLevel);
+
+  uint32_t checkCycles      = filteredCycles > baselineCycles ? filteredCycles - baselineCycles : 0;
+  uint32_t centiCyclesCheck = static_cast<uint32_t>(static_cast<uint64_t>(checkCycles) * 100 / LOGLEVEL_BENCH_ITERATIONS);
+
+  SERPR_RESPONSE("LogLevelBench|iterations=%u,baselineCycles=%u,filteredCycles=%u,cyclesPerCheck=%u.%02u,cpuMHz=%u", LOGLEVEL_BENCH_ITERATIONS, baselineCycles, filteredCycles, centiCyclesCheck / 100, centiCyclesCheck % 100, ESP.getCpuFreqMHz());
+#else
+  SERPR_ERROR("Logging is compiled out of this build, there is no check to measure");
+#endif
+}
+
+OpenShock::Serial::CommandGroup OpenShock::Serial::CommandHandlers::LogLevelHandler()
+{
+  auto group = OpenShock::Serial::CommandGroup("loglevel"sv);
+
+  auto& listCommand = group.addCommand("List the log level of every TAG, \"max\" is the most verbose level compiled into this build"sv, _handleLogLevelListCommand);
+
+  auto& setCommand = group.addCommand("set"sv, "Set the log level of a TAG until restart, \"*\" sets the default level"sv, _handleLogLevelSetCommand);
+  setCommand.addArgument("tag"sv, "must be a TAG or *"sv, "RFTransmitter"sv);
+  setCommand.addArgument("level"sv, "must be none, error, warn, info, debug, verbose or inherit"sv, "debug"sv);
+
+  auto& saveCommand = group.addCommand("save"sv, "Save the current log levels so they are restored on boot"sv, _handleLogLevelSaveCommand);
+
+  auto& resetCommand = group.addCommand("reset"sv, "Reset every log level to the default and clear the saved ones"sv, _handleLogLevelResetCommand);
+
+  auto& benchCommand = group.addCommand("bench"sv, "Measure the cost of a log call filtered out at runtime"sv, _handleLogLevelBenchCommand);
+
+  return group;
+}
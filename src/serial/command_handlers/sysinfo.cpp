@@ -1,7 +1,9 @@
 #include "serial/command_handlers/common.h"
 
 #include "FormatHelpers.h"
+#include "ReadWriteMutex.h"
 #include "Time.h"
+#include "util/TaskProfiler.h"
 #include "wifi/WiFiManager.h"
 #include "wifi/WiFiNetwork.h"
 
@@ -33,12 +35,44 @@ void _handleDebugInfoCommand(std::string_view arg, bool isAutomated) {
     OpenShock::WiFiManager::GetIPv6Address(ipAddressBuffer);
     SERPR_RESPONSE("WiFiInfo|IPv6|%s", ipAddressBuffer);
   }
+
+  std::vector<OpenShock::TaskProfiler::TaskStats> tasks;
+  if (OpenShock::TaskProfiler::GetTaskStats(tasks)) {
+    for (const auto& task : tasks) {
+      char cpu[16] = "n/a";
+      if (task.cpuPermille >= 0) {
+        snprintf(cpu, sizeof(cpu), "%d.%d%%", task.cpuPermille / 10, task.cpuPermille % 10);
+      }
+
+      char stack[32];
+      if (task.stackSize != 0) {
+        snprintf(stack, sizeof(stack), "%u/%u", task.stackSize - task.stackHighWater, task.stackSize);
+      } else {
+        snprintf(stack, sizeof(stack), "%u free", task.stackHighWater);
+      }
+
+      char heap[16] = "n/a";
+      if (task.heapBytes >= 0) {
+        snprintf(heap, sizeof(heap), "%d", task.heapBytes);
+      }
+
+      SERPR_RESPONSE("TaskInfo|%s|Core %d|Priority %u|CPU %s|Stack %s|Heap %s", task.name.c_str(), task.core == tskNO_AFFINITY ? -1 : static_cast<int>(task.core), task.priority, cpu, stack, heap);
+    }
+  }
+
+#if OPENSHOCK_RWMUTEX_METRICS
+  for (const auto& entry : OpenShock::ReadWriteMutex::GetAllMetrics()) {
+    const auto& m = entry.metrics;
+    SERPR_RESPONSE("LockInfo|%s|Reads|%u (%u waited, %llu us waiting, %llu us held)", entry.name, m.readLocks, m.readContended, m.readWaitUs, m.readHeldUs);
+    SERPR_RESPONSE("LockInfo|%s|Writes|%u (%u waited, %llu us waiting, max %u us; %llu us held, max %u us)", entry.name, m.writeLocks, m.writeContended, m.writeWaitUs, m.writeWaitMaxUs, m.writeHeldUs, m.writeHeldMaxUs);
+  }
+#endif
 }
 
 OpenShock::Serial::CommandGroup OpenShock::Serial::CommandHandlers::SysInfoHandler() {
   auto group = OpenShock::Serial::CommandGroup("sysinfo"sv);
 
-  auto& cmd = group.addCommand("Get system information from RTOS, WiFi, etc."sv, _handleDebugInfoCommand);
+  auto& cmd = group.addCommand("Get system information from RTOS, WiFi, tasks, etc. Per-task CPU and heap show n/a unless the firmware is built with FreeRTOS run time stats and heap task tracking, which the stock Arduino sdkconfig leaves off"sv, _handleDebugInfoCommand);
 
   return group;
 }
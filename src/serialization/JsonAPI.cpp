@@ -2,238 +2,373 @@
 
 const char* const TAG = "JsonAPI";
 
+#include "Convert.h"
 #include "Logging.h"
 
-#define ESP_LOGJSONE(err, root) OS_LOGE(TAG, "Invalid JSON response (" err "): %s", cJSON_PrintUnformatted(root))
+#include <string_view>
 
+#define ESP_LOGJSONE(err) OS_LOGE(TAG, "Invalid JSON response (" err ")")
+
+using namespace std::string_view_literals;
 using namespace OpenShock::Serialization;
 
-bool JsonAPI::ParseLcgInstanceDetailsJsonResponse(int code, const cJSON* root, JsonAPI::LcgInstanceDetailsResponse& out) {
-  (void)code;
+using JsonStream::Token;
+using JsonStream::TokenType;
 
-  if (cJSON_IsObject(root) == 0) {
-    ESP_LOGJSONE("not an object", root);
-    return false;
+enum class FieldMatch : uint8_t {
+  NoMatch,
+  Assigned,
+  WrongType,
+};
+
+static FieldMatch _matchStringField(const Token& token, std::string_view key, std::string& out, uint8_t& seen, uint8_t bit)
+{
+  if (token.key != key) {
+    return FieldMatch::NoMatch;
   }
 
-  out = {};
+  if (token.type != TokenType::String) {
+    return FieldMatch::WrongType;
+  }
 
-  const cJSON* name = cJSON_GetObjectItemCaseSensitive(root, "name");
-  if (cJSON_IsString(name) == 0) {
-    ESP_LOGJSONE("value at 'data.name' is not a string", root);
-    return false;
+  out.assign(token.value.data(), token.value.size());
+  seen |= bit;
+
+  return FieldMatch::Assigned;
+}
+
+/// @brief Checks the root value is an object, tokens at depth 0 are only ever the root value's start/end
+static bool _isRootObjectToken(const Token& token)
+{
+  return token.type == TokenType::ObjectStart || token.type == TokenType::ObjectEnd;
+}
+
+/// @brief Tracks entry into and exit from the root-level "data" object, returns false if "data" is present but not an object
+static bool _trackDataObject(const Token& token, bool& inData, uint8_t& seen, uint8_t bit)
+{
+  if (token.type == TokenType::ObjectEnd) {
+    inData = false;
+    return true;
   }
 
-  const cJSON* version = cJSON_GetObjectItemCaseSensitive(root, "version");
-  if (cJSON_IsString(version) == 0) {
-    ESP_LOGJSONE("value at 'data.version' is not a string", root);
-    return false;
+  if (token.key != "data"sv) {
+    return true;
   }
 
-  const cJSON* currentTime = cJSON_GetObjectItemCaseSensitive(root, "currentTime");
-  if (cJSON_IsString(currentTime) == 0) {
-    ESP_LOGJSONE("value at 'data.currentTime' is not a string", root);
+  if (token.type != TokenType::ObjectStart) {
     return false;
   }
 
-  const cJSON* countryCode = cJSON_GetObjectItemCaseSensitive(root, "countryCode");
-  if (cJSON_IsString(countryCode) == 0) {
-    ESP_LOGJSONE("value at 'data.countryCode' is not a string", root);
-    return false;
+  inData = true;
+  seen |= bit;
+
+  return true;
+}
+
+bool JsonAPI::LcgInstanceDetailsJsonParser::onToken(const Token& token)
+{
+  if (token.depth == 0) {
+    if (!_isRootObjectToken(token)) {
+      ESP_LOGJSONE("not an object");
+      return false;
+    }
+    return true;
+  }
+
+  if (token.depth != 1) {
+    return true;
   }
 
-  const cJSON* fqdn = cJSON_GetObjectItemCaseSensitive(root, "fqdn");
-  if (cJSON_IsString(fqdn) == 0) {
-    ESP_LOGJSONE("value at 'data.fqdn' is not a string", root);
+  if (_matchStringField(token, "name"sv, m_out.name, m_seen, 1 << 0) == FieldMatch::WrongType) {
+    ESP_LOGJSONE("value at 'name' is not a string");
+    return false;
+  }
+  if (_matchStringField(token, "version"sv, m_out.version, m_seen, 1 << 1) == FieldMatch::WrongType) {
+    ESP_LOGJSONE("value at 'version' is not a string");
+    return false;
+  }
+  if (_matchStringField(token, "currentTime"sv, m_out.currentTime, m_seen, 1 << 2) == FieldMatch::WrongType) {
+    ESP_LOGJSONE("value at 'currentTime' is not a string");
+    return false;
+  }
+  if (_matchStringField(token, "countryCode"sv, m_out.countryCode, m_seen, 1 << 3) == FieldMatch::WrongType) {
+    ESP_LOGJSONE("value at 'countryCode' is not a string");
+    return false;
+  }
+  if (_matchStringField(token, "fqdn"sv, m_out.fqdn, m_seen, 1 << 4) == FieldMatch::WrongType) {
+    ESP_LOGJSONE("value at 'fqdn' is not a string");
     return false;
   }
 
-  out.name        = name->valuestring;
-  out.version     = version->valuestring;
-  out.currentTime = currentTime->valuestring;
-  out.countryCode = countryCode->valuestring;
-  out.fqdn        = fqdn->valuestring;
+  return true;
+}
+bool JsonAPI::LcgInstanceDetailsJsonParser::onEnd()
+{
+  if (m_seen != 0b11111) {
+    ESP_LOGJSONE("missing one of 'name', 'version', 'currentTime', 'countryCode' or 'fqdn'");
+    return false;
+  }
 
   return true;
 }
-bool JsonAPI::ParseBackendVersionJsonResponse(int code, const cJSON* root, JsonAPI::BackendVersionResponse& out) {
-  (void)code;
 
-  if (cJSON_IsObject(root) == 0) {
-    ESP_LOGJSONE("not an object", root);
-    return false;
+bool JsonAPI::BackendVersionJsonParser::onToken(const Token& token)
+{
+  if (token.depth == 0) {
+    if (!_isRootObjectToken(token)) {
+      ESP_LOGJSONE("not an object");
+      return false;
+    }
+    return true;
   }
 
-  const cJSON* data = cJSON_GetObjectItemCaseSensitive(root, "data");
-  if (cJSON_IsObject(data) == 0) {
-    ESP_LOGJSONE("value at 'data' is not an object", root);
-    return false;
+  if (token.depth == 1) {
+    if (!_trackDataObject(token, m_inData, m_seen, 1 << 0)) {
+      ESP_LOGJSONE("value at 'data' is not an object");
+      return false;
+    }
+    return true;
   }
 
-  out = {};
+  if (token.depth != 2 || !m_inData) {
+    return true;
+  }
 
-  const cJSON* version = cJSON_GetObjectItemCaseSensitive(data, "version");
-  if (cJSON_IsString(version) == 0) {
-    ESP_LOGJSONE("value at 'data.version' is not a string", root);
+  if (_matchStringField(token, "version"sv, m_out.version, m_seen, 1 << 1) == FieldMatch::WrongType) {
+    ESP_LOGJSONE("value at 'data.version' is not a string");
     return false;
   }
-
-  const cJSON* commit = cJSON_GetObjectItemCaseSensitive(data, "commit");
-  if (cJSON_IsString(commit) == 0) {
-    ESP_LOGJSONE("value at 'data.commit' is not a string", root);
+  if (_matchStringField(token, "commit"sv, m_out.commit, m_seen, 1 << 2) == FieldMatch::WrongType) {
+    ESP_LOGJSONE("value at 'data.commit' is not a string");
     return false;
   }
-
-  const cJSON* currentTime = cJSON_GetObjectItemCaseSensitive(data, "currentTime");
-  if (cJSON_IsString(currentTime) == 0) {
-    ESP_LOGJSONE("value at 'data.currentTime' is not a string", root);
+  if (_matchStringField(token, "currentTime"sv, m_out.currentTime, m_seen, 1 << 3) == FieldMatch::WrongType) {
+    ESP_LOGJSONE("value at 'data.currentTime' is not a string");
     return false;
   }
 
-  out.version     = version->valuestring;
-  out.commit      = commit->valuestring;
-  out.currentTime = currentTime->valuestring;
+  return true;
+}
+bool JsonAPI::BackendVersionJsonParser::onEnd()
+{
+  if (m_seen != 0b1111) {
+    ESP_LOGJSONE("missing one of 'data', 'data.version', 'data.commit' or 'data.currentTime'");
+    return false;
+  }
 
   return true;
 }
 
-bool JsonAPI::ParseAccountLinkJsonResponse(int code, const cJSON* root, JsonAPI::AccountLinkResponse& out) {
-  (void)code;
+bool JsonAPI::AccountLinkJsonParser::onToken(const Token& token)
+{
+  if (token.depth == 0) {
+    if (!_isRootObjectToken(token)) {
+      ESP_LOGJSONE("not an object");
+      return false;
+    }
+    return true;
+  }
 
-  if (cJSON_IsObject(root) == 0) {
-    ESP_LOGJSONE("not an object", root);
-    return false;
+  if (token.depth != 1) {
+    return true;
   }
 
-  const cJSON* data = cJSON_GetObjectItemCaseSensitive(root, "data");
-  if (cJSON_IsString(data) == 0) {
-    ESP_LOGJSONE("value at 'data' is not a string", root);
+  if (_matchStringField(token, "data"sv, m_out.authToken, m_seen, 1 << 0) == FieldMatch::WrongType) {
+    ESP_LOGJSONE("value at 'data' is not a string");
     return false;
   }
 
-  out = {};
-
-  out.authToken = data->valuestring;
+  return true;
+}
+bool JsonAPI::AccountLinkJsonParser::onEnd()
+{
+  if (m_seen != 0b1) {
+    ESP_LOGJSONE("missing 'data'");
+    return false;
+  }
 
   return true;
 }
-bool JsonAPI::ParseDeviceInfoJsonResponse(int code, const cJSON* root, JsonAPI::DeviceInfoResponse& out) {
-  (void)code;
 
-  if (cJSON_IsObject(root) == 0) {
-    ESP_LOGJSONE("not an object", root);
-    return false;
+bool JsonAPI::DeviceInfoJsonParser::onToken(const Token& token)
+{
+  if (token.depth == 0) {
+    if (!_isRootObjectToken(token)) {
+      ESP_LOGJSONE("not an object");
+      return false;
+    }
+    return true;
   }
 
-  const cJSON* data = cJSON_GetObjectItemCaseSensitive(root, "data");
-  if (cJSON_IsObject(data) == 0) {
-    ESP_LOGJSONE("value at 'data' is not an object", root);
-    return false;
+  if (token.depth == 1) {
+    if (!_trackDataObject(token, m_inData, m_seen, 1 << 0)) {
+      ESP_LOGJSONE("value at 'data' is not an object");
+      return false;
+    }
+    return true;
   }
 
-  const cJSON* deviceId = cJSON_GetObjectItemCaseSensitive(data, "id");
-  if (cJSON_IsString(deviceId) == 0) {
-    ESP_LOGJSONE("value at 'data.id' is not a string", root);
-    return false;
+  if (!m_inData) {
+    return true;
   }
 
-  const cJSON* deviceName = cJSON_GetObjectItemCaseSensitive(data, "name");
-  if (cJSON_IsString(deviceName) == 0) {
-    ESP_LOGJSONE("value at 'data.name' is not a string", root);
-    return false;
+  if (token.depth > 2) {
+    return m_inShockers ? _onShockerToken(token) : true;
+  }
+
+  if (token.type == TokenType::ArrayEnd) {
+    m_inShockers = false;
+    return true;
+  }
+
+  if (token.key == "shockers"sv) {
+    if (token.type != TokenType::ArrayStart) {
+      ESP_LOGJSONE("value at 'data.shockers' is not an array");
+      return false;
+    }
+
+    m_inShockers = true;
+    m_seen |= 1 << 3;
+    return true;
   }
 
-  const cJSON* deviceShockers = cJSON_GetObjectItemCaseSensitive(data, "shockers");
-  if (cJSON_IsArray(deviceShockers) == 0) {
-    ESP_LOGJSONE("value at 'data.shockers' is not an array", root);
+  if (_matchStringField(token, "id"sv, m_out.deviceId, m_seen, 1 << 1) == FieldMatch::WrongType) {
+    ESP_LOGJSONE("value at 'data.id' is not a string");
+    return false;
+  }
+  if (_matchStringField(token, "name"sv, m_out.deviceName, m_seen, 1 << 2) == FieldMatch::WrongType) {
+    ESP_LOGJSONE("value at 'data.name' is not a string");
     return false;
   }
 
-  out = {};
+  return true;
+}
+bool JsonAPI::DeviceInfoJsonParser::_onShockerToken(const Token& token)
+{
+  if (token.depth == 3) {
+    if (token.type == TokenType::ObjectStart) {
+      m_out.shockers.push_back({});
+      m_shockerSeen = 0;
+      return true;
+    }
 
-  out.deviceId   = deviceId->valuestring;
-  out.deviceName = deviceName->valuestring;
+    if (token.type == TokenType::ObjectEnd) {
+      if (m_shockerSeen != 0b111) {
+        ESP_LOGJSONE("shocker is missing one of 'id', 'rfId' or 'model'");
+        return false;
+      }
+      return true;
+    }
 
-  if (out.deviceId.empty() || out.deviceName.empty()) {
-    ESP_LOGJSONE("value at 'data.id' or 'data.name' is empty", root);
+    ESP_LOGJSONE("value in 'data.shockers' is not an object");
     return false;
   }
 
-  cJSON* shocker = nullptr;
-  cJSON_ArrayForEach(shocker, deviceShockers) {
-    const cJSON* shockerId = cJSON_GetObjectItemCaseSensitive(shocker, "id");
-    if (cJSON_IsString(shockerId) == 0) {
-      ESP_LOGJSONE("value at 'shocker.id' is not a string", shocker);
+  if (token.depth != 4) {
+    return true;
+  }
+
+  DeviceInfoResponse::ShockerInfo& shocker = m_out.shockers.back();
+
+  if (token.key == "id"sv) {
+    if (token.type != TokenType::String) {
+      ESP_LOGJSONE("value at 'shocker.id' is not a string");
       return false;
     }
-    const char* shockerIdStr = shockerId->valuestring;
-
-    if (shockerIdStr == nullptr || shockerIdStr[0] == '\0') {
-      ESP_LOGJSONE("value at 'shocker.id' is empty", shocker);
+    if (token.value.empty()) {
+      ESP_LOGJSONE("value at 'shocker.id' is empty");
       return false;
     }
 
-    const cJSON* shockerRfId = cJSON_GetObjectItemCaseSensitive(shocker, "rfId");
-    if (cJSON_IsNumber(shockerRfId) == 0) {
-      ESP_LOGJSONE("value at 'shocker.rfId' is not a number", shocker);
+    shocker.id.assign(token.value.data(), token.value.size());
+    m_shockerSeen |= 1 << 0;
+    return true;
+  }
+
+  if (token.key == "rfId"sv) {
+    if (token.type != TokenType::Number) {
+      ESP_LOGJSONE("value at 'shocker.rfId' is not a number");
       return false;
     }
-    int shockerRfIdInt = shockerRfId->valueint;
-    if (shockerRfIdInt < 0 || shockerRfIdInt > UINT16_MAX) {
-      ESP_LOGJSONE("value at 'shocker.rfId' is not a valid uint16_t", shocker);
+    if (!JsonStream::NumberToInteger(token.value, shocker.rfId, OpenShock::Convert::ToUint16)) {
+      ESP_LOGJSONE("value at 'shocker.rfId' is not a valid uint16_t");
       return false;
     }
-    uint16_t shockerRfIdU16 = static_cast<uint16_t>(shockerRfIdInt);
 
-    const cJSON* shockerModel = cJSON_GetObjectItemCaseSensitive(shocker, "model");
-    if (cJSON_IsString(shockerModel) == 0) {
-      ESP_LOGJSONE("value at 'shocker.model' is not a string", shocker);
+    m_shockerSeen |= 1 << 1;
+    return true;
+  }
+
+  if (token.key == "model"sv) {
+    if (token.type != TokenType::String) {
+      ESP_LOGJSONE("value at 'shocker.model' is not a string");
       return false;
     }
-    const char* shockerModelStr = shockerModel->valuestring;
-
-    if (shockerModelStr == nullptr || shockerModelStr[0] == '\0') {
-      ESP_LOGJSONE("value at 'shocker.model' is empty", shocker);
+    if (token.value.empty()) {
+      ESP_LOGJSONE("value at 'shocker.model' is empty");
       return false;
     }
-
-    OpenShock::ShockerModelType shockerModelType;
-    if (!OpenShock::ShockerModelTypeFromString(shockerModelStr, shockerModelType, true)) {  // PetTrainer is a typo in the API, we pass true to allow it
-      ESP_LOGJSONE("value at 'shocker.model' is not a valid shocker model", shocker);
+    if (!OpenShock::ShockerModelTypeFromString(token.value.data(), shocker.model, true)) {  // PetTrainer is a typo in the API, we pass true to allow it
+      ESP_LOGJSONE("value at 'shocker.model' is not a valid shocker model");
       return false;
     }
 
-    out.shockers.push_back({.id = shockerIdStr, .rfId = shockerRfIdU16, .model = shockerModelType});
+    m_shockerSeen |= 1 << 2;
+    return true;
   }
 
   return true;
 }
-bool JsonAPI::ParseAssignLcgJsonResponse(int code, const cJSON* root, JsonAPI::AssignLcgResponse& out) {
-  (void)code;
-
-  if (cJSON_IsObject(root) == 0) {
-    ESP_LOGJSONE("not an object", root);
+bool JsonAPI::DeviceInfoJsonParser::onEnd()
+{
+  if (m_seen != 0b1111) {
+    ESP_LOGJSONE("missing one of 'data', 'data.id', 'data.name' or 'data.shockers'");
     return false;
   }
 
-  const cJSON* data = cJSON_GetObjectItemCaseSensitive(root, "data");
-  if (cJSON_IsObject(data) == 0) {
-    ESP_LOGJSONE("value at 'data' is not an object", root);
+  if (m_out.deviceId.empty() || m_out.deviceName.empty()) {
+    ESP_LOGJSONE("value at 'data.id' or 'data.name' is empty");
     return false;
   }
 
-  const cJSON* fqdn    = cJSON_GetObjectItemCaseSensitive(data, "fqdn");
-  const cJSON* country = cJSON_GetObjectItemCaseSensitive(data, "country");
+  return true;
+}
 
-  if (cJSON_IsString(fqdn) == 0 || cJSON_IsString(country) == 0) {
-    ESP_LOGJSONE("value at 'data.fqdn' or 'data.country' is not a string", root);
-    return false;
+bool JsonAPI::AssignLcgJsonParser::onToken(const Token& token)
+{
+  if (token.depth == 0) {
+    if (!_isRootObjectToken(token)) {
+      ESP_LOGJSONE("not an object");
+      return false;
+    }
+    return true;
   }
 
-  out = {};
+  if (token.depth == 1) {
+    if (!_trackDataObject(token, m_inData, m_seen, 1 << 0)) {
+      ESP_LOGJSONE("value at 'data' is not an object");
+      return false;
+    }
+    return true;
+  }
+
+  if (token.depth != 2 || !m_inData) {
+    return true;
+  }
+
+  if (_matchStringField(token, "fqdn"sv, m_out.fqdn, m_seen, 1 << 1) == FieldMatch::WrongType || _matchStringField(token, "country"sv, m_out.country, m_seen, 1 << 2) == FieldMatch::WrongType) {
+    ESP_LOGJSONE("value at 'data.fqdn' or 'data.country' is not a string");
+    return false;
+  }
 
-  out.fqdn    = fqdn->valuestring;
-  out.country = country->valuestring;
+  return true;
+}
+bool JsonAPI::AssignLcgJsonParser::onEnd()
+{
+  if (m_seen != 0b111) {
+    ESP_LOGJSONE("missing one of 'data', 'data.fqdn' or 'data.country'");
+    return false;
+  }
 
   return true;
 }
@@ -0,0 +1,651 @@
+#include "serialization/JsonStream.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace OpenShock::Serialization::JsonStream;
+
+constexpr bool _isWhiteSpace(uint8_t c)
+{
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+constexpr bool _isNumberChar(uint8_t c)
+{
+  return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+constexpr int8_t _hexValue(uint8_t c)
+{
+  if (c >= '0' && c <= '9') return static_cast<int8_t>(c - '0');
+  if (c >= 'a' && c <= 'f') return static_cast<int8_t>(c - 'a' + 10);
+  if (c >= 'A' && c <= 'F') return static_cast<int8_t>(c - 'A' + 10);
+  return -1;
+}
+
+bool OpenShock::Serialization::JsonStream::NumberToIntegralDouble(std::string_view number, double& out)
+{
+  char buffer[32];
+  if (number.empty() || number.size() >= sizeof(buffer)) {
+    return false;
+  }
+
+  // strtod also takes hex, infinity and leading white space, none of which are JSON numbers
+  for (char c : number) {
+    if (!_isNumberChar(static_cast<uint8_t>(c))) {
+      return false;
+    }
+  }
+
+  memcpy(buffer, number.data(), number.size());
+  buffer[number.size()] = '\0';
+
+  char* end;
+  double value = strtod(buffer, &end);
+  if (end != buffer + number.size() || std::trunc(value) != value) {
+    return false;
+  }
+
+  out = value;
+
+  return true;
+}
+
+Parser::Parser(Handler& handler)
+  : m_handler(handler)
+{
+  reset();
+}
+
+void Parser::reset()
+{
+  m_state         = State::Value;
+  m_depth         = 0;
+  m_objectBits    = 0;
+  m_stringIsKey   = false;
+  m_hasKey        = false;
+  m_unicodeDigits = 0;
+  m_unicodeValue  = 0;
+  m_highSurrogate = 0;
+  m_literal       = nullptr;
+  m_literalPos    = 0;
+  m_literalType   = TokenType::Null;
+  m_keyLen        = 0;
+  m_valueLen      = 0;
+  m_key[0]        = '\0';
+  m_value[0]      = '\0';
+}
+
+Parser::Result Parser::feed(const uint8_t* data, std::size_t len)
+{
+  for (std::size_t i = 0; i < len; ++i) {
+    if (!_consume(data[i])) {
+      break;
+    }
+  }
+
+  switch (m_state) {
+    case State::Done:
+      return Result::Done;
+    case State::Invalid:
+      return Result::Invalid;
+    case State::Cancelled:
+      return Result::Cancelled;
+    default:
+      return Result::NeedMoreData;
+  }
+}
+
+Parser::Result Parser::finish()
+{
+  // A root-level number has no terminator, so it can only be completed here
+  if (m_state == State::Number && m_depth == 0) {
+    _endNumber();
+  }
+
+  switch (m_state) {
+    case State::Done:
+      if (!m_handler.onEnd()) {
+        m_state = State::Invalid;
+        return Result::Invalid;
+      }
+      return Result::Done;
+    case State::Cancelled:
+      return Result::Cancelled;
+    default:
+      m_state = State::Invalid;
+      return Result::Invalid;
+  }
+}
+
+bool Parser::_consume(uint8_t c)
+{
+  switch (m_state) {
+    case State::Value:
+      if (_isWhiteSpace(c)) return true;
+      return _beginValue(c);
+    case State::ValueOrArrayEnd:
+      if (_isWhiteSpace(c)) return true;
+      if (c == ']') return _endContainer(false);
+      return _beginValue(c);
+    case State::KeyOrObjectEnd:
+      if (_isWhiteSpace(c)) return true;
+      if (c == '}') return _endContainer(true);
+      [[fallthrough]];
+    case State::Key:
+      if (_isWhiteSpace(c)) return true;
+      if (c != '"') break;
+      m_state       = State::String;
+      m_stringIsKey = true;
+      m_keyLen      = 0;
+      return true;
+    case State::Colon:
+      if (_isWhiteSpace(c)) return true;
+      if (c != ':') break;
+      m_state = State::Value;
+      return true;
+    case State::CommaOrEnd:
+      if (_isWhiteSpace(c)) return true;
+      if (c == ',') {
+        m_state = _inObject() ? State::Key : State::Value;
+        return true;
+      }
+      if (c == '}' && _inObject()) return _endContainer(true);
+      if (c == ']' && !_inObject()) return _endContainer(false);
+      break;
+    case State::String:
+      if (c == '"') {
+        if (m_highSurrogate != 0) break;  // Unpaired surrogate
+
+        if (m_stringIsKey) {
+          m_key[m_keyLen] = '\0';
+          m_hasKey        = true;
+          m_state         = State::Colon;
+          return true;
+        }
+
+        m_value[m_valueLen] = '\0';
+        if (!_emit(TokenType::String, std::string_view(m_value, m_valueLen))) return false;
+        return _endValue();
+      }
+      if (c == '\\') {
+        m_state = State::StringEscape;
+        return true;
+      }
+      if (c < 0x20 || m_highSurrogate != 0) break;  // Unescaped control character, or unpaired surrogate
+      if (!_appendChar(static_cast<char>(c))) break;
+      return true;
+    case State::StringEscape: {
+      char unescaped;
+      switch (c) {
+        case '"':
+        case '\\':
+        case '/':
+          unescaped = static_cast<char>(c);
+          break;
+        case 'b':
+          unescaped = '\b';
+          break;
+        case 'f':
+          unescaped = '\f';
+          break;
+        case 'n':
+          unescaped = '\n';
+          break;
+        case 'r':
+          unescaped = '\r';
+          break;
+        case 't':
+          unescaped = '\t';
+          break;
+        case 'u':
+          m_state         = State::StringUnicode;
+          m_unicodeDigits = 0;
+          m_unicodeValue  = 0;
+          return true;
+        default:
+          m_state = State::Invalid;
+          return false;
+      }
+      if (m_highSurrogate != 0 || !_appendChar(unescaped)) break;
+      m_state = State::String;
+      return true;
+    }
+    case State::StringUnicode: {
+      int8_t digit = _hexValue(c);
+      if (digit < 0) break;
+
+      m_unicodeValue = (m_unicodeValue << 4) | static_cast<uint32_t>(digit);
+      if (++m_unicodeDigits < 4) return true;
+
+      m_state = State::String;
+
+      if (m_unicodeValue >= 0xD800 && m_unicodeValue <= 0xDBFF) {
+        if (m_highSurrogate != 0) break;
+        m_highSurrogate = static_cast<uint16_t>(m_unicodeValue);
+        return true;
+      }
+
+      if (m_unicodeValue >= 0xDC00 && m_unicodeValue <= 0xDFFF) {
+        if (m_highSurrogate == 0) break;
+        uint32_t codepoint = 0x10000 + ((static_cast<uint32_t>(m_highSurrogate) - 0xD800) << 10) + (m_unicodeValue - 0xDC00);
+        m_highSurrogate    = 0;
+        if (!_appendCodepoint(codepoint)) break;
+        return true;
+      }
+
+      if (m_highSurrogate != 0 || !_appendCodepoint(m_unicodeValue)) break;
+      return true;
+    }
+    case State::Number:
+      if (_isNumberChar(c)) {
+        if (!_appendChar(static_cast<char>(c))) break;
+        return true;
+      }
+      // The terminating character belongs to the enclosing structure, so reprocess it
+      if (!_endNumber()) return false;
+      return _consume(c);
+    case State::Literal:
+      if (c != static_cast<uint8_t>(m_literal[m_literalPos])) break;
+      if (m_literal[++m_literalPos] != '\0') return true;
+      if (!_emit(m_literalType)) return false;
+      return _endValue();
+    case State::Done:
+      if (_isWhiteSpace(c)) return true;
+      break;
+    case State::Invalid:
+    case State::Cancelled:
+    default:
+      return false;
+  }
+
+  m_state = State::Invalid;
+  return false;
+}
+
+bool Parser::_beginValue(uint8_t c)
+{
+  switch (c) {
+    case '{':
+    case '[':
+      if (m_depth >= MaxDepth) break;
+      if (!_emit(c == '{' ? TokenType::ObjectStart : TokenType::ArrayStart)) return false;
+      if (c == '{') {
+        m_objectBits |= 1UL << m_depth;
+        m_state = State::KeyOrObjectEnd;
+      } else {
+        m_objectBits &= ~(1UL << m_depth);
+        m_state = State::ValueOrArrayEnd;
+      }
+      ++m_depth;
+      return true;
+    case '"':
+      m_state       = State::String;
+      m_stringIsKey = false;
+      m_valueLen    = 0;
+      return true;
+    case 't':
+      m_state       = State::Literal;
+      m_literal     = "true";
+      m_literalPos  = 1;
+      m_literalType = TokenType::True;
+      return true;
+    case 'f':
+      m_state       = State::Literal;
+      m_literal     = "false";
+      m_literalPos  = 1;
+      m_literalType = TokenType::False;
+      return true;
+    case 'n':
+      m_state       = State::Literal;
+      m_literal     = "null";
+      m_literalPos  = 1;
+      m_literalType = TokenType::Null;
+      return true;
+    default:
+      if (c == '-' || (c >= '0' && c <= '9')) {
+        m_state    = State::Number;
+        m_valueLen = 0;
+        return _appendChar(static_cast<char>(c));
+      }
+      break;
+  }
+
+  m_state = State::Invalid;
+  return false;
+}
+
+bool Parser::_endValue()
+{
+  m_literal = nullptr;
+  m_state   = m_depth == 0 ? State::Done : State::CommaOrEnd;
+  return true;
+}
+
+bool Parser::_endNumber()
+{
+  m_value[m_valueLen] = '\0';
+
+  // Character set is already restricted, strtod catches misplaced signs, dots and exponents
+  char* end = nullptr;
+  strtod(m_value, &end);
+  if (end != m_value + m_valueLen) {
+    m_state = State::Invalid;
+    return false;
+  }
+
+  if (!_emit(TokenType::Number, std::string_view(m_value, m_valueLen))) return false;
+  return _endValue();
+}
+
+bool Parser::_endContainer(bool isObject)
+{
+  --m_depth;
+  m_hasKey = false;
+  if (!_emit(isObject ? TokenType::ObjectEnd : TokenType::ArrayEnd)) return false;
+  return _endValue();
+}
+
+bool Parser::_appendChar(char c)
+{
+  if (m_stringIsKey && m_state != State::Number) {
+    if (m_keyLen >= MaxKeyLength) {
+      m_state = State::Invalid;
+      return false;
+    }
+    m_key[m_keyLen++] = c;
+    return true;
+  }
+
+  if (m_valueLen >= MaxValueLength) {
+    m_state = State::Invalid;
+    return false;
+  }
+  m_value[m_valueLen++] = c;
+  return true;
+}
+
+bool Parser::_appendCodepoint(uint32_t codepoint)
+{
+  if (codepoint < 0x80) {
+    return _appendChar(static_cast<char>(codepoint));
+  }
+  if (codepoint < 0x800) {
+    return _appendChar(static_cast<char>(0xC0 | (codepoint >> 6))) && _appendChar(static_cast<char>(0x80 | (codepoint & 0x3F)));
+  }
+  if (codepoint < 0x10000) {
+    return _appendChar(static_cast<char>(0xE0 | (codepoint >> 12))) && _appendChar(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F))) && _appendChar(static_cast<char>(0x80 | (codepoint & 0x3F)));
+  }
+  return _appendChar(static_cast<char>(0xF0 | (codepoint >> 18))) && _appendChar(static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F))) && _appendChar(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)))
+      && _appendChar(static_cast<char>(0x80 | (codepoint & 0x3F)));
+}
+
+bool Parser::_emit(TokenType type, std::string_view value)
+{
+  Token token;
+  token.type  = type;
+  token.depth = m_depth;
+  token.key   = m_hasKey ? std::string_view(m_key, m_keyLen) : std::string_view();
+  token.value = value.data() != nullptr ? value : std::string_view("", 0);
+
+  m_hasKey = false;
+
+  if (!m_handler.onToken(token)) {
+    m_state = State::Cancelled;
+    return false;
+  }
+
+  return true;
+}
+
+Writer::Writer(Sink sink)
+  : m_sink(std::move(sink))
+  , m_failed(false)
+  , m_hasKey(false)
+  , m_done(false)
+  , m_depth(0)
+  , m_objectBits(0)
+  , m_hasMemberBits(0)
+  , m_bufferLen(0)
+  , m_buffer()
+{
+}
+
+void Writer::key(std::string_view key)
+{
+  bool inObject = m_depth > 0 && (m_objectBits & (1UL << (m_depth - 1))) != 0;
+  if (m_failed || !inObject || m_hasKey) {
+    m_failed = true;
+    return;
+  }
+
+  uint32_t bit = 1UL << (m_depth - 1);
+  if ((m_hasMemberBits & bit) != 0) {
+    _writeChar(',');
+  }
+  m_hasMemberBits |= bit;
+
+  _writeChar('"');
+  _writeEscaped(key);
+  _writeRaw("\":");
+
+  m_hasKey = true;
+}
+
+void Writer::beginObject()
+{
+  if (!_beginValue()) {
+    return;
+  }
+
+  if (m_depth >= MaxDepth) {
+    m_failed = true;
+    return;
+  }
+
+  _writeChar('{');
+
+  uint32_t bit = 1UL << m_depth;
+  m_objectBits |= bit;
+  m_hasMemberBits &= ~bit;
+  m_depth++;
+}
+
+void Writer::endObject()
+{
+  _endContainer(true);
+}
+
+void Writer::beginArray()
+{
+  if (!_beginValue()) {
+    return;
+  }
+
+  if (m_depth >= MaxDepth) {
+    m_failed = true;
+    return;
+  }
+
+  _writeChar('[');
+
+  uint32_t bit = 1UL << m_depth;
+  m_objectBits &= ~bit;
+  m_hasMemberBits &= ~bit;
+  m_depth++;
+}
+
+void Writer::endArray()
+{
+  _endContainer(false);
+}
+
+void Writer::string(std::string_view value)
+{
+  if (!_beginValue()) {
+    return;
+  }
+
+  _writeChar('"');
+  _writeEscaped(value);
+  _writeChar('"');
+
+  m_done = m_depth == 0;
+}
+
+void Writer::number(int64_t value)
+{
+  if (!_beginValue()) {
+    return;
+  }
+
+  char buffer[24];
+  int len = snprintf(buffer, sizeof(buffer), "%lld", static_cast<long long>(value));
+
+  _writeRaw(std::string_view(buffer, static_cast<std::size_t>(len)));
+
+  m_done = m_depth == 0;
+}
+
+void Writer::boolean(bool value)
+{
+  if (!_beginValue()) {
+    return;
+  }
+
+  _writeRaw(value ? "true" : "false");
+
+  m_done = m_depth == 0;
+}
+
+void Writer::null()
+{
+  if (!_beginValue()) {
+    return;
+  }
+
+  _writeRaw("null");
+
+  m_done = m_depth == 0;
+}
+
+bool Writer::finish()
+{
+  if (!m_done) {
+    m_failed = true;
+  }
+
+  _flush();
+
+  return !m_failed;
+}
+
+/// @brief Checks a value may be written here (after a key in objects, anywhere in arrays, once at the root) and writes the separating comma
+bool Writer::_beginValue()
+{
+  if (m_failed || m_done) {
+    m_failed = true;
+    return false;
+  }
+
+  if (m_depth == 0) {
+    return true;
+  }
+
+  uint32_t bit = 1UL << (m_depth - 1);
+
+  if ((m_objectBits & bit) != 0) {
+    if (!m_hasKey) {
+      m_failed = true;
+      return false;
+    }
+
+    m_hasKey = false;
+    return true;
+  }
+
+  if ((m_hasMemberBits & bit) != 0) {
+    _writeChar(',');
+  }
+  m_hasMemberBits |= bit;
+
+  return true;
+}
+
+void Writer::_endContainer(bool isObject)
+{
+  if (m_failed || m_depth == 0 || m_hasKey || ((m_objectBits & (1UL << (m_depth - 1))) != 0) != isObject) {
+    m_failed = true;
+    return;
+  }
+
+  _writeChar(isObject ? '}' : ']');
+
+  m_depth--;
+  m_done = m_depth == 0;
+}
+
+void Writer::_writeRaw(std::string_view data)
+{
+  for (char c : data) {
+    _writeChar(c);
+  }
+}
+
+void Writer::_writeChar(char c)
+{
+  if (m_bufferLen == sizeof(m_buffer)) {
+    _flush();
+  }
+
+  m_buffer[m_bufferLen++] = c;
+}
+
+void Writer::_writeEscaped(std::string_view str)
+{
+  static const char HexChars[] = "0123456789abcdef";
+
+  for (char c : str) {
+    switch (c) {
+      case '"':
+        _writeRaw("\\\"");
+        break;
+      case '\\':
+        _writeRaw("\\\\");
+        break;
+      case '\n':
+        _writeRaw("\\n");
+        break;
+      case '\r':
+        _writeRaw("\\r");
+        break;
+      case '\t':
+        _writeRaw("\\t");
+        break;
+      default:
+        if (static_cast<uint8_t>(c) < 0x20) {
+          _writeRaw("\\u00");
+          _writeChar(HexChars[static_cast<uint8_t>(c) >> 4]);
+          _writeChar(HexChars[static_cast<uint8_t>(c) & 0xF]);
+        } else {
+          _writeChar(c);
+        }
+        break;
+    }
+  }
+}
+
+void Writer::_flush()
+{
+  if (m_bufferLen == 0) {
+    return;
+  }
+
+  if (!m_failed && !m_sink(m_buffer, m_bufferLen)) {
+    m_failed = true;
+  }
+
+  m_bufferLen = 0;
+}
@@ -5,10 +5,13 @@ const char* const TAG = "WSGateway";
 #include "config/Config.h"
 #include "Logging.h"
 #include "Time.h"
+#include "util/HeapTracker.h"
 
 using namespace OpenShock::Serialization;
 
 bool Gateway::SerializeKeepAliveMessage(Common::SerializationCallbackFn callback) {
+  OS_HEAP_SITE(TAG);
+
   flatbuffers::FlatBufferBuilder builder(256);  // TODO: Profile this and adjust the size accordingly
 
   int64_t uptime = OpenShock::millis();
@@ -30,9 +33,11 @@ bool Gateway::SerializeKeepAliveMessage(Common::SerializationCallbackFn callback
 }
 
 bool Gateway::SerializeBootStatusMessage(int32_t updateId, OpenShock::FirmwareBootType bootType, const OpenShock::SemVer& version, Common::SerializationCallbackFn callback) {
+  OS_HEAP_SITE(TAG);
+
   flatbuffers::FlatBufferBuilder builder(256);  // TODO: Profile this and adjust the size accordingly
 
-  auto fbsVersion = Types::CreateSemVerDirect(builder, version.major, version.minor, version.patch, version.prerelease.data(), version.build.data());
+  auto fbsVersion = Types::CreateSemVerDirect(builder, version.major, version.minor, version.patch, version.prerelease, version.build);
 
   auto fbsBootStatus = Gateway::CreateBootStatus(builder, bootType, fbsVersion, updateId);
 
@@ -46,9 +51,11 @@ bool Gateway::SerializeBootStatusMessage(int32_t updateId, OpenShock::FirmwareBo
 }
 
 bool Gateway::SerializeOtaInstallStartedMessage(int32_t updateId, const OpenShock::SemVer& version, Common::SerializationCallbackFn callback) {
+  OS_HEAP_SITE(TAG);
+
   flatbuffers::FlatBufferBuilder builder(256);  // TODO: Profile this and adjust the size accordingly
 
-  auto versionOffset = Types::CreateSemVerDirect(builder, version.major, version.minor, version.patch, version.prerelease.data(), version.build.data());
+  auto versionOffset = Types::CreateSemVerDirect(builder, version.major, version.minor, version.patch, version.prerelease, version.build);
 
   auto otaInstallStartedOffset = Gateway::CreateOtaInstallStarted(builder, updateId, versionOffset);
 
@@ -62,6 +69,8 @@ bool Gateway::SerializeOtaInstallStartedMessage(int32_t updateId, const OpenShoc
 }
 
 bool Gateway::SerializeOtaInstallProgressMessage(int32_t updateId, Gateway::OtaInstallProgressTask task, float progress, Common::SerializationCallbackFn callback) {
+  OS_HEAP_SITE(TAG);
+
   flatbuffers::FlatBufferBuilder builder(64);  // TODO: Profile this and adjust the size accordingly
 
   auto otaInstallProgressOffset = Gateway::CreateOtaInstallProgress(builder, updateId, task, progress);
@@ -76,6 +85,8 @@ bool Gateway::SerializeOtaInstallProgressMessage(int32_t updateId, Gateway::OtaI
 }
 
 bool Gateway::SerializeOtaInstallFailedMessage(int32_t updateId, std::string_view message, bool fatal, Common::SerializationCallbackFn callback) {
+  OS_HEAP_SITE(TAG);
+
   flatbuffers::FlatBufferBuilder builder(256);  // TODO: Profile this and adjust the size accordingly
 
   auto messageOffset = builder.CreateString(message.data(), message.size());
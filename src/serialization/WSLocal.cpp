@@ -5,6 +5,7 @@ const char* const TAG = "WSLocal";
 #include "Chipset.h"
 #include "config/Config.h"
 #include "Logging.h"
+#include "util/HeapTracker.h"
 #include "util/HexUtils.h"
 #include "wifi/WiFiNetwork.h"
 
@@ -47,6 +48,8 @@ flatbuffers::Offset<OpenShock::Serialization::Types::WifiNetwork> _createWiFiNet
 }
 
 bool Local::SerializeErrorMessage(const char* message, Common::SerializationCallbackFn callback) {
+  OS_HEAP_SITE(TAG);
+
   flatbuffers::FlatBufferBuilder builder(256);  // TODO: Profile this and adjust the size accordingly
 
   auto wrapperOffset = Local::CreateErrorMessage(builder, builder.CreateString(message));
@@ -63,6 +66,8 @@ bool Local::SerializeErrorMessage(const char* message, Common::SerializationCall
 }
 
 bool Local::SerializeReadyMessage(const WiFiNetwork* connectedNetwork, bool accountLinked, Common::SerializationCallbackFn callback) {
+  OS_HEAP_SITE(TAG);
+
   flatbuffers::FlatBufferBuilder builder(256);
 
   flatbuffers::Offset<Serialization::Types::WifiNetwork> fbsNetwork = 0;
@@ -97,6 +102,8 @@ bool Local::SerializeReadyMessage(const WiFiNetwork* connectedNetwork, bool acco
 }
 
 bool Local::SerializeWiFiScanStatusChangedEvent(OpenShock::WiFiScanStatus status, Common::SerializationCallbackFn callback) {
+  OS_HEAP_SITE(TAG);
+
   flatbuffers::FlatBufferBuilder builder(32);  // TODO: Profile this and adjust the size accordingly
 
   auto scanStatusOffset = Serialization::Local::CreateWifiScanStatusMessage(builder, status);
@@ -111,6 +118,8 @@ bool Local::SerializeWiFiScanStatusChangedEvent(OpenShock::WiFiScanStatus status
 }
 
 bool Local::SerializeWiFiNetworkEvent(Types::WifiNetworkEventType eventType, const WiFiNetwork& network, Common::SerializationCallbackFn callback) {
+  OS_HEAP_SITE(TAG);
+
   flatbuffers::FlatBufferBuilder builder(256);  // TODO: Profile this and adjust the size accordingly
 
   auto networkOffset = _createWiFiNetwork(builder, network);
@@ -127,6 +136,8 @@ bool Local::SerializeWiFiNetworkEvent(Types::WifiNetworkEventType eventType, con
 }
 
 bool Local::SerializeWiFiNetworksEvent(Types::WifiNetworkEventType eventType, const std::vector<WiFiNetwork>& networks, Common::SerializationCallbackFn callback) {
+  OS_HEAP_SITE(TAG);
+
   flatbuffers::FlatBufferBuilder builder(256);  // TODO: Profile this and adjust the size accordingly
 
   std::vector<flatbuffers::Offset<Serialization::Types::WifiNetwork>> fbsNetworks;
@@ -0,0 +1,197 @@
+#include "util/DeltaPatcher.h"
+
+const char* const TAG = "DeltaPatcher";
+
+#include "Logging.h"
+
+#include <algorithm>
+#include <cstring>
+
+const char DELTA_PATCH_MAGIC[8]           = {'O', 'S', 'D', 'E', 'L', 'T', 'A', '1'};
+const std::size_t DELTA_PATCH_HEADER_SIZE = 8 + 4 + 4 + 32;
+const std::size_t DELTA_PATCH_RECORD_SIZE = 4 + 4 + 4;
+
+using namespace OpenShock;
+
+static uint32_t _readU32LE(const uint8_t* data)
+{
+  return static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8) | (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24);
+}
+
+DeltaPatcher::DeltaPatcher(ReadCallback readBase, HeaderCallback onHeader)
+  : m_readBase(std::move(readBase))
+  , m_onHeader(std::move(onHeader))
+  , m_state(State::Header)
+  , m_header({0, 0, {0}})
+  , m_scratch()
+  , m_scratchFill(0)
+  , m_baseOffset(0)
+  , m_targetOffset(0)
+  , m_diffRemaining(0)
+  , m_extraRemaining(0)
+  , m_seek(0)
+  , m_buffer()
+{
+}
+
+DeltaPatcher::Result DeltaPatcher::feed(const uint8_t* data, std::size_t len, const OutputCallback& onOutput)
+{
+  std::size_t pos = 0;
+
+  while (pos < len) {
+    switch (m_state) {
+      case State::Header:
+      case State::Control:
+      {
+        std::size_t needed = m_state == State::Header ? DELTA_PATCH_HEADER_SIZE : DELTA_PATCH_RECORD_SIZE;
+        std::size_t n      = std::min(needed - m_scratchFill, len - pos);
+
+        memcpy(m_scratch.data() + m_scratchFill, data + pos, n);
+        m_scratchFill += n;
+        pos += n;
+
+        if (m_scratchFill < needed) {
+          return Result::NeedMoreData;
+        }
+
+        m_scratchFill = 0;
+
+        if (m_state == State::Header) {
+          if (!parseHeader()) {
+            m_state = State::Invalid;
+            return Result::Invalid;
+          }
+          if (!m_onHeader(m_header)) {
+            m_state = State::Invalid;
+            return Result::BaseMismatch;
+          }
+          nextRecordOrDone();
+        } else if (!parseControl()) {
+          m_state = State::Invalid;
+          return Result::Invalid;
+        }
+        break;
+      }
+      case State::Diff:
+      {
+        std::size_t n = std::min({static_cast<std::size_t>(m_diffRemaining), len - pos, m_buffer.size()});
+
+        if (!m_readBase(m_baseOffset, m_buffer.data(), n)) {
+          OS_LOGE(TAG, "Failed to read base image at 0x%x", m_baseOffset);
+          m_state = State::Invalid;
+          return Result::Invalid;
+        }
+
+        for (std::size_t i = 0; i < n; ++i) {
+          m_buffer[i] += data[pos + i];
+        }
+
+        if (!onOutput(m_buffer.data(), n)) {
+          m_state = State::Invalid;
+          return Result::Cancelled;
+        }
+
+        pos += n;
+        m_baseOffset += n;
+        m_targetOffset += n;
+        m_diffRemaining -= n;
+
+        if (m_diffRemaining == 0) {
+          m_state = State::Extra;
+          if (m_extraRemaining == 0) {
+            nextRecordOrDone();
+          }
+        }
+        break;
+      }
+      case State::Extra:
+      {
+        std::size_t n = std::min(static_cast<std::size_t>(m_extraRemaining), len - pos);
+
+        if (!onOutput(data + pos, n)) {
+          m_state = State::Invalid;
+          return Result::Cancelled;
+        }
+
+        pos += n;
+        m_targetOffset += n;
+        m_extraRemaining -= n;
+
+        if (m_extraRemaining == 0) {
+          nextRecordOrDone();
+        }
+        break;
+      }
+      case State::Done:
+        OS_LOGE(TAG, "Unexpected data after end of patch");
+        m_state = State::Invalid;
+        return Result::Invalid;
+      default:
+        return Result::Invalid;
+    }
+  }
+
+  if (m_state == State::Invalid) {
+    return Result::Invalid;
+  }
+
+  return m_state == State::Done ? Result::Done : Result::NeedMoreData;
+}
+
+bool DeltaPatcher::parseHeader()
+{
+  if (memcmp(m_scratch.data(), DELTA_PATCH_MAGIC, sizeof(DELTA_PATCH_MAGIC)) != 0) {
+    OS_LOGE(TAG, "Not a delta patch");
+    return false;
+  }
+
+  m_header.baseSize   = _readU32LE(m_scratch.data() + 8);
+  m_header.targetSize = _readU32LE(m_scratch.data() + 12);
+  memcpy(m_header.baseHash, m_scratch.data() + 16, sizeof(m_header.baseHash));
+
+  return true;
+}
+
+bool DeltaPatcher::parseControl()
+{
+  m_diffRemaining  = _readU32LE(m_scratch.data());
+  m_extraRemaining = _readU32LE(m_scratch.data() + 4);
+  m_seek           = static_cast<int32_t>(_readU32LE(m_scratch.data() + 8));
+
+  std::size_t targetLeft = m_header.targetSize - m_targetOffset;
+  if (m_diffRemaining > targetLeft || m_extraRemaining > targetLeft - m_diffRemaining) {
+    OS_LOGE(TAG, "Patch record overruns target image");
+    return false;
+  }
+
+  if (m_diffRemaining > m_header.baseSize - m_baseOffset) {
+    OS_LOGE(TAG, "Patch record overruns base image");
+    return false;
+  }
+
+  if (m_diffRemaining > 0) {
+    m_state = State::Diff;
+  } else if (m_extraRemaining > 0) {
+    m_state = State::Extra;
+  } else {
+    nextRecordOrDone();
+  }
+
+  return true;
+}
+
+void DeltaPatcher::nextRecordOrDone()
+{
+  // Seek is applied once the record has been fully consumed, it may not leave the base image
+  int64_t baseOffset = static_cast<int64_t>(m_baseOffset) + m_seek;
+  m_seek             = 0;
+
+  if (baseOffset < 0 || baseOffset > static_cast<int64_t>(m_header.baseSize)) {
+    OS_LOGE(TAG, "Patch record seeks outside base image");
+    m_state = State::Invalid;
+    return;
+  }
+
+  m_baseOffset = static_cast<std::size_t>(baseOffset);
+  m_state      = m_targetOffset == m_header.targetSize ? State::Done : State::Control;
+}
@@ -0,0 +1,204 @@
+#include "util/GzipDecompressor.h"
+
+const char* const TAG = "GzipDecompressor";
+
+#include "Logging.h"
+
+#include <esp_heap_caps.h>
+#include <rom/miniz.h>
+
+#include <cstdlib>
+
+const uint8_t GZIP_MAGIC1         = 0x1F;
+const uint8_t GZIP_MAGIC2         = 0x8B;
+const uint8_t GZIP_METHOD         = 8;  // Deflate
+const uint8_t GZIP_FLAG_FHCRC     = 1 << 1;
+const uint8_t GZIP_FLAG_FEXTRA    = 1 << 2;
+const uint8_t GZIP_FLAG_FNAME     = 1 << 3;
+const uint8_t GZIP_FLAG_FCOMMENT  = 1 << 4;
+const uint8_t GZIP_FLAGS_RESERVED = 0xE0;
+const uint8_t GZIP_TRAILER_SIZE   = 8;  // CRC32 + ISIZE, the image is verified by its SHA-256 instead
+
+using namespace OpenShock;
+
+static void* _allocPreferPsram(std::size_t size)
+{
+  void* ptr = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  if (ptr == nullptr) {
+    ptr = malloc(size);
+  }
+
+  return ptr;
+}
+
+GzipDecompressor::GzipDecompressor()
+  : m_state(State::Magic1)
+  , m_afterSkip(State::Deflate)
+  , m_flags(0)
+  , m_skipRemaining(0)
+  , m_trailerRemaining(GZIP_TRAILER_SIZE)
+  , m_inflator(static_cast<tinfl_decompressor*>(_allocPreferPsram(sizeof(tinfl_decompressor))))
+  , m_dict(static_cast<uint8_t*>(_allocPreferPsram(TINFL_LZ_DICT_SIZE)))
+  , m_dictOffset(0)
+  , m_outputSize(0)
+{
+  if (!ok()) {
+    OS_LOGE(TAG, "Failed to allocate decompressor state");
+    return;
+  }
+
+  tinfl_init(m_inflator);
+}
+
+GzipDecompressor::~GzipDecompressor()
+{
+  free(m_inflator);
+  free(m_dict);
+}
+
+GzipDecompressor::Result GzipDecompressor::feed(const uint8_t* data, std::size_t len, const OutputCallback& onOutput)
+{
+  if (!ok() || m_state == State::Invalid) {
+    return Result::Invalid;
+  }
+
+  std::size_t pos = 0;
+
+  while (pos < len && m_state < State::Deflate) {
+    if (!consumeHeaderByte(data[pos++])) {
+      m_state = State::Invalid;
+      return Result::Invalid;
+    }
+  }
+
+  while (m_state == State::Deflate) {
+    std::size_t inBytes  = len - pos;
+    std::size_t outBytes = TINFL_LZ_DICT_SIZE - m_dictOffset;
+
+    tinfl_status status = tinfl_decompress(m_inflator, data + pos, &inBytes, m_dict, m_dict + m_dictOffset, &outBytes, TINFL_FLAG_HAS_MORE_INPUT);
+
+    pos += inBytes;
+
+    if (outBytes > 0) {
+      if (!onOutput(m_dict + m_dictOffset, outBytes)) {
+        m_state = State::Invalid;
+        return Result::Cancelled;
+      }
+
+      m_dictOffset = (m_dictOffset + outBytes) & (TINFL_LZ_DICT_SIZE - 1);
+      m_outputSize += outBytes;
+    }
+
+    if (status < TINFL_STATUS_DONE) {
+      OS_LOGE(TAG, "Deflate stream is corrupt (status %d)", status);
+      m_state = State::Invalid;
+      return Result::Invalid;
+    }
+
+    if (status == TINFL_STATUS_DONE) {
+      m_state = State::Trailer;
+      break;
+    }
+
+    if (status == TINFL_STATUS_NEEDS_MORE_INPUT && pos >= len) {
+      return Result::NeedMoreData;
+    }
+  }
+
+  // The inflater may have buffered a few trailer bytes already, so the trailer can be shorter than 8 bytes but never longer
+  if (m_state == State::Trailer || m_state == State::Done) {
+    std::size_t remaining = len - pos;
+    if (remaining > m_trailerRemaining) {
+      OS_LOGE(TAG, "Unexpected data after end of gzip stream");
+      m_state = State::Invalid;
+      return Result::Invalid;
+    }
+
+    m_trailerRemaining -= remaining;
+    if (m_trailerRemaining == 0) {
+      m_state = State::Done;
+    }
+
+    return Result::Done;
+  }
+
+  return Result::NeedMoreData;
+}
+
+bool GzipDecompressor::consumeHeaderByte(uint8_t c)
+{
+  switch (m_state) {
+    case State::Magic1:
+    case State::Magic2:
+      if (c != (m_state == State::Magic1 ? GZIP_MAGIC1 : GZIP_MAGIC2)) {
+        OS_LOGE(TAG, "Not a gzip stream");
+        return false;
+      }
+      m_state = m_state == State::Magic1 ? State::Magic2 : State::Method;
+      return true;
+    case State::Method:
+      if (c != GZIP_METHOD) {
+        OS_LOGE(TAG, "Unsupported compression method %u", c);
+        return false;
+      }
+      m_state = State::Flags;
+      return true;
+    case State::Flags:
+      if ((c & GZIP_FLAGS_RESERVED) != 0) {
+        OS_LOGE(TAG, "Reserved gzip header flags set");
+        return false;
+      }
+      m_flags         = c;
+      m_state         = State::Skip;
+      m_skipRemaining = 6;  // MTIME (4), XFL (1), OS (1)
+      m_afterSkip     = State::ExtraLen1;
+      return true;
+    case State::Skip:
+      if (--m_skipRemaining == 0) {
+        m_state = m_afterSkip;
+        advanceHeader();
+      }
+      return true;
+    case State::ExtraLen1:
+      m_skipRemaining = c;
+      m_state         = State::ExtraLen2;
+      return true;
+    case State::ExtraLen2:
+      m_skipRemaining |= static_cast<uint16_t>(c) << 8;
+      m_flags &= ~GZIP_FLAG_FEXTRA;
+      m_afterSkip = State::FileName;
+      m_state     = m_skipRemaining > 0 ? State::Skip : State::FileName;
+      advanceHeader();
+      return true;
+    case State::FileName:
+    case State::Comment:
+      if (c == '\0') {
+        m_flags &= m_state == State::FileName ? ~GZIP_FLAG_FNAME : ~GZIP_FLAG_FCOMMENT;
+        advanceHeader();
+      }
+      return true;
+    default:
+      return false;
+  }
+}
+
+/// @brief Moves past header sections whose flag is not set, once the state machine reaches them
+void GzipDecompressor::advanceHeader()
+{
+  if (m_state == State::ExtraLen1 && (m_flags & GZIP_FLAG_FEXTRA) == 0) {
+    m_state = State::FileName;
+  }
+  if (m_state == State::FileName && (m_flags & GZIP_FLAG_FNAME) == 0) {
+    m_state = State::Comment;
+  }
+  if (m_state == State::Comment && (m_flags & GZIP_FLAG_FCOMMENT) == 0) {
+    if ((m_flags & GZIP_FLAG_FHCRC) != 0) {
+      m_flags &= ~GZIP_FLAG_FHCRC;
+      m_state         = State::Skip;
+      m_skipRemaining = 2;
+      m_afterSkip     = State::Deflate;
+    } else {
+      m_state = State::Deflate;
+    }
+  }
+}
@@ -0,0 +1,534 @@
+#include "util/HeapTracker.h"
+
+const char* const TAG = "HeapTracker";
+
+#include "Logging.h"
+
+#include <esp_heap_caps.h>
+
+#if OPENSHOCK_HEAP_TRACKING
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#endif
+
+using namespace OpenShock;
+
+HeapTracker::HeapInfo HeapTracker::GetHeapInfo()
+{
+  return HeapInfo {
+    .freeBytes        = static_cast<uint32_t>(heap_caps_get_free_size(MALLOC_CAP_8BIT)),
+    .minFreeBytes     = static_cast<uint32_t>(heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT)),
+    .largestFreeBlock = static_cast<uint32_t>(heap_caps_get_largest_free_block(MALLOC_CAP_8BIT)),
+  };
+}
+
+#if OPENSHOCK_HEAP_TRACKING
+
+const uint32_t HEAP_TRACKING_LIVE_BITS          = 10;
+const std::size_t HEAP_TRACKING_MAX_LIVE        = 1 << HEAP_TRACKING_LIVE_BITS;   // 12KB of .bss
+const std::size_t HEAP_TRACKING_LIVE_LIMIT      = HEAP_TRACKING_MAX_LIVE * 3 / 4;  // Keeps probe sequences short
+const std::size_t HEAP_TRACKING_MAX_SITES       = 64;
+const std::size_t HEAP_TRACKING_TREND_SAMPLES   = 60;
+const int64_t HEAP_TRACKING_SAMPLE_INTERVAL_US  = 60'000'000;  // Together with the sample count, keeps the last hour
+
+// Everything below is constant-initialized, static constructors allocate before this unit could run any of its own
+
+struct LiveAllocation {
+  uintptr_t ptr;  // 0 if the slot is free
+  uint32_t size;
+  uint16_t site;
+};
+
+struct Site {
+  const char* tag;
+  uintptr_t pc;
+  uint32_t liveBytes;
+  uint32_t liveCount;
+  uint32_t allocs;
+  uint64_t allocBytes;
+  bool used;
+};
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;  // malloc can't take a mutex, it is called while creating them
+static LiveAllocation s_live[HEAP_TRACKING_MAX_LIVE];
+static Site s_sites[HEAP_TRACKING_MAX_SITES + 1];  // The last one collects every site that didn't fit
+static HeapTracker::Totals s_totals;
+static HeapTracker::TrendSample s_trend[HEAP_TRACKING_TREND_SAMPLES];
+static std::size_t s_trendCount        = 0;
+static std::size_t s_trendNext         = 0;
+static uint32_t s_lastSampleAllocs     = 0;
+static int64_t s_lastSampleTime        = 0;
+static esp_timer_handle_t s_trendTimer = nullptr;
+
+static thread_local const char* s_currentSite = nullptr;
+
+extern "C" {
+void* __real_malloc(std::size_t size);
+void* __real_calloc(std::size_t count, std::size_t size);
+void* __real_realloc(void* ptr, std::size_t size);
+void __real_free(void* ptr);
+}
+
+static uint32_t _hash(uintptr_t value)
+{
+  return static_cast<uint32_t>(value >> 2) * 2'654'435'761u;
+}
+
+static std::size_t _liveSlot(uintptr_t ptr)
+{
+  return _hash(ptr) >> (32 - HEAP_TRACKING_LIVE_BITS);
+}
+
+static uintptr_t _callerPc(void* returnAddress)
+{
+  uintptr_t pc = reinterpret_cast<uintptr_t>(returnAddress);
+#ifdef __XTENSA__
+  pc = (pc & 0x3FFF'FFFF) | 0x4000'0000;  // Windowed calls keep the caller's window size in the top bits
+#endif
+  return pc;
+}
+
+static const char* _currentSiteTag()
+{
+  // Static constructors allocate before the scheduler starts, there is no task whose site could be read yet
+  if (xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED) {
+    return nullptr;
+  }
+
+  return s_currentSite;
+}
+
+// Called with the lock held
+static uint16_t _findSite(const char* tag, uintptr_t pc)
+{
+  if (tag != nullptr) {
+    pc = 0;
+  }
+
+  std::size_t index = _hash(tag != nullptr ? reinterpret_cast<uintptr_t>(tag) : pc) % HEAP_TRACKING_MAX_SITES;
+  for (std::size_t i = 0; i < HEAP_TRACKING_MAX_SITES; i++) {
+    Site& site = s_sites[index];
+    if (!site.used) {
+      site.used = true;
+      site.tag  = tag;
+      site.pc   = pc;
+      return index;
+    }
+
+    if (site.tag == tag && site.pc == pc) {
+      return index;
+    }
+
+    index = (index + 1) % HEAP_TRACKING_MAX_SITES;
+  }
+
+  return HEAP_TRACKING_MAX_SITES;
+}
+
+// Called with the lock held
+static void _eraseLive(std::size_t index)
+{
+  // Backward shift deletion, moves later entries of the probe sequence into the gap so lookups never need tombstones
+  std::size_t next = index;
+  while (true) {
+    next = (next + 1) % HEAP_TRACKING_MAX_LIVE;
+    if (s_live[next].ptr == 0) {
+      break;
+    }
+
+    std::size_t home   = _liveSlot(s_live[next].ptr);
+    bool homeInBetween = index <= next ? (home > index && home <= next) : (home > index || home <= next);
+    if (!homeInBetween) {
+      s_live[index] = s_live[next];
+      index         = next;
+    }
+  }
+
+  s_live[index].ptr = 0;
+}
+
+// Called with the lock held
+static void _removeLive(std::size_t index)
+{
+  const LiveAllocation& entry = s_live[index];
+
+  Site& site = s_sites[entry.site];
+  site.liveBytes -= entry.size;
+  site.liveCount--;
+
+  s_totals.liveBytes -= entry.size;
+  s_totals.liveCount--;
+
+  _eraseLive(index);
+}
+
+// Called with the lock held
+static bool _insertLive(uintptr_t ptr, uint32_t size, uint16_t siteIndex)
+{
+  std::size_t index = _liveSlot(ptr);
+  while (s_live[index].ptr != 0) {
+    if (s_live[index].ptr == ptr) {
+      // Freed by something that doesn't go through the wrappers (e.g. ROM code), drop the stale entry
+      _removeLive(index);
+      return _insertLive(ptr, size, siteIndex);
+    }
+
+    index = (index + 1) % HEAP_TRACKING_MAX_LIVE;
+  }
+
+  if (s_totals.liveCount >= HEAP_TRACKING_LIVE_LIMIT) {
+    return false;
+  }
+
+  s_live[index] = {.ptr = ptr, .size = size, .site = siteIndex};
+
+  Site& site = s_sites[siteIndex];
+  site.liveBytes += size;
+  site.liveCount++;
+
+  s_totals.liveBytes += size;
+  s_totals.liveCount++;
+  s_totals.peakLiveBytes = std::max(s_totals.peakLiveBytes, s_totals.liveBytes);
+
+  return true;
+}
+
+static void _record(void* ptr, std::size_t size, uintptr_t pc)
+{
+  if (ptr == nullptr) {
+    return;
+  }
+
+  const char* tag = _currentSiteTag();
+
+  portENTER_CRITICAL_SAFE(&s_lock);
+
+  uint16_t siteIndex = _findSite(tag, pc);
+
+  Site& site = s_sites[siteIndex];
+  site.allocs++;
+  site.allocBytes += size;
+
+  s_totals.allocs++;
+  if (!_insertLive(reinterpret_cast<uintptr_t>(ptr), static_cast<uint32_t>(size), siteIndex)) {
+    s_totals.untracked++;
+  }
+
+  portEXIT_CRITICAL_SAFE(&s_lock);
+}
+
+// Must run before the memory is handed back, another task could otherwise allocate and record the same address first
+static bool _forget(void* ptr, LiveAllocation& out)
+{
+  if (ptr == nullptr) {
+    return false;
+  }
+
+  uintptr_t key = reinterpret_cast<uintptr_t>(ptr);
+  bool found    = false;
+
+  portENTER_CRITICAL_SAFE(&s_lock);
+
+  std::size_t index = _liveSlot(key);
+  while (s_live[index].ptr != 0) {
+    if (s_live[index].ptr == key) {
+      out = s_live[index];
+      _removeLive(index);
+      s_totals.frees++;
+      found = true;
+      break;
+    }
+
+    index = (index + 1) % HEAP_TRACKING_MAX_LIVE;
+  }
+
+  portEXIT_CRITICAL_SAFE(&s_lock);
+
+  return found;
+}
+
+static void _restore(const LiveAllocation& entry)
+{
+  portENTER_CRITICAL_SAFE(&s_lock);
+  s_totals.frees--;
+  _insertLive(entry.ptr, entry.size, entry.site);
+  portEXIT_CRITICAL_SAFE(&s_lock);
+}
+
+static void* _trackedMalloc(std::size_t size, uintptr_t pc)
+{
+  void* ptr = __real_malloc(size);
+  _record(ptr, size, pc);
+  return ptr;
+}
+
+static void _trackedFree(void* ptr)
+{
+  LiveAllocation entry;
+  _forget(ptr, entry);
+  __real_free(ptr);
+}
+
+extern "C" {
+void* __wrap_malloc(std::size_t size)
+{
+  return _trackedMalloc(size, _callerPc(__builtin_return_address(0)));
+}
+
+void* __wrap_calloc(std::size_t count, std::size_t size)
+{
+  void* ptr = __real_calloc(count, size);
+  _record(ptr, count * size, _callerPc(__builtin_return_address(0)));
+  return ptr;
+}
+
+void* __wrap_realloc(void* ptr, std::size_t size)
+{
+  LiveAllocation entry;
+  bool wasTracked = _forget(ptr, entry);
+
+  void* newPtr = __real_realloc(ptr, size);
+  if (newPtr == nullptr && size != 0) {
+    // The old block is still allocated
+    if (wasTracked) {
+      _restore(entry);
+    }
+    return nullptr;
+  }
+
+  _record(newPtr, size, _callerPc(__builtin_return_address(0)));
+
+  return newPtr;
+}
+
+void __wrap_free(void* ptr)
+{
+  _trackedFree(ptr);
+}
+}
+
+// Replacing the global operators attributes allocations to the code calling new, not to the operator itself
+
+static void* _trackedNew(std::size_t size, uintptr_t pc)
+{
+  void* ptr = _trackedMalloc(size == 0 ? 1 : size, pc);
+  if (ptr == nullptr) {
+#if __cpp_exceptions
+    throw std::bad_alloc();
+#else
+    abort();
+#endif
+  }
+
+  return ptr;
+}
+
+void* operator new(std::size_t size)
+{
+  return _trackedNew(size, _callerPc(__builtin_return_address(0)));
+}
+
+void* operator new[](std::size_t size)
+{
+  return _trackedNew(size, _callerPc(__builtin_return_address(0)));
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+  return _trackedMalloc(size == 0 ? 1 : size, _callerPc(__builtin_return_address(0)));
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+  return _trackedMalloc(size == 0 ? 1 : size, _callerPc(__builtin_return_address(0)));
+}
+
+void operator delete(void* ptr) noexcept
+{
+  _trackedFree(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+  _trackedFree(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+  _trackedFree(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+  _trackedFree(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+  _trackedFree(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept
+{
+  _trackedFree(ptr);
+}
+
+HeapTracker::ScopedSite::ScopedSite(const char* tag)
+  : m_previous(s_currentSite)
+{
+  s_currentSite = tag;
+}
+
+HeapTracker::ScopedSite::~ScopedSite()
+{
+  s_currentSite = m_previous;
+}
+
+static void _sampleTrend(void* arg)
+{
+  (void)arg;
+
+  // Walks the heap under its own lock, so it can't run inside ours
+  HeapTracker::HeapInfo info = HeapTracker::GetHeapInfo();
+  int64_t now                = esp_timer_get_time();
+
+  portENTER_CRITICAL_SAFE(&s_lock);
+
+  int64_t elapsed          = now - s_lastSampleTime;
+  uint32_t allocs          = s_totals.allocs - s_lastSampleAllocs;
+  uint32_t allocsPerMinute = elapsed > 0 ? static_cast<uint32_t>(static_cast<int64_t>(allocs) * 60'000'000 / elapsed) : 0;
+
+  s_trend[s_trendNext] = {
+    .uptimeS          = static_cast<uint32_t>(now / 1'000'000),
+    .freeBytes        = info.freeBytes,
+    .largestFreeBlock = info.largestFreeBlock,
+    .liveBytes        = s_totals.liveBytes,
+    .allocsPerMinute  = allocsPerMinute,
+  };
+
+  s_trendNext  = (s_trendNext + 1) % HEAP_TRACKING_TREND_SAMPLES;
+  s_trendCount = std::min(s_trendCount + 1, HEAP_TRACKING_TREND_SAMPLES);
+
+  s_lastSampleAllocs = s_totals.allocs;
+  s_lastSampleTime   = now;
+
+  portEXIT_CRITICAL_SAFE(&s_lock);
+}
+
+bool HeapTracker::Init()
+{
+  if (s_trendTimer != nullptr) {
+    return true;
+  }
+
+  esp_timer_create_args_t args = {
+    .callback              = _sampleTrend,
+    .arg                   = nullptr,
+    .dispatch_method       = ESP_TIMER_TASK,
+    .name                  = "heap_trend",
+    .skip_unhandled_events = true,
+  };
+
+  esp_err_t err = esp_timer_create(&args, &s_trendTimer);
+  if (err != ESP_OK) {
+    OS_LOGE(TAG, "Failed to create heap trend timer: %s", esp_err_to_name(err));
+    s_trendTimer = nullptr;
+    return false;
+  }
+
+  err = esp_timer_start_periodic(s_trendTimer, HEAP_TRACKING_SAMPLE_INTERVAL_US);
+  if (err != ESP_OK) {
+    OS_LOGE(TAG, "Failed to start heap trend timer: %s", esp_err_to_name(err));
+    esp_timer_delete(s_trendTimer);
+    s_trendTimer = nullptr;
+    return false;
+  }
+
+  OS_LOGI(TAG, "Tracking allocations, %zu live allocations fit before they go untracked", HEAP_TRACKING_LIVE_LIMIT);
+
+  return true;
+}
+
+HeapTracker::Totals HeapTracker::GetTotals()
+{
+  portENTER_CRITICAL_SAFE(&s_lock);
+  Totals totals = s_totals;
+  portEXIT_CRITICAL_SAFE(&s_lock);
+
+  return totals;
+}
+
+std::vector<HeapTracker::SiteStats> HeapTracker::GetSites()
+{
+  std::vector<SiteStats> sites;
+  sites.reserve(HEAP_TRACKING_MAX_SITES + 1);  // Can't allocate with the lock held
+
+  portENTER_CRITICAL_SAFE(&s_lock);
+  for (std::size_t i = 0; i <= HEAP_TRACKING_MAX_SITES; i++) {
+    const Site& site = s_sites[i];
+    if (!site.used && i != HEAP_TRACKING_MAX_SITES) {
+      continue;
+    }
+
+    if (site.allocs == 0 && site.liveCount == 0) {
+      continue;
+    }
+
+    sites.push_back({
+      .tag        = i == HEAP_TRACKING_MAX_SITES ? "(other)" : site.tag,
+      .pc         = site.pc,
+      .liveBytes  = site.liveBytes,
+      .liveCount  = site.liveCount,
+      .allocs     = site.allocs,
+      .allocBytes = site.allocBytes,
+    });
+  }
+  portEXIT_CRITICAL_SAFE(&s_lock);
+
+  std::sort(sites.begin(), sites.end(), [](const SiteStats& a, const SiteStats& b) { return a.liveBytes > b.liveBytes; });
+
+  return sites;
+}
+
+std::vector<HeapTracker::TrendSample> HeapTracker::GetTrend()
+{
+  std::vector<TrendSample> trend;
+  trend.reserve(HEAP_TRACKING_TREND_SAMPLES);
+
+  portENTER_CRITICAL_SAFE(&s_lock);
+  std::size_t first = (s_trendNext + HEAP_TRACKING_TREND_SAMPLES - s_trendCount) % HEAP_TRACKING_TREND_SAMPLES;
+  for (std::size_t i = 0; i < s_trendCount; i++) {
+    trend.push_back(s_trend[(first + i) % HEAP_TRACKING_TREND_SAMPLES]);
+  }
+  portEXIT_CRITICAL_SAFE(&s_lock);
+
+  return trend;
+}
+
+void HeapTracker::Reset()
+{
+  portENTER_CRITICAL_SAFE(&s_lock);
+
+  for (Site& site : s_sites) {
+    site.allocs     = 0;
+    site.allocBytes = 0;
+  }
+
+  s_totals.peakLiveBytes = s_totals.liveBytes;
+  s_totals.allocs        = 0;
+  s_totals.frees         = 0;
+  s_totals.untracked     = 0;
+
+  s_trendCount       = 0;
+  s_trendNext        = 0;
+  s_lastSampleAllocs = 0;
+
+  portEXIT_CRITICAL_SAFE(&s_lock);
+}
+
+#endif
@@ -2,11 +2,25 @@
 
 const char* const TAG = "PartitionUtils";
 
+#include "config/Config.h"
 #include "Hashing.h"
 #include "http/HTTPRequestManager.h"
 #include "Logging.h"
 #include "Time.h"
+#include "util/DeltaPatcher.h"
+#include "util/GzipDecompressor.h"
 #include "util/HexUtils.h"
+#include "util/PartitionWriter.h"
+#include "wifi/WiFiManager.h"
+
+#include <esp_ota_ops.h>
+#include <esp_spi_flash.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <memory>
+#include <string>
 
 bool OpenShock::TryGetPartitionHash(const esp_partition_t* partition, char (&hash)[65]) {
   uint8_t buffer[32];
@@ -22,47 +36,290 @@ bool OpenShock::TryGetPartitionHash(const esp_partition_t* partition, char (&has
   return true;
 }
 
-bool OpenShock::FlashPartitionFromUrl(const esp_partition_t* partition, std::string_view remoteUrl, const uint8_t (&remoteHash)[32], std::function<bool(std::size_t, std::size_t, float)> progressCallback) {
+const std::size_t DATA_PARTITION_SAMPLE_STRIDE = 64 * 1024;  // Distance between the blocks sampled into a data partition's fingerprint
+const std::size_t DATA_PARTITION_SAMPLE_SIZE   = 256;
+
+/// @brief Hashes the first two blocks of a data partition and the start of every 64 KiB after them
+///
+/// The first two blocks hold the LittleFS superblock pair, their revision count and CRC change whenever the filesystem is committed to.
+/// Reads about 13 KiB of a 1.4 MiB partition instead of all of it.
+static bool _getDataPartitionFingerprint(const esp_partition_t* partition, uint8_t (&fingerprint)[8]) {
+  OpenShock::SHA256 sha256;
+  if (!sha256.begin()) {
+    return false;
+  }
+
+  uint8_t buffer[DATA_PARTITION_SAMPLE_SIZE];
+
+  std::size_t headerSize = std::min<std::size_t>(2 * SPI_FLASH_SEC_SIZE, partition->size);
+  for (std::size_t offset = 0; offset < headerSize; offset += sizeof(buffer)) {
+    if (esp_partition_read(partition, offset, buffer, sizeof(buffer)) != ESP_OK || !sha256.update(buffer, sizeof(buffer))) {
+      return false;
+    }
+  }
+
+  for (std::size_t offset = DATA_PARTITION_SAMPLE_STRIDE; offset + sizeof(buffer) <= partition->size; offset += DATA_PARTITION_SAMPLE_STRIDE) {
+    if (esp_partition_read(partition, offset, buffer, sizeof(buffer)) != ESP_OK || !sha256.update(buffer, sizeof(buffer))) {
+      return false;
+    }
+  }
+
+  std::array<uint8_t, 32> hash;
+  if (!sha256.finish(hash)) {
+    return false;
+  }
+
+  memcpy(fingerprint, hash.data(), sizeof(fingerprint));
+
+  return true;
+}
+
+/// @brief Identifies what a cached partition hash belongs to
+///
+/// App images identify themselves through the ELF hash in their app description, so an app partition rewritten behind our back (e.g. over USB) is detected cheaply.
+/// Data partitions have no such header, their entry is tied to the firmware version and a fingerprint of sampled partition contents, so a rewrite under the same version misses the cache too.
+static bool _getPartitionCacheTag(const esp_partition_t* partition, std::string_view firmwareVersion, std::string& tag) {
+  uint8_t fingerprint[8];
+
+  if (partition->type != ESP_PARTITION_TYPE_APP) {
+    if (!_getDataPartitionFingerprint(partition, fingerprint)) {
+      return false;
+    }
+
+    tag.assign(firmwareVersion.data(), firmwareVersion.size());
+    tag.push_back(':');
+    tag.append(OpenShock::HexUtils::ToHex<8>(fingerprint, false).data());
+
+    return true;
+  }
+
+  esp_app_desc_t appDesc;
+  if (esp_ota_get_partition_description(partition, &appDesc) != ESP_OK) {
+    return false;
+  }
+
+  memcpy(fingerprint, appDesc.app_elf_sha256, sizeof(fingerprint));
+
+  tag = OpenShock::HexUtils::ToHex<8>(fingerprint, false).data();
+
+  return true;
+}
+
+bool OpenShock::TryGetPartitionImageHash(const esp_partition_t* partition, uint8_t (&hash)[32]) {
+  std::string expectedTag;
+  if (!_getPartitionCacheTag(partition, OPENSHOCK_FW_VERSION, expectedTag)) {
+    return false;
+  }
+
+  std::string cachedTag;
+  if (Config::GetPartitionHash(partition->label, hash, cachedTag) && cachedTag == expectedTag) {
+    return true;
+  }
+
+  // An app partition's hash only matches the release file over the exact image length, which is only known while flashing it
+  if (partition->type == ESP_PARTITION_TYPE_APP) {
+    return false;
+  }
+
+  OS_LOGD(TAG, "Hashing partition %s, no valid cached hash", partition->label);
+
+  esp_err_t err = esp_partition_get_sha256(partition, hash);
+  if (err != ESP_OK) {
+    OS_LOGE(TAG, "Failed to get partition hash: %s", esp_err_to_name(err));
+    return false;
+  }
+
+  if (!Config::SetPartitionHash(partition->label, hash, expectedTag)) {
+    OS_LOGW(TAG, "Failed to cache partition hash");
+  }
+
+  return true;
+}
+
+bool OpenShock::CachePartitionImageHash(const esp_partition_t* partition, const uint8_t (&hash)[32], std::string_view firmwareVersion) {
+  std::string tag;
+  if (!_getPartitionCacheTag(partition, firmwareVersion, tag)) {
+    OS_LOGW(TAG, "Failed to read image description of partition %s", partition->label);
+    return false;
+  }
+
+  return Config::SetPartitionHash(partition->label, hash, tag);
+}
+
+const uint8_t OTA_DOWNLOAD_MAX_STALLED_ATTEMPTS = 5;  // Consecutive attempts that made no progress before giving up
+const uint32_t OTA_RECONNECT_TIMEOUT_MS        = 60'000;
+const uint32_t OTA_RESUME_BACKOFF_MS           = 1000;
+
+static bool _isResumable(OpenShock::HTTP::RequestResult result) {
+  return result == OpenShock::HTTP::RequestResult::RequestFailed || result == OpenShock::HTTP::RequestResult::TimedOut;
+}
+
+/// @brief Waits for WiFi to come back after a dropped download
+static bool _waitForReconnect(uint32_t timeoutMs) {
+  int64_t deadline = OpenShock::millis() + timeoutMs;
+
+  vTaskDelay(pdMS_TO_TICKS(OTA_RESUME_BACKOFF_MS));
+
+  while (!OpenShock::WiFiManager::IsConnected()) {
+    if (OpenShock::millis() >= deadline) {
+      return false;
+    }
+
+    vTaskDelay(pdMS_TO_TICKS(250));
+  }
+
+  return true;
+}
+
+static float _kibPerSecond(std::size_t bytes, int64_t us) {
+  if (us <= 0) {
+    return 0.0f;
+  }
+
+  return (static_cast<float>(bytes) / 1024.0f) / (static_cast<float>(us) / 1'000'000.0f);
+}
+
+/// @brief Checks a delta patch was made against the image in the base partition
+static bool _verifyPatchBase(const esp_partition_t* basePartition, const OpenShock::DeltaPatcher::Header& header) {
+  if (header.baseSize > basePartition->size) {
+    OS_LOGW(TAG, "Delta patch base is larger than the running partition");
+    return false;
+  }
+
   OpenShock::SHA256 sha256;
   if (!sha256.begin()) {
     OS_LOGE(TAG, "Failed to initialize SHA256 hash");
     return false;
   }
 
+  uint8_t buffer[512];
+  for (std::size_t offset = 0; offset < header.baseSize; offset += sizeof(buffer)) {
+    std::size_t length = std::min(sizeof(buffer), header.baseSize - offset);
+
+    esp_err_t err = esp_partition_read(basePartition, offset, buffer, length);
+    if (err != ESP_OK) {
+      OS_LOGE(TAG, "Failed to read running partition: %s", esp_err_to_name(err));
+      return false;
+    }
+
+    if (!sha256.update(buffer, length)) {
+      OS_LOGE(TAG, "Failed to update SHA256 hash");
+      return false;
+    }
+  }
+
+  std::array<uint8_t, 32> baseHash;
+  if (!sha256.finish(baseHash)) {
+    OS_LOGE(TAG, "Failed to finish SHA256 hash");
+    return false;
+  }
+
+  if (memcmp(baseHash.data(), header.baseHash, 32) != 0) {
+    OS_LOGW(TAG, "Delta patch was made for a different base image");
+    return false;
+  }
+
+  return true;
+}
+
+/// @brief Downloads into the partition, the stream optionally passes through a decompressor and then a delta patcher before being written
+static bool _flashPartitionFromUrl(const esp_partition_t* partition, std::string_view remoteUrl, const uint8_t (&remoteHash)[32], std::function<bool(std::size_t, std::size_t, float)> progressCallback, OpenShock::GzipDecompressor* decompressor, OpenShock::DeltaPatcher* patcher) {
+  OpenShock::SHA256 sha256;
+  if (!sha256.begin()) {
+    OS_LOGE(TAG, "Failed to initialize SHA256 hash");
+    return false;
+  }
+
+  // The cached hash describes the image about to be erased, it is only recorded again once the new image is verified
+  if (!OpenShock::Config::ClearPartitionHash(partition->label)) {
+    OS_LOGE(TAG, "Failed to clear cached hash of partition %s", partition->label);
+    return false;
+  }
+
+  // Flash erase and write happen on the writer task, network reads and hashing stay on this one
+  OpenShock::PartitionWriter writer(partition);
+  if (!writer.ok()) {
+    OS_LOGE(TAG, "Failed to start partition writer");
+    return false;
+  }
+
   std::size_t contentLength  = 0;
   std::size_t contentWritten = 0;
-  int64_t lastProgress  = 0;
+  int64_t lastProgress       = 0;
+  int64_t hashUs             = 0;
 
-  auto sizeValidator = [partition, &contentLength, progressCallback, &lastProgress](std::size_t size) -> bool {
-    if (size > partition->size) {
+  auto sizeValidator = [partition, decompressor, &contentLength, &contentWritten, progressCallback, &lastProgress](std::size_t size) -> bool {
+    // A compressed image's decompressed size is only known once it has been fully written, PartitionWriter rejects overruns
+    if (decompressor == nullptr && size > partition->size) {
       OS_LOGE(TAG, "Remote partition binary is too large");
       return false;
     }
 
-    // Erase app partition.
-    if (esp_partition_erase_range(partition, 0, partition->size) != ESP_OK) {
-      OS_LOGE(TAG, "Failed to erase partition in preparation for update");
+    // The resource must not change between resumed attempts
+    if (contentWritten > 0 && size != contentLength) {
+      OS_LOGE(TAG, "Remote partition binary changed size while resuming (%zu != %zu)", size, contentLength);
       return false;
     }
 
     contentLength = size;
 
     lastProgress = OpenShock::millis();
-    progressCallback(0, contentLength, 0.0f);
+    progressCallback(contentWritten, contentLength, static_cast<float>(contentWritten) / static_cast<float>(contentLength));
 
     return true;
   };
-  auto dataWriter = [partition, &sha256, &contentLength, &contentWritten, progressCallback, &lastProgress](std::size_t offset, const uint8_t* data, std::size_t length) -> bool {
-    if (esp_partition_write(partition, offset, data, length) != ESP_OK) {
+  // Writes (decompressed) image data to flash, the hash always covers the image as it ends up in flash
+  auto imageWriter = [&writer, &sha256, &hashUs](const uint8_t* data, std::size_t length) -> bool {
+    if (!writer.write(data, length)) {
       OS_LOGE(TAG, "Failed to write to partition");
       return false;
     }
 
+    int64_t hashStart = OpenShock::micros();
     if (!sha256.update(data, length)) {
       OS_LOGE(TAG, "Failed to update SHA256 hash");
       return false;
     }
+    hashUs += OpenShock::micros() - hashStart;
+
+    return true;
+  };
+  auto patchWriter = [patcher, &imageWriter](const uint8_t* data, std::size_t length) -> bool {
+    if (patcher == nullptr) {
+      return imageWriter(data, length);
+    }
+
+    switch (patcher->feed(data, length, imageWriter)) {
+      case OpenShock::DeltaPatcher::Result::NeedMoreData:
+      case OpenShock::DeltaPatcher::Result::Done:
+        return true;
+      case OpenShock::DeltaPatcher::Result::Invalid:
+        OS_LOGE(TAG, "Failed to apply delta patch");
+        return false;
+      default:
+        return false;
+    }
+  };
+  auto dataWriter = [decompressor, &patchWriter, &contentLength, &contentWritten, progressCallback, &lastProgress](std::size_t offset, const uint8_t* data, std::size_t length) -> bool {
+    if (offset != contentWritten) {
+      OS_LOGE(TAG, "Received data at offset %zu, expected %zu", offset, contentWritten);
+      return false;
+    }
+
+    if (decompressor != nullptr) {
+      auto result = decompressor->feed(data, length, patchWriter);
+      if (result == OpenShock::GzipDecompressor::Result::Invalid) {
+        OS_LOGE(TAG, "Failed to decompress remote partition binary");
+        return false;
+      }
+      if (result == OpenShock::GzipDecompressor::Result::Cancelled) {
+        return false;
+      }
+    } else if (!patchWriter(data, length)) {
+      return false;
+    }
 
+    // Progress is tracked over the transferred bytes, as the decompressed size is not known up front
     contentWritten += length;
 
     int64_t now = OpenShock::millis();
@@ -74,36 +331,161 @@ bool OpenShock::FlashPartitionFromUrl(const esp_partition_t* partition, std::str
     return true;
   };
 
-  // Start streaming binary to app partition.
-  auto appBinaryResponse = OpenShock::HTTP::Download(
-    remoteUrl,
-    {
-      {"Accept", "application/octet-stream"}
-  },
-    sizeValidator,
-    dataWriter,
-    {200, 304},
-    180'000
-  );  // 3 minutes
+  int64_t downloadStart = OpenShock::micros();
+  int64_t reconnectUs   = 0;
+
+  // A dropped connection resumes where it left off, the partition writer, hash and decoders keep their state across attempts,
+  // so nothing before the resume point is downloaded, erased or hashed again
+  OpenShock::HTTP::Response<std::size_t> appBinaryResponse = {OpenShock::HTTP::RequestResult::InternalError, 0, 0};
+  for (uint8_t stalledAttempts = 0;;) {
+    std::size_t attemptStart = contentWritten;
+
+    // Start streaming binary to app partition.
+    appBinaryResponse = OpenShock::HTTP::ResumeDownload(
+      remoteUrl,
+      {
+        {"Accept", "application/octet-stream"}
+    },
+      contentWritten,
+      sizeValidator,
+      dataWriter,
+      {200, 304},
+      180'000
+    );  // 3 minutes
+
+    if (appBinaryResponse.result == OpenShock::HTTP::RequestResult::Success || !_isResumable(appBinaryResponse.result)) {
+      break;
+    }
+
+    stalledAttempts = contentWritten > attemptStart ? 0 : stalledAttempts + 1;
+    if (stalledAttempts >= OTA_DOWNLOAD_MAX_STALLED_ATTEMPTS) {
+      OS_LOGE(TAG, "Download made no progress after %u attempts", stalledAttempts);
+      break;
+    }
+
+    OS_LOGW(TAG, "Download interrupted at %zu / %zu bytes, resuming once connected", contentWritten, contentLength);
+
+    int64_t reconnectStart = OpenShock::micros();
+    bool reconnected       = _waitForReconnect(OTA_RECONNECT_TIMEOUT_MS);
+    reconnectUs += OpenShock::micros() - reconnectStart;
+
+    if (!reconnected) {
+      OS_LOGE(TAG, "Timed out waiting for network to resume download");
+      break;
+    }
+  }
+
+  int64_t downloadUs = OpenShock::micros() - downloadStart - reconnectUs;
+
+  // Every failure below stops the writer through abort(), so a failed image never pays for the tail erase of a data partition
   if (appBinaryResponse.result != OpenShock::HTTP::RequestResult::Success) {
     OS_LOGE(TAG, "Failed to download remote partition binary: [%u]", appBinaryResponse.code);
+    writer.abort();
     return false;
   }
 
-  progressCallback(contentLength, contentLength, 1.0f);
-  OS_LOGD(TAG, "Wrote %u bytes to partition", appBinaryResponse.data);
+  if (decompressor != nullptr && !decompressor->isDone()) {
+    OS_LOGE(TAG, "Compressed remote partition binary is truncated");
+    writer.abort();
+    return false;
+  }
+
+  if (patcher != nullptr && !patcher->isDone()) {
+    OS_LOGE(TAG, "Delta patch is truncated");
+    writer.abort();
+    return false;
+  }
 
+  // The hash covers everything handed to the writer, so the image is verified before its last buffer is flushed
   std::array<uint8_t, 32> localHash;
   if (!sha256.finish(localHash)) {
     OS_LOGE(TAG, "Failed to finish SHA256 hash");
+    writer.abort();
     return false;
   }
 
   // Compare hashes.
   if (memcmp(localHash.data(), remoteHash, 32) != 0) {
     OS_LOGE(TAG, "App binary hash mismatch");
+    writer.abort();
+    return false;
+  }
+
+  bool flushed = writer.finish();
+
+  int64_t totalUs = OpenShock::micros() - downloadStart;
+
+  if (!flushed) {
+    OS_LOGE(TAG, "Failed to flush data to partition");
     return false;
   }
 
+  if (decompressor != nullptr) {
+    OS_LOGI(TAG, "Decompressed %zu bytes into %zu bytes", contentWritten, decompressor->outputSize());
+  }
+
+  if (patcher != nullptr) {
+    OS_LOGI(TAG, "Delta update: downloaded %zu bytes for a %zu byte image (%.1f%% saved)", contentWritten, patcher->targetSize(), 100.0f - (static_cast<float>(contentWritten) * 100.0f / static_cast<float>(patcher->targetSize())));
+  }
+
+  progressCallback(contentLength, contentLength, 1.0f);
+  OS_LOGD(TAG, "Wrote %zu bytes to partition", writer.stats().bytesWritten);
+
+  const auto& stats = writer.stats();
+
+  // Time this task spent neither hashing nor waiting on flash is time spent waiting on the network
+  int64_t networkUs = downloadUs - hashUs - stats.stallUs;
+  OS_LOGI(
+    TAG,
+    "OTA pipeline: %zu bytes in %lli ms | network %.1f KiB/s | flash %.1f KiB/s (erase %lli ms, write %lli ms) | hash %.1f KiB/s | stalled on flash %lli ms",
+    stats.bytesWritten,
+    totalUs / 1000,
+    _kibPerSecond(contentWritten, networkUs),
+    _kibPerSecond(stats.bytesWritten, stats.eraseUs + stats.writeUs),
+    stats.eraseUs / 1000,
+    stats.writeUs / 1000,
+    _kibPerSecond(stats.bytesWritten, hashUs),
+    stats.stallUs / 1000
+  );
+
   return true;
 }
+
+bool OpenShock::FlashPartitionFromUrl(const esp_partition_t* partition, std::string_view remoteUrl, const uint8_t (&remoteHash)[32], std::function<bool(std::size_t, std::size_t, float)> progressCallback, OtaImageEncoding encoding) {
+  if (encoding == OtaImageEncoding::Raw) {
+    return _flashPartitionFromUrl(partition, remoteUrl, remoteHash, progressCallback, nullptr, nullptr);
+  }
+
+  auto decompressor = std::make_unique<OpenShock::GzipDecompressor>();
+  if (!decompressor->ok()) {
+    OS_LOGE(TAG, "Failed to create decompressor");
+    return false;
+  }
+
+  return _flashPartitionFromUrl(partition, remoteUrl, remoteHash, progressCallback, decompressor.get(), nullptr);
+}
+
+bool OpenShock::FlashPartitionFromPatchUrl(const esp_partition_t* partition, const esp_partition_t* basePartition, std::string_view patchUrl, const uint8_t (&remoteHash)[32], std::function<bool(std::size_t, std::size_t, float)> progressCallback) {
+  if (basePartition == nullptr || basePartition == partition) {
+    OS_LOGE(TAG, "Invalid delta patch base partition");
+    return false;
+  }
+
+  // Patches are always published gzip-compressed, the diff bytes of unchanged code compress to almost nothing
+  auto decompressor = std::make_unique<OpenShock::GzipDecompressor>();
+  if (!decompressor->ok()) {
+    OS_LOGE(TAG, "Failed to create decompressor");
+    return false;
+  }
+
+  auto readBase = [basePartition](std::size_t offset, uint8_t* data, std::size_t length) -> bool {
+    return esp_partition_read(basePartition, offset, data, length) == ESP_OK;
+  };
+  auto onHeader = [basePartition](const OpenShock::DeltaPatcher::Header& header) -> bool {
+    return _verifyPatchBase(basePartition, header);
+  };
+
+  auto patcher = std::make_unique<OpenShock::DeltaPatcher>(readBase, onHeader);
+
+  return _flashPartitionFromUrl(partition, patchUrl, remoteHash, progressCallback, decompressor.get(), patcher.get());
+}
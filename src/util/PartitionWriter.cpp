@@ -0,0 +1,303 @@
+#include "util/PartitionWriter.h"
+
+const char* const TAG = "PartitionWriter";
+
+#include "Logging.h"
+#include "Time.h"
+#include "util/FnProxy.h"
+#include "util/TaskUtils.h"
+
+#include <esp_heap_caps.h>
+#include <esp_spi_flash.h>
+
+#include <algorithm>
+#include <cstring>
+
+const std::size_t PARTITION_WRITER_ERASE_BLOCK_SIZE  = 64 * 1024;  // Erase ahead in 64KB steps, the flash chip erases these in a single block-erase command
+const uint8_t PARTITION_WRITER_BUFFER_COUNT          = 4;
+const std::size_t PARTITION_WRITER_BUFFER_SIZE_PSRAM = 16 * 1024;
+const std::size_t PARTITION_WRITER_BUFFER_SIZE       = 8 * 1024;
+const std::size_t PARTITION_WRITER_BUFFER_SIZE_MIN   = SPI_FLASH_SEC_SIZE;
+const uint32_t PARTITION_WRITER_STALL_TIMEOUT_MS     = 30'000;
+const uint32_t PARTITION_WRITER_TASK_STACK_SIZE      = 3072;
+const UBaseType_t PARTITION_WRITER_TASK_PRIORITY     = 2;  // Above the OTA task, so filled buffers are picked up immediately
+
+using namespace OpenShock;
+
+constexpr std::size_t _alignUp(std::size_t value, std::size_t alignment)
+{
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+PartitionWriter::PartitionWriter(const esp_partition_t* partition, std::size_t startOffset)
+  : m_partition(partition)
+  , m_startOffset(startOffset)
+  , m_offset(startOffset)
+  , m_writeOffset(startOffset)
+  , m_erasedUpTo(_alignUp(startOffset, SPI_FLASH_SEC_SIZE))  // A partially written sector was already erased by whoever wrote it
+  , m_buffers(nullptr)
+  , m_bufferSize(0)
+  , m_bufferCount(PARTITION_WRITER_BUFFER_COUNT)
+  , m_currentIndex(-1)
+  , m_currentFill(0)
+  , m_freeQueue(nullptr)
+  , m_fullQueue(nullptr)
+  , m_doneSemaphore(nullptr)
+  , m_taskHandle(nullptr)
+  , m_failed(false)
+  , m_aborting(false)
+  , m_stopped(false)
+  , m_stats({0, 0, 0, 0})
+{
+  if (partition == nullptr || startOffset > partition->size) {
+    OS_LOGE(TAG, "Invalid partition or start offset");
+    m_failed = true;
+    return;
+  }
+
+  // Prefer PSRAM for the pipeline buffers, fall back to progressively smaller internal buffers
+  m_buffers = static_cast<uint8_t*>(heap_caps_malloc(PARTITION_WRITER_BUFFER_SIZE_PSRAM * m_bufferCount, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT));
+  if (m_buffers != nullptr) {
+    m_bufferSize = PARTITION_WRITER_BUFFER_SIZE_PSRAM;
+  } else {
+    for (std::size_t size = PARTITION_WRITER_BUFFER_SIZE; size >= PARTITION_WRITER_BUFFER_SIZE_MIN; size /= 2) {
+      m_buffers = static_cast<uint8_t*>(malloc(size * m_bufferCount));
+      if (m_buffers != nullptr) {
+        m_bufferSize = size;
+        break;
+      }
+    }
+  }
+  if (m_buffers == nullptr) {
+    OS_LOGE(TAG, "Failed to allocate pipeline buffers");
+    destroy();
+    return;
+  }
+
+  m_freeQueue     = xQueueCreate(m_bufferCount, sizeof(uint8_t));
+  m_fullQueue     = xQueueCreate(m_bufferCount + 1, sizeof(Block));  // +1 for the end-of-stream marker
+  m_doneSemaphore = xSemaphoreCreateBinary();
+  if (m_freeQueue == nullptr || m_fullQueue == nullptr || m_doneSemaphore == nullptr) {
+    OS_LOGE(TAG, "Failed to create pipeline queues");
+    destroy();
+    return;
+  }
+
+  for (uint8_t i = 0; i < m_bufferCount; ++i) {
+    xQueueSend(m_freeQueue, &i, 0);
+  }
+
+  if (TaskUtils::TaskCreateExpensive(&Util::FnProxy<&PartitionWriter::WriterTask>, TAG, PARTITION_WRITER_TASK_STACK_SIZE, this, PARTITION_WRITER_TASK_PRIORITY, &m_taskHandle) != pdPASS) {
+    OS_LOGE(TAG, "Failed to create writer task");
+    destroy();
+    return;
+  }
+
+  OS_LOGD(TAG, "Pipeline ready: %u x %zu byte buffers, starting at offset %zu", m_bufferCount, m_bufferSize, startOffset);
+}
+
+PartitionWriter::~PartitionWriter()
+{
+  abort();
+
+  destroy();
+}
+
+bool PartitionWriter::write(const uint8_t* data, std::size_t length)
+{
+  if (m_taskHandle == nullptr || m_stopped || m_failed.load()) {
+    return false;
+  }
+
+  if (length > m_partition->size - m_offset) {
+    OS_LOGE(TAG, "Data does not fit in partition");
+    m_failed = true;
+    return false;
+  }
+
+  while (length > 0) {
+    if (m_currentIndex < 0) {
+      uint8_t index;
+
+      int64_t waitStart = OpenShock::micros();
+      if (xQueueReceive(m_freeQueue, &index, pdMS_TO_TICKS(PARTITION_WRITER_STALL_TIMEOUT_MS)) != pdTRUE) {
+        OS_LOGE(TAG, "Timed out waiting for a free buffer");
+        m_failed = true;
+        return false;
+      }
+      m_stats.stallUs += OpenShock::micros() - waitStart;
+
+      m_currentIndex = index;
+      m_currentFill  = 0;
+
+      if (m_failed.load()) {
+        return false;
+      }
+    }
+
+    std::size_t n = std::min(length, m_bufferSize - m_currentFill);
+    memcpy(m_buffers + (m_currentIndex * m_bufferSize) + m_currentFill, data, n);
+
+    m_currentFill += n;
+    m_offset += n;
+    data += n;
+    length -= n;
+
+    if (m_currentFill == m_bufferSize && !submitCurrent()) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool PartitionWriter::finish()
+{
+  if (m_taskHandle == nullptr || m_stopped) {
+    return false;
+  }
+
+  if (m_currentIndex >= 0 && m_currentFill > 0) {
+    submitCurrent();
+  }
+
+  return stop() && !m_failed.load();
+}
+
+void PartitionWriter::abort()
+{
+  if (m_taskHandle == nullptr || m_stopped) {
+    return;
+  }
+
+  // The partially filled buffer is never submitted, and the writer task skips the ones already queued
+  m_aborting     = true;
+  m_currentIndex = -1;
+  m_currentFill  = 0;
+
+  stop();
+}
+
+bool PartitionWriter::submitCurrent()
+{
+  Block block = {static_cast<uint8_t>(m_currentIndex), static_cast<uint32_t>(m_currentFill)};
+
+  m_currentIndex = -1;
+  m_currentFill  = 0;
+
+  // Queue has room for every buffer plus the end marker, so this never blocks
+  if (xQueueSend(m_fullQueue, &block, portMAX_DELAY) != pdTRUE) {
+    m_failed = true;
+    return false;
+  }
+
+  return true;
+}
+
+bool PartitionWriter::stop()
+{
+  Block end = {0, 0};
+  if (xQueueSend(m_fullQueue, &end, portMAX_DELAY) != pdTRUE) {
+    return false;
+  }
+
+  xSemaphoreTake(m_doneSemaphore, portMAX_DELAY);
+
+  m_stopped            = true;
+  m_taskHandle         = nullptr;  // Task deleted itself
+  m_stats.bytesWritten = m_writeOffset - m_startOffset;
+
+  return true;
+}
+
+void PartitionWriter::destroy()
+{
+  if (m_taskHandle != nullptr) {
+    vTaskDelete(m_taskHandle);
+    m_taskHandle = nullptr;
+  }
+  if (m_freeQueue != nullptr) {
+    vQueueDelete(m_freeQueue);
+    m_freeQueue = nullptr;
+  }
+  if (m_fullQueue != nullptr) {
+    vQueueDelete(m_fullQueue);
+    m_fullQueue = nullptr;
+  }
+  if (m_doneSemaphore != nullptr) {
+    vSemaphoreDelete(m_doneSemaphore);
+    m_doneSemaphore = nullptr;
+  }
+  if (m_buffers != nullptr) {
+    free(m_buffers);
+    m_buffers = nullptr;
+  }
+}
+
+bool PartitionWriter::eraseUpTo(std::size_t end)
+{
+  if (end <= m_erasedUpTo) {
+    return true;
+  }
+
+  std::size_t eraseEnd = std::min(_alignUp(end, PARTITION_WRITER_ERASE_BLOCK_SIZE), static_cast<std::size_t>(m_partition->size));
+
+  int64_t eraseStart = OpenShock::micros();
+  esp_err_t err      = esp_partition_erase_range(m_partition, m_erasedUpTo, eraseEnd - m_erasedUpTo);
+  m_stats.eraseUs += OpenShock::micros() - eraseStart;
+
+  if (err != ESP_OK) {
+    OS_LOGE(TAG, "Failed to erase partition range 0x%x-0x%x: %s", m_erasedUpTo, eraseEnd, esp_err_to_name(err));
+    return false;
+  }
+
+  m_erasedUpTo = eraseEnd;
+
+  return true;
+}
+
+void PartitionWriter::WriterTask()
+{
+  Block block;
+  while (xQueueReceive(m_fullQueue, &block, portMAX_DELAY) == pdTRUE) {
+    if (block.length == 0) {
+      break;
+    }
+
+    // Keep consuming after a failure so the producer never deadlocks waiting for a free buffer
+    if (!m_failed.load() && !m_aborting.load()) {
+      if (!eraseUpTo(m_writeOffset + block.length)) {
+        m_failed = true;
+      } else {
+        int64_t writeStart = OpenShock::micros();
+        esp_err_t err      = esp_partition_write(m_partition, m_writeOffset, m_buffers + (block.index * m_bufferSize), block.length);
+        m_stats.writeUs += OpenShock::micros() - writeStart;
+
+        if (err != ESP_OK) {
+          OS_LOGE(TAG, "Failed to write to partition at 0x%x: %s", m_writeOffset, esp_err_to_name(err));
+          m_failed = true;
+        } else {
+          m_writeOffset += block.length;
+        }
+      }
+    }
+
+    xQueueSend(m_freeQueue, &block.index, portMAX_DELAY);
+  }
+
+  // App images carry their own length, stale data after them is harmless. Data partitions (filesystems) must not contain leftovers of the previous image.
+  if (!m_failed.load() && !m_aborting.load() && m_partition->type != ESP_PARTITION_TYPE_APP) {
+    while (m_erasedUpTo < m_partition->size) {
+      if (!eraseUpTo(m_erasedUpTo + PARTITION_WRITER_ERASE_BLOCK_SIZE)) {
+        m_failed = true;
+        break;
+      }
+
+      vTaskDelay(1);  // Let the idle tasks feed the watchdog between block erases
+    }
+  }
+
+  xSemaphoreGive(m_doneSemaphore);
+
+  vTaskDelete(nullptr);
+}
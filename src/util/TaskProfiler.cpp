@@ -0,0 +1,241 @@
+#include "util/TaskProfiler.h"
+
+const char* const TAG = "TaskProfiler";
+
+#include "Logging.h"
+#include "SimpleMutex.h"
+
+#if CONFIG_HEAP_TASK_TRACKING
+#include <esp_heap_task_info.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+
+using namespace OpenShock;
+
+const std::size_t TASK_PROFILER_MAX_TASKS = 32;  // Registered tasks, exited ones are pruned while sampling, past this the oldest registrations are overwritten
+#if CONFIG_HEAP_TASK_TRACKING
+const std::size_t TASK_PROFILER_MAX_HEAP_TOTALS = 48;
+#endif
+
+struct RegisteredTask {
+  TaskHandle_t handle;
+  char name[configMAX_TASK_NAME_LEN];  // Copied, some callers build the name on their stack
+  uint32_t stackSize;
+  BaseType_t core;
+  uint32_t sequence;  // Registration order, tasks registered after a sample was taken are missing from it without having exited
+};
+
+struct RunTimeSample {
+  TaskHandle_t handle;
+  uint32_t runTime;
+};
+
+static RegisteredTask s_tasks[TASK_PROFILER_MAX_TASKS];
+static std::size_t s_taskCount    = 0;
+static std::size_t s_nextEviction = 0;
+static uint32_t s_nextSequence    = 0;
+static portMUX_TYPE s_tasksLock   = portMUX_INITIALIZER_UNLOCKED;  // Tasks may be created before any mutex could be
+
+static OpenShock::SimpleMutex s_sampleMutex = {};
+static std::vector<RunTimeSample> s_lastRunTimes;  // Only accessed under the sample lock
+static uint32_t s_lastTotalRunTime = 0;
+
+void TaskProfiler::RegisterTask(TaskHandle_t handle, const char* name, uint32_t stackSize, BaseType_t core)
+{
+  portENTER_CRITICAL_SAFE(&s_tasksLock);
+
+  // FreeRTOS reuses the memory of deleted tasks, a new task can show up with the handle of an exited one
+  std::size_t index = s_taskCount;
+  for (std::size_t i = 0; i < s_taskCount; i++) {
+    if (s_tasks[i].handle == handle) {
+      index = i;
+      break;
+    }
+  }
+
+  if (index == TASK_PROFILER_MAX_TASKS) {
+    index          = s_nextEviction;
+    s_nextEviction = (s_nextEviction + 1) % TASK_PROFILER_MAX_TASKS;
+  } else if (index == s_taskCount) {
+    s_taskCount++;
+  }
+
+  RegisteredTask& task = s_tasks[index];
+  task.handle          = handle;
+  task.stackSize       = stackSize;
+  task.core            = core;
+  task.sequence        = s_nextSequence++;
+  strncpy(task.name, name, sizeof(task.name) - 1);
+  task.name[sizeof(task.name) - 1] = '\0';
+
+  portEXIT_CRITICAL_SAFE(&s_tasksLock);
+}
+
+static bool _findRegisteredTask(TaskHandle_t handle, RegisteredTask& out)
+{
+  bool found = false;
+
+  portENTER_CRITICAL_SAFE(&s_tasksLock);
+  for (std::size_t i = 0; i < s_taskCount; i++) {
+    if (s_tasks[i].handle == handle) {
+      out   = s_tasks[i];
+      found = true;
+      break;
+    }
+  }
+  portEXIT_CRITICAL_SAFE(&s_tasksLock);
+
+  return found;
+}
+
+/// @brief Drops registrations of tasks that have exited, so short-lived tasks don't evict the long-lived ones
+static void _pruneRegisteredTasks(const std::vector<TaskStatus_t>& statuses, uint32_t sampleSequence)
+{
+  portENTER_CRITICAL_SAFE(&s_tasksLock);
+
+  std::size_t i = 0;
+  while (i < s_taskCount) {
+    const RegisteredTask& task = s_tasks[i];
+
+    bool alive = static_cast<int32_t>(task.sequence - sampleSequence) >= 0 || std::any_of(statuses.begin(), statuses.end(), [&task](const TaskStatus_t& status) { return status.xHandle == task.handle; });
+    if (alive) {
+      i++;
+      continue;
+    }
+
+    s_tasks[i] = s_tasks[--s_taskCount];
+  }
+
+  if (s_nextEviction >= s_taskCount) {
+    s_nextEviction = 0;
+  }
+
+  portEXIT_CRITICAL_SAFE(&s_tasksLock);
+}
+
+#if CONFIG_HEAP_TASK_TRACKING
+static void _fillHeapUsage(std::vector<TaskProfiler::TaskStats>& stats, const std::vector<TaskHandle_t>& handles)
+{
+  heap_task_totals_t totals[TASK_PROFILER_MAX_HEAP_TOTALS];
+  std::size_t numTotals = 0;
+
+  heap_task_info_params_t params = {};
+  params.caps[0]                 = MALLOC_CAP_8BIT;
+  params.mask[0]                 = MALLOC_CAP_8BIT;
+  params.totals                  = totals;
+  params.num_totals              = &numTotals;
+  params.max_totals              = TASK_PROFILER_MAX_HEAP_TOTALS;
+
+  heap_caps_get_per_task_info(&params);
+
+  for (std::size_t i = 0; i < stats.size(); i++) {
+    stats[i].heapBytes = 0;
+    for (std::size_t j = 0; j < numTotals; j++) {
+      if (totals[j].task == handles[i]) {
+        stats[i].heapBytes = static_cast<int32_t>(totals[j].size[0]);
+        break;
+      }
+    }
+  }
+}
+#endif
+
+bool TaskProfiler::GetTaskStats(std::vector<TaskStats>& out)
+{
+#if configUSE_TRACE_FACILITY
+  ScopedLock lock__(&s_sampleMutex);
+
+  // Slack for tasks created while sampling
+  std::vector<TaskStatus_t> statuses(uxTaskGetNumberOfTasks() + 4);
+
+  portENTER_CRITICAL_SAFE(&s_tasksLock);
+  uint32_t sampleSequence = s_nextSequence;
+  portEXIT_CRITICAL_SAFE(&s_tasksLock);
+
+  uint32_t totalRunTime = 0;
+  UBaseType_t count     = uxTaskGetSystemState(statuses.data(), statuses.size(), &totalRunTime);
+  if (count == 0) {
+    OS_LOGE(TAG, "Failed to get task states");
+    return false;
+  }
+
+  statuses.resize(count);
+
+  _pruneRegisteredTasks(statuses, sampleSequence);
+
+#if configGENERATE_RUN_TIME_STATS
+  uint32_t totalDelta = totalRunTime - s_lastTotalRunTime;
+
+  std::vector<RunTimeSample> runTimes;
+  runTimes.reserve(count);
+#endif
+
+#if CONFIG_HEAP_TASK_TRACKING
+  std::vector<TaskHandle_t> handles;
+  handles.reserve(count);
+#endif
+
+  out.clear();
+  out.reserve(count);
+
+  for (const TaskStatus_t& status : statuses) {
+    TaskStats stats;
+    stats.name           = status.pcTaskName;
+    stats.priority       = status.uxCurrentPriority;
+    stats.stackSize      = 0;
+    stats.stackHighWater = status.usStackHighWaterMark;  // Bytes, stacks are byte arrays on ESP-IDF
+    stats.cpuPermille    = -1;
+    stats.heapBytes      = -1;
+#if configTASKLIST_INCLUDE_COREID
+    stats.core = status.xCoreID;
+#else
+    stats.core = tskNO_AFFINITY;
+#endif
+
+    RegisteredTask registered;
+    if (_findRegisteredTask(status.xHandle, registered)) {
+      stats.stackSize = registered.stackSize;
+      stats.core      = registered.core;
+    }
+
+#if configGENERATE_RUN_TIME_STATS
+    // Tasks seen for the first time are measured since they started
+    uint32_t lastRunTime = 0;
+    auto it              = std::find_if(s_lastRunTimes.begin(), s_lastRunTimes.end(), [&status](const RunTimeSample& sample) { return sample.handle == status.xHandle; });
+    if (it != s_lastRunTimes.end() && it->runTime <= status.ulRunTimeCounter) {
+      lastRunTime = it->runTime;
+    }
+
+    if (totalDelta != 0) {
+      stats.cpuPermille = static_cast<int32_t>(static_cast<uint64_t>(status.ulRunTimeCounter - lastRunTime) * 1000 / totalDelta);
+    }
+
+    runTimes.push_back({status.xHandle, status.ulRunTimeCounter});
+#endif
+
+#if CONFIG_HEAP_TASK_TRACKING
+    handles.push_back(status.xHandle);
+#endif
+    out.push_back(std::move(stats));
+  }
+
+#if CONFIG_HEAP_TASK_TRACKING
+  _fillHeapUsage(out, handles);
+#endif
+
+#if configGENERATE_RUN_TIME_STATS
+  // Exited tasks drop out here
+  s_lastRunTimes     = std::move(runTimes);
+  s_lastTotalRunTime = totalRunTime;
+#endif
+
+  std::sort(out.begin(), out.end(), [](const TaskStats& a, const TaskStats& b) { return a.name < b.name; });
+
+  return true;
+#else
+  OS_LOGW(TAG, "Task profiling requires CONFIG_FREERTOS_USE_TRACE_FACILITY");
+  return false;
+#endif
+}
@@ -2,17 +2,37 @@
 
 #include "util/TaskUtils.h"
 
+#include "util/TaskProfiler.h"
+
 using namespace OpenShock;
 
 /// @brief Create a task on the specified core, or the default core if the specified core is invalid
 BaseType_t TaskUtils::TaskCreateUniversal(TaskFunction_t pvTaskCode, const char* const pcName, const uint32_t usStackDepth, void* const pvParameters, UBaseType_t uxPriority, TaskHandle_t* const pvCreatedTask, const BaseType_t xCoreID)
 {
+  // The profiler needs the handle even if the caller doesn't want it. The caller's is still written by FreeRTOS itself, before the new task can run
+  TaskHandle_t localHandle = nullptr;
+  TaskHandle_t* handle     = pvCreatedTask != nullptr ? pvCreatedTask : &localHandle;
+  BaseType_t coreID        = tskNO_AFFINITY;
+  BaseType_t result;
+
 #ifndef CONFIG_FREERTOS_UNICORE
   if (xCoreID >= 0 && xCoreID < portNUM_PROCESSORS) {
-    return xTaskCreatePinnedToCore(pvTaskCode, pcName, usStackDepth, pvParameters, uxPriority, pvCreatedTask, xCoreID);
+    coreID = xCoreID;
   }
 #endif
-  return xTaskCreate(pvTaskCode, pcName, usStackDepth, pvParameters, uxPriority, pvCreatedTask);
+
+  if (coreID != tskNO_AFFINITY) {
+    result = xTaskCreatePinnedToCore(pvTaskCode, pcName, usStackDepth, pvParameters, uxPriority, handle, coreID);
+  } else {
+    result = xTaskCreate(pvTaskCode, pcName, usStackDepth, pvParameters, uxPriority, handle);
+  }
+
+  // A task that already ran and cleared the caller's handle is simply not tracked
+  if (result == pdPASS && *handle != nullptr) {
+    TaskProfiler::RegisterTask(*handle, pcName, usStackDepth, coreID);
+  }
+
+  return result;
 }
 
 /// @brief Create a task on the core that does expensive work, this should not run on the core that handles WiFi
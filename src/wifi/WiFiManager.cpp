@@ -11,6 +11,7 @@ const char* const TAG = "WiFiManager";
 #include "util/TaskUtils.h"
 #include "VisualStateManager.h"
 #include "wifi/WiFiNetwork.h"
+#include "wifi/WiFiNetworkTable.h"
 #include "wifi/WiFiScanManager.h"
 
 #include <WiFi.h>
@@ -32,8 +33,10 @@ enum class WiFiState : uint8_t {
 static WiFiState s_wifiState            = WiFiState::Disconnected;
 static uint8_t s_connectedBSSID[6]      = {0};
 static uint8_t s_connectedCredentialsID = 0;
+static uint8_t s_connectedChannel       = 0;
 static uint8_t s_preferredCredentialsID = 0;
-static std::vector<WiFiNetwork> s_wifiNetworks;
+static uint8_t s_lastConnectionChannel  = 0;  // Channel of the last successful connection, scanned first when reconnecting
+static WiFiNetworkTable s_wifiNetworks;
 
 bool _isZeroBSSID(const uint8_t (&bssid)[6])
 {
@@ -46,18 +49,6 @@ bool _isZeroBSSID(const uint8_t (&bssid)[6])
   return true;
 }
 
-bool _attractivityComparer(const WiFiNetwork& a, const WiFiNetwork& b)
-{
-  if (a.credentialsID == 0) {
-    return false;
-  }
-
-  if (a.connectAttempts > b.connectAttempts) {
-    return false;
-  }
-
-  return a.rssi > b.rssi;
-}
 bool _isConnectRateLimited(const WiFiNetwork& net)
 {
   if (net.lastConnectAttempt == 0) {
@@ -77,42 +68,26 @@ bool _isSaved(std::function<bool(const Config::WiFiCredentials&)> predicate)
 {
   return Config::AnyWiFiCredentials(predicate);
 }
-std::vector<WiFiNetwork>::iterator _findNetwork(std::function<bool(WiFiNetwork&)> predicate, bool sortByAttractivity = true)
-{
-  if (sortByAttractivity) {
-    std::sort(s_wifiNetworks.begin(), s_wifiNetworks.end(), _attractivityComparer);
-  }
-  return std::find_if(s_wifiNetworks.begin(), s_wifiNetworks.end(), predicate);
-}
-std::vector<WiFiNetwork>::iterator _findNetworkBySSID(const char* ssid, bool sortByAttractivity = true)
+const WiFiNetwork* _findNetworkBySSID(const char* ssid)
 {
-  return _findNetwork([ssid](const WiFiNetwork& net) { return strcmp(net.ssid, ssid) == 0; }, sortByAttractivity);
+  return s_wifiNetworks.findBest([ssid](const WiFiNetwork& net) { return strcmp(net.ssid, ssid) == 0; });
 }
-std::vector<WiFiNetwork>::iterator _findNetworkByBSSID(const uint8_t (&bssid)[6])
+const WiFiNetwork* _findNetworkByCredentialsID(uint8_t credentialsID)
 {
-  return _findNetwork([bssid](const WiFiNetwork& net) { return memcmp(net.bssid, bssid, sizeof(bssid)) == 0; }, false);
-}
-std::vector<WiFiNetwork>::iterator _findNetworkByCredentialsID(uint8_t credentialsID, bool sortByAttractivity = true)
-{
-  return _findNetwork([credentialsID](const WiFiNetwork& net) { return net.credentialsID == credentialsID; }, sortByAttractivity);
+  return s_wifiNetworks.findBest([credentialsID](const WiFiNetwork& net) { return net.credentialsID == credentialsID; });
 }
 
 bool _markNetworkAsAttempted(const uint8_t (&bssid)[6])
 {
-  auto it = _findNetworkByBSSID(bssid);
-  if (it == s_wifiNetworks.end()) {
-    return false;
-  }
-
-  it->connectAttempts++;
-  it->lastConnectAttempt = OpenShock::millis();
-
-  return true;
+  return s_wifiNetworks.modify(bssid, [](WiFiNetwork& net) {
+    net.connectAttempts++;
+    net.lastConnectAttempt = OpenShock::millis();
+  });
 }
 
 bool _getNextWiFiNetwork(OpenShock::Config::WiFiCredentials& creds)
 {
-  return _findNetwork([&creds](const WiFiNetwork& net) {
+  return s_wifiNetworks.findBest([&creds](const WiFiNetwork& net) {
     if (net.credentialsID == 0) {
       return false;
     }
@@ -126,7 +101,7 @@ bool _getNextWiFiNetwork(OpenShock::Config::WiFiCredentials& creds)
     }
 
     return true;
-  }) != s_wifiNetworks.end();
+  }) != nullptr;
 }
 
 bool _connectImpl(const char* ssid, const char* password, const uint8_t (&bssid)[6])
@@ -162,13 +137,13 @@ bool _connect(const std::string& ssid, const std::string& password)
     return false;
   }
 
-  auto it = _findNetworkBySSID(ssid.c_str());
-  if (it == s_wifiNetworks.end()) {
+  const WiFiNetwork* net = _findNetworkBySSID(ssid.c_str());
+  if (net == nullptr) {
     OS_LOGE(TAG, "Failed to find network with SSID %s", ssid.c_str());
     return false;
   }
 
-  return _connectImpl(ssid.c_str(), password.c_str(), it->bssid);
+  return _connectImpl(ssid.c_str(), password.c_str(), net->bssid);
 }
 bool _connect(const uint8_t (&bssid)[6], const std::string& password)
 {
@@ -177,13 +152,13 @@ bool _connect(const uint8_t (&bssid)[6], const std::string& password)
     return false;
   }
 
-  auto it = _findNetworkByBSSID(bssid);
-  if (it == s_wifiNetworks.end()) {
+  const WiFiNetwork* net = s_wifiNetworks.find(bssid);
+  if (net == nullptr) {
     OS_LOGE(TAG, "Failed to find network " BSSID_FMT, BSSID_ARG(bssid));
     return false;
   }
 
-  return _connectImpl(it->ssid, password.c_str(), bssid);
+  return _connectImpl(net->ssid, password.c_str(), bssid);
 }
 
 bool _authenticate(const WiFiNetwork& net, std::string_view password)
@@ -205,21 +180,30 @@ void _evWiFiConnected(arduino_event_t* event)
 
   s_wifiState = WiFiState::Connected;
   memcpy(s_connectedBSSID, info.bssid, sizeof(s_connectedBSSID));
+  s_connectedChannel = info.channel;
 
-  auto it = _findNetworkByBSSID(info.bssid);
-  if (it == s_wifiNetworks.end()) {
-    s_connectedCredentialsID = 0;
+  // Only connects we attempted count as successes, so a network never has more successes than attempts
+  bool found = s_wifiNetworks.modify(info.bssid, [](WiFiNetwork& net) {
+    if (net.connectSuccesses < net.connectAttempts) {
+      net.connectSuccesses++;
+    }
+  });
+  if (!found) {
+    // Expected after a direct connect to the last network, which skips scanning
+    s_connectedCredentialsID = Config::GetWiFiCredentialsIDbySSID(reinterpret_cast<const char*>(info.ssid));
 
-    OS_LOGW(TAG, "Connected to unscanned network \"%s\", BSSID: " BSSID_FMT, reinterpret_cast<char*>(info.ssid), BSSID_ARG(info.bssid));
+    OS_LOGI(TAG, "Connected to unscanned network \"%s\", BSSID: " BSSID_FMT, reinterpret_cast<char*>(info.ssid), BSSID_ARG(info.bssid));
 
     return;
   }
 
-  s_connectedCredentialsID = it->credentialsID;
+  const WiFiNetwork* net = s_wifiNetworks.find(info.bssid);
+
+  s_connectedCredentialsID = net->credentialsID;
 
   OS_LOGI(TAG, "Connected to network %s (" BSSID_FMT ")", reinterpret_cast<const char*>(info.ssid), BSSID_ARG(info.bssid));
 
-  Serialization::Local::SerializeWiFiNetworkEvent(Serialization::Types::WifiNetworkEventType::Connected, *it, CaptivePortal::BroadcastMessageBIN);
+  Serialization::Local::SerializeWiFiNetworkEvent(Serialization::Types::WifiNetworkEventType::Connected, *net, CaptivePortal::BroadcastMessageBIN);
 }
 void _evWiFiGotIP(arduino_event_t* event)
 {
@@ -228,7 +212,14 @@ void _evWiFiGotIP(arduino_event_t* event)
   uint8_t ip[4];
   memcpy(ip, &info.ip_info.ip.addr, sizeof(ip));
 
-  OS_LOGI(TAG, "Got IP address " IPV4ADDR_FMT " from network " BSSID_FMT, IPV4ADDR_ARG(ip), BSSID_ARG(s_connectedBSSID));
+  OS_LOGI(TAG, "Got IP address " IPV4ADDR_FMT " from network " BSSID_FMT " (%lld ms after boot)", IPV4ADDR_ARG(ip), BSSID_ARG(s_connectedBSSID), OpenShock::millis());
+
+  if (s_connectedCredentialsID != 0) {
+    s_lastConnectionChannel = s_connectedChannel;
+    if (!Config::SetWiFiLastConnection(s_connectedCredentialsID, s_connectedBSSID, s_connectedChannel)) {
+      OS_LOGW(TAG, "Failed to save last connection, next boot will have to scan");
+    }
+  }
 }
 void _evWiFiGotIP6(arduino_event_t* event)
 {
@@ -267,21 +258,16 @@ void _evWiFiScanStatusChanged(OpenShock::WiFiScanStatus status)
 {
   // If the scan started, remove any networks that have not been seen in 3 scans
   if (status == OpenShock::WiFiScanStatus::Started) {
-    for (auto it = s_wifiNetworks.begin(); it != s_wifiNetworks.end();) {
-      if (it->scansMissed++ > 3) {
-        OS_LOGV(TAG, "Network %s (" BSSID_FMT ") has not been seen in 3 scans, removing from list", it->ssid, BSSID_ARG(it->bssid));
-        Serialization::Local::SerializeWiFiNetworkEvent(Serialization::Types::WifiNetworkEventType::Lost, *it, CaptivePortal::BroadcastMessageBIN);
-        it = s_wifiNetworks.erase(it);
-      } else {
-        ++it;
+    s_wifiNetworks.removeIf([](const WiFiNetwork& net) {
+      if (net.scansMissed <= 3) {
+        return false;
       }
-    }
-  }
 
-  // If the scan completed, sort the networks by RSSI
-  if (status == OpenShock::WiFiScanStatus::Completed || status == OpenShock::WiFiScanStatus::Aborted || status == OpenShock::WiFiScanStatus::Error) {
-    // Sort the networks by RSSI
-    std::sort(s_wifiNetworks.begin(), s_wifiNetworks.end(), [](const WiFiNetwork& a, const WiFiNetwork& b) { return a.rssi > b.rssi; });
+      OS_LOGV(TAG, "Network %s (" BSSID_FMT ") has not been seen in 3 scans, removing from list", net.ssid, BSSID_ARG(net.bssid));
+      Serialization::Local::SerializeWiFiNetworkEvent(Serialization::Types::WifiNetworkEventType::Lost, net, CaptivePortal::BroadcastMessageBIN);
+      return true;
+    });
+    s_wifiNetworks.modifyAll([](WiFiNetwork& net) { net.scansMissed++; });
   }
 
   // Send the scan status changed event
@@ -295,29 +281,17 @@ void _evWiFiNetworksDiscovery(const std::vector<const wifi_ap_record_t*>& record
   for (const wifi_ap_record_t* record : records) {
     uint8_t credsId = Config::GetWiFiCredentialsIDbySSID(reinterpret_cast<const char*>(record->ssid));
 
-    auto it = _findNetworkByBSSID(record->bssid);
-    if (it != s_wifiNetworks.end()) {
-      // Update the network
-      memcpy(it->ssid, record->ssid, sizeof(it->ssid));
-      it->channel       = record->primary;
-      it->rssi          = record->rssi;
-      it->authMode      = record->authmode;
-      it->credentialsID = credsId;  // TODO: I don't understand why I need to set this here, but it seems to fix a bug where the credentials ID is not set correctly
-      it->scansMissed   = 0;
+    WiFiNetwork network(record->ssid, record->bssid, record->primary, record->rssi, record->authmode, credsId);
 
-      updatedNetworks.push_back(*it);
-      OS_LOGV(TAG, "Updated network %s (" BSSID_FMT ") with new scan info", it->ssid, BSSID_ARG(it->bssid));
+    if (!s_wifiNetworks.upsert(network)) {
+      updatedNetworks.push_back(*s_wifiNetworks.find(record->bssid));
+      OS_LOGV(TAG, "Updated network %s (" BSSID_FMT ") with new scan info", network.ssid, BSSID_ARG(network.bssid));
 
       continue;
     }
 
-    WiFiNetwork network(record->ssid, record->bssid, record->primary, record->rssi, record->authmode, credsId);
-
     discoveredNetworks.push_back(network);
     OS_LOGV(TAG, "Discovered new network %s (" BSSID_FMT ")", network.ssid, BSSID_ARG(network.bssid));
-
-    // Insert the network into the list of networks sorted by RSSI
-    s_wifiNetworks.insert(std::lower_bound(s_wifiNetworks.begin(), s_wifiNetworks.end(), network, [](const WiFiNetwork& a, const WiFiNetwork& b) { return a.rssi > b.rssi; }), std::move(network));
   }
 
   if (!updatedNetworks.empty()) {
@@ -330,6 +304,60 @@ void _evWiFiNetworksDiscovery(const std::vector<const wifi_ap_record_t*>& record
 
 esp_err_t set_esp_interface_dns(esp_interface_t interface, IPAddress main_dns, IPAddress backup_dns, IPAddress fallback_dns);
 
+/// @brief Channels saved networks were last seen on, so a reconnect can scan those before the rest
+uint16_t _getSavedNetworkChannelMask()
+{
+  uint16_t mask = 0;
+
+  if (s_lastConnectionChannel != 0) {
+    mask |= 1 << s_lastConnectionChannel;
+  }
+
+  // Saved networks rank first, so the search stops at the first unsaved one
+  s_wifiNetworks.findBest([&mask](const WiFiNetwork& net) {
+    if (net.credentialsID == 0) {
+      return true;
+    }
+
+    if (net.channel != 0) {
+      mask |= 1 << net.channel;
+    }
+
+    return false;
+  });
+
+  return mask;
+}
+
+/// @brief Connects straight to the access point of the last successful connection, skipping the scan
+bool _tryConnectLast()
+{
+  uint8_t credentialsID;
+  uint8_t bssid[6];
+  uint8_t channel;
+  if (!Config::GetWiFiLastConnection(credentialsID, bssid, channel)) {
+    return false;
+  }
+
+  Config::WiFiCredentials creds;
+  if (!Config::TryGetWiFiCredentialsByID(credentialsID, creds)) {
+    OS_LOGV(TAG, "Credentials of the last connection were removed");
+    return false;
+  }
+
+  s_lastConnectionChannel = channel;
+
+  OS_LOGV(TAG, "Connecting to last network %s (" BSSID_FMT ") on channel %u", creds.ssid.c_str(), BSSID_ARG(bssid), channel);
+
+  s_wifiState = WiFiState::Connecting;
+  if (WiFi.begin(creds.ssid.c_str(), creds.password.c_str(), channel, bssid, true) == WL_CONNECT_FAILED) {
+    s_wifiState = WiFiState::Disconnected;
+    return false;
+  }
+
+  return true;
+}
+
 bool _tryConnect()
 {
   Config::WiFiCredentials creds;
@@ -359,16 +387,29 @@ bool _tryConnect()
 
 void _wifimanagerUpdateTask(void*)
 {
-  int64_t lastScanRequest = 0;
+  int64_t lastScanRequest  = 0;
+  bool lastScanWasTargeted = false;
   while (true) {
     if (s_wifiState == WiFiState::Disconnected && !WiFiScanManager::IsScanning()) {
-      if (!_tryConnect()) {
+      if (_tryConnect()) {
+        lastScanWasTargeted = false;
+      } else {
         int64_t now = OpenShock::millis();
-        if (lastScanRequest == 0 || now - lastScanRequest > 30'000) {
+        if (lastScanWasTargeted) {
+          // Saved networks weren't where they were last seen, look everywhere without waiting
+          lastScanRequest     = now;
+          lastScanWasTargeted = false;
+
+          OS_LOGV(TAG, "No saved networks on their last channels, starting full scan...");
+          WiFiScanManager::StartScan();
+        } else if (lastScanRequest == 0 || now - lastScanRequest > 30'000) {
           lastScanRequest = now;
 
+          uint16_t channelMask = _getSavedNetworkChannelMask();
+          lastScanWasTargeted  = channelMask != 0;
+
           OS_LOGV(TAG, "No networks to connect to, starting scan...");
-          WiFiScanManager::StartScan();
+          WiFiScanManager::StartScan(channelMask);
         }
       }
     }
@@ -390,23 +431,24 @@ bool WiFiManager::Init()
     return false;
   }
 
-  std::string hostname;
-  if (!Config::GetWiFiHostname(hostname)) {
-    OS_LOGE(TAG, "Failed to get WiFi hostname, reverting to default");
-    hostname = OPENSHOCK_FW_HOSTNAME;
-  }
-
   WiFi.setAutoConnect(false);
   WiFi.setAutoReconnect(false);
   WiFi.enableSTA(true);
-  WiFi.setHostname(hostname.c_str());
-
-  // If we recognize the network in the ESP's WiFi cache, try to connect to it
-  wifi_config_t current_conf;
-  if (esp_wifi_get_config(static_cast<wifi_interface_t>(ESP_IF_WIFI_STA), &current_conf) == ESP_OK) {
-    if (current_conf.sta.ssid[0] != '\0') {
-      if (Config::GetWiFiCredentialsIDbySSID(reinterpret_cast<const char*>(current_conf.sta.ssid)) != 0) {
-        WiFi.begin();
+
+  {
+    // Strings in the snapshot are null-terminated, and setHostname copies it
+    Config::Snapshot config = Config::GetSnapshot();
+    WiFi.setHostname(config != nullptr ? config->wifiHostname().data() : OPENSHOCK_FW_HOSTNAME);
+  }
+
+  // Reconnect to where we were last connected, falling back to the network in the ESP's WiFi cache if we recognize it
+  if (!_tryConnectLast()) {
+    wifi_config_t current_conf;
+    if (esp_wifi_get_config(static_cast<wifi_interface_t>(ESP_IF_WIFI_STA), &current_conf) == ESP_OK) {
+      if (current_conf.sta.ssid[0] != '\0') {
+        if (Config::GetWiFiCredentialsIDbySSID(reinterpret_cast<const char*>(current_conf.sta.ssid)) != 0) {
+          WiFi.begin();
+        }
       }
     }
   }
@@ -428,8 +470,8 @@ bool WiFiManager::Save(const char* ssid, std::string_view password)
 {
   OS_LOGV(TAG, "Authenticating to network %s", ssid);
 
-  auto it = _findNetworkBySSID(ssid);
-  if (it == s_wifiNetworks.end()) {
+  const WiFiNetwork* net = _findNetworkBySSID(ssid);
+  if (net == nullptr) {
     OS_LOGE(TAG, "Failed to find network with SSID %s", ssid);
 
     Serialization::Local::SerializeErrorMessage("network_not_found", CaptivePortal::BroadcastMessageBIN);
@@ -437,20 +479,21 @@ bool WiFiManager::Save(const char* ssid, std::string_view password)
     return false;
   }
 
-  return _authenticate(*it, password);
+  // Copied, saving the credentials refreshes the table entry it points to
+  return _authenticate(WiFiNetwork(*net), password);
 }
 
 bool WiFiManager::Forget(const char* ssid)
 {
   OS_LOGV(TAG, "Forgetting network %s", ssid);
 
-  auto it = _findNetworkBySSID(ssid);
-  if (it == s_wifiNetworks.end()) {
+  const WiFiNetwork* net = _findNetworkBySSID(ssid);
+  if (net == nullptr) {
     OS_LOGE(TAG, "Failed to find network with SSID %s", ssid);
     return false;
   }
 
-  uint8_t credsId = it->credentialsID;
+  uint8_t credsId = net->credentialsID;
 
   // Check if the network is currently connected
   if (s_connectedCredentialsID == credsId) {
@@ -460,8 +503,16 @@ bool WiFiManager::Forget(const char* ssid)
 
   // Remove the credentials from the config
   if (Config::RemoveWiFiCredentials(credsId)) {
-    it->credentialsID = 0;
-    Serialization::Local::SerializeWiFiNetworkEvent(Serialization::Types::WifiNetworkEventType::Removed, *it, CaptivePortal::BroadcastMessageBIN);
+    WiFiNetwork removed   = *net;
+    removed.credentialsID = 0;
+
+    s_wifiNetworks.modifyAll([credsId](WiFiNetwork& other) {
+      if (other.credentialsID == credsId) {
+        other.credentialsID = 0;
+      }
+    });
+
+    Serialization::Local::SerializeWiFiNetworkEvent(Serialization::Types::WifiNetworkEventType::Removed, removed, CaptivePortal::BroadcastMessageBIN);
   }
 
   return true;
@@ -471,7 +522,7 @@ bool WiFiManager::RefreshNetworkCredentials()
 {
   OS_LOGV(TAG, "Refreshing network credentials");
 
-  for (auto& net : s_wifiNetworks) {
+  s_wifiNetworks.modifyAll([](WiFiNetwork& net) {
     Config::WiFiCredentials creds;
     if (Config::TryGetWiFiCredentialsBySSID(net.ssid, creds)) {
       OS_LOGV(TAG, "Found credentials for network %s (" BSSID_FMT ")", net.ssid, BSSID_ARG(net.bssid));
@@ -480,7 +531,7 @@ bool WiFiManager::RefreshNetworkCredentials()
       OS_LOGV(TAG, "Failed to find credentials for network %s (" BSSID_FMT ")", net.ssid, BSSID_ARG(net.bssid));
       net.credentialsID = 0;
     }
-  }
+  });
 
   return true;
 }
@@ -514,15 +565,15 @@ bool WiFiManager::Connect(const char* ssid)
 
 bool WiFiManager::Connect(const uint8_t (&bssid)[6])
 {
-  auto it = _findNetworkByBSSID(bssid);
-  if (it == s_wifiNetworks.end()) {
+  const WiFiNetwork* net = s_wifiNetworks.find(bssid);
+  if (net == nullptr) {
     OS_LOGE(TAG, "Failed to find network " BSSID_FMT, BSSID_ARG(bssid));
     return false;
   }
 
   Config::WiFiCredentials creds;
-  if (!Config::TryGetWiFiCredentialsBySSID(it->ssid, creds)) {
-    OS_LOGE(TAG, "Failed to find credentials for network %s (" BSSID_FMT ")", it->ssid, BSSID_ARG(it->bssid));
+  if (!Config::TryGetWiFiCredentialsBySSID(net->ssid, creds)) {
+    OS_LOGE(TAG, "Failed to find credentials for network %s (" BSSID_FMT ")", net->ssid, BSSID_ARG(net->bssid));
     return false;
   }
 
@@ -551,25 +602,26 @@ bool WiFiManager::IsConnected()
 }
 bool WiFiManager::GetConnectedNetwork(OpenShock::WiFiNetwork& network)
 {
-  if (s_connectedCredentialsID == 0) {
-    if (IsConnected()) {
-      // We connected without a scan, so populate the network with the current connection info manually
-      network.credentialsID = 0;
-      memcpy(network.ssid, WiFi.SSID().c_str(), WiFi.SSID().length() + 1);
-      memcpy(network.bssid, WiFi.BSSID(), sizeof(network.bssid));
-      network.channel = WiFi.channel();
-      network.rssi    = WiFi.RSSI();
-      return true;
-    }
-    return false;
+  const WiFiNetwork* net = nullptr;
+  if (s_connectedCredentialsID != 0) {
+    net = _findNetworkByCredentialsID(s_connectedCredentialsID);
   }
 
-  auto it = _findNetwork([](const WiFiNetwork& net) { return net.credentialsID == s_connectedCredentialsID; });
-  if (it == s_wifiNetworks.end()) {
-    return false;
+  if (net == nullptr) {
+    if (!IsConnected()) {
+      return false;
+    }
+
+    // We connected without a scan (e.g. directly to the last network), so populate the network with the current connection info manually
+    network.credentialsID = s_connectedCredentialsID;
+    memcpy(network.ssid, WiFi.SSID().c_str(), WiFi.SSID().length() + 1);
+    memcpy(network.bssid, WiFi.BSSID(), sizeof(network.bssid));
+    network.channel = WiFi.channel();
+    network.rssi    = WiFi.RSSI();
+    return true;
   }
 
-  network = *it;
+  network = *net;
 
   return true;
 }
@@ -601,5 +653,5 @@ bool WiFiManager::GetIPv6Address(char* ipAddress)
 
 std::vector<WiFiNetwork> WiFiManager::GetDiscoveredWiFiNetworks()
 {
-  return s_wifiNetworks;
+  return s_wifiNetworks.toVector();
 }
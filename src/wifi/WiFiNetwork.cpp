@@ -6,13 +6,13 @@
 
 using namespace OpenShock;
 
-WiFiNetwork::WiFiNetwork() : ssid {0}, bssid {0}, channel(0), rssi(0), authMode(WIFI_AUTH_MAX), credentialsID(0), connectAttempts(0), lastConnectAttempt(0), scansMissed(0) {
+WiFiNetwork::WiFiNetwork() : ssid {0}, bssid {0}, channel(0), rssi(0), authMode(WIFI_AUTH_MAX), credentialsID(0), connectAttempts(0), connectSuccesses(0), lastConnectAttempt(0), scansMissed(0) {
   memset(ssid, 0, sizeof(ssid));
   memset(bssid, 0, sizeof(bssid));
 }
 
 WiFiNetwork::WiFiNetwork(const wifi_ap_record_t* apRecord, uint8_t credentialsId)
-  : ssid {0}, bssid {0}, channel(apRecord->primary), rssi(apRecord->rssi), authMode(apRecord->authmode), credentialsID(credentialsId), connectAttempts(0), lastConnectAttempt(0), scansMissed(0) {
+  : ssid {0}, bssid {0}, channel(apRecord->primary), rssi(apRecord->rssi), authMode(apRecord->authmode), credentialsID(credentialsId), connectAttempts(0), connectSuccesses(0), lastConnectAttempt(0), scansMissed(0) {
   static_assert(sizeof(ssid) == sizeof(apRecord->ssid) && sizeof(ssid) == 33, "SSID buffers must be 33 bytes long! (32 bytes for the SSID + 1 byte for the null terminator)");
   static_assert(sizeof(bssid) == sizeof(apRecord->bssid) && sizeof(bssid) == 6, "BSSIDs must be 6 bytes long!");
 
@@ -21,7 +21,7 @@ WiFiNetwork::WiFiNetwork(const wifi_ap_record_t* apRecord, uint8_t credentialsId
 }
 
 WiFiNetwork::WiFiNetwork(const char (&ssid)[33], const uint8_t (&bssid)[6], uint8_t channel, int8_t rssi, wifi_auth_mode_t authMode, uint8_t credentialsId)
-  : ssid {0}, bssid {0}, channel(channel), rssi(rssi), authMode(authMode), credentialsID(credentialsId), connectAttempts(0), lastConnectAttempt(0), scansMissed(0) {
+  : ssid {0}, bssid {0}, channel(channel), rssi(rssi), authMode(authMode), credentialsID(credentialsId), connectAttempts(0), connectSuccesses(0), lastConnectAttempt(0), scansMissed(0) {
   static_assert(sizeof(ssid) == sizeof(this->ssid) && sizeof(ssid) == 33, "SSID buffers must be 33 bytes long! (32 bytes for the SSID + 1 byte for the null terminator)");
   static_assert(sizeof(bssid) == sizeof(this->bssid) && sizeof(bssid) == 6, "BSSIDs must be 6 bytes long!");
 
@@ -0,0 +1,232 @@
+#include "wifi/WiFiNetworkTable.h"
+
+#include <cstring>
+
+using namespace OpenShock;
+
+const std::size_t WIFI_NETWORK_TABLE_INITIAL_SLOTS = 32;  // Keeps the index at most half full, like the capacity it doubles to
+
+static std::size_t _hashBSSID(const uint8_t (&bssid)[6])
+{
+  // FNV-1a, the vendor prefix alone would cluster access points of the same brand
+  uint32_t hash = 2'166'136'261U;
+  for (uint8_t byte : bssid) {
+    hash ^= byte;
+    hash *= 16'777'619U;
+  }
+
+  return hash;
+}
+
+WiFiNetworkTable::WiFiNetworkTable()
+  : m_entries()
+  , m_freeEntries()
+  , m_slots(WIFI_NETWORK_TABLE_INITIAL_SLOTS, EmptySlot)
+  , m_rank(RankCompare {&m_entries})
+{
+}
+
+bool WiFiNetworkTable::IsMoreAttractive(const WiFiNetwork& a, const WiFiNetwork& b)
+{
+  bool aSaved = a.credentialsID != 0;
+  bool bSaved = b.credentialsID != 0;
+  if (aSaved != bSaved) {
+    return aSaved;
+  }
+
+  uint16_t aFailures = a.connectAttempts - a.connectSuccesses;
+  uint16_t bFailures = b.connectAttempts - b.connectSuccesses;
+  if (aFailures != bFailures) {
+    return aFailures < bFailures;
+  }
+
+  if (a.rssi != b.rssi) {
+    return a.rssi > b.rssi;
+  }
+
+  // Tie-breaker, entries in the ranking must never compare equal
+  return memcmp(a.bssid, b.bssid, sizeof(a.bssid)) < 0;
+}
+
+std::size_t WiFiNetworkTable::_findSlot(const uint8_t (&bssid)[6]) const
+{
+  std::size_t mask = m_slots.size() - 1;
+  std::size_t slot = _hashBSSID(bssid) & mask;
+
+  while (m_slots[slot] != EmptySlot) {
+    if (memcmp(m_entries[m_slots[slot]].bssid, bssid, sizeof(bssid)) == 0) {
+      return slot;
+    }
+    slot = (slot + 1) & mask;
+  }
+
+  return slot;
+}
+
+void WiFiNetworkTable::_insertIndex(uint16_t entry)
+{
+  if ((m_rank.size() + 1) * 2 > m_slots.size()) {
+    _growIndex();
+  }
+
+  m_slots[_findSlot(m_entries[entry].bssid)] = entry;
+}
+
+void WiFiNetworkTable::_removeIndex(std::size_t slot)
+{
+  std::size_t mask = m_slots.size() - 1;
+
+  // Backward-shift deletion, moves later entries of the probe sequence into the hole so lookups never need tombstones
+  std::size_t hole = slot;
+  std::size_t next = (slot + 1) & mask;
+  while (m_slots[next] != EmptySlot) {
+    std::size_t home = _hashBSSID(m_entries[m_slots[next]].bssid) & mask;
+
+    // Move the entry if the hole lies between its home slot and where it currently is
+    if (((next - home) & mask) >= ((next - hole) & mask)) {
+      m_slots[hole] = m_slots[next];
+      hole          = next;
+    }
+
+    next = (next + 1) & mask;
+  }
+
+  m_slots[hole] = EmptySlot;
+}
+
+void WiFiNetworkTable::_growIndex()
+{
+  m_slots.assign(m_slots.size() * 2, EmptySlot);
+
+  for (uint16_t entry : m_rank) {
+    m_slots[_findSlot(m_entries[entry].bssid)] = entry;
+  }
+}
+
+const WiFiNetwork* WiFiNetworkTable::find(const uint8_t (&bssid)[6]) const
+{
+  uint16_t entry = m_slots[_findSlot(bssid)];
+  if (entry == EmptySlot) {
+    return nullptr;
+  }
+
+  return &m_entries[entry];
+}
+
+bool WiFiNetworkTable::upsert(const WiFiNetwork& network)
+{
+  std::size_t slot = _findSlot(network.bssid);
+  if (m_slots[slot] != EmptySlot) {
+    uint16_t entry   = m_slots[slot];
+    WiFiNetwork& net = m_entries[entry];
+
+    m_rank.erase(entry);
+
+    memcpy(net.ssid, network.ssid, sizeof(net.ssid));
+    net.channel       = network.channel;
+    net.rssi          = network.rssi;
+    net.authMode      = network.authMode;
+    net.credentialsID = network.credentialsID;
+    net.scansMissed   = 0;
+
+    m_rank.insert(entry);
+
+    return false;
+  }
+
+  uint16_t entry;
+  if (!m_freeEntries.empty()) {
+    entry = m_freeEntries.back();
+    m_freeEntries.pop_back();
+    m_entries[entry] = network;
+  } else {
+    entry = static_cast<uint16_t>(m_entries.size());
+    m_entries.push_back(network);
+  }
+
+  _insertIndex(entry);
+  m_rank.insert(entry);
+
+  return true;
+}
+
+bool WiFiNetworkTable::remove(const uint8_t (&bssid)[6])
+{
+  std::size_t slot = _findSlot(bssid);
+  uint16_t entry   = m_slots[slot];
+  if (entry == EmptySlot) {
+    return false;
+  }
+
+  m_rank.erase(entry);
+  _removeIndex(slot);
+  m_freeEntries.push_back(entry);
+
+  return true;
+}
+
+void WiFiNetworkTable::removeIf(const std::function<bool(const WiFiNetwork&)>& predicate)
+{
+  std::vector<uint16_t> removed;
+  for (uint16_t entry : m_rank) {
+    if (predicate(m_entries[entry])) {
+      removed.push_back(entry);
+    }
+  }
+
+  for (uint16_t entry : removed) {
+    remove(m_entries[entry].bssid);
+  }
+}
+
+bool WiFiNetworkTable::modify(const uint8_t (&bssid)[6], const std::function<void(WiFiNetwork&)>& fn)
+{
+  uint16_t entry = m_slots[_findSlot(bssid)];
+  if (entry == EmptySlot) {
+    return false;
+  }
+
+  WiFiNetwork& net = m_entries[entry];
+
+  m_rank.erase(entry);
+  fn(net);
+  memcpy(net.bssid, bssid, sizeof(net.bssid));  // The BSSID is the key and cannot change
+  m_rank.insert(entry);
+
+  return true;
+}
+
+void WiFiNetworkTable::modifyAll(const std::function<void(WiFiNetwork&)>& fn)
+{
+  std::vector<uint16_t> entries(m_rank.begin(), m_rank.end());
+
+  m_rank.clear();
+
+  for (uint16_t entry : entries) {
+    fn(m_entries[entry]);
+    m_rank.insert(entry);
+  }
+}
+
+const WiFiNetwork* WiFiNetworkTable::findBest(const std::function<bool(const WiFiNetwork&)>& predicate) const
+{
+  for (uint16_t entry : m_rank) {
+    if (predicate(m_entries[entry])) {
+      return &m_entries[entry];
+    }
+  }
+
+  return nullptr;
+}
+
+std::vector<WiFiNetwork> WiFiNetworkTable::toVector() const
+{
+  std::vector<WiFiNetwork> networks;
+  networks.reserve(m_rank.size());
+
+  for (uint16_t entry : m_rank) {
+    networks.push_back(m_entries[entry]);
+  }
+
+  return networks;
+}
@@ -15,6 +15,7 @@ const char* const TAG = "WiFiScanManager";
 const uint8_t OPENSHOCK_WIFI_SCAN_MAX_CHANNEL         = 13;
 const uint32_t OPENSHOCK_WIFI_SCAN_MAX_MS_PER_CHANNEL = 300;  // Adjusting this value will affect the scan rate, but may also affect the scan results
 const uint32_t OPENSHOCK_WIFI_SCAN_TIMEOUT_MS         = 10 * 1000;
+const uint16_t OPENSHOCK_WIFI_SCAN_ALL_CHANNELS       = ((1 << (OPENSHOCK_WIFI_SCAN_MAX_CHANNEL + 1)) - 1) & ~1;  // Bit n is channel n
 
 enum WiFiScanTaskNotificationFlags {
   CHANNEL_DONE  = 1 << 0,
@@ -27,6 +28,7 @@ static bool s_initialized                     = false;
 static TaskHandle_t s_scanTaskHandle          = nullptr;
 static OpenShock::SimpleMutex s_scanTaskMutex = {};
 static uint8_t s_currentChannel               = 0;
+static uint16_t s_channelMask                 = OPENSHOCK_WIFI_SCAN_ALL_CHANNELS;
 static std::map<uint64_t, OpenShock::WiFiScanManager::StatusChangedHandler> s_statusChangedHandlers;
 static std::map<uint64_t, OpenShock::WiFiScanManager::NetworksDiscoveredHandler> s_networksDiscoveredHandlers;
 
@@ -86,10 +88,22 @@ int16_t _scanChannel(uint8_t channel)
   return retval;
 }
 
+/// @brief Returns the next lower channel selected for this scan, or 0 once all of them have been scanned
+uint8_t _nextChannel(uint8_t channel)
+{
+  while (--channel > 0) {
+    if ((s_channelMask & (1 << channel)) != 0) {
+      return channel;
+    }
+  }
+
+  return 0;
+}
+
 WiFiScanStatus _scanningTaskImpl()
 {
   // Start the scan on the highest channel and work our way down
-  uint8_t channel = OPENSHOCK_WIFI_SCAN_MAX_CHANNEL;
+  uint8_t channel = _nextChannel(OPENSHOCK_WIFI_SCAN_MAX_CHANNEL + 1);
 
   // Start the scan on the first channel
   int16_t retval = _scanChannel(channel);
@@ -127,7 +141,8 @@ WiFiScanStatus _scanningTaskImpl()
     }
 
     // Select the next channel, or break if we're done
-    if (--channel <= 0) {
+    channel = _nextChannel(channel);
+    if (channel == 0) {
       break;
     }
 
@@ -235,7 +250,7 @@ bool WiFiScanManager::IsScanning()
   return s_scanTaskHandle != nullptr && eTaskGetState(s_scanTaskHandle) != eDeleted;
 }
 
-bool WiFiScanManager::StartScan()
+bool WiFiScanManager::StartScan(uint16_t channelMask)
 {
   ScopedLock lock__(&s_scanTaskMutex);
 
@@ -250,6 +265,10 @@ bool WiFiScanManager::StartScan()
     vTaskDelete(s_scanTaskHandle);
   }
 
+  // Only channels that exist are scanned, nothing left means a full scan
+  channelMask &= OPENSHOCK_WIFI_SCAN_ALL_CHANNELS;
+  s_channelMask = channelMask != 0 ? channelMask : OPENSHOCK_WIFI_SCAN_ALL_CHANNELS;
+
   // Start the scan task
   if (TaskUtils::TaskCreateExpensive(_scanningTask, "WiFiScanManager", 4096, nullptr, 1, &s_scanTaskHandle) != pdPASS) {  // PROFILED: 1.8KB stack usage
     OS_LOGE(TAG, "Failed to create scan task");
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstring>
+#include <string>
+
+// Only the parts of the Arduino String the host built components touch
+class String {
+public:
+  String(const char* cstr = "")
+    : m_buffer(cstr)
+  {
+  }
+  String(const char* cstr, unsigned int length)
+    : m_buffer(cstr, length)
+  {
+  }
+
+  const char* c_str() const { return m_buffer.c_str(); }
+  unsigned int length() const { return static_cast<unsigned int>(m_buffer.size()); }
+
+  bool operator==(const String& other) const { return m_buffer == other.m_buffer; }
+  bool operator!=(const String& other) const { return m_buffer != other.m_buffer; }
+
+private:
+  std::string m_buffer;
+};
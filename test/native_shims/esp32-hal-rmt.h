@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+
+// Same layout as the Arduino core, one RMT item holds two pulses
+typedef struct {
+  union {
+    struct {
+      uint32_t duration0 : 15;
+      uint32_t level0    : 1;
+      uint32_t duration1 : 15;
+      uint32_t level1    : 1;
+    };
+    uint32_t val;
+  };
+} rmt_data_t;
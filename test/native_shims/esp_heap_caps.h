@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#define MALLOC_CAP_8BIT     (1 << 2)
+#define MALLOC_CAP_SPIRAM   (1 << 10)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+#define MALLOC_CAP_DEFAULT  (1 << 12)
+
+// Behaves like a board without PSRAM
+inline void* heap_caps_malloc(std::size_t size, uint32_t caps)
+{
+  if ((caps & MALLOC_CAP_SPIRAM) != 0) {
+    return nullptr;
+  }
+
+  return malloc(size);
+}
+
+// The host heap has no fixed size, these report a 320KB heap that nothing has been allocated from
+inline std::size_t heap_caps_get_free_size(uint32_t caps)
+{
+  (void)caps;
+  return 320 * 1024;
+}
+
+inline std::size_t heap_caps_get_minimum_free_size(uint32_t caps)
+{
+  return heap_caps_get_free_size(caps);
+}
+
+inline std::size_t heap_caps_get_largest_free_block(uint32_t caps)
+{
+  return heap_caps_get_free_size(caps);
+}
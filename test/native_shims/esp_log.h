@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdarg>
+#include <cstdio>
+
+// Provided by the Arduino core on the device
+extern "C" inline int log_printf(const char* fmt, ...)
+{
+  va_list args;
+  va_start(args, fmt);
+  int len = vprintf(fmt, args);
+  va_end(args);
+
+  return len;
+}
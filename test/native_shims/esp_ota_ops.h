@@ -0,0 +1,3 @@
+#pragma once
+
+// Only needed by the Logging.h panic macros, which the host tests never use
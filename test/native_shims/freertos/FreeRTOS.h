@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+
+// One tick per millisecond, like the Arduino core configures FreeRTOS
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdFALSE ((BaseType_t)0)
+#define pdTRUE  ((BaseType_t)1)
+
+#define portMAX_DELAY     ((TickType_t)0xFFFFFFFF)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+// Critical sections are a plain mutex, the host has no interrupts to mask
+struct portMUX_TYPE {
+  std::mutex mutex;
+};
+
+#define portMUX_INITIALIZER_UNLOCKED {}
+
+#define portENTER_CRITICAL(mux)      (mux)->mutex.lock()
+#define portEXIT_CRITICAL(mux)       (mux)->mutex.unlock()
+#define portENTER_CRITICAL_SAFE(mux) portENTER_CRITICAL(mux)
+#define portEXIT_CRITICAL_SAFE(mux)  portEXIT_CRITICAL(mux)
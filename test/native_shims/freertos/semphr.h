@@ -0,0 +1,70 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+// Counting semaphore on a condition variable, mutexes and binary semaphores are counting semaphores with a maximum of one
+struct SemaphoreDefinition_t {
+  std::mutex mutex;
+  std::condition_variable available;
+  UBaseType_t count;
+  UBaseType_t maxCount;
+};
+
+typedef SemaphoreDefinition_t* SemaphoreHandle_t;
+
+inline SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount)
+{
+  SemaphoreHandle_t semaphore = new SemaphoreDefinition_t();
+  semaphore->count            = initialCount;
+  semaphore->maxCount         = maxCount;
+
+  return semaphore;
+}
+
+inline SemaphoreHandle_t xSemaphoreCreateBinary()
+{
+  return xSemaphoreCreateCounting(1, 0);
+}
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex()
+{
+  return xSemaphoreCreateCounting(1, 1);
+}
+
+inline void vSemaphoreDelete(SemaphoreHandle_t semaphore)
+{
+  delete semaphore;
+}
+
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t xTicksToWait)
+{
+  std::unique_lock<std::mutex> lock(semaphore->mutex);
+
+  auto hasToken = [semaphore] { return semaphore->count > 0; };
+  if (xTicksToWait == portMAX_DELAY) {
+    semaphore->available.wait(lock, hasToken);
+  } else if (!semaphore->available.wait_for(lock, std::chrono::milliseconds(xTicksToWait), hasToken)) {
+    return pdFALSE;
+  }
+
+  semaphore->count--;
+  return pdTRUE;
+}
+
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore)
+{
+  {
+    std::lock_guard<std::mutex> lock(semaphore->mutex);
+    if (semaphore->count >= semaphore->maxCount) {
+      return pdFALSE;
+    }
+    semaphore->count++;
+  }
+
+  semaphore->available.notify_one();
+  return pdTRUE;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct tskTaskControlBlock* TaskHandle_t;
+
+#define taskSCHEDULER_SUSPENDED   ((BaseType_t)0)
+#define taskSCHEDULER_NOT_STARTED ((BaseType_t)1)
+#define taskSCHEDULER_RUNNING     ((BaseType_t)2)
+
+// Every thread is a task, identified by a thread local of its own
+inline TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+  static thread_local char task;
+  return reinterpret_cast<TaskHandle_t>(&task);
+}
+
+// Tests only allocate from main onwards, so the scheduler is always running
+inline BaseType_t xTaskGetSchedulerState()
+{
+  return taskSCHEDULER_RUNNING;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+// The device uses the tinfl inflater in ROM, on the host its interface is mapped onto zlib (linked with -lz).
+// Only the streaming mode with a wrapping 32KB dictionary, as used by GzipDecompressor, is supported.
+
+#include <zlib.h>
+
+#include <cstddef>
+#include <cstdint>
+
+#define TINFL_LZ_DICT_SIZE        32768
+#define TINFL_FLAG_HAS_MORE_INPUT 2
+
+typedef enum {
+  TINFL_STATUS_FAILED_CANNOT_MAKE_PROGRESS = -4,
+  TINFL_STATUS_BAD_PARAM                   = -3,
+  TINFL_STATUS_ADLER32_MISMATCH            = -2,
+  TINFL_STATUS_FAILED                      = -1,
+  TINFL_STATUS_DONE                        = 0,
+  TINFL_STATUS_NEEDS_MORE_INPUT            = 1,
+  TINFL_STATUS_HAS_MORE_OUTPUT             = 2,
+} tinfl_status;
+
+// Like tinfl_decompressor the state is a plain block that is freed without a destructor, so zlib allocates from an arena inside it
+struct tinfl_decompressor_tag {
+  z_stream stream;
+  std::size_t arenaUsed;
+  alignas(16) uint8_t arena[48 * 1024];  // inflate state (~7KB) plus its own 32KB window
+};
+typedef struct tinfl_decompressor_tag tinfl_decompressor;
+
+inline voidpf tinfl_shim_alloc(voidpf opaque, uInt items, uInt size)
+{
+  auto* r           = static_cast<tinfl_decompressor*>(opaque);
+  std::size_t bytes = (static_cast<std::size_t>(items) * size + 15) & ~static_cast<std::size_t>(15);
+  if (r->arenaUsed + bytes > sizeof(r->arena)) {
+    return Z_NULL;
+  }
+
+  void* ptr = r->arena + r->arenaUsed;
+  r->arenaUsed += bytes;
+
+  return ptr;
+}
+
+inline void tinfl_shim_free(voidpf, voidpf) { }
+
+inline void tinfl_init(tinfl_decompressor* r)
+{
+  r->stream        = {};
+  r->stream.zalloc = tinfl_shim_alloc;
+  r->stream.zfree  = tinfl_shim_free;
+  r->stream.opaque = r;
+  r->arenaUsed     = 0;
+  inflateInit2(&r->stream, -MAX_WBITS);  // Raw deflate, like tinfl without TINFL_FLAG_PARSE_ZLIB_HEADER
+}
+
+inline tinfl_status tinfl_decompress(tinfl_decompressor* r, const uint8_t* pIn_buf_next, std::size_t* pIn_buf_size, uint8_t* pOut_buf_start, uint8_t* pOut_buf_next, std::size_t* pOut_buf_size, uint32_t decomp_flags)
+{
+  (void)pOut_buf_start;
+  (void)decomp_flags;
+
+  r->stream.next_in   = const_cast<Bytef*>(pIn_buf_next);
+  r->stream.avail_in  = static_cast<uInt>(*pIn_buf_size);
+  r->stream.next_out  = pOut_buf_next;
+  r->stream.avail_out = static_cast<uInt>(*pOut_buf_size);
+
+  int ret = inflate(&r->stream, Z_NO_FLUSH);
+
+  *pIn_buf_size -= r->stream.avail_in;
+  *pOut_buf_size -= r->stream.avail_out;
+
+  if (ret == Z_STREAM_END) {
+    return TINFL_STATUS_DONE;
+  }
+  if (ret != Z_OK && ret != Z_BUF_ERROR) {
+    return TINFL_STATUS_FAILED;
+  }
+  if (r->stream.avail_out == 0) {
+    return TINFL_STATUS_HAS_MORE_OUTPUT;
+  }
+
+  return TINFL_STATUS_NEEDS_MORE_INPUT;
+}
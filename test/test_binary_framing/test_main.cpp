@@ -0,0 +1,263 @@
+#include <unity.h>
+
+#include "serial/BinaryProtocol.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace OpenShock::Serial::BinaryProtocol;
+
+using Bytes = std::vector<uint8_t>;
+
+static Bytes _encode(const Bytes& data)
+{
+  Bytes out(EncodedSize(data.size()));
+  out.resize(Encode(data.data(), data.size(), out.data()));
+
+  return out;
+}
+
+/// @brief Feeds a byte stream to the decoder and collects every frame it completes
+static std::vector<Bytes> _decodeAll(FrameDecoder& decoder, const Bytes& stream)
+{
+  std::vector<Bytes> frames;
+  for (uint8_t byte : stream) {
+    if (decoder.feed(byte)) {
+      frames.emplace_back(decoder.data(), decoder.data() + decoder.size());
+    }
+  }
+
+  return frames;
+}
+
+static Bytes _random(std::mt19937& rng, std::size_t len, unsigned zeroOneIn)
+{
+  Bytes data(len);
+  for (uint8_t& b : data) {
+    b = rng() % zeroOneIn == 0 ? 0x00 : static_cast<uint8_t>(1 + rng() % 255);
+  }
+
+  return data;
+}
+
+/// @brief Builds a frame the way hosts do: [type][status][sequence LE][payload][crc32 LE]
+static Bytes _frame(uint8_t type, uint16_t sequence, const Bytes& payload)
+{
+  Bytes body = {type, 0, static_cast<uint8_t>(sequence), static_cast<uint8_t>(sequence >> 8)};
+  body.insert(body.end(), payload.begin(), payload.end());
+
+  uint32_t crc = crc32(0, body.data(), static_cast<uInt>(body.size()));
+  for (int i = 0; i < 4; i++) {
+    body.push_back(static_cast<uint8_t>(crc >> (8 * i)));
+  }
+
+  return body;
+}
+
+static bool _crcOk(const Bytes& frame)
+{
+  if (frame.size() < 8) {
+    return false;
+  }
+
+  uint32_t crc;
+  std::memcpy(&crc, frame.data() + frame.size() - 4, sizeof(crc));
+
+  return crc32(0, frame.data(), static_cast<uInt>(frame.size() - 4)) == crc;
+}
+
+void setUp(void) { }
+
+void tearDown(void) { }
+
+void test_encodes_known_vectors(void)
+{
+  // Examples from the COBS paper and Wikipedia, plus the frame delimiter
+  struct Case {
+    Bytes data;
+    Bytes encoded;
+  };
+
+  const Case cases[] = {
+    {                  {0x00},                   {0x01, 0x01, 0x00}},
+    {            {0x00, 0x00},             {0x01, 0x01, 0x01, 0x00}},
+    {{0x11, 0x22, 0x00, 0x33}, {0x03, 0x11, 0x22, 0x02, 0x33, 0x00}},
+    {{0x11, 0x22, 0x33, 0x44}, {0x05, 0x11, 0x22, 0x33, 0x44, 0x00}},
+    {{0x11, 0x00, 0x00, 0x00}, {0x02, 0x11, 0x01, 0x01, 0x01, 0x00}},
+  };
+
+  for (const auto& c : cases) {
+    Bytes encoded = _encode(c.data);
+    TEST_ASSERT_EQUAL_size_t(c.encoded.size(), encoded.size());
+    TEST_ASSERT_EQUAL_MEMORY(c.encoded.data(), encoded.data(), encoded.size());
+  }
+}
+
+void test_round_trips_every_length(void)
+{
+  std::mt19937 rng(1);
+
+  for (std::size_t len = 1; len <= FrameDecoder::MaxFrameSize; len++) {
+    for (unsigned zeroOneIn : {2u, 16u, 1000u}) {
+      Bytes data    = _random(rng, len, zeroOneIn);
+      Bytes encoded = _encode(data);
+
+      TEST_ASSERT_LESS_OR_EQUAL_size_t(EncodedSize(len), encoded.size());
+      TEST_ASSERT_EQUAL_UINT8(0x00, encoded.back());
+      TEST_ASSERT_TRUE(std::find(encoded.begin(), encoded.end() - 1, 0x00) == encoded.end() - 1);
+
+      FrameDecoder decoder;
+      std::vector<Bytes> frames = _decodeAll(decoder, encoded);
+      TEST_ASSERT_EQUAL_size_t_MESSAGE(1, frames.size(), std::to_string(len).c_str());
+      TEST_ASSERT_TRUE_MESSAGE(frames[0] == data, std::to_string(len).c_str());
+    }
+  }
+}
+
+void test_full_blocks_without_zeros(void)
+{
+  // 254 non-zero bytes fill a 0xFF block exactly, which stands for no zero byte
+  for (std::size_t len : {253u, 254u, 255u, 508u, 509u}) {
+    Bytes data(len, 0x42);
+
+    Bytes encoded = _encode(data);
+    TEST_ASSERT_EQUAL_size_t(EncodedSize(len), encoded.size());
+
+    FrameDecoder decoder;
+    std::vector<Bytes> frames = _decodeAll(decoder, encoded);
+    TEST_ASSERT_EQUAL_size_t(1, frames.size());
+    TEST_ASSERT_TRUE_MESSAGE(frames[0] == data, std::to_string(len).c_str());
+  }
+}
+
+void test_drops_empty_truncated_and_oversized_frames(void)
+{
+  FrameDecoder decoder;
+
+  // Lone delimiters are keep-alives
+  TEST_ASSERT_EQUAL_size_t(0, _decodeAll(decoder, {0x00, 0x00, 0x00}).size());
+
+  // A block promising more bytes than arrive before the delimiter
+  TEST_ASSERT_EQUAL_size_t(0, _decodeAll(decoder, {0x05, 0x11, 0x22, 0x00}).size());
+
+  // One byte too many, then a valid frame still decodes
+  Bytes tooLarge = _encode(Bytes(FrameDecoder::MaxFrameSize + 1, 0x42));
+  Bytes fits     = _encode(Bytes(FrameDecoder::MaxFrameSize, 0x42));
+
+  Bytes stream = tooLarge;
+  stream.insert(stream.end(), fits.begin(), fits.end());
+
+  std::vector<Bytes> frames = _decodeAll(decoder, stream);
+  TEST_ASSERT_EQUAL_size_t(1, frames.size());
+  TEST_ASSERT_EQUAL_size_t(FrameDecoder::MaxFrameSize, frames[0].size());
+
+  // A zero implied by a block boundary can overflow too
+  Bytes zeros = _encode(Bytes(FrameDecoder::MaxFrameSize + 1, 0x00));
+  TEST_ASSERT_EQUAL_size_t(0, _decodeAll(decoder, zeros).size());
+}
+
+void test_resynchronises_after_line_noise(void)
+{
+  std::mt19937 rng(2);
+  FrameDecoder decoder;
+
+  Bytes frame = _frame(0x01, 7, _random(rng, 40, 8));
+
+  // Text typed before switching modes runs into the next frame, which is dropped or fails its CRC, the host retransmits after a delimiter
+  Bytes stream  = {'h', 'e', 'l', 'p', '\r', '\n'};
+  Bytes encoded = _encode(frame);
+  stream.insert(stream.end(), encoded.begin(), encoded.end());
+  stream.push_back(0x00);
+  stream.insert(stream.end(), encoded.begin(), encoded.end());
+
+  std::vector<Bytes> frames = _decodeAll(decoder, stream);
+  TEST_ASSERT_GREATER_THAN_size_t(0, frames.size());
+  for (std::size_t i = 0; i + 1 < frames.size(); i++) {
+    TEST_ASSERT_FALSE(_crcOk(frames[i]));
+  }
+  TEST_ASSERT_TRUE(frames.back() == frame);
+  TEST_ASSERT_TRUE(_crcOk(frames.back()));
+}
+
+void test_reset_discards_partial_frame(void)
+{
+  FrameDecoder decoder;
+  Bytes encoded = _encode({0x11, 0x22, 0x33});
+
+  TEST_ASSERT_FALSE(decoder.feed(encoded[0]));
+  TEST_ASSERT_FALSE(decoder.feed(encoded[1]));
+  decoder.reset();
+
+  std::vector<Bytes> frames = _decodeAll(decoder, encoded);
+  TEST_ASSERT_EQUAL_size_t(1, frames.size());
+  TEST_ASSERT_TRUE(frames[0] == Bytes({0x11, 0x22, 0x33}));
+}
+
+void test_decoded_frames_are_aligned(void)
+{
+  // Flatbuffers are read in place after the 4 byte header
+  auto decoder = std::make_unique<FrameDecoder>();
+  TEST_ASSERT_EQUAL_size_t(0, reinterpret_cast<uintptr_t>(decoder->data()) % 4);
+}
+
+void test_loopback_throughput(void)
+{
+  std::mt19937 rng(3);
+
+  // Command lists of one to eight shockers are roughly 40 to 250 bytes of flatbuffer
+  const std::size_t frameCount = 200'000;
+  Bytes stream;
+  std::vector<Bytes> sent;
+  sent.reserve(frameCount);
+
+  for (std::size_t i = 0; i < frameCount; i++) {
+    Bytes frame   = _frame(0x01, static_cast<uint16_t>(i), _random(rng, 40 + rng() % 210, 6));
+    Bytes encoded = _encode(frame);
+    stream.insert(stream.end(), encoded.begin(), encoded.end());
+    sent.push_back(std::move(frame));
+  }
+
+  FrameDecoder decoder;
+  std::size_t received = 0;
+  bool allMatch        = true;
+
+  auto begin = std::chrono::steady_clock::now();
+  for (uint8_t byte : stream) {
+    if (decoder.feed(byte)) {
+      allMatch = allMatch && decoder.size() == sent[received].size() && std::memcmp(decoder.data(), sent[received].data(), decoder.size()) == 0;
+      ++received;
+    }
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+  TEST_ASSERT_EQUAL_size_t(frameCount, received);
+  TEST_ASSERT_TRUE(allMatch);
+
+  char message[128];
+  snprintf(message, sizeof(message), "Decoded %.1f MB/s, %.0f frames/s (a 921600 baud link carries about 92 KB/s)", stream.size() / seconds / 1e6, frameCount / seconds);
+  TEST_MESSAGE(message);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_encodes_known_vectors);
+  RUN_TEST(test_round_trips_every_length);
+  RUN_TEST(test_full_blocks_without_zeros);
+  RUN_TEST(test_drops_empty_truncated_and_oversized_frames);
+  RUN_TEST(test_resynchronises_after_line_noise);
+  RUN_TEST(test_reset_discards_partial_frame);
+  RUN_TEST(test_decoded_frames_are_aligned);
+  RUN_TEST(test_loopback_throughput);
+
+  return UNITY_END();
+}
@@ -0,0 +1,278 @@
+#include <unity.h>
+
+#include "http/ChunkedDecoder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace OpenShock::HTTP;
+
+struct DecodeResult {
+  ChunkedDecoder::Result result;
+  std::string payload;
+  std::size_t consumed;  // Total bytes consumed over all feeds
+  std::size_t callbacks;
+};
+
+/// @brief Feeds body to a fresh decoder in pieces of pieceSize bytes, stopping at the first result other than NeedMoreData
+static DecodeResult _decode(std::string_view body, std::size_t pieceSize = SIZE_MAX)
+{
+  ChunkedDecoder decoder;
+  DecodeResult out = {ChunkedDecoder::Result::NeedMoreData, {}, 0, 0};
+
+  for (std::size_t pos = 0; pos < body.size() && out.result == ChunkedDecoder::Result::NeedMoreData; pos += pieceSize) {
+    std::size_t len      = std::min(pieceSize, body.size() - pos);
+    std::size_t consumed = 0;
+
+    out.result = decoder.feed(reinterpret_cast<const uint8_t*>(body.data() + pos), len, consumed, [&out](const uint8_t* data, std::size_t len) {
+      out.payload.append(reinterpret_cast<const char*>(data), len);
+      ++out.callbacks;
+      return true;
+    });
+    out.consumed += consumed;
+  }
+
+  return out;
+}
+
+/// @brief Encodes payload with chunks of the given sizes, the last size is repeated until the payload is used up
+static std::string _encode(std::string_view payload, const std::vector<std::size_t>& sizes, const char* trailer = "")
+{
+  std::string body;
+  char line[32];
+
+  std::size_t pos = 0;
+  for (std::size_t i = 0; pos < payload.size(); i++) {
+    std::size_t size = std::min(sizes[std::min(i, sizes.size() - 1)], payload.size() - pos);
+
+    snprintf(line, sizeof(line), "%zx\r\n", size);
+    body.append(line);
+    body.append(payload.substr(pos, size));
+    body.append("\r\n");
+
+    pos += size;
+  }
+
+  body.append("0\r\n");
+  body.append(trailer);
+  body.append("\r\n");
+
+  return body;
+}
+
+static std::string _randomPayload(std::size_t size, uint32_t seed)
+{
+  std::mt19937 rng(seed);
+  std::string payload(size, '\0');
+  for (char& c : payload) {
+    c = static_cast<char>(rng());
+  }
+
+  return payload;
+}
+
+void setUp(void) { }
+
+void tearDown(void) { }
+
+void test_decodes_corpus(void)
+{
+  struct Case {
+    const char* body;
+    const char* payload;
+  };
+
+  const Case cases[] = {
+    {                                     "0\r\n\r\n",              ""},
+    {                          "5\r\nhello\r\n0\r\n\r\n",         "hello"},
+    {          "5\r\nhello\r\n1\r\n \r\n5\r\nworld\r\n0\r\n\r\n",   "hello world"},
+    {                "A\r\n0123456789\r\n0\r\n\r\n",    "0123456789"},
+    {                "a\r\n0123456789\r\n0\r\n\r\n",    "0123456789"},
+    {             "0003\r\nabc\r\n000\r\n\r\n",           "abc"},
+    {        "3;name=value\r\nabc\r\n0;last\r\n\r\n",           "abc"},
+    {                   "3 \r\nabc\r\n0\t\r\n\r\n",           "abc"},
+    {"3\r\nabc\r\n0\r\nExpires: never\r\nX-Sum: 1\r\n\r\n",           "abc"},
+    {                  "4\r\n\r\n\r\n\r\n0\r\n\r\n",        "\r\n\r\n"},
+  };
+
+  for (const auto& c : cases) {
+    DecodeResult out = _decode(c.body);
+    TEST_ASSERT_EQUAL_MESSAGE(static_cast<int>(ChunkedDecoder::Result::Done), static_cast<int>(out.result), c.body);
+    TEST_ASSERT_EQUAL_STRING_MESSAGE(c.payload, out.payload.c_str(), c.body);
+    TEST_ASSERT_EQUAL_size_t_MESSAGE(strlen(c.body), out.consumed, c.body);
+  }
+}
+
+void test_rejects_malformed_framing(void)
+{
+  const char* const cases[] = {
+    "\r\n",                    // Empty size
+    ";ext\r\n",                // Extension without size
+    "g\r\n",                   // Not hex
+    "-1\r\n",                  // Negative
+    "5\rhello",                // CR without LF after size
+    "5\nhello",                // Bare LF after size
+    "5\r\nhelloX",             // Payload not followed by CR
+    "5\r\nhello\rX",           // Payload CR not followed by LF
+    "5\r\nhello\r\n0\r\n\rX",  // Final CRLF broken
+    "11111111111111111\r\n",   // 17 hex digits overflow a 64 bit size
+  };
+
+  for (const char* body : cases) {
+    DecodeResult out = _decode(body);
+    TEST_ASSERT_EQUAL_MESSAGE(static_cast<int>(ChunkedDecoder::Result::Invalid), static_cast<int>(out.result), body);
+  }
+
+  // Largest size that fits is still accepted as a size, the decoder then waits for its payload
+  std::string maxSize(sizeof(std::size_t) * 2, 'f');
+  maxSize.append("\r\n");
+  TEST_ASSERT_EQUAL(static_cast<int>(ChunkedDecoder::Result::NeedMoreData), static_cast<int>(_decode(maxSize).result));
+}
+
+void test_truncated_body_needs_more_data(void)
+{
+  std::string body = _encode("hello world", {4});
+
+  for (std::size_t len = 0; len < body.size(); len++) {
+    DecodeResult out = _decode(std::string_view(body).substr(0, len));
+    TEST_ASSERT_EQUAL_MESSAGE(static_cast<int>(ChunkedDecoder::Result::NeedMoreData), static_cast<int>(out.result), std::to_string(len).c_str());
+    TEST_ASSERT_EQUAL_size_t(len, out.consumed);
+  }
+}
+
+void test_every_split_yields_the_same_payload(void)
+{
+  std::string payload = _randomPayload(3000, 1);
+  std::string body    = _encode(payload, {1, 700, 16, 1500}, "X-Trailer: yes\r\n");
+
+  for (std::size_t pieceSize = 1; pieceSize <= body.size(); pieceSize++) {
+    DecodeResult out = _decode(body, pieceSize);
+    TEST_ASSERT_EQUAL_MESSAGE(static_cast<int>(ChunkedDecoder::Result::Done), static_cast<int>(out.result), std::to_string(pieceSize).c_str());
+    TEST_ASSERT_TRUE_MESSAGE(out.payload == payload, std::to_string(pieceSize).c_str());
+    TEST_ASSERT_EQUAL_size_t(body.size(), out.consumed);
+  }
+}
+
+void test_chunks_larger_than_any_buffer(void)
+{
+  // CDNs send 16-64KB chunks, the old parser failed on anything over its 4KB buffer
+  std::string payload = _randomPayload(1 << 20, 2);
+
+  for (std::size_t chunkSize : {16u << 10, 64u << 10, 1u << 20}) {
+    std::string body = _encode(payload, {chunkSize});
+
+    DecodeResult out = _decode(body, 1436);  // One TCP segment at a time
+    TEST_ASSERT_EQUAL(static_cast<int>(ChunkedDecoder::Result::Done), static_cast<int>(out.result));
+    TEST_ASSERT_TRUE(out.payload == payload);
+  }
+}
+
+void test_payload_is_passed_through_without_buffering(void)
+{
+  // A piece holding only payload bytes is handed on as a single callback pointing into the input
+  std::string body = _encode(std::string(100, 'x'), {100});
+  std::string_view header(body.data(), 4);  // "64\r\n"
+
+  ChunkedDecoder decoder;
+  std::size_t consumed = 0;
+  TEST_ASSERT_EQUAL(static_cast<int>(ChunkedDecoder::Result::NeedMoreData), static_cast<int>(decoder.feed(reinterpret_cast<const uint8_t*>(header.data()), header.size(), consumed, [](const uint8_t*, std::size_t) { return true; })));
+
+  const uint8_t* payload  = reinterpret_cast<const uint8_t*>(body.data() + header.size());
+  const uint8_t* received = nullptr;
+  std::size_t receivedLen = 0;
+  std::size_t calls       = 0;
+  TEST_ASSERT_EQUAL(static_cast<int>(ChunkedDecoder::Result::NeedMoreData), static_cast<int>(decoder.feed(payload, 100, consumed, [&](const uint8_t* data, std::size_t len) {
+    received    = data;
+    receivedLen = len;
+    ++calls;
+    return true;
+  })));
+  TEST_ASSERT_EQUAL_size_t(1, calls);
+  TEST_ASSERT_EQUAL_PTR(payload, received);
+  TEST_ASSERT_EQUAL_size_t(100, receivedLen);
+  TEST_ASSERT_EQUAL_size_t(100, consumed);
+}
+
+void test_leaves_bytes_after_terminator(void)
+{
+  std::string body  = _encode("abc", {3});
+  std::string input = body + "HTTP/1.1 200 OK\r\n";
+
+  DecodeResult out = _decode(input);
+  TEST_ASSERT_EQUAL(static_cast<int>(ChunkedDecoder::Result::Done), static_cast<int>(out.result));
+  TEST_ASSERT_EQUAL_size_t(body.size(), out.consumed);
+}
+
+void test_callback_can_cancel(void)
+{
+  std::string body = _encode("hello world", {5});
+
+  ChunkedDecoder decoder;
+  std::size_t consumed = 0;
+  auto result          = decoder.feed(reinterpret_cast<const uint8_t*>(body.data()), body.size(), consumed, [](const uint8_t*, std::size_t) { return false; });
+
+  TEST_ASSERT_EQUAL(static_cast<int>(ChunkedDecoder::Result::Cancelled), static_cast<int>(result));
+  TEST_ASSERT_EQUAL_size_t(3, consumed);  // Stopped before the first payload byte
+  TEST_ASSERT_FALSE(decoder.isDone());
+}
+
+void test_reset_allows_reuse(void)
+{
+  ChunkedDecoder decoder;
+  std::size_t consumed = 0;
+  auto ignore          = [](const uint8_t*, std::size_t) { return true; };
+
+  std::string invalid = "zz\r\n";
+  TEST_ASSERT_EQUAL(static_cast<int>(ChunkedDecoder::Result::Invalid), static_cast<int>(decoder.feed(reinterpret_cast<const uint8_t*>(invalid.data()), invalid.size(), consumed, ignore)));
+
+  decoder.reset();
+
+  std::string body = _encode("abc", {3});
+  TEST_ASSERT_EQUAL(static_cast<int>(ChunkedDecoder::Result::Done), static_cast<int>(decoder.feed(reinterpret_cast<const uint8_t*>(body.data()), body.size(), consumed, ignore)));
+  TEST_ASSERT_TRUE(decoder.isDone());
+}
+
+void test_throughput(void)
+{
+  std::string payload = _randomPayload(8 << 20, 3);
+
+  for (std::size_t chunkSize : {256u, 4u << 10, 64u << 10}) {
+    std::string body = _encode(payload, {chunkSize});
+
+    auto begin       = std::chrono::steady_clock::now();
+    DecodeResult out = _decode(body, 1436);
+    auto end         = std::chrono::steady_clock::now();
+    double seconds   = std::chrono::duration<double>(end - begin).count();
+
+    TEST_ASSERT_EQUAL(static_cast<int>(ChunkedDecoder::Result::Done), static_cast<int>(out.result));
+    TEST_ASSERT_EQUAL_size_t(payload.size(), out.payload.size());
+
+    char message[96];
+    snprintf(message, sizeof(message), "%zu byte chunks: %.1f MB/s (%zu callbacks)", chunkSize, body.size() / seconds / 1e6, out.callbacks);
+    TEST_MESSAGE(message);
+  }
+}
+
+int main()
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_decodes_corpus);
+  RUN_TEST(test_rejects_malformed_framing);
+  RUN_TEST(test_truncated_body_needs_more_data);
+  RUN_TEST(test_every_split_yields_the_same_payload);
+  RUN_TEST(test_chunks_larger_than_any_buffer);
+  RUN_TEST(test_payload_is_passed_through_without_buffering);
+  RUN_TEST(test_leaves_bytes_after_terminator);
+  RUN_TEST(test_callback_can_cancel);
+  RUN_TEST(test_reset_allows_reuse);
+  RUN_TEST(test_throughput);
+
+  return UNITY_END();
+}
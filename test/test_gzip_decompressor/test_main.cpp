@@ -0,0 +1,275 @@
+#include <unity.h>
+
+#include "util/GzipDecompressor.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <string>
+
+using namespace OpenShock;
+
+struct GzipOptions {
+  int level           = 9;
+  const char* name    = nullptr;
+  const char* comment = nullptr;
+  std::string extra;
+  bool hasExtra = false;
+  bool hcrc     = false;
+};
+
+/// @brief Compresses data into a gzip member with the given header fields, like gzip -9 does for the release artifacts
+static std::string _gzip(std::string_view data, const GzipOptions& options = {})
+{
+  z_stream stream = {};
+  TEST_ASSERT_EQUAL(Z_OK, deflateInit2(&stream, options.level, Z_DEFLATED, MAX_WBITS + 16, 8, Z_DEFAULT_STRATEGY));
+
+  gz_header header = {};
+  header.name      = reinterpret_cast<Bytef*>(const_cast<char*>(options.name));
+  header.comment   = reinterpret_cast<Bytef*>(const_cast<char*>(options.comment));
+  header.extra     = options.hasExtra ? reinterpret_cast<Bytef*>(const_cast<char*>(options.extra.data())) : Z_NULL;
+  header.extra_len = static_cast<uInt>(options.extra.size());
+  header.hcrc      = options.hcrc ? 1 : 0;
+  header.os        = 3;
+  TEST_ASSERT_EQUAL(Z_OK, deflateSetHeader(&stream, &header));
+
+  std::string out(deflateBound(&stream, data.size()) + 256, '\0');
+
+  stream.next_in   = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+  stream.avail_in  = static_cast<uInt>(data.size());
+  stream.next_out  = reinterpret_cast<Bytef*>(out.data());
+  stream.avail_out = static_cast<uInt>(out.size());
+  TEST_ASSERT_EQUAL(Z_STREAM_END, deflate(&stream, Z_FINISH));
+
+  out.resize(stream.total_out);
+  deflateEnd(&stream);
+
+  return out;
+}
+
+struct InflateResult {
+  GzipDecompressor::Result result;
+  std::string output;
+  std::size_t largestPiece;
+  bool done;
+};
+
+/// @brief Feeds a gzip stream to a fresh decompressor in pieces of pieceSize bytes, stopping at the first result other than NeedMoreData
+static InflateResult _gunzip(std::string_view gz, std::size_t pieceSize = SIZE_MAX, std::size_t cancelAfter = SIZE_MAX)
+{
+  GzipDecompressor decompressor;
+  TEST_ASSERT_TRUE(decompressor.ok());
+
+  InflateResult out = {GzipDecompressor::Result::NeedMoreData, {}, 0, false};
+
+  auto onOutput = [&out, cancelAfter](const uint8_t* data, std::size_t len) {
+    out.output.append(reinterpret_cast<const char*>(data), len);
+    out.largestPiece = std::max(out.largestPiece, len);
+    return out.output.size() < cancelAfter;
+  };
+
+  for (std::size_t pos = 0; pos < gz.size(); pos += pieceSize) {
+    std::size_t len = std::min(pieceSize, gz.size() - pos);
+
+    out.result = decompressor.feed(reinterpret_cast<const uint8_t*>(gz.data() + pos), len, onOutput);
+    if (out.result == GzipDecompressor::Result::Invalid || out.result == GzipDecompressor::Result::Cancelled) {
+      break;
+    }
+  }
+
+  out.done = decompressor.isDone();
+  if (out.result != GzipDecompressor::Result::Invalid && out.result != GzipDecompressor::Result::Cancelled) {
+    TEST_ASSERT_EQUAL_size_t(out.output.size(), decompressor.outputSize());
+  }
+
+  return out;
+}
+
+/// @brief Firmware-like data, long runs and repeated blocks with random bytes between them, so matches reach back across the whole 32KB window
+static std::string _firmwareLike(std::size_t size, uint32_t seed)
+{
+  std::mt19937 rng(seed);
+  std::string data;
+  data.reserve(size);
+
+  while (data.size() < size) {
+    switch (rng() % 4) {
+      case 0:
+        data.append(rng() % 512, static_cast<char>(rng() % 4 == 0 ? 0xFF : 0x00));
+        break;
+      case 1:
+        if (data.size() > 1024) {
+          std::size_t distance = 1 + rng() % std::min<std::size_t>(data.size(), 32768);
+          std::size_t length   = 3 + rng() % 258;
+          for (std::size_t i = 0; i < length; i++) {
+            data.push_back(data[data.size() - distance]);
+          }
+        }
+        break;
+      default:
+        for (std::size_t n = rng() % 256; n > 0; n--) {
+          data.push_back(static_cast<char>(rng()));
+        }
+        break;
+    }
+  }
+
+  data.resize(size);
+  return data;
+}
+
+void setUp(void) { }
+
+void tearDown(void) { }
+
+void test_round_trips_at_every_feed_size(void)
+{
+  std::string image = _firmwareLike(300'000, 1);
+  std::string gz    = _gzip(image);
+
+  for (std::size_t pieceSize : {std::size_t(1), std::size_t(2), std::size_t(7), std::size_t(100), std::size_t(1436), std::size_t(4096), std::size_t(65536), SIZE_MAX}) {
+    InflateResult out = _gunzip(gz, pieceSize);
+    TEST_ASSERT_EQUAL_MESSAGE(static_cast<int>(GzipDecompressor::Result::Done), static_cast<int>(out.result), std::to_string(pieceSize).c_str());
+    TEST_ASSERT_TRUE_MESSAGE(out.output == image, std::to_string(pieceSize).c_str());
+    TEST_ASSERT_TRUE(out.done);
+
+    // Output is handed on straight out of the 32KB dictionary, never more than the window at once
+    TEST_ASSERT_LESS_OR_EQUAL_size_t(32768, out.largestPiece);
+  }
+}
+
+void test_round_trips_every_level(void)
+{
+  std::string image = _firmwareLike(100'000, 2);
+
+  for (int level = 0; level <= 9; level++) {
+    GzipOptions options;
+    options.level = level;
+
+    InflateResult out = _gunzip(_gzip(image, options), 1000);
+    TEST_ASSERT_EQUAL_MESSAGE(static_cast<int>(GzipDecompressor::Result::Done), static_cast<int>(out.result), std::to_string(level).c_str());
+    TEST_ASSERT_TRUE_MESSAGE(out.output == image, std::to_string(level).c_str());
+  }
+}
+
+void test_empty_image(void)
+{
+  InflateResult out = _gunzip(_gzip(""));
+  TEST_ASSERT_EQUAL(static_cast<int>(GzipDecompressor::Result::Done), static_cast<int>(out.result));
+  TEST_ASSERT_EQUAL_size_t(0, out.output.size());
+}
+
+void test_skips_optional_header_fields(void)
+{
+  std::string image = _firmwareLike(50'000, 3);
+
+  GzipOptions variants[6];
+  variants[0].name     = "app.bin";
+  variants[1].comment  = "OpenShock firmware";
+  variants[2].hasExtra = true;
+  variants[2].extra    = std::string("AB\x04\x00test", 8);
+  variants[3].hasExtra = true;  // Present but empty
+  variants[4].hcrc     = true;
+  variants[5].name     = "staticfs.bin";
+  variants[5].comment  = "all of them";
+  variants[5].hasExtra = true;
+  variants[5].extra    = std::string(300, 'x');  // Length needs both bytes
+  variants[5].hcrc     = true;
+
+  for (std::size_t i = 0; i < 6; i++) {
+    std::string gz = _gzip(image, variants[i]);
+
+    for (std::size_t pieceSize : {std::size_t(1), std::size_t(3), SIZE_MAX}) {
+      InflateResult out   = _gunzip(gz, pieceSize);
+      std::string message = "variant " + std::to_string(i) + " piece " + std::to_string(pieceSize);
+      TEST_ASSERT_EQUAL_MESSAGE(static_cast<int>(GzipDecompressor::Result::Done), static_cast<int>(out.result), message.c_str());
+      TEST_ASSERT_TRUE_MESSAGE(out.output == image, message.c_str());
+    }
+  }
+}
+
+void test_rejects_invalid_headers(void)
+{
+  std::string gz = _gzip("hello");
+
+  std::string badMagic = gz;
+  badMagic[1]          = 0x8C;
+  TEST_ASSERT_EQUAL(static_cast<int>(GzipDecompressor::Result::Invalid), static_cast<int>(_gunzip(badMagic).result));
+
+  std::string badMethod = gz;
+  badMethod[2]          = 7;
+  TEST_ASSERT_EQUAL(static_cast<int>(GzipDecompressor::Result::Invalid), static_cast<int>(_gunzip(badMethod).result));
+
+  std::string reservedFlags = gz;
+  reservedFlags[3]          = static_cast<char>(reservedFlags[3] | 0x20);
+  TEST_ASSERT_EQUAL(static_cast<int>(GzipDecompressor::Result::Invalid), static_cast<int>(_gunzip(reservedFlags).result));
+
+  TEST_ASSERT_EQUAL(static_cast<int>(GzipDecompressor::Result::Invalid), static_cast<int>(_gunzip("PK\x03\x04").result));
+}
+
+void test_rejects_corrupt_deflate_data(void)
+{
+  std::string gz = _gzip(_firmwareLike(20'000, 4));
+
+  // Block type 3 is reserved, the first deflate byte sits right after the 10 byte header
+  std::string corrupt = gz;
+  corrupt[10]         = static_cast<char>(0x07);
+
+  InflateResult out = _gunzip(corrupt, 100);
+  TEST_ASSERT_EQUAL(static_cast<int>(GzipDecompressor::Result::Invalid), static_cast<int>(out.result));
+  TEST_ASSERT_FALSE(out.done);
+}
+
+void test_rejects_data_after_trailer(void)
+{
+  std::string gz = _gzip("hello");
+
+  TEST_ASSERT_EQUAL(static_cast<int>(GzipDecompressor::Result::Invalid), static_cast<int>(_gunzip(gz + "x").result));
+  TEST_ASSERT_EQUAL(static_cast<int>(GzipDecompressor::Result::Invalid), static_cast<int>(_gunzip(gz + gz, gz.size()).result));
+}
+
+void test_truncated_stream_needs_more_data(void)
+{
+  std::string image = _firmwareLike(40'000, 5);
+  std::string gz    = _gzip(image);
+
+  for (std::size_t cut : {std::size_t(5), std::size_t(10), gz.size() / 2, gz.size() - 9}) {
+    InflateResult out = _gunzip(std::string_view(gz).substr(0, cut), 512);
+    TEST_ASSERT_EQUAL_MESSAGE(static_cast<int>(GzipDecompressor::Result::NeedMoreData), static_cast<int>(out.result), std::to_string(cut).c_str());
+    TEST_ASSERT_FALSE(out.done);
+  }
+
+  // Once only trailer bytes are missing the image is complete, the trailer is not checked since the image has its own SHA-256
+  InflateResult out = _gunzip(std::string_view(gz).substr(0, gz.size() - 4), 512);
+  TEST_ASSERT_EQUAL(static_cast<int>(GzipDecompressor::Result::Done), static_cast<int>(out.result));
+  TEST_ASSERT_TRUE(out.output == image);
+}
+
+void test_callback_can_cancel(void)
+{
+  std::string image = _firmwareLike(100'000, 6);
+
+  InflateResult out = _gunzip(_gzip(image), 4096, 10'000);
+  TEST_ASSERT_EQUAL(static_cast<int>(GzipDecompressor::Result::Cancelled), static_cast<int>(out.result));
+  TEST_ASSERT_FALSE(out.done);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_round_trips_at_every_feed_size);
+  RUN_TEST(test_round_trips_every_level);
+  RUN_TEST(test_empty_image);
+  RUN_TEST(test_skips_optional_header_fields);
+  RUN_TEST(test_rejects_invalid_headers);
+  RUN_TEST(test_rejects_corrupt_deflate_data);
+  RUN_TEST(test_rejects_data_after_trailer);
+  RUN_TEST(test_truncated_stream_needs_more_data);
+  RUN_TEST(test_callback_can_cancel);
+
+  return UNITY_END();
+}
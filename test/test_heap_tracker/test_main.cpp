@@ -0,0 +1,370 @@
+#include <unity.h>
+
+#include "util/HeapTracker.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace OpenShock;
+
+// A realloc the allocator can't satisfy has to return nullptr under the sanitizers too, like it does on the device
+extern "C" const char* __asan_default_options()
+{
+  return "allocator_may_return_null=1";
+}
+
+extern "C" const char* __tsan_default_options()
+{
+  return "allocator_may_return_null=1";
+}
+
+// Sites are keyed by the TAG pointer, like the TAG of a translation unit
+static const char SITE_A[]     = "a";
+static const char SITE_B[]     = "b";
+static const char SITE_CHURN[] = "churn";
+static const char SITE_FILL[]  = "fill";
+
+const std::size_t LIVE_LIMIT = 768;  // 3/4 of the 1024 slot pointer table
+
+static std::atomic<const void*> s_escaped;
+
+/// @brief Publishes ptr, so the compiler can't pair an allocation with its free and drop both
+template<typename T>
+static T* _keep(T* ptr)
+{
+  s_escaped.store(ptr, std::memory_order_relaxed);
+  return ptr;
+}
+
+/// @brief Stats of a tagged site, all zero if it never allocated. Call it outside of a ScopedSite, GetSites allocates
+static HeapTracker::SiteStats _site(const char* tag)
+{
+  for (const auto& site : HeapTracker::GetSites()) {
+    if (site.tag == tag) {
+      return site;
+    }
+  }
+
+  return {};
+}
+
+void setUp(void) { }
+
+void tearDown(void) { }
+
+void test_attributes_allocations_to_the_scoped_site(void)
+{
+  void* fromMalloc;
+  void* fromCalloc;
+  uint8_t* fromNew;
+  void* nested;
+  void* afterNested;
+
+  {
+    OS_HEAP_SITE(SITE_A);
+    fromMalloc = _keep(malloc(100));
+    fromCalloc = _keep(calloc(4, 25));
+    fromNew    = _keep(new uint8_t[40]);
+
+    {
+      OS_HEAP_SITE(SITE_B);
+      nested = _keep(malloc(7));
+    }
+
+    afterNested = _keep(malloc(3));
+  }
+
+  HeapTracker::SiteStats a = _site(SITE_A);
+  TEST_ASSERT_EQUAL_UINT32(4, a.liveCount);
+  TEST_ASSERT_EQUAL_UINT32(243, a.liveBytes);
+  TEST_ASSERT_EQUAL_UINT32(4, a.allocs);
+  TEST_ASSERT_EQUAL_UINT64(243, a.allocBytes);
+
+  HeapTracker::SiteStats b = _site(SITE_B);
+  TEST_ASSERT_EQUAL_UINT32(1, b.liveCount);
+  TEST_ASSERT_EQUAL_UINT32(7, b.liveBytes);
+
+  free(fromMalloc);
+  free(fromCalloc);
+  delete[] fromNew;
+  free(nested);
+  free(afterNested);
+
+  a = _site(SITE_A);
+  TEST_ASSERT_EQUAL_UINT32(0, a.liveCount);
+  TEST_ASSERT_EQUAL_UINT32(0, a.liveBytes);
+  TEST_ASSERT_EQUAL_UINT32(4, a.allocs);  // Counts stay until a reset
+  TEST_ASSERT_EQUAL_UINT32(0, _site(SITE_B).liveCount);
+}
+
+void test_realloc_moves_and_restores_tracking(void)
+{
+  HeapTracker::Reset();
+
+  void* ptr;
+  {
+    OS_HEAP_SITE(SITE_A);
+    ptr = _keep(malloc(16));
+    ptr = _keep(realloc(ptr, 4096));
+  }
+
+  HeapTracker::SiteStats site = _site(SITE_A);
+  TEST_ASSERT_EQUAL_UINT32(1, site.liveCount);
+  TEST_ASSERT_EQUAL_UINT32(4096, site.liveBytes);
+  TEST_ASSERT_EQUAL_UINT32(2, site.allocs);
+
+  uint32_t frees = HeapTracker::GetTotals().frees;
+
+  // The old block stays allocated when realloc fails, so it has to stay tracked.
+  // Called through a pointer, the compiler can't tell this realloc fails and would warn about freeing the block below
+  void* (*volatile reallocFn)(void*, std::size_t) = realloc;
+  {
+    OS_HEAP_SITE(SITE_A);
+    TEST_ASSERT_NULL(_keep(reallocFn(ptr, SIZE_MAX / 2)));
+  }
+  TEST_ASSERT_EQUAL_UINT32(frees, HeapTracker::GetTotals().frees);
+
+  site = _site(SITE_A);
+  TEST_ASSERT_EQUAL_UINT32(1, site.liveCount);
+  TEST_ASSERT_EQUAL_UINT32(4096, site.liveBytes);
+
+  frees = HeapTracker::GetTotals().frees;
+  free(ptr);
+  TEST_ASSERT_EQUAL_UINT32(frees + 1, HeapTracker::GetTotals().frees);
+  TEST_ASSERT_EQUAL_UINT32(0, _site(SITE_A).liveCount);
+
+  // realloc of nullptr allocates, and to zero bytes frees
+  {
+    OS_HEAP_SITE(SITE_A);
+    ptr = _keep(realloc(nullptr, 32));
+  }
+  TEST_ASSERT_EQUAL_UINT32(32, _site(SITE_A).liveBytes);
+
+  {
+    OS_HEAP_SITE(SITE_A);
+    ptr = _keep(realloc(ptr, 0));
+  }
+  free(ptr);
+  TEST_ASSERT_EQUAL_UINT32(0, _site(SITE_A).liveCount);
+  TEST_ASSERT_EQUAL_UINT32(0, _site(SITE_A).liveBytes);
+}
+
+void test_live_table_survives_churn(void)
+{
+  std::mt19937 rng(1);
+
+  // Reserved up front, the reference list must not take slots of the table itself
+  std::vector<std::pair<void*, std::size_t>> live;
+  live.reserve(LIVE_LIMIT);
+
+  HeapTracker::Totals before = HeapTracker::GetTotals();
+  std::size_t maxLive        = LIVE_LIMIT - before.liveCount - 8;
+  std::size_t liveBytes      = 0;
+  std::size_t target         = 0;
+  bool allMatch              = true;
+
+  // Running the table close to its limit makes long clusters that wrap around its end, every free then shifts entries back
+  for (int step = 0; step < 200'000; step++) {
+    if (step % 5'000 == 0) {
+      target = step % 10'000 == 0 ? maxLive : rng() % maxLive;
+    }
+
+    if (live.size() < target || (live.size() < maxLive && rng() % 2 == 0)) {
+      std::size_t size = 1 + rng() % 256;
+
+      OS_HEAP_SITE(SITE_CHURN);
+      live.emplace_back(_keep(malloc(size)), size);
+      liveBytes += size;
+    } else if (!live.empty()) {
+      std::size_t index = rng() % live.size();
+      free(live[index].first);
+      liveBytes -= live[index].second;
+
+      live[index] = live.back();
+      live.pop_back();
+    }
+
+    HeapTracker::Totals totals = HeapTracker::GetTotals();
+    allMatch                   = allMatch && totals.liveCount == before.liveCount + live.size() && totals.liveBytes == before.liveBytes + liveBytes;
+    if (!allMatch) {
+      break;
+    }
+  }
+
+  TEST_ASSERT_TRUE(allMatch);
+  TEST_ASSERT_EQUAL_UINT32(before.untracked, HeapTracker::GetTotals().untracked);
+
+  HeapTracker::SiteStats site = _site(SITE_CHURN);
+  TEST_ASSERT_EQUAL_UINT32(live.size(), site.liveCount);
+  TEST_ASSERT_EQUAL_UINT32(liveBytes, site.liveBytes);
+
+  for (const auto& entry : live) {
+    free(entry.first);
+  }
+
+  site = _site(SITE_CHURN);
+  TEST_ASSERT_EQUAL_UINT32(0, site.liveCount);
+  TEST_ASSERT_EQUAL_UINT32(0, site.liveBytes);
+  TEST_ASSERT_EQUAL_UINT32(before.liveCount, HeapTracker::GetTotals().liveCount);
+}
+
+void test_allocations_past_the_table_go_untracked(void)
+{
+  std::vector<void*> blocks;
+  blocks.reserve(1000);
+
+  HeapTracker::Reset();
+  HeapTracker::Totals before = HeapTracker::GetTotals();
+
+  {
+    OS_HEAP_SITE(SITE_FILL);
+    for (int i = 0; i < 1000; i++) {
+      blocks.push_back(_keep(malloc(8)));
+    }
+  }
+
+  HeapTracker::Totals full = HeapTracker::GetTotals();
+  TEST_ASSERT_EQUAL_UINT32(LIVE_LIMIT, full.liveCount);
+  TEST_ASSERT_EQUAL_UINT32(1000 - (LIVE_LIMIT - before.liveCount), full.untracked);
+  TEST_ASSERT_EQUAL_UINT32(1000, _site(SITE_FILL).allocs);
+
+  for (void* block : blocks) {
+    free(block);
+  }
+
+  // Freeing a block that was never tracked changes nothing
+  HeapTracker::Totals after = HeapTracker::GetTotals();
+  TEST_ASSERT_EQUAL_UINT32(before.liveCount, after.liveCount);
+  TEST_ASSERT_EQUAL_UINT32(before.liveBytes, after.liveBytes);
+  TEST_ASSERT_EQUAL_UINT32(LIVE_LIMIT - before.liveCount, after.frees);
+  TEST_ASSERT_EQUAL_UINT32(0, _site(SITE_FILL).liveCount);
+}
+
+void test_reset_keeps_live_allocations(void)
+{
+  void* blocks[3];
+  {
+    OS_HEAP_SITE(SITE_B);
+    for (auto& block : blocks) {
+      block = _keep(malloc(50));
+    }
+  }
+
+  HeapTracker::Reset();
+
+  HeapTracker::SiteStats site = _site(SITE_B);
+  TEST_ASSERT_EQUAL_UINT32(0, site.allocs);
+  TEST_ASSERT_EQUAL_UINT64(0, site.allocBytes);
+  TEST_ASSERT_EQUAL_UINT32(3, site.liveCount);
+  TEST_ASSERT_EQUAL_UINT32(150, site.liveBytes);
+
+  HeapTracker::Totals totals = HeapTracker::GetTotals();
+  TEST_ASSERT_EQUAL_UINT32(0, totals.untracked);
+  TEST_ASSERT_GREATER_OR_EQUAL(150, totals.peakLiveBytes);
+
+  for (void* block : blocks) {
+    free(block);
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, _site(SITE_B).liveCount);
+}
+
+void test_sites_are_sorted_by_live_bytes(void)
+{
+  void* big;
+  void* small;
+  {
+    OS_HEAP_SITE(SITE_A);
+    big = _keep(malloc(100'000));
+  }
+  {
+    OS_HEAP_SITE(SITE_B);
+    small = _keep(malloc(10));
+  }
+
+  std::vector<HeapTracker::SiteStats> sites = HeapTracker::GetSites();
+  TEST_ASSERT_TRUE(sites.size() >= 2);
+  TEST_ASSERT_TRUE(sites[0].tag == SITE_A);
+
+  bool sorted = true;
+  for (std::size_t i = 1; i < sites.size(); i++) {
+    sorted = sorted && sites[i - 1].liveBytes >= sites[i].liveBytes;
+  }
+  TEST_ASSERT_TRUE(sorted);
+
+  free(big);
+  free(small);
+}
+
+void test_threads_track_their_own_sites(void)
+{
+  static const char* const tags[] = {"thread 0", "thread 1", "thread 2", "thread 3"};
+  uint32_t allocs[4]              = {};
+
+  HeapTracker::Reset();
+  uint32_t untrackedBefore = HeapTracker::GetTotals().untracked;
+
+  // Each thread keeps at most 64 blocks, well within the table even with all four at their peak
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([t, &allocs] {
+      std::mt19937 rng(t);
+      void* blocks[64] = {};
+
+      OS_HEAP_SITE(tags[t]);
+      for (int i = 0; i < 50'000; i++) {
+        void*& block = blocks[rng() % 64];
+        switch (rng() % 3) {
+          case 0:
+            free(block);
+            block = _keep(malloc(1 + rng() % 128));
+            allocs[t]++;
+            break;
+          case 1:
+            block = _keep(realloc(block, 1 + rng() % 128));
+            allocs[t]++;
+            break;
+          default:
+            free(block);
+            block = nullptr;
+            break;
+        }
+      }
+
+      for (void* block : blocks) {
+        free(block);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  for (int t = 0; t < 4; t++) {
+    HeapTracker::SiteStats site = _site(tags[t]);
+    TEST_ASSERT_EQUAL_UINT32(allocs[t], site.allocs);
+    TEST_ASSERT_EQUAL_UINT32(0, site.liveCount);
+    TEST_ASSERT_EQUAL_UINT32(0, site.liveBytes);
+  }
+  TEST_ASSERT_EQUAL_UINT32(untrackedBefore, HeapTracker::GetTotals().untracked);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_attributes_allocations_to_the_scoped_site);
+  RUN_TEST(test_realloc_moves_and_restores_tracking);
+  RUN_TEST(test_live_table_survives_churn);
+  RUN_TEST(test_allocations_past_the_table_go_untracked);
+  RUN_TEST(test_reset_keeps_live_allocations);
+  RUN_TEST(test_sites_are_sorted_by_live_bytes);
+  RUN_TEST(test_threads_track_their_own_sites);
+
+  return UNITY_END();
+}
@@ -0,0 +1,276 @@
+#include <unity.h>
+
+#include "http/ChunkedDecoder.h"
+#include "http/ContentRange.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+
+using namespace OpenShock::HTTP;
+
+void setUp(void) { }
+
+void tearDown(void) { }
+
+void test_parses_content_range_start(void)
+{
+  struct Case {
+    const char* header;
+    std::size_t start;
+  };
+
+  const Case valid[] = {
+    {            "bytes 100-199/200",        100},
+    {                  "bytes 0-0/1",          0},
+    {             "bytes 512-1023/*",        512},
+    {"bytes 4294967295-4294967295/*", 4294967295},
+  };
+
+  for (const auto& c : valid) {
+    std::size_t start = 0;
+    TEST_ASSERT_TRUE_MESSAGE(TryParseContentRangeStart(c.header, start), c.header);
+    TEST_ASSERT_EQUAL_size_t_MESSAGE(c.start, start, c.header);
+  }
+
+  const char* const invalid[] = {
+    "",
+    "bytes",
+    "bytes */200",                    // Unsatisfied range
+    "bytes=100-199/200",              // Range request syntax, not a response
+    "items 100-199/200",
+    "bytes 100",
+    "bytes -100/200",
+    "bytes 1a0-199/200",
+    "bytes 4294967296-4294967297/*",  // Does not fit the 32 bit sizes used for downloads
+  };
+
+  for (const char* header : invalid) {
+    std::size_t start = 12345;
+    TEST_ASSERT_FALSE_MESSAGE(TryParseContentRangeStart(header, start), header);
+  }
+}
+
+void test_trims_pieces_to_resume_offset(void)
+{
+  const uint8_t buffer[16] = {};
+
+  struct Case {
+    std::size_t offset;
+    std::size_t len;
+    bool kept;
+    std::size_t keptOffset;
+    std::size_t keptLen;
+  };
+
+  // Resuming at 100
+  const Case cases[] = {
+    {  0, 16, false,   0,  0},  // Entirely before
+    { 84, 16, false,   0,  0},  // Ends exactly at the resume point
+    { 90, 16,  true, 100,  6},  // Straddles it
+    { 99, 16,  true, 100, 15},
+    {100, 16,  true, 100, 16},  // Starts at it
+    {150, 16,  true, 150, 16},  // Entirely after
+  };
+
+  for (const auto& c : cases) {
+    std::size_t offset  = c.offset;
+    const uint8_t* data = buffer;
+    std::size_t len     = c.len;
+
+    bool kept = TrimToResumeOffset(100, offset, data, len);
+
+    std::string message = "piece at " + std::to_string(c.offset);
+    TEST_ASSERT_EQUAL_MESSAGE(c.kept, kept, message.c_str());
+    if (kept) {
+      TEST_ASSERT_EQUAL_size_t_MESSAGE(c.keptOffset, offset, message.c_str());
+      TEST_ASSERT_EQUAL_size_t_MESSAGE(c.keptLen, len, message.c_str());
+      TEST_ASSERT_TRUE_MESSAGE(data == buffer + (c.len - c.keptLen), message.c_str());
+    }
+  }
+}
+
+/// @brief A server that drops the connection at a random point of each response, honours or ignores Range requests and uses chunked encoding at random
+class FlakyServer {
+public:
+  struct Response {
+    int code;
+    std::string contentRange;
+    std::size_t contentLength;  // Of the whole response, 0 if chunked
+    bool chunked;
+    std::string wire;  // Body bytes as they arrive, possibly cut short
+  };
+
+  FlakyServer(const std::string& resource, uint32_t seed)
+    : m_resource(resource)
+    , m_rng(seed)
+  {
+  }
+
+  Response get(std::size_t rangeStart)
+  {
+    Response response;
+
+    std::size_t start = 0;
+    if (rangeStart > 0 && m_rng() % 4 != 0) {
+      start = rangeStart;
+
+      // Now and then a broken cache answers with the wrong range
+      std::size_t reportedStart = m_rng() % 20 == 0 ? start + 1 : start;
+
+      response.code         = 206;
+      response.contentRange = "bytes " + std::to_string(reportedStart) + "-" + std::to_string(m_resource.size() - 1) + "/" + std::to_string(m_resource.size());
+    } else {
+      response.code = 200;
+    }
+
+    std::string_view body = std::string_view(m_resource).substr(start);
+
+    response.chunked       = m_rng() % 2 == 0;
+    response.contentLength = response.chunked ? 0 : body.size();
+    response.wire          = response.chunked ? _chunk(body) : std::string(body);
+
+    // Most responses are cut off somewhere, headers are assumed to have arrived
+    if (m_rng() % 3 != 0) {
+      response.wire.resize(m_rng() % (response.wire.size() + 1));
+    }
+
+    return response;
+  }
+
+private:
+  std::string _chunk(std::string_view body)
+  {
+    std::string wire;
+    char line[32];
+
+    for (std::size_t pos = 0; pos < body.size();) {
+      std::size_t size = std::min<std::size_t>(1 + m_rng() % 70'000, body.size() - pos);
+
+      snprintf(line, sizeof(line), "%zx\r\n", size);
+      wire.append(line);
+      wire.append(body.substr(pos, size));
+      wire.append("\r\n");
+
+      pos += size;
+    }
+
+    wire.append("0\r\n\r\n");
+
+    return wire;
+  }
+
+  const std::string& m_resource;
+  std::mt19937 m_rng;
+};
+
+/// @brief Client side of one attempt, following what ResumeDownload does with the response
+/// @return True if the response was read to its end
+static bool _attempt(const FlakyServer::Response& response, std::size_t rangeStart, std::string& received, std::mt19937& rng)
+{
+  std::size_t responseStart = 0;
+  if (rangeStart > 0 && response.code == 206) {
+    if (!TryParseContentRangeStart(response.contentRange, responseStart) || responseStart != rangeStart) {
+      return false;
+    }
+  }
+
+  bool gap = false;
+
+  // Same checks as the OTA data writer, every byte must arrive exactly once and in order
+  auto consume = [&](std::size_t offset, const uint8_t* data, std::size_t len) {
+    std::size_t absolute = responseStart + offset;
+    if (rangeStart > 0 && !TrimToResumeOffset(rangeStart, absolute, data, len)) {
+      return true;
+    }
+
+    if (absolute != received.size()) {
+      gap = true;
+      return false;
+    }
+
+    received.append(reinterpret_cast<const char*>(data), len);
+    return true;
+  };
+
+  ChunkedDecoder decoder;
+  std::size_t bodyOffset = 0;
+
+  // Read the wire in TCP segment sized pieces until it runs out
+  for (std::size_t pos = 0; pos < response.wire.size();) {
+    std::size_t len        = std::min<std::size_t>(1 + rng() % 1436, response.wire.size() - pos);
+    const uint8_t* segment = reinterpret_cast<const uint8_t*>(response.wire.data() + pos);
+
+    if (response.chunked) {
+      std::size_t consumed = 0;
+      auto result          = decoder.feed(segment, len, consumed, [&](const uint8_t* data, std::size_t payloadLen) {
+        bool ok = consume(bodyOffset, data, payloadLen);
+        bodyOffset += payloadLen;
+        return ok;
+      });
+
+      TEST_ASSERT_FALSE(gap);
+      TEST_ASSERT_TRUE(result == ChunkedDecoder::Result::NeedMoreData || result == ChunkedDecoder::Result::Done);
+    } else {
+      TEST_ASSERT_TRUE(consume(bodyOffset, segment, len));
+      bodyOffset += len;
+    }
+
+    pos += len;
+  }
+
+  return response.chunked ? decoder.isDone() : bodyOffset == response.contentLength;
+}
+
+void test_resumes_across_dropped_connections(void)
+{
+  std::mt19937 rng(1);
+  std::string resource(300'000, '\0');
+  for (char& c : resource) {
+    c = static_cast<char>(rng());
+  }
+
+  std::size_t totalAttempts = 0;
+  std::size_t totalWire     = 0;
+
+  for (uint32_t seed = 1; seed <= 100; seed++) {
+    FlakyServer server(resource, seed);
+    std::mt19937 clientRng(seed);
+
+    std::string received;
+    std::size_t attempts = 0;
+
+    while (received.size() < resource.size()) {
+      TEST_ASSERT_LESS_OR_EQUAL_size_t(500, attempts++);
+
+      std::size_t rangeStart = received.size();
+
+      FlakyServer::Response response = server.get(rangeStart);
+      totalWire += response.wire.size();
+
+      if (_attempt(response, rangeStart, received, clientRng)) {
+        TEST_ASSERT_EQUAL_size_t(resource.size(), received.size());
+      }
+    }
+
+    TEST_ASSERT_TRUE_MESSAGE(received == resource, std::to_string(seed).c_str());
+    totalAttempts += attempts;
+  }
+
+  char message[96];
+  snprintf(message, sizeof(message), "%zu attempts, %.2fx the resource size on the wire", totalAttempts, static_cast<double>(totalWire) / (100.0 * resource.size()));
+  TEST_MESSAGE(message);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_parses_content_range_start);
+  RUN_TEST(test_trims_pieces_to_resume_offset);
+  RUN_TEST(test_resumes_across_dropped_connections);
+
+  return UNITY_END();
+}
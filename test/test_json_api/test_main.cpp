@@ -0,0 +1,236 @@
+#include <unity.h>
+
+#include "serialization/JsonAPI.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <string_view>
+
+using namespace OpenShock::Serialization;
+using namespace std::string_view_literals;
+
+// Tracks live heap bytes, so the tests can compare the peak of each parse path
+static std::size_t s_liveBytes = 0;
+static std::size_t s_peakBytes = 0;
+
+const std::size_t ALLOCATION_HEADER_SIZE = alignof(std::max_align_t);
+
+void* operator new(std::size_t size)
+{
+  uint8_t* ptr = static_cast<uint8_t*>(std::malloc(size + ALLOCATION_HEADER_SIZE));
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+
+  *reinterpret_cast<std::size_t*>(ptr) = size;
+
+  s_liveBytes += size;
+  s_peakBytes = std::max(s_peakBytes, s_liveBytes);
+
+  return ptr + ALLOCATION_HEADER_SIZE;
+}
+
+void operator delete(void* ptr) noexcept
+{
+  if (ptr == nullptr) {
+    return;
+  }
+
+  uint8_t* base = static_cast<uint8_t*>(ptr) - ALLOCATION_HEADER_SIZE;
+  s_liveBytes -= *reinterpret_cast<std::size_t*>(base);
+
+  std::free(base);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+  operator delete(ptr);
+}
+
+static void _resetPeak()
+{
+  s_peakBytes = s_liveBytes;
+}
+
+// A TCP segment's worth, the HTTP stream hands the body over in pieces of about this size
+const std::size_t BODY_CHUNK_SIZE = 1436;
+
+/// @brief Parses a body the way HTTP::GetJSON does, fed in network sized chunks
+template<typename Response, typename Parser>
+static bool _parse(std::string_view body, Response& out, std::size_t chunkSize = BODY_CHUNK_SIZE)
+{
+  Parser handler(out);
+  JsonStream::Parser parser(handler);
+
+  for (std::size_t offset = 0; offset < body.size(); offset += chunkSize) {
+    std::size_t length = std::min(chunkSize, body.size() - offset);
+
+    auto result = parser.feed(reinterpret_cast<const uint8_t*>(body.data() + offset), length);
+    if (result == JsonStream::Parser::Result::Invalid || result == JsonStream::Parser::Result::Cancelled) {
+      return false;
+    }
+  }
+
+  return parser.finish() == JsonStream::Parser::Result::Done;
+}
+
+static std::string _deviceInfo(std::size_t shockerCount, std::string_view rfId = "12345"sv)
+{
+  std::string body = R"({"message":"Successfully retrieved hub","data":{"id":"6b0a3c2e-9d7f-4e1a-8b5c-2f4d6e8a0c1b","name":"Living room hub","createdOn":"2024-03-14T09:26:53.589Z","shockers":[)";
+
+  for (std::size_t i = 0; i < shockerCount; i++) {
+    char shocker[320];
+    snprintf(
+      shocker,
+      sizeof(shocker),
+      R"(%s{"id":"0f3e5a7c-%04zx-4b2d-9e6f-1a3c5e7b9d0f","name":"Shocker %zu","rfId":%.*s,"model":"%s","isPaused":false,"createdOn":"2024-03-14T09:26:53.589Z"})",
+      i == 0 ? "" : ",",
+      i,
+      i,
+      static_cast<int>(rfId.size()),
+      rfId.data(),
+      i % 2 == 0 ? "CaiXianlin" : "PetTrainer"
+    );
+    body.append(shocker);
+  }
+
+  body.append("]}}");
+
+  return body;
+}
+
+/// @brief Mirrors struct cJSON, every value in a document costs one of these on the old path
+struct CJsonNode {
+  CJsonNode* next;
+  CJsonNode* prev;
+  CJsonNode* child;
+  int type;
+  char* valuestring;
+  int valueint;
+  double valuedouble;
+  char* string;
+};
+
+/// @brief Adds up what cJSON_ParseWithLength allocates for a document: a node per value, plus a copy of every member name and string value
+class CJsonTreeSize : public JsonStream::Handler {
+public:
+  std::size_t bytes = 0;
+
+  bool onToken(const JsonStream::Token& token) override
+  {
+    if (token.type == JsonStream::TokenType::ObjectEnd || token.type == JsonStream::TokenType::ArrayEnd) {
+      return true;
+    }
+
+    bytes += sizeof(CJsonNode);
+    if (!token.key.empty()) {
+      bytes += token.key.size() + 1;
+    }
+    if (token.type == JsonStream::TokenType::String) {
+      bytes += token.value.size() + 1;
+    }
+
+    return true;
+  }
+};
+
+/// @brief Peak heap of the old GetJSON for a body: GetString reserved the whole body, the cJSON tree was built from it and the response struct filled from the tree,
+/// then the struct was copied into the returned Response after the tree was deleted
+static std::size_t _oldPeakBytes(std::string_view body, std::size_t structBytes)
+{
+  CJsonTreeSize tree;
+  JsonStream::Parser parser(tree);
+  parser.feed(reinterpret_cast<const uint8_t*>(body.data()), body.size());
+  TEST_ASSERT_TRUE(parser.finish() == JsonStream::Parser::Result::Done);
+
+  return (body.size() + 1) + std::max(tree.bytes + structBytes, 2 * structBytes);
+}
+
+void setUp(void) { }
+
+void tearDown(void) { }
+
+void test_parses_device_info(void)
+{
+  JsonAPI::DeviceInfoResponse info;
+  TEST_ASSERT_TRUE((_parse<JsonAPI::DeviceInfoResponse, JsonAPI::DeviceInfoJsonParser>(_deviceInfo(3), info, 7)));
+
+  TEST_ASSERT_EQUAL_STRING("6b0a3c2e-9d7f-4e1a-8b5c-2f4d6e8a0c1b", info.deviceId.c_str());
+  TEST_ASSERT_EQUAL_STRING("Living room hub", info.deviceName.c_str());
+  TEST_ASSERT_EQUAL_size_t(3, info.shockers.size());
+  TEST_ASSERT_EQUAL_STRING("0f3e5a7c-0002-4b2d-9e6f-1a3c5e7b9d0f", info.shockers[2].id.c_str());
+  TEST_ASSERT_EQUAL_UINT16(12345, info.shockers[2].rfId);
+  TEST_ASSERT_TRUE(info.shockers[0].model == OpenShock::ShockerModelType::CaiXianlin);
+  TEST_ASSERT_TRUE(info.shockers[1].model == OpenShock::ShockerModelType::Petrainer);
+}
+
+void test_rf_id_accepts_whole_numbers_like_cjson(void)
+{
+  for (auto [rfId, expected] : {std::pair {"1.0"sv, 1}, {"1e2"sv, 100}, {"6.5535e4"sv, 65535}, {"0"sv, 0}}) {
+    JsonAPI::DeviceInfoResponse info;
+    TEST_ASSERT_TRUE_MESSAGE((_parse<JsonAPI::DeviceInfoResponse, JsonAPI::DeviceInfoJsonParser>(_deviceInfo(1, rfId), info)), rfId.data());
+    TEST_ASSERT_EQUAL_UINT16(expected, info.shockers[0].rfId);
+  }
+
+  for (std::string_view rfId : {"1.5"sv, "65536"sv, "-1"sv, "1e5"sv}) {
+    JsonAPI::DeviceInfoResponse info;
+    TEST_ASSERT_FALSE_MESSAGE((_parse<JsonAPI::DeviceInfoResponse, JsonAPI::DeviceInfoJsonParser>(_deviceInfo(1, rfId), info)), rfId.data());
+  }
+}
+
+void test_rejects_incomplete_responses(void)
+{
+  JsonAPI::DeviceInfoResponse info;
+  TEST_ASSERT_FALSE((_parse<JsonAPI::DeviceInfoResponse, JsonAPI::DeviceInfoJsonParser>(R"({"data":{"id":"a","name":"b"}})"sv, info)));
+  TEST_ASSERT_FALSE((_parse<JsonAPI::DeviceInfoResponse, JsonAPI::DeviceInfoJsonParser>(R"({"data":{"id":"a","name":"b","shockers":[{"id":"c","rfId":1}]}})"sv, info)));
+
+  JsonAPI::AccountLinkResponse link;
+  TEST_ASSERT_FALSE((_parse<JsonAPI::AccountLinkResponse, JsonAPI::AccountLinkJsonParser>(R"({"data":42})"sv, link)));
+  TEST_ASSERT_TRUE((_parse<JsonAPI::AccountLinkResponse, JsonAPI::AccountLinkJsonParser>(R"({"message":"ok","data":"token"})"sv, link)));
+  TEST_ASSERT_EQUAL_STRING("token", link.authToken.c_str());
+}
+
+void test_peak_heap_against_cjson(void)
+{
+  for (std::size_t shockerCount : {1u, 8u, 32u}) {
+    std::string body = _deviceInfo(shockerCount);
+
+    // What the parsed response itself holds on to, both paths end up with this
+    std::size_t before = s_liveBytes;
+    JsonAPI::DeviceInfoResponse info;
+    TEST_ASSERT_TRUE((_parse<JsonAPI::DeviceInfoResponse, JsonAPI::DeviceInfoJsonParser>(body, info)));
+    std::size_t structBytes = s_liveBytes - before;
+
+    JsonAPI::DeviceInfoResponse streamed;
+    _resetPeak();
+    before = s_liveBytes;
+    TEST_ASSERT_TRUE((_parse<JsonAPI::DeviceInfoResponse, JsonAPI::DeviceInfoJsonParser>(body, streamed)));
+    std::size_t newPeak = s_peakBytes - before;
+
+    std::size_t oldPeak = _oldPeakBytes(body, structBytes);
+
+    // The streaming parser keeps nothing on the heap besides the response, vector growth aside
+    TEST_ASSERT_LESS_OR_EQUAL_size_t(2 * structBytes, newPeak);
+    TEST_ASSERT_GREATER_THAN_size_t(newPeak, oldPeak);
+
+    char message[200];
+    snprintf(message, sizeof(message), "Device info with %zu shockers (%zu byte body): peak heap %zu bytes with cJSON, %zu streamed (parser state is %zu bytes of stack)", shockerCount, body.size(), oldPeak, newPeak, sizeof(JsonStream::Parser));
+    TEST_MESSAGE(message);
+  }
+}
+
+int main()
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_parses_device_info);
+  RUN_TEST(test_rf_id_accepts_whole_numbers_like_cjson);
+  RUN_TEST(test_rejects_incomplete_responses);
+  RUN_TEST(test_peak_heap_against_cjson);
+
+  return UNITY_END();
+}
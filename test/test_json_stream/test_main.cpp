@@ -0,0 +1,444 @@
+#include <unity.h>
+
+#include "Convert.h"
+#include "serialization/JsonStream.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace OpenShock::Serialization::JsonStream;
+
+/// @brief Records every token as "<depth><key:><type><value>", e.g. "1name:Sfoo" for a string member at depth 1
+class RecordingHandler : public Handler {
+public:
+  std::vector<std::string> tokens;
+  std::size_t cancelAfter = SIZE_MAX;
+  bool endResult          = true;
+  bool ended              = false;
+
+  bool onToken(const Token& token) override
+  {
+    static const char TypeChars[] = "{}[]SNTF0";
+
+    std::string text = std::to_string(token.depth);
+    if (!token.key.empty()) {
+      text.append(token.key).push_back(':');
+    }
+    text.push_back(TypeChars[static_cast<uint8_t>(token.type)]);
+    text.append(token.value);
+
+    // Values are documented to be null-terminated
+    if (token.value.data()[token.value.size()] != '\0') {
+      text.append("<unterminated>");
+    }
+
+    tokens.push_back(std::move(text));
+
+    return tokens.size() < cancelAfter;
+  }
+
+  bool onEnd() override
+  {
+    ended = true;
+    return endResult;
+  }
+
+  std::string joined() const
+  {
+    std::string result;
+    for (const auto& token : tokens) {
+      if (!result.empty()) {
+        result.push_back(' ');
+      }
+      result.append(token);
+    }
+    return result;
+  }
+};
+
+static Parser::Result _parse(std::string_view json, RecordingHandler& handler, std::size_t chunkSize = SIZE_MAX)
+{
+  Parser parser(handler);
+
+  Parser::Result result = Parser::Result::NeedMoreData;
+  for (std::size_t pos = 0; pos < json.size() && result == Parser::Result::NeedMoreData; pos += chunkSize) {
+    std::size_t len = std::min(chunkSize, json.size() - pos);
+    result          = parser.feed(reinterpret_cast<const uint8_t*>(json.data() + pos), len);
+  }
+
+  if (result == Parser::Result::Invalid || result == Parser::Result::Cancelled) {
+    return result;
+  }
+
+  return parser.finish();
+}
+
+static std::string _write(void (*fn)(Writer&), bool* ok = nullptr)
+{
+  std::string output;
+
+  Writer writer([&output](const char* data, std::size_t len) {
+    output.append(data, len);
+    return true;
+  });
+
+  fn(writer);
+
+  bool finished = writer.finish();
+  if (ok != nullptr) {
+    *ok = finished;
+  }
+
+  return output;
+}
+
+const char* const SAMPLE_DOCUMENT = R"({
+  "id": "8d1b2c3a",
+  "name": "Hub \"one\"\n\u00e9\ud83d\ude00",
+  "shockers": [
+    {"id": "a", "rfId": 12345, "model": "CaiXianlin", "paused": false},
+    {"id": "b", "rfId": -1.5e3, "model": null, "paused": true}
+  ],
+  "empty": {},
+  "list": [[], [1, [2, [3]]]]
+})";
+
+void setUp(void) { }
+
+void tearDown(void) { }
+
+void test_tokens_in_document_order(void)
+{
+  RecordingHandler handler;
+  TEST_ASSERT_EQUAL(static_cast<int>(Parser::Result::Done), static_cast<int>(_parse(R"({"a": [1, "x", true, false, null], "b": {}})", handler)));
+
+  TEST_ASSERT_EQUAL_STRING("0{ 1a:[ 2N1 2Sx 2T 2F 20 1] 1b:{ 1} 0}", handler.joined().c_str());
+  TEST_ASSERT_TRUE(handler.ended);
+}
+
+void test_every_chunk_size_yields_the_same_tokens(void)
+{
+  RecordingHandler whole;
+  TEST_ASSERT_EQUAL(static_cast<int>(Parser::Result::Done), static_cast<int>(_parse(SAMPLE_DOCUMENT, whole)));
+
+  std::size_t length = strlen(SAMPLE_DOCUMENT);
+  for (std::size_t chunkSize = 1; chunkSize <= length; chunkSize++) {
+    RecordingHandler chunked;
+    TEST_ASSERT_EQUAL_MESSAGE(static_cast<int>(Parser::Result::Done), static_cast<int>(_parse(SAMPLE_DOCUMENT, chunked, chunkSize)), std::to_string(chunkSize).c_str());
+    TEST_ASSERT_EQUAL_STRING_MESSAGE(whole.joined().c_str(), chunked.joined().c_str(), std::to_string(chunkSize).c_str());
+  }
+}
+
+void test_unescapes_strings(void)
+{
+  RecordingHandler handler;
+  TEST_ASSERT_EQUAL(static_cast<int>(Parser::Result::Done), static_cast<int>(_parse(R"("q\"b\\s\/n\nt\tu\u0041\u00e9\u20ac\ud83d\ude00")", handler)));
+
+  TEST_ASSERT_EQUAL_size_t(1, handler.tokens.size());
+  TEST_ASSERT_EQUAL_STRING("0Sq\"b\\s/n\nt\tuA\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80", handler.tokens[0].c_str());
+}
+
+void test_root_number_completes_on_finish(void)
+{
+  RecordingHandler handler;
+  Parser parser(handler);
+
+  TEST_ASSERT_EQUAL(static_cast<int>(Parser::Result::NeedMoreData), static_cast<int>(parser.feed(reinterpret_cast<const uint8_t*>("-12.5e2"), 7)));
+  TEST_ASSERT_EQUAL_size_t(0, handler.tokens.size());
+
+  TEST_ASSERT_EQUAL(static_cast<int>(Parser::Result::Done), static_cast<int>(parser.finish()));
+  TEST_ASSERT_EQUAL_STRING("0N-12.5e2", handler.joined().c_str());
+}
+
+void test_rejects_malformed_documents(void)
+{
+  const char* const documents[] = {
+    "",
+    "{",
+    "[1,]",
+    "[1 2]",
+    "{\"a\" 1}",
+    "{\"a\":1,}",
+    "{1:2}",
+    "{\"a\":1}}",
+    "[}",
+    "tru",
+    "nul",
+    "1.2.3",
+    "--1",
+    "\"unterminated",
+    "\"ctrl\x01\"",
+    "\"\\x\"",
+    "\"\\u12G4\"",
+    "\"\\ud83d\"",
+    "\"\\ude00\"",
+    "\"\\ud83dx\"",
+    "{} {}",
+  };
+
+  for (const char* document : documents) {
+    RecordingHandler handler;
+    TEST_ASSERT_EQUAL_MESSAGE(static_cast<int>(Parser::Result::Invalid), static_cast<int>(_parse(document, handler)), document);
+  }
+}
+
+void test_enforces_limits(void)
+{
+  std::string deepest = std::string(Parser::MaxDepth, '[') + std::string(Parser::MaxDepth, ']');
+  std::string tooDeep = std::string(Parser::MaxDepth + 1, '[') + std::string(Parser::MaxDepth + 1, ']');
+
+  std::string longestKey = "{\"" + std::string(Parser::MaxKeyLength, 'k') + "\":1}";
+  std::string tooLongKey = "{\"" + std::string(Parser::MaxKeyLength + 1, 'k') + "\":1}";
+
+  std::string longestValue = "\"" + std::string(Parser::MaxValueLength, 'v') + "\"";
+  std::string tooLongValue = "\"" + std::string(Parser::MaxValueLength + 1, 'v') + "\"";
+
+  // Escapes count by their unescaped length, two bytes here
+  std::string longestEscaped = "\"" + std::string(Parser::MaxValueLength - 2, 'v') + "\\u00e9\"";
+  std::string tooLongEscaped = "\"" + std::string(Parser::MaxValueLength - 1, 'v') + "\\u00e9\"";
+
+  RecordingHandler handler;
+  TEST_ASSERT_EQUAL(static_cast<int>(Parser::Result::Done), static_cast<int>(_parse(deepest, handler)));
+  TEST_ASSERT_EQUAL(static_cast<int>(Parser::Result::Invalid), static_cast<int>(_parse(tooDeep, handler)));
+  TEST_ASSERT_EQUAL(static_cast<int>(Parser::Result::Done), static_cast<int>(_parse(longestKey, handler)));
+  TEST_ASSERT_EQUAL(static_cast<int>(Parser::Result::Invalid), static_cast<int>(_parse(tooLongKey, handler)));
+  TEST_ASSERT_EQUAL(static_cast<int>(Parser::Result::Done), static_cast<int>(_parse(longestValue, handler)));
+  TEST_ASSERT_EQUAL(static_cast<int>(Parser::Result::Invalid), static_cast<int>(_parse(tooLongValue, handler)));
+  TEST_ASSERT_EQUAL(static_cast<int>(Parser::Result::Done), static_cast<int>(_parse(longestEscaped, handler)));
+  TEST_ASSERT_EQUAL(static_cast<int>(Parser::Result::Invalid), static_cast<int>(_parse(tooLongEscaped, handler)));
+}
+
+void test_handler_can_cancel(void)
+{
+  RecordingHandler handler;
+  handler.cancelAfter = 2;
+
+  Parser parser(handler);
+  TEST_ASSERT_EQUAL(static_cast<int>(Parser::Result::Cancelled), static_cast<int>(parser.feed(reinterpret_cast<const uint8_t*>("[1, 2, 3"), 8)));
+  TEST_ASSERT_EQUAL_size_t(2, handler.tokens.size());
+
+  // Stays cancelled, nothing more reaches the handler
+  TEST_ASSERT_EQUAL(static_cast<int>(Parser::Result::Cancelled), static_cast<int>(parser.feed(reinterpret_cast<const uint8_t*>("]"), 1)));
+  TEST_ASSERT_EQUAL(static_cast<int>(Parser::Result::Cancelled), static_cast<int>(parser.finish()));
+  TEST_ASSERT_EQUAL_size_t(2, handler.tokens.size());
+  TEST_ASSERT_FALSE(handler.ended);
+}
+
+void test_handler_end_validation(void)
+{
+  RecordingHandler handler;
+  handler.endResult = false;
+
+  TEST_ASSERT_EQUAL(static_cast<int>(Parser::Result::Invalid), static_cast<int>(_parse("{}", handler)));
+  TEST_ASSERT_TRUE(handler.ended);
+}
+
+void test_reset_allows_reuse(void)
+{
+  RecordingHandler handler;
+  Parser parser(handler);
+
+  TEST_ASSERT_EQUAL(static_cast<int>(Parser::Result::Invalid), static_cast<int>(parser.feed(reinterpret_cast<const uint8_t*>("[}"), 2)));
+
+  parser.reset();
+  handler.tokens.clear();
+
+  TEST_ASSERT_EQUAL(static_cast<int>(Parser::Result::Done), static_cast<int>(parser.feed(reinterpret_cast<const uint8_t*>("[true]"), 6)));
+  TEST_ASSERT_EQUAL_STRING("0[ 1T 0]", handler.joined().c_str());
+}
+
+void test_number_to_integer(void)
+{
+  uint16_t u16 = 0;
+  TEST_ASSERT_TRUE(NumberToInteger("65535", u16, OpenShock::Convert::ToUint16));
+  TEST_ASSERT_EQUAL_UINT16(65535, u16);
+
+  // Whole numbers with a fraction or exponent, as cJSON accepted them
+  TEST_ASSERT_TRUE(NumberToInteger("1.0", u16, OpenShock::Convert::ToUint16));
+  TEST_ASSERT_EQUAL_UINT16(1, u16);
+  TEST_ASSERT_TRUE(NumberToInteger("1e2", u16, OpenShock::Convert::ToUint16));
+  TEST_ASSERT_EQUAL_UINT16(100, u16);
+  TEST_ASSERT_TRUE(NumberToInteger("6.5535E4", u16, OpenShock::Convert::ToUint16));
+  TEST_ASSERT_EQUAL_UINT16(65535, u16);
+
+  u16 = 7;
+  for (const char* rejected : {"1.5", "65536", "6.5536e4", "-1", "-1.0", "1e400", "", "1e", "0x10"}) {
+    TEST_ASSERT_FALSE_MESSAGE(NumberToInteger(rejected, u16, OpenShock::Convert::ToUint16), rejected);
+  }
+  TEST_ASSERT_EQUAL_UINT16(7, u16);
+
+  int8_t i8 = 0;
+  TEST_ASSERT_TRUE(NumberToInteger("-1.28e2", i8, OpenShock::Convert::ToInt8));
+  TEST_ASSERT_EQUAL_INT(-128, i8);
+  TEST_ASSERT_FALSE(NumberToInteger("1.28e2", i8, OpenShock::Convert::ToInt8));
+
+  // The largest values are not exactly representable as a double, the bound must still hold
+  uint64_t u64 = 0;
+  TEST_ASSERT_TRUE(NumberToInteger("18446744073709551615", u64, OpenShock::Convert::ToUint64));
+  TEST_ASSERT_FALSE(NumberToInteger("1.8446744073709552e19", u64, OpenShock::Convert::ToUint64));
+}
+
+void test_writer_output(void)
+{
+  bool ok       = false;
+  std::string s = _write(
+    [](Writer& writer) {
+      writer.beginObject();
+      writer.key("a");
+      writer.number(-9'007'199'254'740'993LL);
+      writer.key("b");
+      writer.beginArray();
+      writer.boolean(true);
+      writer.null();
+      writer.beginObject();
+      writer.endObject();
+      writer.beginArray();
+      writer.endArray();
+      writer.endArray();
+      writer.key("c");
+      writer.string("x");
+      writer.endObject();
+    },
+    &ok
+  );
+
+  TEST_ASSERT_TRUE(ok);
+  TEST_ASSERT_EQUAL_STRING(R"({"a":-9007199254740993,"b":[true,null,{},[]],"c":"x"})", s.c_str());
+}
+
+void test_writer_escapes_and_round_trips(void)
+{
+  bool ok       = false;
+  std::string s = _write(
+    [](Writer& writer) {
+      writer.beginObject();
+      writer.key("k\"ey");
+      writer.string("q\"b\\n\nr\rt\tc\x01\x1f\xC3\xA9");
+      writer.endObject();
+    },
+    &ok
+  );
+
+  TEST_ASSERT_TRUE(ok);
+  TEST_ASSERT_EQUAL_STRING("{\"k\\\"ey\":\"q\\\"b\\\\n\\nr\\rt\\tc\\u0001\\u001f\xC3\xA9\"}", s.c_str());
+
+  RecordingHandler handler;
+  TEST_ASSERT_EQUAL(static_cast<int>(Parser::Result::Done), static_cast<int>(_parse(s, handler)));
+  TEST_ASSERT_EQUAL_STRING("0{ 1k\"ey:Sq\"b\\n\nr\rt\tc\x01\x1f\xC3\xA9 0}", handler.joined().c_str());
+}
+
+void test_writer_flushes_in_buffer_sized_pieces(void)
+{
+  std::string value(Writer::BufferSize * 3 + 7, 'x');
+
+  std::string output;
+  std::size_t pieces  = 0;
+  std::size_t largest = 0;
+
+  Writer writer([&](const char* data, std::size_t len) {
+    output.append(data, len);
+    pieces++;
+    largest = std::max(largest, len);
+    return true;
+  });
+
+  writer.string(value);
+  TEST_ASSERT_TRUE(writer.finish());
+
+  TEST_ASSERT_EQUAL_STRING(("\"" + value + "\"").c_str(), output.c_str());
+  TEST_ASSERT_EQUAL_size_t(4, pieces);
+  TEST_ASSERT_EQUAL_size_t(Writer::BufferSize, largest);
+}
+
+void test_writer_sink_failure_is_sticky(void)
+{
+  std::size_t calls = 0;
+
+  Writer writer([&calls](const char*, std::size_t) {
+    calls++;
+    return false;
+  });
+
+  writer.beginArray();
+  for (std::size_t i = 0; i < Writer::BufferSize; i++) {
+    writer.number(1);
+  }
+  writer.endArray();
+
+  TEST_ASSERT_FALSE(writer.ok());
+  TEST_ASSERT_FALSE(writer.finish());
+  TEST_ASSERT_EQUAL_size_t(1, calls);
+}
+
+void test_writer_rejects_misuse(void)
+{
+  void (*const misuses[])(Writer&) = {
+    [](Writer&) { },
+    [](Writer& writer) {
+      writer.beginObject();
+      writer.number(1);
+      writer.endObject();
+    },
+    [](Writer& writer) {
+      writer.beginArray();
+      writer.key("a");
+      writer.endArray();
+    },
+    [](Writer& writer) {
+      writer.beginObject();
+      writer.key("a");
+      writer.endObject();
+    },
+    [](Writer& writer) {
+      writer.beginObject();
+      writer.endArray();
+    },
+    [](Writer& writer) {
+      writer.beginArray();
+    },
+    [](Writer& writer) {
+      writer.number(1);
+      writer.number(2);
+    },
+    [](Writer& writer) {
+      for (std::size_t i = 0; i <= Writer::MaxDepth; i++) {
+        writer.beginArray();
+      }
+      for (std::size_t i = 0; i <= Writer::MaxDepth; i++) {
+        writer.endArray();
+      }
+    },
+  };
+
+  for (auto misuse : misuses) {
+    bool ok = true;
+    _write(misuse, &ok);
+    TEST_ASSERT_FALSE(ok);
+  }
+}
+
+int main()
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_tokens_in_document_order);
+  RUN_TEST(test_every_chunk_size_yields_the_same_tokens);
+  RUN_TEST(test_unescapes_strings);
+  RUN_TEST(test_root_number_completes_on_finish);
+  RUN_TEST(test_rejects_malformed_documents);
+  RUN_TEST(test_enforces_limits);
+  RUN_TEST(test_handler_can_cancel);
+  RUN_TEST(test_handler_end_validation);
+  RUN_TEST(test_reset_allows_reuse);
+  RUN_TEST(test_number_to_integer);
+  RUN_TEST(test_writer_output);
+  RUN_TEST(test_writer_escapes_and_round_trips);
+  RUN_TEST(test_writer_flushes_in_buffer_sized_pieces);
+  RUN_TEST(test_writer_sink_failure_is_sticky);
+  RUN_TEST(test_writer_rejects_misuse);
+
+  return UNITY_END();
+}
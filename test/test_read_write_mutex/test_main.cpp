@@ -0,0 +1,432 @@
+#include <unity.h>
+
+#include <freertos/FreeRTOS.h>
+
+#include "ReadWriteMutex.h"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace OpenShock;
+
+/// @brief The two semaphore lock ReadWriteMutex replaced, kept to benchmark against
+class TwoSemaphoreMutex {
+public:
+  TwoSemaphoreMutex() : m_mutex(xSemaphoreCreateMutex()), m_readSem(xSemaphoreCreateBinary()), m_readers(0) { xSemaphoreGive(m_readSem); }
+  ~TwoSemaphoreMutex() {
+    vSemaphoreDelete(m_mutex);
+    vSemaphoreDelete(m_readSem);
+  }
+
+  bool lockRead(TickType_t xTicksToWait) {
+    if (xSemaphoreTake(m_readSem, xTicksToWait) == pdFALSE) {
+      return false;
+    }
+
+    if (++m_readers == 1) {
+      if (xSemaphoreTake(m_mutex, xTicksToWait) == pdFALSE) {
+        xSemaphoreGive(m_readSem);
+        return false;
+      }
+    }
+
+    xSemaphoreGive(m_readSem);
+
+    return true;
+  }
+
+  void unlockRead() {
+    xSemaphoreTake(m_readSem, portMAX_DELAY);
+
+    if (--m_readers == 0) {
+      xSemaphoreGive(m_mutex);
+    }
+
+    xSemaphoreGive(m_readSem);
+  }
+
+  bool lockWrite(TickType_t xTicksToWait) { return xSemaphoreTake(m_mutex, xTicksToWait) == pdTRUE; }
+  void unlockWrite() { xSemaphoreGive(m_mutex); }
+
+private:
+  SemaphoreHandle_t m_mutex;
+  SemaphoreHandle_t m_readSem;
+  int m_readers;
+};
+
+#if OPENSHOCK_RWMUTEX_CHECK_REENTRY
+/// @brief Runs fn in a child process
+/// @return True if the child aborted, which is how a panic ends on the host
+static bool _aborts(const std::function<void()>& fn)
+{
+  fflush(stdout);
+
+  pid_t pid = fork();
+  if (pid == 0) {
+    fn();
+    _exit(0);
+  }
+
+  int status = 0;
+  waitpid(pid, &status, 0);
+
+  return WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT;
+}
+#endif
+
+void setUp(void) { }
+
+void tearDown(void) { }
+
+void test_excludes_under_random_timeouts(void)
+{
+  ReadWriteMutex mutex;
+
+  std::atomic<int> readers(0);
+  std::atomic<int> writers(0);
+  std::atomic<uint32_t> violations(0);
+  std::atomic<uint32_t> reads(0);
+  std::atomic<uint32_t> writes(0);
+  std::atomic<uint32_t> timeouts(0);
+
+  // Written together under the write lock, readers must always see them equal
+  uint64_t first  = 0;
+  uint64_t second = 0;
+
+  auto worker = [&](uint32_t seed) {
+    std::mt19937 rng(seed);
+
+    for (int i = 0; i < 20'000; i++) {
+      bool write = rng() % 8 == 0;
+
+      // Short timeouts expire while waiters are being let in, which exercises the give-back paths
+      TickType_t timeout = rng() % 4 == 0 ? 0 : rng() % 4 == 0 ? 1 : portMAX_DELAY;
+
+      if (write) {
+        if (!mutex.lockWrite(timeout)) {
+          timeouts++;
+          continue;
+        }
+
+        if (writers.fetch_add(1) != 0 || readers.load() != 0) {
+          violations++;
+        }
+
+        first++;
+        if (rng() % 16 == 0) {
+          std::this_thread::yield();
+        }
+        second++;
+
+        writers.fetch_sub(1);
+        mutex.unlockWrite();
+        writes++;
+      } else {
+        if (!mutex.lockRead(timeout)) {
+          timeouts++;
+          continue;
+        }
+
+        readers.fetch_add(1);
+        if (writers.load() != 0 || first != second) {
+          violations++;
+        }
+
+        if (rng() % 16 == 0) {
+          std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+
+        readers.fetch_sub(1);
+        mutex.unlockRead();
+        reads++;
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (uint32_t seed = 1; seed <= 6; seed++) {
+    threads.emplace_back(worker, seed);
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  TEST_ASSERT_EQUAL_UINT32(0, violations.load());
+  TEST_ASSERT_GREATER_THAN_UINT32(0, writes.load());
+  TEST_ASSERT_EQUAL_UINT64(writes.load(), first);
+
+  // Every waiter that timed out took itself out of the counts, an idle mutex is free for both sides
+  TEST_ASSERT_TRUE(mutex.lockWrite(0));
+  mutex.unlockWrite();
+  TEST_ASSERT_TRUE(mutex.lockRead(0));
+  mutex.unlockRead();
+
+  char message[96];
+  snprintf(message, sizeof(message), "%u reads, %u writes, %u timeouts", reads.load(), writes.load(), timeouts.load());
+  TEST_MESSAGE(message);
+}
+
+/// @brief Keeps the read lock held by at least one of four overlapping readers, then measures how long a writer waits for it
+/// @return Microseconds waited, or -1 if the writer timed out
+template<typename Mutex>
+static int64_t _writerWaitAgainstReaders(Mutex& mutex, TickType_t timeout)
+{
+  std::atomic<bool> stop(false);
+  std::atomic<uint32_t> readsAfterWrite(0);
+  std::atomic<bool> written(false);
+
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; i++) {
+    readers.emplace_back([&, i] {
+      std::this_thread::sleep_for(std::chrono::microseconds(250 * i));
+
+      while (!stop.load()) {
+        if (mutex.lockRead(portMAX_DELAY)) {
+          std::this_thread::sleep_for(std::chrono::milliseconds(1));
+          mutex.unlockRead();
+
+          if (written.load()) {
+            readsAfterWrite++;
+          }
+        }
+      }
+    });
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+  auto begin  = std::chrono::steady_clock::now();
+  bool locked = mutex.lockWrite(timeout);
+  auto waited = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count();
+
+  if (locked) {
+    mutex.unlockWrite();
+    written = true;
+
+    // Readers queued behind the writer carry on
+    for (int i = 0; i < 1000 && readsAfterWrite.load() == 0; i++) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+
+  stop = true;
+  for (auto& reader : readers) {
+    reader.join();
+  }
+
+  if (locked) {
+    TEST_ASSERT_GREATER_THAN_UINT32(0, readsAfterWrite.load());
+  }
+
+  return locked ? waited : -1;
+}
+
+void test_waiting_writer_holds_off_new_readers(void)
+{
+  ReadWriteMutex mutex;
+
+  int64_t waited = _writerWaitAgainstReaders(mutex, pdMS_TO_TICKS(2000));
+  TEST_ASSERT_NOT_EQUAL(-1, waited);
+  TEST_ASSERT_LESS_THAN_INT64(100'000, waited);  // Readers hold the lock for 1 ms each
+}
+
+void test_writers_do_not_starve_readers(void)
+{
+  ReadWriteMutex mutex;
+  std::atomic<bool> stop(false);
+
+  std::vector<std::thread> writers;
+  for (int i = 0; i < 2; i++) {
+    writers.emplace_back([&] {
+      while (!stop.load()) {
+        if (mutex.lockWrite(portMAX_DELAY)) {
+          std::this_thread::sleep_for(std::chrono::milliseconds(1));
+          mutex.unlockWrite();
+        }
+      }
+    });
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+  // A released writer lets the readers queued behind it in before the next writer
+  int timedOut      = 0;
+  int64_t maxWaited = 0;
+  for (int i = 0; i < 20; i++) {
+    auto begin = std::chrono::steady_clock::now();
+    if (mutex.lockRead(pdMS_TO_TICKS(2000))) {
+      mutex.unlockRead();
+    } else {
+      timedOut++;
+    }
+    maxWaited = std::max<int64_t>(maxWaited, std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count());
+  }
+
+  stop = true;
+  for (auto& writer : writers) {
+    writer.join();
+  }
+
+  TEST_ASSERT_EQUAL_INT(0, timedOut);
+  TEST_ASSERT_LESS_THAN_INT64(100'000, maxWaited);  // Writers hold the lock for 1 ms each
+}
+
+#if OPENSHOCK_RWMUTEX_CHECK_REENTRY
+void test_reentry_panics(void)
+{
+  TEST_ASSERT_TRUE(_aborts([] {
+    ReadWriteMutex mutex("nested");
+    mutex.lockWrite(portMAX_DELAY);
+    mutex.lockWrite(portMAX_DELAY);
+  }));
+  TEST_ASSERT_TRUE(_aborts([] {
+    ReadWriteMutex mutex;
+    mutex.lockWrite(portMAX_DELAY);
+    mutex.lockRead(portMAX_DELAY);
+  }));
+  TEST_ASSERT_TRUE(_aborts([] {
+    ReadWriteMutex mutex;
+    mutex.lockRead(portMAX_DELAY);
+    mutex.lockWrite(portMAX_DELAY);
+  }));
+
+  // Only deadlocks once a writer queues in between, which is exactly when it is hard to reproduce
+  TEST_ASSERT_TRUE(_aborts([] {
+    ReadWriteMutex mutex;
+    mutex.lockRead(portMAX_DELAY);
+    mutex.lockRead(portMAX_DELAY);
+  }));
+}
+
+void test_reentry_check_has_no_false_positives(void)
+{
+  TEST_ASSERT_FALSE(_aborts([] {
+    ReadWriteMutex first;
+    ReadWriteMutex second;
+
+    // Other mutexes, and the same one again after unlocking
+    first.lockRead(portMAX_DELAY);
+    second.lockWrite(portMAX_DELAY);
+    second.unlockWrite();
+    first.unlockRead();
+    first.lockWrite(portMAX_DELAY);
+    first.unlockWrite();
+    first.lockRead(portMAX_DELAY);
+    first.unlockRead();
+
+    // A lock that timed out is not held
+    std::atomic<bool> release(false);
+    std::thread holder([&] {
+      first.lockWrite(portMAX_DELAY);
+      while (!release.load()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      first.unlockWrite();
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    if (first.lockRead(pdMS_TO_TICKS(5))) {
+      _exit(1);
+    }
+
+    release = true;
+    holder.join();
+
+    first.lockRead(portMAX_DELAY);
+    first.unlockRead();
+  }));
+}
+#endif
+
+template<typename Mutex>
+static double _uncontendedReadNs()
+{
+  Mutex mutex;
+  const int iterations = 1'000'000;
+
+  auto begin = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    mutex.lockRead(portMAX_DELAY);
+    mutex.unlockRead();
+  }
+
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / iterations;
+}
+
+/// @brief Four threads that mostly read, one lock in 64 is a write, like the RF transmitter and keep-alive locks see
+template<typename Mutex>
+static double _mixedNsPerOp()
+{
+  Mutex mutex;
+  const int threadCount = 4;
+  const int iterations  = 200'000;
+
+  auto begin = std::chrono::steady_clock::now();
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < threadCount; t++) {
+    threads.emplace_back([&mutex] {
+      for (int i = 0; i < iterations; i++) {
+        if (i % 64 == 0) {
+          mutex.lockWrite(portMAX_DELAY);
+          mutex.unlockWrite();
+        } else {
+          mutex.lockRead(portMAX_DELAY);
+          mutex.unlockRead();
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / (threadCount * iterations);
+}
+
+void test_benchmark_against_two_semaphore_lock(void)
+{
+  char message[128];
+
+  snprintf(message, sizeof(message), "Uncontended read lock+unlock: %.1f ns before, %.1f ns now", _uncontendedReadNs<TwoSemaphoreMutex>(), _uncontendedReadNs<ReadWriteMutex>());
+  TEST_MESSAGE(message);
+
+  snprintf(message, sizeof(message), "4 threads, 1 write in 64: %.1f ns before, %.1f ns now per lock+unlock", _mixedNsPerOp<TwoSemaphoreMutex>(), _mixedNsPerOp<ReadWriteMutex>());
+  TEST_MESSAGE(message);
+
+  // The old lock only lets a writer in once the readers happen to all leave at once, which overlapping readers never do
+  TwoSemaphoreMutex before;
+  ReadWriteMutex now;
+  int64_t beforeUs = _writerWaitAgainstReaders(before, pdMS_TO_TICKS(500));
+  int64_t nowUs    = _writerWaitAgainstReaders(now, pdMS_TO_TICKS(500));
+
+  snprintf(message, sizeof(message), "Writer against 4 overlapping readers: %s before, waited %lld us now", beforeUs < 0 ? "timed out after 500 ms" : "got in", static_cast<long long>(nowUs));
+  TEST_MESSAGE(message);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_excludes_under_random_timeouts);
+  RUN_TEST(test_waiting_writer_holds_off_new_readers);
+  RUN_TEST(test_writers_do_not_starve_readers);
+#if OPENSHOCK_RWMUTEX_CHECK_REENTRY
+  RUN_TEST(test_reentry_panics);
+  RUN_TEST(test_reentry_check_has_no_false_positives);
+#endif
+  RUN_TEST(test_benchmark_against_two_semaphore_lock);
+
+  return UNITY_END();
+}
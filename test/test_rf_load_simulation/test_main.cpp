@@ -0,0 +1,677 @@
+#include <unity.h>
+
+#include "radio/RFCommandScheduler.h"
+#include "radio/rmt/MainEncoder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <queue>
+#include <vector>
+
+using namespace OpenShock;
+
+// Discrete-event simulation of the command path, from the gateway sending a ShockerCommandList to the hub putting it on air, in virtual time.
+// The RF task runs the real RFCommandScheduler and the real RMT encoders, one air time per RMT tick like RFTransmitter.
+// Everything around it is a scripted model of the firmware:
+//   - Gateway: Poisson message rate, one way latency with jitter, in order delivery, messages sent while the hub is offline are lost
+//   - GatewayClient: handles messages one after the other, each command goes through HandleCommand into the 64 slot RF queue, waiting at most 10 ms for a slot
+//   - Disconnects and WiFi flaps: the hub is offline for the scripted time, a flap adds reassociation, DHCP and the websocket handshake on top
+//   - EStopManager: a press is seen on the next 5 ms GPIO sample, clearing it is scripted as the time the release was accepted
+//   - OtaUpdateManager: the PartitionWriter erases the partition 64 KiB ahead of the download, no task runs from flash while a block erase is in progress
+// Keep-alive commands are left out, they only go to shockers that have been idle for longer than any scenario runs.
+
+const std::size_t RF_QUEUE_SIZE           = 64;     // RFTransmitter's queue
+const int64_t RF_QUEUE_SEND_TIMEOUT_US    = 10'000;  // SendCommand's xQueueSend timeout
+const int64_t RMT_TICK_US                 = 1;      // RFTRANSMITTER_TICKRATE_NS
+const int64_t ESTOP_SAMPLE_INTERVAL_US    = 5000;   // k_estopUpdateRate
+const int64_t WIFI_REJOIN_US              = 2'500'000;  // Reassociation, DHCP and the websocket handshake after a flap
+const uint32_t OTA_ERASE_BLOCK_KIB        = 64;     // PARTITION_WRITER_ERASE_BLOCK_SIZE
+const int64_t OTA_BLOCK_ERASE_US          = 150'000;  // Typical 64 KiB block erase of the flash chips in use
+const int64_t IDLE_ROUND_US               = 1000;   // Only a round with nothing to transmit, the real task would spin instead
+
+struct LinkOutage {
+  int64_t atMs;
+  int64_t downMs;
+};
+
+struct EStopPress {
+  int64_t atMs;
+  int64_t clearedAtMs;  // 0 keeps it active
+};
+
+struct OtaUpdate {
+  int64_t atMs;
+  uint32_t imageKiB;
+  uint32_t downloadKiBps;
+};
+
+struct Scenario {
+  uint32_t seed                 = 1;
+  int64_t durationMs            = 60'000;
+  uint16_t shockers             = 4;
+  double messagesPerSecond      = 2.0;
+  uint8_t commandsPerMessage    = 1;  // Picked from the shockers at random, a message never targets one shocker twice
+  uint16_t minDurationMs        = 300;
+  uint16_t maxDurationMs        = 1500;
+  int64_t latencyMs             = 40;
+  int64_t jitterMs              = 20;
+  std::vector<LinkOutage> disconnects;
+  std::vector<LinkOutage> wifiFlaps;
+  std::vector<EStopPress> estopPresses;
+  std::vector<OtaUpdate> otaUpdates;
+};
+
+struct Report {
+  uint32_t sent             = 0;  // Commands the gateway sent
+  uint32_t lostOffline      = 0;  // Sent or arriving while the hub was offline
+  uint32_t droppedQueueFull = 0;  // SendCommand timed out on the RF queue
+  uint32_t neverAired       = 0;  // Replaced, ended by the E-Stop or expired before their first transmission
+  uint32_t backlogged       = 0;  // Still waiting for the handler or in the RF queue when the run ended
+  uint32_t aired            = 0;
+  std::vector<int64_t> latenciesUs;     // Gateway send to the start of the first transmission
+  std::vector<int64_t> hubLatenciesUs;  // Arrival at the hub to the start of the first transmission
+  int64_t airTimeUs             = 0;
+  int64_t maxRoundUs            = 0;
+  int64_t flashStallUs          = 0;  // Time the RF task waited for a block erase
+  std::size_t maxQueueDepth     = 0;
+  int64_t maxEStopSilenceUs     = 0;  // E-Stop press to the end of the last transmission that wasn't a zero sequence
+  uint32_t airedWhileEStopped   = 0;  // Non zero transmissions in rounds that started after the E-Stop activated
+  int64_t durationUs            = 0;  // Until the RF task went idle, at least the scripted duration
+
+  bool operator==(const Report& other) const {
+    return sent == other.sent && lostOffline == other.lostOffline && droppedQueueFull == other.droppedQueueFull && neverAired == other.neverAired && backlogged == other.backlogged && aired == other.aired && latenciesUs == other.latenciesUs && hubLatenciesUs == other.hubLatenciesUs && airTimeUs == other.airTimeUs
+        && maxRoundUs == other.maxRoundUs && flashStallUs == other.flashStallUs && maxQueueDepth == other.maxQueueDepth && maxEStopSilenceUs == other.maxEStopSilenceUs && airedWhileEStopped == other.airedWhileEStopped;
+  }
+};
+
+/// @brief Events ordered by virtual time in microseconds, ties run in the order they were scheduled
+class EventQueue {
+public:
+  int64_t now() const { return m_now; }
+
+  void at(int64_t time, std::function<void()> fn) { m_events.push(Event {std::max(time, m_now), m_nextSequence++, std::move(fn)}); }
+
+  /// @brief Runs everything due up to the given time, then moves the clock there
+  void runUntil(int64_t time) {
+    while (!m_events.empty() && m_events.top().time <= time) {
+      Event event = m_events.top();
+      m_events.pop();
+
+      m_now = event.time;
+      event.fn();
+    }
+
+    m_now = std::max(m_now, time);
+  }
+private:
+  struct Event {
+    int64_t time;
+    uint64_t sequence;
+    std::function<void()> fn;
+
+    bool operator>(const Event& other) const { return time != other.time ? time > other.time : sequence > other.sequence; }
+  };
+
+  int64_t m_now           = 0;
+  uint64_t m_nextSequence = 0;
+  std::priority_queue<Event, std::vector<Event>, std::greater<Event>> m_events;
+};
+
+/// @brief xorshift32, the same seed always gives the same run
+class Random {
+public:
+  explicit Random(uint32_t seed) : m_state(seed != 0 ? seed : 1) { }
+
+  uint32_t next() {
+    m_state ^= m_state << 13;
+    m_state ^= m_state >> 17;
+    m_state ^= m_state << 5;
+    return m_state;
+  }
+  double uniform() { return (next() >> 8) * (1.0 / 16'777'216.0); }
+  int64_t range(int64_t min, int64_t max) { return min + static_cast<int64_t>(next() % static_cast<uint32_t>(max - min + 1)); }
+  int64_t exponentialUs(double meanUs) { return static_cast<int64_t>(-meanUs * std::log(1.0 - uniform())); }
+private:
+  uint32_t m_state;
+};
+
+class HubSimulation {
+public:
+  explicit HubSimulation(const Scenario& scenario) : m_scenario(scenario), m_random(scenario.seed) { }
+
+  Report run() {
+    int64_t end = m_scenario.durationMs * 1000;
+
+    _scheduleOutages();
+    _scheduleEStop();
+    _scheduleOta(end);
+    m_events.at(m_random.exponentialUs(1'000'000.0 / m_scenario.messagesPerSecond), [this, end] { _gatewaySend(end); });
+
+    m_events.runUntil(end);
+
+    // Let whatever is still pending finish, without new traffic
+    m_events.runUntil(end + 10'000'000);
+    for (auto& [shockerId, tracked] : m_live) {
+      if (!tracked.aired) {
+        m_report.neverAired++;
+      }
+    }
+
+    m_report.backlogged = m_handlerBacklog.size() + m_rfQueue.size();
+    m_report.durationUs = (m_scheduler.empty() && m_rfQueue.empty()) ? std::max(end, m_rfIdleAt) : m_events.now();
+    return m_report;
+  }
+private:
+  struct Pending {
+    ShockerModelType model;
+    uint16_t shockerId;
+    ShockerCommandType type;
+    uint8_t intensity;
+    uint16_t durationMs;
+    int64_t sentAt;
+    int64_t arrivedAt;
+  };
+  struct Queued {
+    std::unique_ptr<RFCommandScheduler::Command> command;
+    int64_t sentAt;
+    int64_t arrivedAt;
+  };
+  struct Tracked {
+    int64_t sentAt;
+    int64_t arrivedAt;
+    bool aired;
+  };
+
+  bool _offline(int64_t time) const {
+    for (const auto& [from, to] : m_offline) {
+      if (time >= from && time < to) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  int64_t _flashStallEnd(int64_t time) const {
+    for (const auto& [from, to] : m_flashStalls) {
+      if (time >= from && time < to) {
+        return to;
+      }
+    }
+    return time;
+  }
+
+  void _scheduleOutages() {
+    for (const auto& outage : m_scenario.disconnects) {
+      m_offline.emplace_back(outage.atMs * 1000, (outage.atMs + outage.downMs) * 1000);
+    }
+    for (const auto& flap : m_scenario.wifiFlaps) {
+      m_offline.emplace_back(flap.atMs * 1000, (flap.atMs + flap.downMs) * 1000 + WIFI_REJOIN_US);
+    }
+  }
+
+  void _scheduleEStop() {
+    for (const auto& press : m_scenario.estopPresses) {
+      int64_t pressedAt = press.atMs * 1000;
+      int64_t seenAt    = (pressedAt / ESTOP_SAMPLE_INTERVAL_US + 1) * ESTOP_SAMPLE_INTERVAL_US;
+
+      m_events.at(seenAt, [this, pressedAt] {
+        if (m_estopActive) return;
+        m_estopActive      = true;
+        m_estopPressedAt   = pressedAt;
+        m_estopActivatedAt = m_events.now();
+
+        m_report.maxEStopSilenceUs = std::max(m_report.maxEStopSilenceUs, m_estopActivatedAt - pressedAt);
+      });
+      if (press.clearedAtMs > 0) {
+        m_events.at(press.clearedAtMs * 1000, [this] { m_estopActive = false; });
+      }
+    }
+  }
+
+  void _scheduleOta(int64_t end) {
+    for (const auto& update : m_scenario.otaUpdates) {
+      // Every block is erased once the download reaches it
+      int64_t blockUs = static_cast<int64_t>(OTA_ERASE_BLOCK_KIB) * 1'000'000 / update.downloadKiBps;
+      for (uint32_t offset = 0; offset < update.imageKiB; offset += OTA_ERASE_BLOCK_KIB) {
+        int64_t start = update.atMs * 1000 + (offset / OTA_ERASE_BLOCK_KIB) * blockUs;
+        if (start >= end) break;
+        m_flashStalls.emplace_back(start, start + OTA_BLOCK_ERASE_US);
+      }
+    }
+  }
+
+  void _gatewaySend(int64_t end) {
+    int64_t now = m_events.now();
+    if (now >= end) return;
+
+    m_events.at(now + m_random.exponentialUs(1'000'000.0 / m_scenario.messagesPerSecond), [this, end] { _gatewaySend(end); });
+
+    // Pick distinct shockers for this message
+    std::vector<uint16_t> shockers(m_scenario.shockers);
+    for (uint16_t i = 0; i < m_scenario.shockers; i++) {
+      shockers[i] = 1000 + i;
+    }
+    uint8_t count = std::min<uint16_t>(m_scenario.commandsPerMessage, m_scenario.shockers);
+    for (uint8_t i = 0; i < count; i++) {
+      std::swap(shockers[i], shockers[i + m_random.next() % (m_scenario.shockers - i)]);
+    }
+
+    std::vector<Pending> message;
+    for (uint8_t i = 0; i < count; i++) {
+      message.push_back(Pending {
+        .model      = (shockers[i] % 3 == 0) ? ShockerModelType::Petrainer : ShockerModelType::CaiXianlin,
+        .shockerId  = shockers[i],
+        .type       = (m_random.next() % 2 == 0) ? ShockerCommandType::Vibrate : ShockerCommandType::Shock,
+        .intensity  = static_cast<uint8_t>(m_random.range(1, 100)),
+        .durationMs = static_cast<uint16_t>(m_random.range(m_scenario.minDurationMs, m_scenario.maxDurationMs)),
+        .sentAt     = now,
+        .arrivedAt  = 0,
+      });
+    }
+    m_report.sent += count;
+
+    if (_offline(now)) {
+      m_report.lostOffline += count;
+      return;
+    }
+
+    // The websocket keeps messages in order
+    int64_t arrival = now + (m_scenario.latencyMs + m_random.range(0, m_scenario.jitterMs)) * 1000;
+    arrival         = std::max(arrival, m_lastArrival);
+    m_lastArrival   = arrival;
+
+    m_events.at(arrival, [this, message = std::move(message)]() mutable {
+      if (_offline(m_events.now())) {
+        m_report.lostOffline += message.size();
+        return;
+      }
+
+      for (auto& pending : message) {
+        pending.arrivedAt = m_events.now();
+        m_handlerBacklog.push_back(pending);
+      }
+      _pumpHandler();
+    });
+  }
+
+  /// @brief The GatewayClient task, handing commands to the RF queue in order until it has to wait for a slot
+  void _pumpHandler() {
+    while (!m_handlerBacklog.empty()) {
+      // Flash is unavailable to this task as well
+      int64_t stallEnd = _flashStallEnd(m_events.now());
+      if (stallEnd != m_events.now()) {
+        if (!m_handlerStalled) {
+          m_handlerStalled = true;
+          m_events.at(stallEnd, [this] {
+            m_handlerStalled = false;
+            _pumpHandler();
+          });
+        }
+        return;
+      }
+
+      if (m_rfQueue.size() >= RF_QUEUE_SIZE) {
+        if (m_handlerWaitingSince < 0) {
+          m_handlerWaitingSince = m_events.now();
+          uint64_t waiter       = ++m_handlerWaiter;
+          m_events.at(m_events.now() + RF_QUEUE_SEND_TIMEOUT_US, [this, waiter] {
+            if (waiter != m_handlerWaiter || m_handlerWaitingSince < 0) return;
+
+            // xQueueSend timed out, the command is dropped and the next one tried
+            m_report.droppedQueueFull++;
+            m_handlerBacklog.pop_front();
+            m_handlerWaitingSince = -1;
+            _pumpHandler();
+          });
+        }
+        return;
+      }
+      m_handlerWaitingSince = -1;
+
+      const Pending& pending = m_handlerBacklog.front();
+
+      int64_t nowMs = m_events.now() / 1000;
+      auto command  = std::make_unique<RFCommandScheduler::Command>(RFCommandScheduler::Command {
+        .until        = nowMs + pending.durationMs,
+        .sequence     = Rmt::GetSequence(pending.model, pending.shockerId, pending.type, pending.intensity),
+        .zeroSequence = Rmt::GetZeroSequence(pending.model, pending.shockerId),
+        .shockerId    = pending.shockerId,
+        .overwrite    = true,
+      });
+      m_rfQueue.push_back(Queued {std::move(command), pending.sentAt, pending.arrivedAt});
+      m_report.maxQueueDepth = std::max(m_report.maxQueueDepth, m_rfQueue.size());
+      m_handlerBacklog.pop_front();
+
+      _wakeRfTask();
+    }
+  }
+
+  void _wakeRfTask() {
+    if (m_rfBusy || m_rfScheduled) return;
+
+    m_rfScheduled = true;
+    m_events.at(m_events.now(), [this] { _rfRound(); });
+  }
+
+  /// @brief One pass of RFTransmitter::TransmitTask's loop
+  void _rfRound() {
+    m_rfScheduled = false;
+    m_rfBusy      = true;
+
+    int64_t roundStart = m_events.now();
+
+    while (!m_rfQueue.empty()) {
+      Queued queued = std::move(m_rfQueue.front());
+      m_rfQueue.pop_front();
+
+      uint16_t shockerId = queued.command->shockerId;
+
+      if (!m_scheduler.add(std::move(queued.command))) {
+        m_report.neverAired++;
+        continue;
+      }
+
+      // Whatever was tracked for this shocker is either replaced or already done
+      auto it = m_live.find(shockerId);
+      if (it != m_live.end() && !it->second.aired) {
+        m_report.neverAired++;
+      }
+      m_live[shockerId] = Tracked {queued.sentAt, queued.arrivedAt, false};
+    }
+    // Slots freed up, the handler may continue
+    _pumpHandler();
+
+    if (m_estopActive) {
+      m_scheduler.endAll(m_estopActivatedAt / 1000);
+    }
+
+    bool transmitted = false;
+    m_scheduler.transmitRound([this] { return m_events.now() / 1000; }, [this, &transmitted, roundStart](const RFCommandScheduler::Command& command, bool stopping) {
+      const auto& sequence = stopping ? command.zeroSequence : command.sequence;
+
+      // No task runs while the flash is busy erasing
+      int64_t stallEnd = _flashStallEnd(m_events.now());
+      if (stallEnd != m_events.now()) {
+        m_report.flashStallUs += stallEnd - m_events.now();
+        m_events.runUntil(stallEnd);
+      }
+
+      int64_t start = m_events.now();
+      int64_t air   = 0;
+      for (const auto& item : sequence) {
+        air += (item.duration0 + item.duration1) * RMT_TICK_US;
+      }
+
+      if (!stopping) {
+        auto& tracked = m_live[command.shockerId];
+        if (!tracked.aired) {
+          tracked.aired = true;
+          m_report.aired++;
+          m_report.latenciesUs.push_back(start - tracked.sentAt);
+          m_report.hubLatenciesUs.push_back(start - tracked.arrivedAt);
+        }
+
+        if (m_estopActive) {
+          m_report.maxEStopSilenceUs = std::max(m_report.maxEStopSilenceUs, start + air - m_estopPressedAt);
+          if (roundStart > m_estopActivatedAt) {
+            m_report.airedWhileEStopped++;
+          }
+        }
+      }
+
+      // rmtWriteBlocking, everything else keeps running meanwhile
+      m_report.airTimeUs += air;
+      m_events.runUntil(start + air);
+      transmitted = true;
+    });
+
+    m_report.maxRoundUs = std::max(m_report.maxRoundUs, m_events.now() - roundStart);
+    m_rfBusy            = false;
+
+    // Blocks on the queue once there is nothing left to send
+    if (m_scheduler.empty() && m_rfQueue.empty()) {
+      m_rfIdleAt = m_events.now();
+      return;
+    }
+
+    m_rfScheduled = true;
+    m_events.at(m_events.now() + (transmitted ? 0 : IDLE_ROUND_US), [this] { _rfRound(); });
+  }
+
+  Scenario m_scenario;
+  Random m_random;
+  EventQueue m_events;
+  Report m_report;
+
+  std::vector<std::pair<int64_t, int64_t>> m_offline;
+  std::vector<std::pair<int64_t, int64_t>> m_flashStalls;
+
+  int64_t m_lastArrival = 0;
+
+  std::deque<Pending> m_handlerBacklog;
+  bool m_handlerStalled         = false;
+  int64_t m_handlerWaitingSince = -1;
+  uint64_t m_handlerWaiter      = 0;
+
+  std::deque<Queued> m_rfQueue;
+  RFCommandScheduler m_scheduler;
+  std::map<uint16_t, Tracked> m_live;  // Last command added to the scheduler per shocker
+  bool m_rfBusy      = false;
+  bool m_rfScheduled = false;
+  int64_t m_rfIdleAt = 0;
+
+  bool m_estopActive         = false;
+  int64_t m_estopPressedAt   = 0;
+  int64_t m_estopActivatedAt = 0;
+};
+
+static int64_t _percentile(std::vector<int64_t> values, double percentile)
+{
+  if (values.empty()) return 0;
+
+  std::sort(values.begin(), values.end());
+  std::size_t index = static_cast<std::size_t>(percentile * (values.size() - 1) + 0.5);
+  return values[index];
+}
+
+static void _printReport(const char* name, const Report& report)
+{
+  char message[256];
+
+  snprintf(message,
+           sizeof(message),
+           "%s: %u sent, %u lost offline, %u dropped at the RF queue, %u never aired, %u backlogged, %u aired (%.1f/s, %.0f%% air time)",
+           name,
+           report.sent,
+           report.lostOffline,
+           report.droppedQueueFull,
+           report.neverAired,
+           report.backlogged,
+           report.aired,
+           report.aired * 1'000'000.0 / report.durationUs,
+           report.airTimeUs * 100.0 / report.durationUs);
+  TEST_MESSAGE(message);
+
+  snprintf(message,
+           sizeof(message),
+           "%s: latency p50 %.1f ms, p99 %.1f ms, max %.1f ms (hub only p99 %.1f ms), longest round %.1f ms, queue depth %zu, flash stalls %.1f ms",
+           name,
+           _percentile(report.latenciesUs, 0.50) / 1000.0,
+           _percentile(report.latenciesUs, 0.99) / 1000.0,
+           _percentile(report.latenciesUs, 1.0) / 1000.0,
+           _percentile(report.hubLatenciesUs, 0.99) / 1000.0,
+           report.maxRoundUs / 1000.0,
+           report.maxQueueDepth,
+           report.flashStallUs / 1000.0);
+  TEST_MESSAGE(message);
+
+  if (report.maxEStopSilenceUs > 0) {
+    snprintf(message, sizeof(message), "%s: E-Stop press to RF silence %.1f ms", name, report.maxEStopSilenceUs / 1000.0);
+    TEST_MESSAGE(message);
+  }
+}
+
+static void _assertAccounted(const Report& report)
+{
+  TEST_ASSERT_EQUAL_UINT32(report.sent, report.lostOffline + report.droppedQueueFull + report.neverAired + report.backlogged + report.aired);
+  TEST_ASSERT_EQUAL_size_t(report.aired, report.latenciesUs.size());
+}
+
+void setUp(void) { }
+
+void tearDown(void) { }
+
+void test_same_seed_gives_the_same_run(void)
+{
+  Scenario scenario;
+  scenario.messagesPerSecond  = 10.0;
+  scenario.commandsPerMessage = 3;
+  scenario.shockers           = 6;
+  scenario.wifiFlaps          = {{20'000, 1'000}};
+  scenario.estopPresses       = {{40'000, 45'000}};
+
+  Report first  = HubSimulation(scenario).run();
+  Report second = HubSimulation(scenario).run();
+  TEST_ASSERT_TRUE(first == second);
+
+  scenario.seed = 2;
+  TEST_ASSERT_FALSE(first == HubSimulation(scenario).run());
+}
+
+void test_nominal_load_loses_nothing(void)
+{
+  Scenario scenario;
+
+  Report report = HubSimulation(scenario).run();
+  _assertAccounted(report);
+
+  TEST_ASSERT_TRUE(report.sent > 0);
+  TEST_ASSERT_EQUAL_UINT32(0, report.lostOffline);
+  TEST_ASSERT_EQUAL_UINT32(0, report.droppedQueueFull);
+
+  TEST_ASSERT_EQUAL_UINT32(0, report.backlogged);
+
+  // Waits for the round in progress to finish, then for the shockers ahead of it in the next one
+  TEST_ASSERT_TRUE(_percentile(report.hubLatenciesUs, 1.0) <= 2 * report.maxRoundUs);
+}
+
+void test_every_command_is_accounted_for(void)
+{
+  Scenario scenario;
+  scenario.durationMs         = 120'000;
+  scenario.shockers           = 12;
+  scenario.messagesPerSecond  = 25.0;
+  scenario.commandsPerMessage = 4;
+  scenario.disconnects        = {{10'000, 3'000}, {70'000, 500}};
+  scenario.wifiFlaps          = {{30'000, 2'000}};
+  scenario.estopPresses       = {{50'000, 56'000}};
+  scenario.otaUpdates         = {{80'000, 1'800, 100}};
+
+  Report report = HubSimulation(scenario).run();
+  _assertAccounted(report);
+
+  TEST_ASSERT_TRUE(report.lostOffline > 0);
+  TEST_ASSERT_TRUE(report.neverAired > 0);
+  TEST_ASSERT_TRUE(report.flashStallUs > 0);
+}
+
+void test_estop_silences_within_one_round(void)
+{
+  Scenario scenario;
+  scenario.shockers           = 16;
+  scenario.messagesPerSecond  = 20.0;
+  scenario.commandsPerMessage = 4;
+  scenario.minDurationMs      = 5'000;
+  scenario.maxDurationMs      = 10'000;
+  scenario.estopPresses       = {{30'000, 0}};
+
+  Report report = HubSimulation(scenario).run();
+  _assertAccounted(report);
+
+  // Seen on the next GPIO sample, then the round in progress finishes, the next only sends zero sequences
+  TEST_ASSERT_TRUE(report.maxEStopSilenceUs > 0);
+  TEST_ASSERT_TRUE(report.maxEStopSilenceUs <= ESTOP_SAMPLE_INTERVAL_US + report.maxRoundUs);
+  TEST_ASSERT_EQUAL_UINT32(0, report.airedWhileEStopped);
+}
+
+void test_ota_flash_erases_delay_commands(void)
+{
+  Scenario scenario;
+  scenario.messagesPerSecond = 5.0;
+
+  Report before = HubSimulation(scenario).run();
+
+  scenario.otaUpdates = {{0, 1'800, 100}};
+  Report during       = HubSimulation(scenario).run();
+  _assertAccounted(during);
+
+  TEST_ASSERT_TRUE(during.flashStallUs > 0);
+  TEST_ASSERT_TRUE(_percentile(during.hubLatenciesUs, 0.99) > _percentile(before.hubLatenciesUs, 0.99));
+}
+
+void test_report(void)
+{
+  Scenario nominal;
+  _printReport("nominal", HubSimulation(nominal).run());
+
+  for (uint16_t shockers : {1, 4, 16, 32}) {
+    Scenario busy;
+    busy.shockers           = shockers;
+    busy.messagesPerSecond  = 20.0;
+    busy.commandsPerMessage = std::min<uint16_t>(shockers, 4);
+    busy.minDurationMs      = 1'000;
+    busy.maxDurationMs      = 5'000;
+
+    char name[32];
+    snprintf(name, sizeof(name), "%u shockers, 20 msg/s", shockers);
+    _printReport(name, HubSimulation(busy).run());
+  }
+
+  Scenario overload;
+  overload.shockers           = 32;
+  overload.messagesPerSecond  = 200.0;
+  overload.commandsPerMessage = 8;
+  _printReport("overload 200 msg/s x 8", HubSimulation(overload).run());
+
+  Scenario flaky;
+  flaky.messagesPerSecond = 10.0;
+  flaky.latencyMs         = 150;
+  flaky.jitterMs          = 250;
+  flaky.disconnects       = {{10'000, 3'000}, {40'000, 1'000}};
+  flaky.wifiFlaps         = {{25'000, 1'500}};
+  _printReport("flaky network", HubSimulation(flaky).run());
+
+  Scenario estop;
+  estop.shockers           = 16;
+  estop.messagesPerSecond  = 20.0;
+  estop.commandsPerMessage = 4;
+  estop.minDurationMs      = 5'000;
+  estop.maxDurationMs      = 10'000;
+  estop.estopPresses       = {{30'000, 40'000}};
+  _printReport("E-Stop", HubSimulation(estop).run());
+
+  Scenario ota;
+  ota.messagesPerSecond = 5.0;
+  ota.otaUpdates        = {{5'000, 1'800, 100}};
+  _printReport("OTA at 100 KiB/s", HubSimulation(ota).run());
+}
+
+int main()
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_same_seed_gives_the_same_run);
+  RUN_TEST(test_nominal_load_loses_nothing);
+  RUN_TEST(test_every_command_is_accounted_for);
+  RUN_TEST(test_estop_silences_within_one_round);
+  RUN_TEST(test_ota_flash_erases_delay_commands);
+  RUN_TEST(test_report);
+
+  return UNITY_END();
+}
@@ -0,0 +1,189 @@
+#include <unity.h>
+
+#include "FirmwareVersion.h"
+#include "SemVer.h"
+
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+
+using namespace OpenShock;
+using namespace std::string_view_literals;
+
+constexpr SemVer _parse(std::string_view str)
+{
+  SemVer version;
+  TryParseSemVer(str, version);
+  return version;
+}
+
+constexpr bool _parses(std::string_view str)
+{
+  SemVer version;
+  return TryParseSemVer(str, version);
+}
+
+constexpr bool _roundTrips(std::string_view str)
+{
+  SemVer version;
+  if (!TryParseSemVer(str, version)) {
+    return false;
+  }
+
+  auto formatted = version.toString();
+  return std::string_view(formatted.data()) == str;
+}
+
+constexpr bool _highest(std::string_view list, std::string_view expected)
+{
+  SemVer version;
+  return TryParseHighestSemVer(list, version) && version == _parse(expected);
+}
+
+// Everything below is checked by the compiler, the firmware relies on it when it parses OPENSHOCK_FW_VERSION at compile time
+
+static_assert(_parse("1.2.3").major == 1 && _parse("1.2.3").minor == 2 && _parse("1.2.3").patch == 3);
+static_assert(_parse("1.2.3-rc.1+build.5").getPrerelease() == "rc.1"sv);
+static_assert(_parse("1.2.3-rc.1+build.5").getBuild() == "build.5"sv);
+static_assert(_parse("1.2.3+build-1.x").getBuild() == "build-1.x"sv);
+static_assert(_parse("1.2.3-a-b").getPrerelease() == "a-b"sv);
+static_assert(_parse("65535.0.0").major == 65535);
+
+static_assert(_roundTrips("0.0.0"));
+static_assert(_roundTrips("1.2.3-rc.1+build.5"));
+static_assert(_roundTrips("10.20.30-alpha.beta.1"));
+
+// The semver.org grammar rejects these
+static_assert(!_parses(""));
+static_assert(!_parses("1"));
+static_assert(!_parses("1.2"));
+static_assert(!_parses("1.2.3.4"));
+static_assert(!_parses("01.2.3"));
+static_assert(!_parses("1.02.3"));
+static_assert(!_parses("1.2.03"));
+static_assert(!_parses("65536.0.0"));
+static_assert(!_parses("v1.2.3"));
+static_assert(!_parses(" 1.2.3"));
+static_assert(!_parses("1.2.3-"));
+static_assert(!_parses("1.2.3+"));
+static_assert(!_parses("1.2.3-01"));
+static_assert(!_parses("1.2.3-rc..1"));
+static_assert(!_parses("1.2.3-rc_1"));
+static_assert(!_parses("1.2.3+build..1"));
+
+// Identifiers over capacity are rejected, not truncated
+static_assert(SemVer::MaxPrereleaseLength == 63 && SemVer::MaxBuildLength == 63);
+static_assert(_parses("1.2.3-aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"));
+static_assert(!_parses("1.2.3-aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"));
+static_assert(_parses("1.2.3+aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"));
+static_assert(!_parses("1.2.3+aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"));
+
+// The precedence example from semver.org
+static_assert(_parse("1.0.0-alpha") < _parse("1.0.0-alpha.1"));
+static_assert(_parse("1.0.0-alpha.1") < _parse("1.0.0-alpha.beta"));
+static_assert(_parse("1.0.0-alpha.beta") < _parse("1.0.0-beta"));
+static_assert(_parse("1.0.0-beta") < _parse("1.0.0-beta.2"));
+static_assert(_parse("1.0.0-beta.2") < _parse("1.0.0-beta.11"));
+static_assert(_parse("1.0.0-beta.11") < _parse("1.0.0-rc.1"));
+static_assert(_parse("1.0.0-rc.1") < _parse("1.0.0"));
+
+static_assert(_parse("1.9.0") < _parse("1.10.0"));
+static_assert(_parse("1.10.0") < _parse("2.0.0"));
+
+// Build metadata only breaks ties, so ordering agrees with equality
+static_assert(_parse("1.0.0+a") != _parse("1.0.0+b"));
+static_assert(_parse("1.0.0+a") < _parse("1.0.0+b"));
+static_assert(_parse("1.0.0-rc.1+z") < _parse("1.0.0+a"));
+
+// Comparisons against strings that do not parse are always false
+static_assert(_parse("1.2.3") == "1.2.3"sv);
+static_assert(!(_parse("1.2.3") == "1.2"sv) && !(_parse("1.2.3") != "1.2"sv));
+
+static_assert(_highest("1.0.0\n1.10.0\n1.9.0", "1.10.0"));
+static_assert(_highest("  1.2.3-rc.1\r\n\r\n1.2.3\r\nnot-a-version\n", "1.2.3"));
+static_assert(!_highest("\n\n", "0.0.0"));
+
+static_assert(FirmwareVersion == OPENSHOCK_FW_VERSION ""sv);
+
+void setUp(void) { }
+
+void tearDown(void) { }
+
+void test_parses_at_runtime(void)
+{
+  // The gateway and the CDN hand over versions at runtime, the same code must agree outside constant evaluation
+  char input[] = "4.5.6-beta.2+sha.abcdef";
+
+  SemVer version;
+  TEST_ASSERT_TRUE(TryParseSemVer(input, version));
+  TEST_ASSERT_EQUAL_UINT16(4, version.major);
+  TEST_ASSERT_EQUAL_UINT16(5, version.minor);
+  TEST_ASSERT_EQUAL_UINT16(6, version.patch);
+  TEST_ASSERT_EQUAL_STRING("beta.2", version.prerelease);
+  TEST_ASSERT_EQUAL_STRING("sha.abcdef", version.build);
+  TEST_ASSERT_EQUAL_STRING(input, version.toString().data());
+  TEST_ASSERT_TRUE(version.isValid());
+
+  input[0] = 'x';
+  TEST_ASSERT_FALSE(TryParseSemVer(input, version));
+}
+
+void test_precedence_is_a_total_order(void)
+{
+  const char* const ordered[] = {
+    "0.9.9",
+    "1.0.0-0",
+    "1.0.0-2",
+    "1.0.0-10",
+    "1.0.0-alpha",
+    "1.0.0-alpha.1",
+    "1.0.0-alpha.beta",
+    "1.0.0-beta",
+    "1.0.0-beta.2",
+    "1.0.0-beta.11",
+    "1.0.0-rc.1",
+    "1.0.0",
+    "1.0.0+build",
+    "1.0.1",
+    "1.1.0",
+    "2.0.0",
+  };
+  const std::size_t count = sizeof(ordered) / sizeof(ordered[0]);
+
+  for (std::size_t i = 0; i < count; i++) {
+    SemVer a;
+    TEST_ASSERT_TRUE_MESSAGE(TryParseSemVer(ordered[i], a), ordered[i]);
+
+    for (std::size_t j = 0; j < count; j++) {
+      SemVer b;
+      TryParseSemVer(ordered[j], b);
+
+      TEST_ASSERT_EQUAL_MESSAGE(i < j, a < b, ordered[i]);
+      TEST_ASSERT_EQUAL_MESSAGE(i == j, a == b, ordered[i]);
+      TEST_ASSERT_EQUAL_MESSAGE(i > j, a > b, ordered[i]);
+    }
+  }
+}
+
+void test_semver_is_trivially_copyable(void)
+{
+  // Versions are copied by value through the OTA request queue
+  static_assert(std::is_trivially_copyable_v<SemVer>);
+
+  SemVer version = _parse("1.2.3-rc.1");
+
+  SemVer copy;
+  std::memcpy(&copy, &version, sizeof(SemVer));
+  TEST_ASSERT_TRUE(copy == version);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_parses_at_runtime);
+  RUN_TEST(test_precedence_is_a_total_order);
+  RUN_TEST(test_semver_is_trivially_copyable);
+
+  return UNITY_END();
+}
@@ -0,0 +1,430 @@
+#include <unity.h>
+
+#include "util/StringUtils.h"
+
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std::string_view_literals;
+
+using Parts = std::vector<std::string_view>;
+
+// Counts every global new, so the tests can check that splitting never touches the heap
+static std::atomic<std::size_t> s_allocations {0};
+
+void* operator new(std::size_t size)
+{
+  s_allocations.fetch_add(1, std::memory_order_relaxed);
+
+  void* ptr = std::malloc(size == 0 ? 1 : size);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+  std::free(ptr);
+}
+
+/// @brief The vector returning splitters the ranges replaced, kept verbatim as the reference
+namespace Old {
+  static Parts StringSplit(const std::string_view view, char delimiter, std::size_t maxSplits = std::numeric_limits<std::size_t>::max())
+  {
+    if (view.empty()) {
+      return {};
+    }
+
+    Parts result = {};
+
+    std::size_t pos    = 0;
+    std::size_t splits = 0;
+    while (pos < view.size() && splits < maxSplits) {
+      std::size_t nextPos = view.find(delimiter, pos);
+      if (nextPos == std::string_view::npos) {
+        nextPos = view.size();
+      }
+
+      result.push_back(view.substr(pos, nextPos - pos));
+      pos = nextPos + 1;
+      ++splits;
+    }
+
+    if (pos < view.size()) {
+      result.push_back(view.substr(pos));
+    }
+
+    return result;
+  }
+
+  // Ignores maxSplits, the range version honours it
+  static Parts StringSplit(const std::string_view view, bool (*predicate)(char delimiter))
+  {
+    if (view.empty()) {
+      return {};
+    }
+
+    Parts result = {};
+
+    const char* start = nullptr;
+    for (const char* ptr = view.data(); ptr < view.data() + view.size(); ++ptr) {
+      if (predicate(*ptr)) {
+        if (start != nullptr) {
+          result.emplace_back(std::string_view(start, ptr - start));
+          start = nullptr;
+        }
+      } else if (start == nullptr) {
+        start = ptr;
+      }
+    }
+
+    if (start != nullptr) {
+      result.emplace_back(std::string_view(start, view.data() + view.size() - start));
+    }
+
+    return result;
+  }
+
+  static Parts StringSplitNewLines(const std::string_view view)
+  {
+    return StringSplit(view, [](char c) { return c == '\r' || c == '\n'; });
+  }
+
+  static Parts StringSplitWhiteSpace(const std::string_view view)
+  {
+    return StringSplit(view, [](char c) { return isspace(c) != 0; });
+  }
+}  // namespace Old
+
+template<typename Range>
+static Parts _collect(const Range& range)
+{
+  Parts parts;
+  for (std::string_view part : range) {
+    parts.push_back(part);
+  }
+
+  return parts;
+}
+
+/// @brief Checks the parts are the same views into the same buffer, not just equal text
+static bool _sameViews(const Parts& a, const Parts& b)
+{
+  if (a.size() != b.size()) {
+    return false;
+  }
+
+  for (std::size_t i = 0; i < a.size(); i++) {
+    if (a[i].data() != b[i].data() || a[i].size() != b[i].size()) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static bool _isDelimiter(char c)
+{
+  return c == ',' || c == ' ';
+}
+
+static std::string _randomInput(std::mt19937& rng)
+{
+  // Mostly delimiters so empty parts, runs and leading or trailing delimiters are common
+  const char alphabet[] = {'a', 'b', ',', ',', ' ', ' ', '\r', '\n', '\t'};
+
+  std::string input(rng() % 24, '\0');
+  for (char& c : input) {
+    c = alphabet[rng() % sizeof(alphabet)];
+  }
+
+  return input;
+}
+
+// The hashes.sha256.txt published next to each release, as written by sha256sum
+static const std::string_view RELEASE_HASHES =
+  "6f1d2e0c8b5a4d3e2f1a0b9c8d7e6f5a4b3c2d1e0f9a8b7c6d5e4f3a2b1c0d9e  ./app.bin\n"
+  "0a1b2c3d4e5f60718293a4b5c6d7e8f90a1b2c3d4e5f60718293a4b5c6d7e8f9  ./app.bin.gz\n"
+  "1b2c3d4e5f60718293a4b5c6d7e8f90a1b2c3d4e5f60718293a4b5c6d7e8f90a  ./app.patch\n"
+  "2c3d4e5f60718293a4b5c6d7e8f90a1b2c3d4e5f60718293a4b5c6d7e8f90a1b  ./bootloader.bin\n"
+  "3d4e5f60718293a4b5c6d7e8f90a1b2c3d4e5f60718293a4b5c6d7e8f90a1b2c  ./firmware.bin\n"
+  "4e5f60718293a4b5c6d7e8f90a1b2c3d4e5f60718293a4b5c6d7e8f90a1b2c3d  ./partitions.bin\n"
+  "5f60718293a4b5c6d7e8f90a1b2c3d4e5f60718293a4b5c6d7e8f90a1b2c3d4e  ./staticfs.bin\n"
+  "60718293a4b5c6d7e8f90a1b2c3d4e5f60718293a4b5c6d7e8f90a1b2c3d4e5f  ./staticfs.bin.gz\n"sv;
+
+// The partition hash cache kept in the config, one "label tag hash" line per partition
+static const std::string_view PARTITION_HASHES =
+  "app0 1.4.0 6f1d2e0c8b5a4d3e2f1a0b9c8d7e6f5a4b3c2d1e0f9a8b7c6d5e4f3a2b1c0d9e\n"
+  "app1 1.3.2 0a1b2c3d4e5f60718293a4b5c6d7e8f90a1b2c3d4e5f60718293a4b5c6d7e8f9\n"
+  "static0 1.4.0 5f60718293a4b5c6d7e8f90a1b2c3d4e5f60718293a4b5c6d7e8f90a1b2c3d4e\n"sv;
+
+static const std::string_view SERIAL_COMMAND = "rftransmit {\"model\":\"caixianlin\",\"id\":12345,\"type\":\"vibrate\",\"intensity\":30,\"durationMs\":500}"sv;
+
+/// @brief Parses the release manifest the way OtaUpdateManager used to, returns the number of valid entries
+static std::size_t _parseHashesOld(std::string_view data)
+{
+  std::size_t entries = 0;
+  for (std::string_view line : Old::StringSplitNewLines(data)) {
+    Parts parts = Old::StringSplitWhiteSpace(line);
+    if (parts.size() != 2 || parts[0].size() != 64) {
+      return 0;
+    }
+    ++entries;
+  }
+
+  return entries;
+}
+
+/// @brief Parses the release manifest the way OtaUpdateManager does now
+static std::size_t _parseHashesNew(std::string_view data)
+{
+  std::size_t entries = 0;
+  for (std::string_view line : OpenShock::StringSplitNewLines(data)) {
+    std::string_view parts[2];
+    if (OpenShock::StringSplitInto(OpenShock::StringSplitWhiteSpace(line), parts) != 2 || parts[0].size() != 64) {
+      return 0;
+    }
+    ++entries;
+  }
+
+  return entries;
+}
+
+/// @brief Looks up a partition the way Config::GetPartitionHash used to, returns its tag
+static std::string_view _findPartitionOld(std::string_view data, std::string_view label)
+{
+  for (std::string_view line : Old::StringSplitNewLines(data)) {
+    Parts parts = Old::StringSplitWhiteSpace(line);
+    if (parts.size() == 3 && parts[0] == label) {
+      return parts[1];
+    }
+  }
+
+  return {};
+}
+
+static std::string_view _findPartitionNew(std::string_view data, std::string_view label)
+{
+  for (std::string_view line : OpenShock::StringSplitNewLines(data)) {
+    std::string_view parts[3];
+    if (OpenShock::StringSplitInto(OpenShock::StringSplitWhiteSpace(line), parts) == 3 && parts[0] == label) {
+      return parts[1];
+    }
+  }
+
+  return {};
+}
+
+/// @brief Splits a command line into command and arguments the way SerialInputHandler used to
+static std::string_view _commandOld(std::string_view line)
+{
+  Parts parts = Old::StringSplit(line, ' ', 1);
+  return parts.size() > 1 ? parts[1] : std::string_view();
+}
+
+static std::string_view _commandNew(std::string_view line)
+{
+  std::string_view parts[2];
+  return OpenShock::StringSplitInto(OpenShock::StringSplit(line, ' ', 1), parts) > 1 ? parts[1] : std::string_view();
+}
+
+/// @brief Stops the compiler from dropping a result it can see is unused
+template<typename T>
+static void _keep(const T& value)
+{
+  asm volatile("" : : "r"(&value) : "memory");
+}
+
+/// @brief Hides a value from the optimizer, so a parse of a constant input cannot be folded away
+template<typename T>
+static T _opaque(T value)
+{
+  asm volatile("" : "+m"(value));
+  return value;
+}
+
+/// @brief Times a parse, returns nanoseconds per call and the heap allocations of one call
+template<typename Parse>
+static double _benchmark(Parse parse, std::size_t iterations, std::size_t& allocations)
+{
+  std::size_t before = s_allocations.load();
+  _keep(parse());
+  allocations = s_allocations.load() - before;
+
+  auto begin = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < iterations; i++) {
+    _keep(parse());
+  }
+
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / iterations;
+}
+
+/// @brief Checks the old and new parse agree, then reports how long each takes and what it allocates
+template<typename OldParse, typename NewParse>
+static void _compare(const char* name, std::size_t iterations, OldParse oldParse, NewParse newParse)
+{
+  TEST_ASSERT_TRUE_MESSAGE(oldParse() == newParse(), name);
+
+  std::size_t oldAllocations = 0, newAllocations = 0;
+  double oldNs = _benchmark(oldParse, iterations, oldAllocations);
+  double newNs = _benchmark(newParse, iterations, newAllocations);
+
+  TEST_ASSERT_EQUAL_size_t_MESSAGE(0, newAllocations, name);
+
+  char message[160];
+  snprintf(message, sizeof(message), "%s: %.0f ns and %zu allocations with vectors, %.0f ns and none with ranges", name, oldNs, oldAllocations, newNs);
+  TEST_MESSAGE(message);
+}
+
+void setUp(void) { }
+
+void tearDown(void) { }
+
+void test_split_on_char(void)
+{
+  TEST_ASSERT_TRUE(_collect(OpenShock::StringSplit(""sv, ',')).empty());
+  TEST_ASSERT_TRUE(_collect(OpenShock::StringSplit("a,,b"sv, ',')) == Parts({"a", "", "b"}));
+  TEST_ASSERT_TRUE(_collect(OpenShock::StringSplit(",a"sv, ',')) == Parts({"", "a"}));
+
+  // A trailing delimiter does not add an empty part
+  TEST_ASSERT_TRUE(_collect(OpenShock::StringSplit("a,b,"sv, ',')) == Parts({"a", "b"}));
+  TEST_ASSERT_TRUE(_collect(OpenShock::StringSplit(","sv, ',')) == Parts({""}));
+
+  // The unsplit remainder is kept whole, delimiters included
+  TEST_ASSERT_TRUE(_collect(OpenShock::StringSplit("a,b,c"sv, ',', 1)) == Parts({"a", "b,c"}));
+  TEST_ASSERT_TRUE(_collect(OpenShock::StringSplit("a,,c"sv, ',', 1)) == Parts({"a", ",c"}));
+  TEST_ASSERT_TRUE(_collect(OpenShock::StringSplit("a,b"sv, ',', 0)) == Parts({"a,b"}));
+}
+
+void test_split_on_predicate(void)
+{
+  TEST_ASSERT_TRUE(_collect(OpenShock::StringSplitWhiteSpace(" \t\r\n"sv)).empty());
+  TEST_ASSERT_TRUE(_collect(OpenShock::StringSplitWhiteSpace("  a \t b\n"sv)) == Parts({"a", "b"}));
+  TEST_ASSERT_TRUE(_collect(OpenShock::StringSplitNewLines("a\r\n\r\nb c\n"sv)) == Parts({"a", "b c"}));
+
+  // The remainder loses its leading delimiters but keeps the rest
+  TEST_ASSERT_TRUE(_collect(OpenShock::StringSplitWhiteSpace(" a  b c "sv, 1)) == Parts({"a", "b c "}));
+  TEST_ASSERT_TRUE(_collect(OpenShock::StringSplitWhiteSpace(" a  "sv, 1)) == Parts({"a"}));
+  TEST_ASSERT_TRUE(_collect(OpenShock::StringSplitWhiteSpace("  a b"sv, 0)) == Parts({"a b"}));
+}
+
+void test_split_into_reports_every_part(void)
+{
+  std::string_view parts[2];
+
+  TEST_ASSERT_EQUAL_size_t(0, OpenShock::StringSplitInto(OpenShock::StringSplitWhiteSpace(""sv), parts));
+
+  TEST_ASSERT_EQUAL_size_t(4, OpenShock::StringSplitInto(OpenShock::StringSplitWhiteSpace("a b c d"sv), parts));
+  TEST_ASSERT_TRUE(parts[0] == "a"sv);
+  TEST_ASSERT_TRUE(parts[1] == "b"sv);
+
+  // A bare "$" leaves an empty line, which must not be indexed past its parts
+  parts[0] = "x"sv;
+  TEST_ASSERT_EQUAL_size_t(0, OpenShock::StringSplitInto(OpenShock::StringSplit(""sv, ' ', 1), parts));
+  TEST_ASSERT_TRUE(parts[0] == "x"sv);
+
+  // Usable at compile time too
+  static_assert([]() {
+    std::string_view fields[2];
+    return OpenShock::StringSplitInto(OpenShock::StringSplit("a,b,c"sv, ','), fields);
+  }() == 3);
+}
+
+void test_iterators_are_forward_iterators(void)
+{
+  auto range = OpenShock::StringSplit("a,b"sv, ',');
+
+  auto it = range.begin();
+  TEST_ASSERT_TRUE(it == range.begin());
+  TEST_ASSERT_TRUE(*it++ == "a"sv);
+  TEST_ASSERT_TRUE(it->size() == 1);
+  TEST_ASSERT_TRUE(*it == "b"sv);
+  TEST_ASSERT_TRUE(++it == range.end());
+
+  // Iterating twice yields the same parts
+  TEST_ASSERT_TRUE(_sameViews(_collect(range), _collect(range)));
+}
+
+void test_matches_old_splitter_on_random_inputs(void)
+{
+  std::mt19937 rng(1);
+
+  for (int i = 0; i < 200'000; i++) {
+    std::string input = _randomInput(rng);
+    std::string_view view(input);
+
+    std::size_t maxSplits = rng() % 4 == 0 ? std::numeric_limits<std::size_t>::max() : rng() % 5;
+
+    TEST_ASSERT_TRUE_MESSAGE(_sameViews(Old::StringSplit(view, ',', maxSplits), _collect(OpenShock::StringSplit(view, ',', maxSplits))), input.c_str());
+    TEST_ASSERT_TRUE_MESSAGE(_sameViews(Old::StringSplit(view, _isDelimiter), _collect(OpenShock::StringSplit(view, _isDelimiter))), input.c_str());
+    TEST_ASSERT_TRUE_MESSAGE(_sameViews(Old::StringSplitNewLines(view), _collect(OpenShock::StringSplitNewLines(view))), input.c_str());
+    TEST_ASSERT_TRUE_MESSAGE(_sameViews(Old::StringSplitWhiteSpace(view), _collect(OpenShock::StringSplitWhiteSpace(view))), input.c_str());
+
+    // The old predicate splitter ignored maxSplits, the first parts still agree and the last one runs to the end
+    Parts all     = Old::StringSplitWhiteSpace(view);
+    Parts limited = _collect(OpenShock::StringSplitWhiteSpace(view, maxSplits));
+    if (maxSplits >= all.size()) {
+      TEST_ASSERT_TRUE_MESSAGE(_sameViews(all, limited), input.c_str());
+    } else {
+      TEST_ASSERT_EQUAL_size_t_MESSAGE(maxSplits + 1, limited.size(), input.c_str());
+      TEST_ASSERT_TRUE_MESSAGE(_sameViews(Parts(all.begin(), all.begin() + maxSplits), Parts(limited.begin(), limited.end() - 1)), input.c_str());
+      TEST_ASSERT_TRUE_MESSAGE(limited.back().data() == all[maxSplits].data(), input.c_str());
+      TEST_ASSERT_TRUE_MESSAGE(limited.back().data() + limited.back().size() == view.data() + view.size(), input.c_str());
+    }
+  }
+}
+
+void test_splitting_never_allocates(void)
+{
+  std::size_t before = s_allocations.load();
+
+  TEST_ASSERT_EQUAL_size_t(8, _parseHashesNew(_opaque(RELEASE_HASHES)));
+  TEST_ASSERT_TRUE(_findPartitionNew(_opaque(PARTITION_HASHES), "static0"sv) == "1.4.0"sv);
+  TEST_ASSERT_TRUE(_commandNew(_opaque(SERIAL_COMMAND)).size() == SERIAL_COMMAND.size() - 11);
+
+  TEST_ASSERT_EQUAL_size_t(before, s_allocations.load());
+}
+
+void test_manifest_parse_benchmark(void)
+{
+  _compare(
+    "Release hash manifest", 100'000, []() { return _parseHashesOld(_opaque(RELEASE_HASHES)); }, []() { return _parseHashesNew(_opaque(RELEASE_HASHES)); }
+  );
+  _compare(
+    "Partition hash cache", 200'000, []() { return _findPartitionOld(_opaque(PARTITION_HASHES), "static0"sv); }, []() { return _findPartitionNew(_opaque(PARTITION_HASHES), "static0"sv); }
+  );
+  _compare(
+    "Serial command line", 1'000'000, []() { return _commandOld(_opaque(SERIAL_COMMAND)); }, []() { return _commandNew(_opaque(SERIAL_COMMAND)); }
+  );
+}
+
+int main()
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_split_on_char);
+  RUN_TEST(test_split_on_predicate);
+  RUN_TEST(test_split_into_reports_every_part);
+  RUN_TEST(test_iterators_are_forward_iterators);
+  RUN_TEST(test_matches_old_splitter_on_random_inputs);
+  RUN_TEST(test_splitting_never_allocates);
+  RUN_TEST(test_manifest_parse_benchmark);
+
+  return UNITY_END();
+}
@@ -0,0 +1,282 @@
+#include <unity.h>
+
+#include "wifi/WiFiNetworkTable.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace OpenShock;
+
+static WiFiNetwork _network(uint32_t id, int8_t rssi, uint8_t credentialsId = 0)
+{
+  char ssid[33] = {};
+  snprintf(ssid, sizeof(ssid), "net-%u", id);
+
+  // Same vendor prefix for every access point, like a block of flats served by one provider
+  uint8_t bssid[6] = {0x24, 0x0A, 0xC4, static_cast<uint8_t>(id >> 16), static_cast<uint8_t>(id >> 8), static_cast<uint8_t>(id)};
+
+  return WiFiNetwork(ssid, bssid, 1 + id % 13, rssi, WIFI_AUTH_WPA2_PSK, credentialsId);
+}
+
+static std::string _bssidKey(const WiFiNetwork& net)
+{
+  return std::string(reinterpret_cast<const char*>(net.bssid), sizeof(net.bssid));
+}
+
+/// @brief Checks the table against a plain list that is sorted from scratch, like the vector it replaced
+static void _assertMatches(const WiFiNetworkTable& table, std::vector<WiFiNetwork> reference)
+{
+  std::sort(reference.begin(), reference.end(), WiFiNetworkTable::IsMoreAttractive);
+
+  std::vector<WiFiNetwork> ranked = table.toVector();
+  TEST_ASSERT_EQUAL_size_t(reference.size(), table.size());
+  TEST_ASSERT_EQUAL_size_t(reference.size(), ranked.size());
+
+  for (std::size_t i = 0; i < reference.size(); i++) {
+    TEST_ASSERT_TRUE_MESSAGE(_bssidKey(ranked[i]) == _bssidKey(reference[i]), std::to_string(i).c_str());
+    TEST_ASSERT_EQUAL_INT(reference[i].rssi, ranked[i].rssi);
+    TEST_ASSERT_EQUAL_UINT16(reference[i].connectAttempts, ranked[i].connectAttempts);
+
+    const WiFiNetwork* found = table.find(reference[i].bssid);
+    TEST_ASSERT_NOT_NULL(found);
+    TEST_ASSERT_TRUE(_bssidKey(*found) == _bssidKey(reference[i]));
+  }
+}
+
+void setUp(void) { }
+
+void tearDown(void) { }
+
+void test_attractivity_is_a_strict_weak_ordering(void)
+{
+  std::mt19937 rng(1);
+
+  // Few distinct values so ties on every criterion are common
+  std::vector<WiFiNetwork> networks;
+  for (uint32_t i = 0; i < 40; i++) {
+    WiFiNetwork net      = _network(i, static_cast<int8_t>(-50 - rng() % 3), rng() % 2);
+    net.connectAttempts  = rng() % 3;
+    net.connectSuccesses = rng() % (net.connectAttempts + 1);
+    networks.push_back(net);
+  }
+
+  for (const auto& a : networks) {
+    TEST_ASSERT_FALSE(WiFiNetworkTable::IsMoreAttractive(a, a));
+
+    for (const auto& b : networks) {
+      if (&a != &b) {
+        // Distinct BSSIDs never compare equal
+        TEST_ASSERT_TRUE(WiFiNetworkTable::IsMoreAttractive(a, b) != WiFiNetworkTable::IsMoreAttractive(b, a));
+      }
+
+      for (const auto& c : networks) {
+        if (WiFiNetworkTable::IsMoreAttractive(a, b) && WiFiNetworkTable::IsMoreAttractive(b, c)) {
+          TEST_ASSERT_TRUE(WiFiNetworkTable::IsMoreAttractive(a, c));
+        }
+      }
+    }
+  }
+}
+
+void test_ranks_saved_then_reliable_then_strongest(void)
+{
+  WiFiNetworkTable table;
+
+  WiFiNetwork strongUnsaved     = _network(1, -30);
+  WiFiNetwork weakSaved         = _network(2, -80, 1);
+  WiFiNetwork strongSaved       = _network(3, -40, 1);
+  WiFiNetwork failingSaved      = _network(4, -20, 1);
+  failingSaved.connectAttempts  = 3;
+  failingSaved.connectSuccesses = 1;
+
+  for (const auto& net : {strongUnsaved, weakSaved, strongSaved, failingSaved}) {
+    TEST_ASSERT_TRUE(table.upsert(net));
+  }
+
+  std::vector<WiFiNetwork> ranked = table.toVector();
+  TEST_ASSERT_EQUAL_STRING("net-3", ranked[0].ssid);
+  TEST_ASSERT_EQUAL_STRING("net-2", ranked[1].ssid);
+  TEST_ASSERT_EQUAL_STRING("net-4", ranked[2].ssid);
+  TEST_ASSERT_EQUAL_STRING("net-1", ranked[3].ssid);
+
+  const WiFiNetwork* best = table.findBest([](const WiFiNetwork& net) { return net.rssi < -50; });
+  TEST_ASSERT_NOT_NULL(best);
+  TEST_ASSERT_EQUAL_STRING("net-2", best->ssid);
+
+  TEST_ASSERT_NULL(table.findBest([](const WiFiNetwork& net) { return net.channel == 0; }));
+}
+
+void test_upsert_keeps_connection_statistics(void)
+{
+  WiFiNetworkTable table;
+  WiFiNetwork net = _network(7, -60, 2);
+  TEST_ASSERT_TRUE(table.upsert(net));
+
+  TEST_ASSERT_TRUE(table.modify(net.bssid, [](WiFiNetwork& n) {
+    n.connectAttempts    = 5;
+    n.connectSuccesses   = 4;
+    n.lastConnectAttempt = 1234;
+    n.scansMissed        = 2;
+  }));
+
+  WiFiNetwork rescanned = _network(7, -45, 2);
+  strcpy(rescanned.ssid, "renamed");
+  TEST_ASSERT_FALSE(table.upsert(rescanned));
+  TEST_ASSERT_EQUAL_size_t(1, table.size());
+
+  const WiFiNetwork* found = table.find(net.bssid);
+  TEST_ASSERT_NOT_NULL(found);
+  TEST_ASSERT_EQUAL_STRING("renamed", found->ssid);
+  TEST_ASSERT_EQUAL_INT(-45, found->rssi);
+  TEST_ASSERT_EQUAL_UINT16(5, found->connectAttempts);
+  TEST_ASSERT_EQUAL_UINT16(4, found->connectSuccesses);
+  TEST_ASSERT_EQUAL_INT(1234, found->lastConnectAttempt);
+  TEST_ASSERT_EQUAL_UINT8(0, found->scansMissed);  // Seen again
+}
+
+void test_modify_cannot_change_the_key(void)
+{
+  WiFiNetworkTable table;
+  WiFiNetwork net = _network(9, -60);
+  table.upsert(net);
+
+  table.modify(net.bssid, [](WiFiNetwork& n) { memset(n.bssid, 0xAA, sizeof(n.bssid)); });
+
+  TEST_ASSERT_NOT_NULL(table.find(net.bssid));
+
+  uint8_t other[6] = {0xAA, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA};
+  TEST_ASSERT_NULL(table.find(other));
+  TEST_ASSERT_FALSE(table.modify(other, [](WiFiNetwork&) { }));
+  TEST_ASSERT_FALSE(table.remove(other));
+}
+
+void test_matches_reference_under_random_operations(void)
+{
+  std::mt19937 rng(2);
+  WiFiNetworkTable table;
+  std::vector<WiFiNetwork> reference;
+
+  auto referenceFind = [&reference](const uint8_t (&bssid)[6]) {
+    return std::find_if(reference.begin(), reference.end(), [&bssid](const WiFiNetwork& net) { return memcmp(net.bssid, bssid, 6) == 0; });
+  };
+
+  // Up to 300 access points grows the index several times, and removals exercise the backward-shift deletion
+  for (int step = 0; step < 20'000; step++) {
+    uint32_t id     = rng() % 300;
+    WiFiNetwork net = _network(id, static_cast<int8_t>(-30 - rng() % 60), rng() % 4 == 0 ? 1 + rng() % 3 : 0);
+    auto it         = referenceFind(net.bssid);
+
+    switch (rng() % 8) {
+      case 0:
+      case 1:
+      case 2: {
+        bool inserted = table.upsert(net);
+        TEST_ASSERT_EQUAL(it == reference.end(), inserted);
+
+        if (it == reference.end()) {
+          reference.push_back(net);
+        } else {
+          memcpy(it->ssid, net.ssid, sizeof(net.ssid));
+          it->channel       = net.channel;
+          it->rssi          = net.rssi;
+          it->authMode      = net.authMode;
+          it->credentialsID = net.credentialsID;
+          it->scansMissed   = 0;
+        }
+        break;
+      }
+      case 3:
+      case 4:
+        TEST_ASSERT_EQUAL(it != reference.end(), table.remove(net.bssid));
+        if (it != reference.end()) {
+          reference.erase(it);
+        }
+        break;
+      case 5: {
+        bool success = rng() % 2 == 0;
+        auto attempt = [success](WiFiNetwork& n) {
+          n.connectAttempts++;
+          n.connectSuccesses += success ? 1 : 0;
+        };
+
+        TEST_ASSERT_EQUAL(it != reference.end(), table.modify(net.bssid, attempt));
+        if (it != reference.end()) {
+          attempt(*it);
+        }
+        break;
+      }
+      case 6:
+        table.modifyAll([](WiFiNetwork& n) { n.scansMissed++; });
+        for (auto& n : reference) {
+          n.scansMissed++;
+        }
+
+        // Networks missing from three scans in a row are forgotten
+        table.removeIf([](const WiFiNetwork& n) { return n.scansMissed > 3; });
+        reference.erase(std::remove_if(reference.begin(), reference.end(), [](const WiFiNetwork& n) { return n.scansMissed > 3; }), reference.end());
+        break;
+      default:
+        TEST_ASSERT_EQUAL(it != reference.end(), table.find(net.bssid) != nullptr);
+        break;
+    }
+
+    if (step % 97 == 0) {
+      _assertMatches(table, reference);
+    }
+  }
+
+  _assertMatches(table, reference);
+}
+
+void test_scan_merge_benchmark(void)
+{
+  std::mt19937 rng(3);
+
+  for (uint32_t apCount : {60u, 500u}) {
+    WiFiNetworkTable table;
+
+    const int scans = 200;
+    auto begin      = std::chrono::steady_clock::now();
+
+    for (int scan = 0; scan < scans; scan++) {
+      table.modifyAll([](WiFiNetwork& n) { n.scansMissed++; });
+
+      for (uint32_t id = 0; id < apCount; id++) {
+        if (rng() % 10 != 0) {
+          table.upsert(_network(id, static_cast<int8_t>(-30 - rng() % 60), id % 20 == 0 ? 1 : 0));
+        }
+      }
+
+      table.removeIf([](const WiFiNetwork& n) { return n.scansMissed > 3; });
+
+      const WiFiNetwork* best = table.findBest([](const WiFiNetwork& n) { return n.credentialsID != 0; });
+      TEST_ASSERT_NOT_NULL(best);
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    char message[96];
+    snprintf(message, sizeof(message), "%u access points: %.1f us per scan merge", apCount, seconds * 1e6 / scans);
+    TEST_MESSAGE(message);
+  }
+}
+
+int main()
+{
+  UNITY_BEGIN();
+
+  RUN_TEST(test_attractivity_is_a_strict_weak_ordering);
+  RUN_TEST(test_ranks_saved_then_reliable_then_strongest);
+  RUN_TEST(test_upsert_keeps_connection_statistics);
+  RUN_TEST(test_modify_cannot_change_the_key);
+  RUN_TEST(test_matches_reference_under_random_operations);
+  RUN_TEST(test_scan_merge_benchmark);
+
+  return UNITY_END();
+}